@@ -0,0 +1,164 @@
+// Prevent any touchmove events that could cause scrolling
+document.addEventListener('touchmove', function(e) {
+  if (e.target.tagName !== 'INPUT' && e.target.tagName !== 'TEXTAREA') {
+    e.preventDefault();
+  }
+}, { passive: false });
+
+// Keep your existing JavaScript exactly the same
+let currentSongIndex = 0;
+let currentTrack = 0;
+
+const socket = new WebSocket(`ws://${window.location.hostname}/ws`);
+socket.binaryType = "arraybuffer";
+
+// Binary control frames: opcode, then a 16-bit request ID the device ACKs.
+const OP = { PREV: 0x01, NEXT: 0x02, PLAY: 0x03, STOP: 0x04, ACK: 0x80, PROGRESS: 0x82 };
+const STATUS = ["ok", "rejected", "unknown"];
+let nextRequestId = 1;
+const pending = new Map();   // request ID -> { op, sentAt }
+
+function command(op) {
+  if (socket.readyState !== WebSocket.OPEN) return;
+  const id = nextRequestId;
+  nextRequestId = (nextRequestId + 1) & 0xffff || 1;
+  pending.set(id, { op, sentAt: performance.now() });
+  socket.send(new Uint8Array([op, id & 0xff, id >> 8]));
+}
+
+// Song progress, pushed a couple of times a second and advanced locally
+// in between while the transport runs.
+let progress = null;
+let animating = false;
+
+function formatTime(ms) {
+  const s = Math.floor(ms / 1000);
+  return `${Math.floor(s / 60)}:${String(s % 60).padStart(2, "0")}`;
+}
+
+function drawProgress() {
+  const fill = document.getElementById("progressFill");
+  if (!progress || !progress.known) {
+    fill.style.width = "0";
+    document.getElementById("elapsed").innerText = "--:--";
+    document.getElementById("remaining").innerText = "";
+    return;
+  }
+  let elapsed = progress.elapsed;
+  if (progress.running) elapsed += performance.now() - progress.receivedAt;
+  if (progress.length) elapsed = Math.min(elapsed, progress.length);
+  fill.style.width = progress.length ? `${100 * elapsed / progress.length}%` : "0";
+  document.getElementById("elapsed").innerText = formatTime(elapsed);
+  document.getElementById("remaining").innerText =
+    progress.length ? `-${formatTime(progress.length - elapsed)}` : "";
+}
+
+function animateProgress() {
+  drawProgress();
+  animating = progress && progress.running;
+  if (animating) requestAnimationFrame(animateProgress);
+}
+
+function handleProgress(view) {
+  const flags = view.getUint8(1);
+  progress = {
+    known: (flags & 1) !== 0,
+    running: (flags & 2) !== 0,
+    elapsed: view.getUint32(2, true),
+    length: view.getUint32(6, true),
+    receivedAt: performance.now(),
+  };
+  if (!animating) animateProgress();
+}
+
+function handleBinary(buffer) {
+  const bytes = new Uint8Array(buffer);
+  if (bytes[0] === OP.PROGRESS && bytes.length >= 12) {
+    handleProgress(new DataView(buffer));
+    return;
+  }
+  if (bytes[0] !== OP.ACK || bytes.length < 4) return;
+  const id = bytes[1] | (bytes[2] << 8);
+  const request = pending.get(id);
+  if (!request) return;
+  pending.delete(id);
+  if (bytes[3] !== 0) {
+    console.warn(`Command ${request.op} ${STATUS[bytes[3]] || bytes[3]}`);
+  }
+}
+
+socket.onopen = () => {
+  console.log("WebSocket connected");
+};
+
+socket.onerror = (err) => {
+  console.error("WebSocket error", err);
+};
+
+socket.onmessage = function(event) {
+  if (event.data instanceof ArrayBuffer) {
+    handleBinary(event.data);
+    return;
+  }
+  if (!event.data.startsWith("{")) return;   // greeting and GET_FILE replies
+  try {
+    const data = JSON.parse(event.data);
+
+    const isPlaying = data.playbackStatus === "PLAYING";
+    
+    // While playing, Prev and Next drop and add cues.
+    document.getElementById("prevBtn").innerText = isPlaying ? "Uncue" : "Prev";
+    document.getElementById("nextBtn").innerText = isPlaying ? "Cue" : "Next";
+    
+    const playBtn = document.getElementById("playBtn");
+    playBtn.classList.toggle("playing", isPlaying);
+    
+    updateUI(data);
+  } catch (e) {
+    console.error("Error parsing JSON:", e);
+  }
+};
+
+function updateUI(data) {
+  document.getElementById("presetName").innerText = data.name || "No Setlist Selected";
+  document.getElementById("projectName").innerText = data.projectName || "N/A";
+  document.getElementById("songCount").innerText = data.songCount || "0";
+
+  const link = document.getElementById("linkHealth");
+  link.innerText = data.link || "unknown";
+  link.className = `link ${data.link || "unknown"}`;
+
+  currentSongIndex = data.currentTrack || 0;
+  document.getElementById("currentTrackDisplay").innerText = currentSongIndex + 1;
+  
+  const songElement = document.getElementById("currentSong");
+  const song = data.songs?.[currentSongIndex]?.songName || "No song available";
+  songElement.innerText = song;
+  
+  const cued = data.cued ?? -1;
+  const cuedName = data.songs?.[cued]?.songName;
+  document.getElementById("cuedSong").innerText = cuedName
+    ? `Next: ${cuedName}` + (data.cueDepth > 1 ? ` +${data.cueDepth - 1}` : "")
+    : "";
+  
+  songElement.className = "song-name";
+  if (data.playbackStatus === "PLAYING") {
+    songElement.classList.add("playing-text");
+  }
+}
+
+document.getElementById("prevBtn").addEventListener("click", () => {
+  command(OP.PREV);
+});
+
+document.getElementById("nextBtn").addEventListener("click", () => {
+  command(OP.NEXT);
+});
+
+document.getElementById("playBtn").addEventListener("click", () => {
+  command(OP.PLAY);
+});
+
+document.getElementById("stopBtn").addEventListener("click", () => {
+  command(OP.STOP);
+});
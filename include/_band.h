@@ -0,0 +1,156 @@
+#ifndef _BAND_H
+#define _BAND_H
+
+#include "config.h"
+#include <Adafruit_GFX.h>
+#include <Adafruit_SPITFT.h>
+
+// One recorded drawing call. Coordinates are screen-space; LINE keeps its end
+// point in w/h.
+struct DrawOp {
+    uint8_t type;
+    uint8_t sizeX, sizeY;      // CHAR: text size
+    uint8_t ch;                // CHAR: character, bit 7 of sizeX is the wrap flag
+    int16_t x, y;
+    union {
+        struct {
+            int16_t  w, h;
+            uint16_t color, bg;
+        };
+        const GFXfont *font;   // FONT
+    };
+};
+
+struct FrameStats {
+    uint16_t ops;
+    uint8_t  bands;
+    uint32_t recordUs;   // beginFrame() to endFrame()
+    uint32_t rasterUs;   // time spent rasterizing bands or the palette frame
+    uint32_t expandUs;   // palette mode: index -> RGB565 conversion
+    uint32_t pushUs;     // endFrame() until the last band left the bus
+};
+
+// Totals since the last BandRenderer::printReport().
+struct BandReport {
+    uint32_t frames;
+    uint32_t direct;          // frames, or parts, replayed straight to the display
+    uint32_t earlyFlushes;    // display list filled up mid-frame
+    uint32_t paletteMisses;   // colors drawn as index 0 because the palette was full
+    uint32_t maxOps;
+    uint32_t maxRasterUs;
+    uint32_t maxExpandUs;
+    uint32_t maxPushUs;
+    uint64_t totalPushUs;
+};
+
+// One strip of the band renderer. GFXcanvas16 uses malloc(), which may hand
+// out PSRAM; writePixels() can only send DMA-capable memory in place.
+class BandCanvas : public GFXcanvas16 {
+public:
+    BandCanvas(uint16_t w, uint16_t h) : GFXcanvas16(w, h) {}
+
+    // Moves the buffer to DMA-capable internal RAM. False if it doesn't fit.
+    bool begin();
+};
+
+// 8-bit canvas that takes RGB565 colors and stores palette indices, assigning
+// a new entry the first time a color is seen. The UI uses about ten colors, so
+// a whole 320x240 frame is 75 KB and fits in internal RAM.
+class PaletteCanvas : public GFXcanvas8 {
+public:
+    PaletteCanvas(uint16_t w, uint16_t h) : GFXcanvas8(w, h) {}
+
+    // Moves the buffer to internal RAM. False if it doesn't fit.
+    bool begin();
+
+    // Converts count indices (a multiple of 8 is fastest) to byte-swapped RGB565.
+    void expand(const uint8_t *src, uint16_t *dst, uint32_t count) const;
+    uint16_t colorCount() const { return _count; }
+    // Lookups that found the palette full, since the last call.
+    uint32_t takeMisses();
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+
+private:
+    uint8_t index(uint16_t color);
+
+    uint16_t _colors[256];       // RGB565 per index
+    uint16_t _swapped[256];      // same, in display byte order
+    uint16_t _count = 0;
+    uint32_t _misses = 0;
+    uint16_t _lastColor = 0;
+    uint8_t  _lastIndex = 0;
+    bool     _lastValid = false;
+};
+
+// Records a screen's drawing calls into a display list, then rasterizes it in
+// BAND_HEIGHT-row strips into two small canvases. While one strip is sent by
+// DMA the next is rasterized into the other, so full-screen redraws appear in
+// one pass without a full framebuffer. With RENDER_PALETTE8 the list is instead
+// rasterized once into a full-frame PaletteCanvas and expanded to RGB565 a few
+// lines at a time while streaming. A full-screen fill discards everything
+// recorded before it; a frame without one is replayed straight to the display.
+class BandRenderer : public Adafruit_GFX {
+public:
+    BandRenderer(Adafruit_SPITFT &display);
+
+    // Allocates the palette frame or strip canvases. False if there isn't
+    // enough memory, in which case frames are drawn directly.
+    bool begin();
+    bool ready() const { return _frame != NULL || _bands[1] != NULL; }
+    bool paletteMode() const { return _frame != NULL; }
+
+    void beginFrame();
+    void endFrame();
+    bool recording() const { return _recording; }
+    const FrameStats &lastFrame() const { return _stats; }
+
+    // Frame counts and worst-case timings since the last report, then resets
+    // them. Call from the task that draws, or with Render::Lock held.
+    BandReport takeReport();
+    void printReport();
+
+    // Recorded primitives. Everything else in Adafruit_GFX decomposes into these.
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void writePixel(int16_t x, int16_t y, uint16_t color) override;
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) override;
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    void reserve(uint16_t count);
+    void record(uint8_t type, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void flush();
+    void pushBands();
+    void pushPalette();
+    void replayTo(Adafruit_GFX &target, int16_t top, int16_t bottom);
+
+    Adafruit_SPITFT &_display;
+    BandCanvas *_bands[2];
+    PaletteCanvas *_frame;
+    uint16_t *_expandBuf[2];
+    DrawOp _ops[BAND_MAX_OPS];
+    uint16_t _opCount;
+    bool _covered;             // list starts with a full-screen fill
+    bool _recording;
+    bool _inChar;              // drawChar() pixels are covered by the CHAR op
+    const GFXfont *_recordedFont;
+    unsigned long _frameStartUs;
+    FrameStats _stats;
+    BandReport _report;
+};
+
+#endif // _BAND_H
@@ -0,0 +1,53 @@
+#ifndef _CUE_H
+#define _CUE_H
+
+#include "config.h"
+#include "_midi.h"
+
+// When a cued song starts (CUE_LAUNCH).
+enum class CueLaunch : uint8_t {
+    SONG_END,   // at the next locator, when the current song runs out
+    NEXT_BAR    // on the next bar line of the synced transport
+};
+
+struct CueStats {
+    uint32_t launched;
+    uint32_t avgLateUs;    // timer fire to SysEx handed to USB, against the target time
+    uint32_t maxLateUs;
+};
+
+// Songs queued to follow the current one while playing. Right (on the device
+// or the web page) cues the song after the last queued one, Left drops the
+// last cue, and with CUE_AUTO_ADVANCE the next track of the setlist is cued by
+// itself. Each entry's Play SysEx is built when it is queued.
+//
+// The MIDI task watches the head of the queue and, CUE_ARM_LEAD_MS before its
+// launch point, starts a one-shot esp_timer for the exact moment. The timer
+// callback only notifies the MIDI task, which wakes at once (it outranks
+// everything on its core) and sends the prebuilt bytes, so a launch doesn't
+// wait for the next poll or for loop().
+//
+// The queue is cleared on Stop and when another preset is loaded.
+class CueQueue {
+public:
+    // Creates the timer. Called on the MIDI task, which gets its notifications.
+    static void begin();
+
+    // Any task. False when the queue is full or there is no next song.
+    static bool cueNext();
+    static bool cancelLast();
+
+    // MIDI task, first thing in every pass.
+    static void update();
+
+    static CueStats stats();
+    static void printReport();
+
+private:
+    static void onTimer(void *arg);
+    static void launch();
+    static void clear();
+    static void publish();
+};
+
+#endif // _CUE_H
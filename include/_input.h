@@ -5,6 +5,9 @@
 #include "config.h"   // For pin definitions and global variables like BOX1_X, NUM_MENU_ITEMS, etc.
 #include "_midi.h"
 #include "_webserver.h"
+#include "_inputlog.h"
+#include "_log.h"
+#include "_state.h"
 
 class Input {
 public:
@@ -0,0 +1,81 @@
+#ifndef _INPUTLOG_H
+#define _INPUTLOG_H
+
+#include "config.h"
+
+class UI;
+
+enum class InputMode : uint8_t {
+    LIVE,       // read the hardware
+    RECORD,     // read the hardware and log every change to INPUT_LOG_PATH
+    REPLAY      // feed the log back on a virtual clock
+};
+
+enum class InputEventKind : uint8_t {
+    PIN,        // a = level
+    ANALOG,     // a = ADC value
+    TOUCH,      // a, b = screen x, y
+    RELEASE     // pen up
+};
+
+// One logged change. t is milliseconds since recording started.
+struct InputEvent {
+    uint32_t t;
+    uint8_t  kind;
+    uint8_t  pin;
+    int16_t  a, b;
+    uint16_t reserved;
+};
+
+// Input handlers timed by main's loop.
+enum class InputHandler : uint8_t {
+    TOUCH, ROTARY, START, STOP, LEFT, RIGHT, VOLUME, COUNT
+};
+
+struct InputHandlerStats {
+    uint32_t calls;
+    uint32_t totalUs;
+    uint32_t maxUs;
+};
+
+// Source of every input Input reads. In LIVE mode the calls go straight to the
+// hardware. RECORD also logs each change of a pin, the pot (beyond
+// INPUT_ADC_DEADBAND) or the touch point, buffered in RAM and written from
+// update(). REPLAY reads the log back instead of the hardware, and now() and
+// sleep() follow a virtual clock that advances INPUT_REPLAY_SPEED times
+// faster than real time, so a long session replays quickly through the same
+// Input/UI code. At the end of a replay the per-handler timings are printed
+// and the mode returns to LIVE.
+class InputLog {
+public:
+    static bool begin(InputMode mode);
+    static InputMode mode() { return _mode; }
+
+    // Replacements for millis(), delay(), digitalRead(), analogRead() and
+    // UI::getTouchCoordinates() in the input path.
+    static unsigned long now();
+    static void sleep(unsigned long ms);
+    static int  readPin(uint8_t pin);
+    static int  readAnalog(uint8_t pin);
+    static bool readTouch(UI &ui, int16_t &x, int16_t &y);
+
+    // Writes buffered events (RECORD) or detects the end of the log (REPLAY).
+    static void update();
+    // Closes the log and returns to LIVE.
+    static void stop();
+
+    static void profile(InputHandler handler, uint32_t us);
+    static const InputHandlerStats &stats(InputHandler handler) { return _stats[(int)handler]; }
+    static void printProfile();
+
+private:
+    static void log(InputEventKind kind, uint8_t pin, int16_t a, int16_t b);
+    static void flush();
+    static bool fetch();
+    static void apply();
+
+    static InputMode _mode;
+    static InputHandlerStats _stats[(int)InputHandler::COUNT];
+};
+
+#endif // _INPUTLOG_H
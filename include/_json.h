@@ -0,0 +1,44 @@
+#ifndef _JSON_H
+#define _JSON_H
+
+#include "config.h"
+
+// Writes JSON straight into a caller-supplied buffer, escaping strings on the
+// way. Commas between members and elements are added automatically. With no
+// buffer it only counts, so a payload can be measured first and then written
+// into a buffer of exactly length() bytes.
+//
+// Strings are escaped for JSON and checked as UTF-8: control characters become
+// \n, \u001f and the like, and bytes that aren't valid UTF-8 become U+FFFD, so
+// the result always parses and is a valid WebSocket text frame.
+class JsonWriter {
+public:
+    JsonWriter(char *buf = nullptr, size_t cap = 0);
+
+    // key is the member name inside an object and nullptr inside an array.
+    void beginObject(const char *key = nullptr);
+    void endObject();
+    void beginArray(const char *key = nullptr);
+    void endArray();
+    void string(const char *key, const char *value);
+    void number(const char *key, long value);
+    void boolean(const char *key, bool value);
+
+    // Bytes the document needs, also when it didn't fit the buffer.
+    size_t length() const { return _len; }
+    bool overflowed() const { return _len > _cap; }
+
+private:
+    void put(char c);
+    void put(const char *s, size_t n);
+    void member(const char *key);
+    void quoted(const char *s);
+
+    char *_buf;
+    size_t _cap;
+    size_t _len;
+    uint32_t _hasItems;   // bit per nesting level: something already written there
+    uint8_t _depth;
+};
+
+#endif // _JSON_H
@@ -0,0 +1,50 @@
+#ifndef _LINK_H
+#define _LINK_H
+
+#include "config.h"
+#include "_state.h"
+
+struct LinkStats {
+    uint32_t sent;
+    uint32_t replies;
+    uint32_t lost;         // no reply within LINK_PING_TIMEOUT_MS
+    uint32_t late;         // replies that came after their ping was given up
+    uint32_t rttUs;        // last round trip
+    uint32_t srttUs;       // smoothed round trip, 1/8 gain
+    uint32_t jitterUs;     // mean change between consecutive round trips, 1/16 gain
+    uint32_t maxRttUs;
+    uint8_t  lossPct;      // over the last LINK_LOSS_WINDOW pings
+    uint32_t intervalMs;   // current ping interval
+};
+
+// Keep-alive pings to Ableton and the health of the USB link. Each ping carries
+// a 14-bit sequence number that the reply echoes, so round trips are timed per
+// ping and a missing reply is told apart from a slow one. Replies without a
+// sequence number (older remote scripts) are matched to the oldest open ping.
+//
+// Pings go out every LINK_PING_INTERVAL_MS while playing, LINK_PING_IDLE_MS
+// while stopped with a good link, and LINK_PING_FAST_MS once a ping goes
+// unanswered or the link is otherwise degraded, so a stall is confirmed (or
+// cleared) within a second or two. The health goes to StateStore for the web
+// page, the home screen shows the live numbers, and LED_PING is on when good
+// and blinks when degraded.
+//
+// update() and onReply() run on the MIDI task; stats() may be called anywhere.
+class LinkMonitor {
+public:
+    static void update();
+    static void onReply(const uint8_t *data, unsigned length);
+
+    static LinkHealth health() { return _health; }
+    static LinkStats stats();
+    static const char *healthName(LinkHealth health);
+    static void printReport();
+
+private:
+    static void resolve(int slot, bool replied, uint32_t nowUs);
+    static void evaluate();
+
+    static LinkHealth _health;
+};
+
+#endif // _LINK_H
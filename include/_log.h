@@ -0,0 +1,62 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+#include "config.h"
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+// Deferred logging for code that can't afford to wait on Serial. A call
+// copies the format string pointer and its arguments (strings by value, up to
+// LOG_MAX_STRING bytes) into a ring buffer and returns; a low-priority task
+// formats and prints the records later. Calls above LOG_LEVEL become dead
+// code: still type-checked, then dropped by the optimizer. With LOG_BINARY
+// the task sends the raw records instead, and tools/log_decode.py formats
+// them using the strings in firmware.elf.
+//
+// Formats take printf conversions without '*' widths; the task adds the
+// timestamp, level and newline.
+class Log {
+public:
+    // Starts the drain task. Records logged before this are kept.
+    static void begin();
+
+    static void write(uint8_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // Prints everything still buffered from the calling task.
+    static void flush();
+
+    static uint32_t dropped() { return _dropped; }
+
+private:
+    static void task(void *param);
+    static bool drainOne();
+
+    static volatile uint32_t _dropped;
+};
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(...) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOGE(...) do { if (0) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(...) Log::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOGW(...) do { if (0) Log::write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(...) Log::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOGI(...) do { if (0) Log::write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(...) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOGD(...) do { if (0) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+#endif // _LOG_H
@@ -6,6 +6,8 @@
 #include <MIDI.h>
 #include "config.h"
 
+#define MIDI_PLAY_MAX_BYTES 8
+
 
 class Midi {
     public:
@@ -14,17 +16,29 @@ class Midi {
         // Callback for handling incoming SysEx messages.
         static void handleSysEx(byte *data, unsigned length);
         // Sends a SysEx message for the specified song index.
-        static void Play(byte songIndex);
+        static void Play(uint16_t songIndex);
+        // Writes Play's SysEx (up to MIDI_PLAY_MAX_BYTES) into out and returns its length.
+        static uint8_t buildPlay(uint16_t songIndex, byte *out);
+        // Queues a complete SysEx message, F0 and F7 included, on the control port.
+        static void sendSysEx(const byte *data, unsigned length);
         // Scan signals to notify Ableton
         static void Scan(); 
+        // Sends the hash of the cached project so Ableton can reply with a diff.
+        static void Sync(uint32_t projectHash);
+        // Asks Ableton to resend songs from..to (inclusive) of a sequenced scan.
+        static void Nak(uint16_t from, uint16_t to);
         // Sends a SysEx message to stop playback.
         static void Stop();  
-        // Sends a SysEx ping message.
-        static void Ping();
+        // Sends a SysEx ping carrying a 14-bit sequence number for the reply to echo.
+        static void Ping(uint16_t seq);
         // Reads Recieving Input
         static void read();
+        // Hands queued output to USB (see _midiport.h). MIDI task only.
+        static void flush();
         // Adjusts Volume in Ableton
         static void volume(byte vol);
+        // Sends Play/Stop/volume for StateStore changes. MIDI task only.
+        static void applyState();
     };
      
 #endif 
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef _MIDIPORT_H
+#define _MIDIPORT_H
+
+#include "config.h"
+#include <ESPNATIVEUSBMIDI.h>
+
+// Virtual ports of the USB MIDI interface, one cable each (see MIDI_USB_CABLES).
+enum class MidiPort : uint8_t {
+    CONTROL,       // Play, Stop, Scan, Sync SysEx and the scan replies
+    PERFORMANCE,   // volume and other channel messages
+    SYNC,          // pings and Ableton's clock and transport
+    COUNT
+};
+
+// Where queued output goes.
+enum class MidiTransport : uint8_t {
+    USB,
+    UART,          // DIN out, see _midiuart.h
+    COUNT
+};
+
+// State of the USB output as the scheduler sees it.
+enum class UsbLink : uint8_t {
+    UP,
+    DOWN,          // not mounted, or output stuck for MIDI_USB_STALL_MS
+    PROBING        // being tried again after MIDI_USB_RETRY_MS
+};
+
+struct MidiPortStats {
+    uint32_t sent[(int)MidiTransport::COUNT];   // messages handed to each transport
+    uint32_t dropped;      // messages that didn't fit the queue
+    uint16_t queued;       // bytes waiting now
+    uint16_t peakQueued;   // most bytes waiting since the last report
+};
+
+// An output the scheduler drains into. Methods run on the MIDI task.
+class MidiBackend {
+public:
+    // Ports with the same stream must not interleave messages.
+    virtual uint8_t stream(MidiPort port) = 0;
+    // Takes bytes of msg from offset done on and returns how many it took,
+    // 0 when it has no room this pass. Never blocks.
+    virtual uint16_t send(MidiPort port, const uint8_t *msg, uint16_t len, uint16_t done) = 0;
+    // The message in progress on port won't be finished.
+    virtual void abandon(MidiPort port) = 0;
+};
+
+// Byte stream of one port, in the shape the MIDI library's serial transport
+// expects: reads come from the port's cable, writes are staged for the
+// port's queue.
+class MidiPortStream {
+public:
+    MidiPortStream(MidiPort port) : _port(port) {}
+    void begin(unsigned long baud) { (void)baud; }
+    int available();
+    int read();
+    size_t write(uint8_t b);
+
+private:
+    MidiPort _port;
+};
+
+// Output scheduler for the MIDI ports. A sender brackets each message with
+// acquire()/release(); the bytes the MIDI library writes in between are
+// queued as a whole, or dropped as a whole when the port's queue is full, so
+// any task may send. flush() runs on the MIDI task and drains the queues into
+// each active transport, sync first, then control, then performance: when a
+// transport backs up, the port with the tightest timing goes first, and a
+// knob sweep can't hold up Play or a ping.
+//
+// Each transport keeps its own place in every queue and takes only what it
+// can without blocking, so a stuck USB endpoint doesn't hold up DIN or the
+// other way round. USB is active unless it is DOWN; the UART is active
+// always (MidiUartMode::MIRROR) or while USB isn't UP (FAILOVER). An
+// inactive transport keeps the place of an active one, so on taking over it
+// starts from the first message the other hadn't finished.
+//
+// With fewer cables than ports the last cable is shared. Ports on a shared
+// cable still have their own queues but never interleave mid-message, and
+// only the first of them reads the cable.
+class MidiPorts {
+public:
+    // Names the cables. Call before USB.begin().
+    static void begin();
+
+    // Bracket one outgoing message. Blocks while another task holds the port.
+    static void acquire(MidiPort port);
+    static void release(MidiPort port);
+
+    // MIDI task: hands queued bytes to the active transports until the
+    // queues are empty or the transports are full.
+    static void flush();
+
+    static UsbLink usbLink();
+    static bool active(MidiTransport transport);
+
+    static uint8_t cable(MidiPort port);
+    // True for the port that reads its cable.
+    static bool reader(MidiPort port);
+    static const char *name(MidiPort port);
+    static MidiPortStats stats(MidiPort port);
+    // Per-port traffic since the last report, then resets the peaks.
+    static void printReport();
+
+private:
+    friend class MidiPortStream;
+    static void stage(MidiPort port, uint8_t b);
+    static void route(uint32_t nowMs, bool usbProgressed);
+    static bool drain(MidiTransport transport, MidiPort port, bool &progressed);
+};
+
+extern ESPNATIVEUSBMIDI usbmidi;
+
+#endif // _MIDIPORT_H
@@ -0,0 +1,43 @@
+#ifndef _MIDIUART_H
+#define _MIDIUART_H
+
+#include "config.h"
+#include "_midiport.h"
+
+// What the DIN output does (MIDI_UART_MODE).
+enum class MidiUartMode : uint8_t {
+    OFF,
+    MIRROR,        // everything sent on USB is also sent on DIN
+    FAILOVER       // DIN takes over while USB is down (see UsbLink)
+};
+
+struct MidiUartStats {
+    uint32_t bytes;         // written to the UART
+    uint32_t statusSaved;   // status bytes left out under running status
+};
+
+// DIN MIDI out on Serial1 at 31250 baud, TX only, as a MidiPorts backend.
+// Channel messages use running status, refreshed every
+// MIDI_UART_STATUS_REFRESH_MS for receivers plugged in mid-stream. The wire
+// takes 320 us a byte, so the UART is never handed more than
+// MIDI_UART_AHEAD_US of line time: a long SysEx goes out in chunks over
+// several passes, and a ping queued behind it waits for at most that much
+// plus the SysEx's remainder instead of a full driver buffer.
+class UartMidi : public MidiBackend {
+public:
+    void begin();
+    uint8_t stream(MidiPort port) override { return 0; }
+    uint16_t send(MidiPort port, const uint8_t *msg, uint16_t len, uint16_t done) override;
+    void abandon(MidiPort port) override;
+    MidiUartStats stats() const { return _stats; }
+
+private:
+    uint8_t _runningStatus = 0;    // 0 = none in force
+    uint32_t _statusUs = 0;        // when it was last sent in full
+    uint32_t _lineFreeUs = 0;      // when the UART will have sent what it was given
+    MidiUartStats _stats = {};
+};
+
+extern UartMidi uartMidi;
+
+#endif // _MIDIUART_H
@@ -6,6 +6,8 @@
 
 extern Preferences preferences;
 
+#define PROJECT_CACHE_PATH "/cache/project.bin"
+
 // The PresetManager class handles saving and loading presets to NVS.
 class ps {
 public:
@@ -17,6 +19,18 @@ public:
 
   static void deletePresetFromDevice(int presetNumber);
 
+  // Write/read a named project as a binary setlist file on LittleFS.
+  static bool writeSetlist(const char *path, const char *name, const ProjectInfo &project);
+  static bool readSetlist(const char *path, char *name, ProjectInfo &project);
+
+  // Snapshot of the last scanned project, restored at boot.
+  static void saveCachedProject(const ProjectInfo &project);
+  static bool loadCachedProject(ProjectInfo &project);
+
+  // Preset slot to reload at boot (-1 for none).
+  static void rememberLastPreset(int presetNumber);
+  static int  getLastPresetSlot();
+
   static void initPreferences();
 };
 
@@ -0,0 +1,34 @@
+#ifndef _PROGRESS_H
+#define _PROGRESS_H
+
+#include "config.h"
+
+struct SongProgress {
+    bool     known;          // the playhead is inside the current song
+    bool     running;
+    uint32_t elapsedMs;      // since the song's locator
+    uint32_t lengthMs;       // to the next locator, 0 for the last song
+    uint32_t tempoCentiBpm;
+};
+
+// Where the synced playhead (see _transport.h) is within the current song.
+// A song runs from its locator to the next locator of the project, taken from
+// the scanned project when it is the preset's and from the preset otherwise
+// (see StateStore::song()). The bounds are looked up again only when the
+// track or preset changes, so
+// sample() is cheap enough to call every frame. Each caller keeps its own
+// tracker; a tracker is not shared between tasks.
+class ProgressTracker {
+public:
+    SongProgress sample(uint32_t nowUs);
+
+private:
+    void findBounds(int track);
+
+    uint32_t _presetVersion = 0;
+    int _track = -1;
+    uint32_t _startMs = 0;
+    uint32_t _endMs = 0;     // 0 = no later locator
+};
+
+#endif // _PROGRESS_H
@@ -0,0 +1,58 @@
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include "config.h"
+#include "freertos/semphr.h"
+
+class UI;
+
+// Parts of a screen that change without user input.
+enum RenderRegion : uint32_t {
+    REGION_PRESET = 1 << 0,   // home: song name, color and track counter
+    REGION_VOLUME = 1 << 1,   // home: volume bar
+    REGION_TASKS  = 1 << 2,   // device properties: task table, every TASK_SCREEN_REFRESH_MS
+    REGION_LINK   = 1 << 3,   // home: link health and ping round trip
+    REGION_PROGRESS = 1 << 4  // home: song progress bar, every PROGRESS_FRAME_MS
+};
+
+struct RenderStats {
+    uint32_t requests;    // request() calls
+    uint32_t coalesced;   // requests for a region that was already pending
+    uint32_t passes;      // render passes that drew something
+    uint32_t maxPassUs;
+};
+
+// Render task: the only place the home-screen regions are redrawn. Any task
+// may request() a region; the request ORs a bit into a pending mask and wakes
+// the task, so repeated requests for the same region collapse into one draw
+// and the caller never waits on the display. StateStore changes are turned
+// into regions the same way.
+//
+// Whole screens and menus are still drawn by the main loop. The loop holds
+// Render::Lock while it handles input, so only one task touches the TFT at a
+// time and a region is never drawn over a screen that is being replaced.
+class Render {
+public:
+    static void begin(UI &ui);
+    static void request(uint32_t regions);
+
+    static const RenderStats &stats() { return _stats; }
+    static void printReport();
+
+    // Exclusive use of the display, recursive. A no-op before begin().
+    class Lock {
+    public:
+        Lock();
+        ~Lock();
+        // True when the calling task holds the lock, or before begin().
+        static bool held();
+    };
+
+private:
+    static void task(void *param);
+
+    static UI *_ui;
+    static RenderStats _stats;
+};
+
+#endif // _RENDER_H
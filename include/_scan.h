@@ -0,0 +1,48 @@
+#ifndef _SCAN_H
+#define _SCAN_H
+
+#include "config.h"
+
+// Sequenced song list transfer (Scan request with protocol byte 0x01):
+//   remote -> device  0x03 count_lo count_hi              total song count
+//   remote -> device  0x04 seq_lo seq_hi <song fields>    one song, placed at seq
+//   remote -> device  0x00 0x7F                           end of a pass
+//   device -> remote  0x12 from_lo from_hi to_lo to_hi    resend seq from..to
+// Remote scripts that only know the legacy protocol send untagged 0x00 songs,
+// which are appended in arrival order and completed by the end marker.
+// Songs land at their seq, so until the scan completes currentProject may
+// have empty slots; abandon() closes them up.
+class ScanSession {
+public:
+    // Clears currentProject and the received map before a new scan.
+    static void begin();
+    // Gives up on an incomplete scan: moves the received songs together,
+    // each keeping its songIndex, and ignores songs that arrive later.
+    static void abandon();
+
+    // Called from the MIDI task as messages arrive.
+    static void onHeader(uint16_t total);
+    static bool onSong(int seq, const SongInfo &song);
+    static void onEnd();
+
+    // Blocks up to timeoutMs for the next progress event. True if one arrived.
+    static bool waitForProgress(uint32_t timeoutMs);
+
+    // Sends a NAK for each gap (up to SCAN_MAX_NAK_RANGES). Returns the count sent.
+    static int  requestMissing();
+
+    static bool complete();
+    static bool endSeen() { return _endSeen; }
+    static int  received() { return _received; }
+    static int  total() { return _total; }
+    // Without a header, only gaps below the highest seq seen count.
+    static int  missing();
+
+private:
+    static volatile bool _active;    // between begin() and abandon()
+    static volatile bool _endSeen;
+    static volatile int  _received;
+    static volatile int  _total;     // 0 while unknown (legacy remote)
+};
+
+#endif // _SCAN_H
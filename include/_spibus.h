@@ -0,0 +1,63 @@
+#ifndef _SPIBUS_H
+#define _SPIBUS_H
+
+#include "config.h"
+#include <SPI.h>
+#include <Adafruit_ILI9341.h>
+#include <XPT2046_Touchscreen.h>
+
+// Devices sharing the default SPI bus.
+enum class SpiDevice : uint8_t {
+    DISPLAY,
+    TOUCH,
+    COUNT
+};
+
+struct SpiDeviceStats {
+    uint32_t transactions;
+    uint32_t busyUs;       // time between acquire and release
+};
+
+// Arbiter for the display/touch bus. Each device's clock divider is computed
+// once and its frequency rounded to what the divider actually produces, so
+// SPIClass::beginTransaction() never has to recompute it when devices alternate.
+//
+// The arbiter has no lock of its own and never defers: Render::Lock is what
+// serializes the bus. The display and the touch panel are only used by the
+// task holding it (the render task or the main loop), which acquire() and
+// sampleTouch() assert, and a display burst never outlives its endWrite(),
+// which waits for queued DMA. So a touch sample can only start between
+// bursts; a touch during one stays latched by the XPT2046 IRQ until then.
+class SpiBus {
+public:
+    static void begin(Adafruit_SPITFT &display);
+
+    // Bracket a device's use of the bus. Calls may nest for the same device.
+    static void acquire(SpiDevice dev);
+    static void release(SpiDevice dev);
+
+    // Reads a touch point if the pen is down. Never called inside a display burst.
+    static bool sampleTouch(XPT2046_Touchscreen &ts, TS_Point &point);
+
+    static const SpiDeviceStats &stats(SpiDevice dev) { return _stats[(int)dev]; }
+    static uint32_t clockSwitches() { return _clockSwitches; }
+
+    // Bus utilization per device since the last report, then resets the window.
+    static void printReport();
+
+private:
+    static Adafruit_SPITFT *_display;
+    static SpiDeviceStats _stats[(int)SpiDevice::COUNT];
+    static uint32_t _clockDiv[(int)SpiDevice::COUNT];
+    static uint32_t _clockSwitches;
+};
+
+// ILI9341 whose write bursts go through the arbiter.
+class SharedBusTFT : public Adafruit_ILI9341 {
+public:
+    SharedBusTFT(int8_t cs, int8_t dc, int8_t rst) : Adafruit_ILI9341(cs, dc, rst) {}
+    void startWrite(void) override;
+    void endWrite(void) override;
+};
+
+#endif // _SPIBUS_H
@@ -0,0 +1,99 @@
+#ifndef _STATE_H
+#define _STATE_H
+
+#include "config.h"
+
+// USB link to Ableton as judged by the ping monitor (see _link.h).
+enum class LinkHealth : uint8_t {
+    UNKNOWN,    // no reply yet
+    GOOD,
+    DEGRADED,   // replies are slow, jittery or some go missing
+    LOST        // no reply for LINK_LOST_MS
+};
+
+// Playback state shared by the UI loop, the MIDI task and the web server.
+struct AppState {
+    uint32_t version;        // bumped by every change
+    int      track;          // index into loadedPreset.data.songs
+    int      songCount;      // loadedPreset.data.songCount as of presetLoaded()
+    bool     playing;
+    uint8_t  volume;         // 0..127
+    uint32_t presetVersion;  // bumped by presetLoaded()
+    LinkHealth link;
+    int      cued;           // next song in the cue queue, -1 if none
+    uint8_t  cueDepth;       // songs queued
+};
+
+// A song of loadedPreset as the MIDI task and the web server need it.
+struct SongRef {
+    uint16_t songIndex;      // for Play
+    uint32_t startMs;        // its locator
+    uint32_t endMs;          // the project's next locator, 0 if none
+};
+
+// Change bits, as returned by StateStore::changes().
+enum StateChange : uint32_t {
+    STATE_TRACK   = 1 << 0,
+    STATE_PLAYING = 1 << 1,   // also set by a repeated play() or stop()
+    STATE_VOLUME  = 1 << 2,
+    STATE_PRESET  = 1 << 3,
+    STATE_LINK    = 1 << 4,
+    STATE_TRANSPORT = 1 << 5, // playing changed by Ableton; not sent back
+    STATE_CUE     = 1 << 6
+};
+
+// Each subsystem collects the changes it hasn't handled yet.
+enum class StateSubscriber : uint8_t {
+    UI,      // redraws the home screen from the main loop
+    WEB,     // broadcasts to the phones from the main loop
+    MIDI,    // sends Play/Stop/volume from the MIDI task
+    COUNT
+};
+
+// Owner of AppState. Any task may call the setters; each commit is atomic
+// and ORs its change bits into every subscriber's pending mask. Subscribers
+// call changes() on their own task and react to the bits, so the network task
+// never draws and the UI never writes MIDI. Changes made between two calls
+// coalesce: a subscriber sees the latest state once.
+//
+// loadedPreset itself stays a global written only by the UI loop, which calls
+// presetLoaded() after replacing it. Replacing it frees its song storage, so
+// other tasks never index it: presetLoaded() resolves each song into a table
+// the store owns, and they read entries with song().
+class StateStore {
+public:
+    static AppState get();
+
+    // Next/previous song, wrapping. Refused while playing or with no songs.
+    static bool stepTrack(int delta);
+    // Starts the current song. Refused with no songs.
+    static bool play();
+    static void stop();
+    static void setVolume(uint8_t volume);
+    // Sets the track directly (screen tour fixtures).
+    static void setTrack(int track);
+    // UI loop only: publishes loadedPreset's song count and song table.
+    static void presetLoaded();
+    // Any task. Copies track's entry of the song table; false if out of range.
+    static bool song(int track, SongRef &ref);
+    static void setLink(LinkHealth link);
+    // Follows Ableton's Start/Stop. Commits STATE_TRANSPORT rather than
+    // STATE_PLAYING, so the MIDI task doesn't echo it.
+    static void setTransport(bool playing);
+    // Mirrors the cue queue (see _cue.h).
+    static void setCue(int cued, uint8_t depth);
+    // A cue has launched: track becomes current and playing, without a
+    // STATE_PLAYING the MIDI task would answer with another Play.
+    static void cueLaunched(int track);
+
+    // Change bits since this subscriber's last call.
+    static uint32_t changes(StateSubscriber subscriber);
+
+private:
+    static void commit(uint32_t bits);
+
+    static AppState _state;
+    static uint32_t _pending[(int)StateSubscriber::COUNT];
+};
+
+#endif // _STATE_H
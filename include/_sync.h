@@ -0,0 +1,53 @@
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#include "config.h"
+
+// Incremental project sync, tried before a full scan when a project is cached:
+//   device -> remote  0x13 h0..h4                   hash of the cached project
+//   remote -> device  0x05                          project unchanged
+//   remote -> device  0x06 op seq_lo seq_hi [...]   one diff op, applied in order
+//       op 0x01 add     <index> <name> 0x00 <time>  insert a song at seq; seq is its index
+//       op 0x02 remove                              remove the song at seq
+//       op 0x03 rename  <name>                      rename the song at seq
+//   remote -> device  0x07 h0..h4                   end of diff, remote's hash
+// Hashes are 32-bit FNV-1a sent 7 bits per byte, LSB first. They cover the
+// project name and a 0x00, then for each song its name, a 0x00, its locator
+// time in milliseconds as 4 little-endian bytes and its song index (the
+// seq a full scan would give it) as 2 little-endian bytes. A remote that does
+// not recognise the device's hash answers with an empty diff; the hash check
+// then fails and the device falls back to a full scan.
+enum class SyncResult { PENDING, UNCHANGED, UPDATED, MISMATCH };
+
+class ProjectSync {
+public:
+    static uint32_t hash(const ProjectInfo &project);
+
+    // Diff operations; false if seq is out of range or memory runs out.
+    // Adds and removes renumber the songIndex of the songs after seq.
+    static bool applyAdd(ProjectInfo &project, int seq, const SongInfo &song);
+    static bool applyRemove(ProjectInfo &project, int seq);
+    static bool applyRename(ProjectInfo &project, int seq, const char *name);
+
+    // Sends the hash of currentProject and resets the result to PENDING.
+    static void begin();
+
+    // Called from the MIDI task as sync messages arrive.
+    static void onUnchanged();
+    static void onDiff(const byte *data, unsigned length);
+    static void onDiffEnd(uint32_t remoteHash);
+
+    // Blocks until the remote answers or timeoutMs passes without a message.
+    static SyncResult wait(uint32_t timeoutMs);
+    static SyncResult result() { return _result; }
+
+    static void     encodeHash(uint32_t hash, byte out[5]);
+    static uint32_t decodeHash(const byte in[5]);
+
+private:
+    static volatile SyncResult _result;
+    static volatile bool       _opFailed;
+    static volatile bool       _active;   // Ignore late replies after a timeout
+};
+
+#endif // _SYNC_H
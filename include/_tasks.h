@@ -0,0 +1,69 @@
+#ifndef _TASKS_H
+#define _TASKS_H
+
+#include "config.h"
+
+// Tasks whose load is tracked. Core and priority of each are set in config.h.
+enum class AppTask : uint8_t {
+    MIDI,     // USB MIDI in/out and pings; preempts everything else on its core
+    RENDER,   // home-screen regions (see _render.h)
+    LOOP,     // Arduino loop(): input, menus, web server housekeeping
+    LOG,      // deferred log drain, idle priority
+    COUNT
+};
+
+// Independent measurement windows, so the serial report and the diagnostics
+// screen don't reset each other's numbers.
+enum class TaskView : uint8_t {
+    REPORT,
+    SCREEN,
+    COUNT
+};
+
+struct TaskStatus {
+    const char *name;
+    int8_t   core;         // -1 until the task has attached
+    uint8_t  priority;
+    uint32_t stackFree;    // bytes never touched since the task started
+    uint16_t cpuPermille;  // share of its core spent in passes
+    uint32_t passes;
+    uint32_t avgLateUs;    // how long after its due time a pass started
+    uint32_t maxLateUs;
+};
+
+// Per-task CPU use, stack headroom and scheduling latency. Each task reports on
+// itself: busy() after a pass of work and woke() with how late the pass began,
+// so no run-time stats support is needed from FreeRTOS. CPU shares are
+// relative to one core.
+class TaskMonitor {
+public:
+    // Called from the task itself, once it is running on its final core.
+    static void attach(AppTask task);
+    static void busy(AppTask task, uint32_t us);
+    static void woke(AppTask task, uint32_t lateUs);
+
+    // Fills one status per AppTask for the window since the view's last call.
+    static void collect(TaskView view, TaskStatus out[(int)AppTask::COUNT]);
+    static void printReport();
+};
+
+// Fixed-rate loop for a monitored task. wait() closes the current pass and
+// sleeps until the next period; the lateness of each wake is measured against
+// the earliest wake seen, which absorbs the phase of the tick interrupt.
+// A task notification ends the sleep early for an extra pass, and the
+// following wait() still sleeps to the same period boundary.
+class TaskPeriod {
+public:
+    TaskPeriod(AppTask task, uint32_t periodMs);
+    void wait();
+
+private:
+    AppTask _task;
+    TickType_t _lastWake;
+    TickType_t _periodTicks;
+    uint32_t _periodUs;
+    uint32_t _dueUs;
+    uint32_t _passStartUs;
+};
+
+#endif // _TASKS_H
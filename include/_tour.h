@@ -0,0 +1,43 @@
+#ifndef _TOUR_H
+#define _TOUR_H
+
+#include "config.h"
+#include "_ui.h"
+
+// Per-screen result of a tour. The hash covers the RGB565 frame drawn into an
+// off-screen canvas, so it is the same whichever path renders to the panel.
+struct TourResult {
+    ScreenState state;
+    uint32_t hash;         // FNV-1a over the captured frame
+    uint16_t ops;          // display list entries (0 when drawn directly)
+    uint32_t spiBytes;     // DMA payload sent to the panel
+    uint32_t spiTxns;      // DMA transactions
+    uint32_t busHolds;     // SpiBus display transactions
+    uint32_t pushUs;       // endFrame() until the last pixel left the bus
+    uint32_t totalUs;      // the whole screen change on the panel
+};
+
+// Screen regression tour (SCREEN_TOUR builds). Loads fixed fixture data, then
+// draws every ScreenState twice: once into a canvas standing in for the
+// panel, to hash and optionally dump it, and once to the real panel to
+// measure SPI cost. Output lines start with "TOUR" and "SHOT" so
+// tools/screen_tour.py can turn a serial log into PNGs and compare runs.
+// Preset names still come from NVS, so SELECT_SETLIST depends on the board.
+// The host suite in test/test_tour runs the same code against a model panel.
+class ScreenTour {
+public:
+    // Runs the whole tour, writing to out. Leaves the globals holding
+    // fixture data.
+    static void run(UI &ui, Print &out, bool dumpFrames);
+
+    static void loadFixtures();
+    // Draws one screen into frame, then to the panel.
+    static TourResult shoot(UI &ui, ScreenState state, GFXcanvas16 &frame);
+    static uint32_t hashFrame(const GFXcanvas16 &frame);
+
+private:
+    static void resetScreenState(UI &ui);
+    static void dumpFrame(Print &out, const char *name, const GFXcanvas16 &frame);
+};
+
+#endif // _TOUR_H
@@ -0,0 +1,51 @@
+#ifndef _TRANSPORT_H
+#define _TRANSPORT_H
+
+#include "config.h"
+
+struct TransportStats {
+    uint32_t clocks;
+    uint32_t relocks;      // times the estimate was thrown away and restarted
+    int32_t  maxErrorUs;   // worst clock arrival against the prediction, while locked
+};
+
+// Ableton's transport as seen through MIDI Clock (24 per quarter note),
+// Start, Continue, Stop and Song Position Pointer.
+//
+// Clocks are timestamped when the MIDI task reads them, which adds up to a
+// poll period of jitter, so tempo and phase come from a second-order PLL:
+// each clock's arrival is compared with the predicted one, the phase moves by
+// 1/2^TRANSPORT_PLL_PHASE_SHIFT of the error and the period by
+// 1/2^TRANSPORT_PLL_PERIOD_SHIFT. TRANSPORT_RELOCK_CLOCKS outliers in a row (a
+// tempo jump) restart the estimate from their mean interval. The playhead
+// advances by the smoothed period per clock and is extrapolated between them.
+//
+// Start, Continue and Stop set StateStore's playing flag without sending
+// anything back, so the screen and the phones follow Ableton.
+//
+// clock() takes the arrival time so it can be fed recorded or synthetic
+// streams; the MIDI handlers pass micros(). The message functions run on the
+// MIDI task; the getters may be called from any task.
+class Transport {
+public:
+    static void clock(uint32_t nowUs);
+    static void start();
+    static void resume();                      // Continue
+    static void stop();
+    static void songPosition(uint16_t sixteenths);
+
+    static bool running();
+    static bool locked();                      // tempo estimate has settled
+    static uint32_t tempoCentiBpm();           // 0 until clocks arrive
+    static uint32_t ticks();                   // clocks since song start
+    static uint32_t playheadMs(uint32_t nowUs);
+    // Time from nowUs until clock number tick is due, 0 if it has passed and
+    // UINT32_MAX while stopped or before the tempo is known.
+    static uint32_t usUntilTick(uint32_t tick, uint32_t nowUs);
+    static TransportStats stats();
+    static void printReport();
+    // Forgets all timing, as after boot.
+    static void reset();
+};
+
+#endif // _TRANSPORT_H
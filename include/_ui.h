@@ -8,6 +8,15 @@
 #include "_midi.h"
 #include "_preset.h"
 #include "_webserver.h"
+#include "_scan.h"
+#include "_sync.h"
+#include "_spibus.h"
+#include "_band.h"
+#include "_state.h"
+#include "_render.h"
+#include "_tasks.h"
+#include "_link.h"
+#include "_progress.h"
 
 // Define an enumeration for your screen states.
 enum class ScreenState {
@@ -52,7 +61,20 @@ public:
     ScreenState getPreviousScreenState() const;
     void restorePreviousScreenState();
     void updateScreen();
-
+    void presentFrame();
+    static const char *screenName(ScreenState state);
+
+    // Draws whole screens into target instead of the panel (NULL to stop).
+    void setCaptureTarget(Adafruit_GFX *target) { captureTarget = target; }
+    const FrameStats &lastFrameStats() const { return band.lastFrame(); }
+    // Full-screen frame totals since the last call. Takes Render::Lock.
+    void printFrameReport();
+
+    // Redraws RenderRegion bits on the current screen. Render task only.
+    void drawRegions(uint32_t regions);
+    void drawTaskTable();
+    void drawLinkStatus();
+    void drawSongProgress(bool full);
     void displayVolume();
     void drawHomeMenuBox();
     void updateHomeMenuSelection(int delta);
@@ -71,6 +93,8 @@ public:
     void drawPresetListItem(int index, bool highlighted);
     void drawSetlistName();
     void drawLoadedPreset();
+    void drawScanProgress();
+    void drawLoadingProgress(int step, int totalSteps, const char *label);
 
     void drawWiFiList();
     void drawWiFiListItem(int absoluteIndex, bool highlighted);
@@ -100,13 +124,25 @@ public:
     bool isTouch(int16_t x, int16_t y, int16_t areaX, int16_t areaY, int16_t width, int16_t height);
 
 private:
-    Adafruit_ILI9341 tft;  // Reference to the display.
+    SharedBusTFT tft;      // Display; write bursts go through SpiBus.
     XPT2046_Touchscreen ts;
+    BandRenderer band;     // Records full screens and sends them in strips.
+    Adafruit_GFX *gfx;     // Drawing target: band while recording, else tft.
+    Adafruit_GFX *captureTarget = NULL;
+    int frameDepth = 0;
     ScreenState currentState;  // Current screen state.
     ScreenState previousState;
 
     int currentHomeMenuSelection = 0;
 
+    // Home-screen progress bar as last drawn, so a frame only touches what moved.
+    ProgressTracker progress;
+    int progressFill = 0;
+    char progressLabel[16] = "";
+
+    void beginFrame();
+    void endFrame();
+
         // Basic UI drawing functions.
     void drawText(const char* text, int16_t x, int16_t y, uint16_t color = ILI9341_WHITE, uint8_t size = 2);
     void drawTextCenter(const String &text, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
@@ -4,7 +4,38 @@
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
 #include <LittleFS.h>
+#include "freertos/semphr.h"
 #include "_ui.h"
+#include "_log.h"
+#include "_json.h"
+#include "_state.h"
+#include "_link.h"
+#include "_progress.h"
+#include "_cue.h"
+
+// Binary WebSocket frames start with an opcode. Client requests carry a
+// little-endian u16 request ID after it, which the server returns in an ACK.
+enum WsOp : uint8_t {
+    WS_OP_PREV      = 0x01,
+    WS_OP_NEXT      = 0x02,
+    WS_OP_PLAY      = 0x03,
+    WS_OP_STOP      = 0x04,
+    WS_OP_ACK       = 0x80,   // server: op, id lo, id hi, WsStatus
+    WS_OP_FILE_DATA = 0x81,   // server: op, then GET_FILE bytes
+    WS_OP_PROGRESS  = 0x82    // server: op, flags, elapsed ms u32, length ms u32, centi-bpm u16
+};
+
+// WS_OP_PROGRESS flags.
+enum WsProgressFlag : uint8_t {
+    WS_PROGRESS_KNOWN   = 1 << 0,   // playhead is inside the current song
+    WS_PROGRESS_RUNNING = 1 << 1
+};
+
+enum WsStatus : uint8_t {
+    WS_STATUS_OK       = 0,
+    WS_STATUS_REJECTED = 1,   // not allowed now, e.g. prev/next while playing
+    WS_STATUS_UNKNOWN  = 2    // unknown opcode or malformed frame
+};
 
 class AsyncWebServerManager {
 private:
@@ -13,6 +44,36 @@ private:
     bool serverStarted;
     uint16_t port;            // Store the port number.
 
+    // A GET_FILE transfer in progress, pumped by update().
+    struct FileTransfer {
+        uint32_t clientId;    // 0 = free slot
+        File file;
+        String path;
+        uint32_t remaining;
+        uint32_t sent;
+    };
+    FileTransfer transfers[WEB_MAX_FILE_TRANSFERS];
+
+    // A connected client. A client whose send queue is WEB_SLOW_CLIENT_QUEUE
+    // deep is skipped by broadcasts and marked stale; update() sends it the
+    // latest snapshot once it drains, so missed updates coalesce into one.
+    struct WsClient {
+        uint32_t id;          // 0 = free slot
+        bool stale;
+    };
+    WsClient clients[WEB_MAX_CLIENTS];
+    char *snapshot;           // latest preset broadcast
+    size_t snapshotLen, snapshotCap;
+    char *scratch;            // the next one, kept if it differs
+    size_t scratchCap;
+    uint32_t coalesced;       // broadcasts skipped for slow clients
+    ProgressTracker progress;
+    uint8_t lastProgress[12]; // last WS_OP_PROGRESS frame sent
+    unsigned long lastProgressMs;
+
+    // The WebSocket callback and update() run on different tasks.
+    SemaphoreHandle_t lock;
+
     // Mount LittleFS and return true if successful.
     bool initFileSystem() {
         if (!LittleFS.begin()) {
@@ -29,94 +90,353 @@ private:
                             void *arg, uint8_t *data, size_t len) {
             if (type == WS_EVT_CONNECT) {
                 Serial.printf("WebSocket client connected, id: %u\n", client->id());
-                client->text("Welcome to the Async WebSocket Server");
-                if (selectedPresetSlot != -1) {  // If a preset is loaded
-                    String json = "{";
-                    json += "\"eventType\":\"INITIAL_STATE\",";
-                    json += "\"name\":\"" + String(loadedPreset.name) + "\",";
-                    json += "\"projectName\":\"" + String(loadedPreset.data.projectName) + "\",";
-                    json += "\"songCount\":" + String(loadedPreset.data.songCount) + ",";
-                    json += "\"currentTrack\":" + String(currentTrack) + ",";
-                    json += "\"playbackStatus\":\"" + String(isPlaying ? "PLAYING" : "STOPPED") + "\",";
-                    json += "\"songs\":[";
-                    for (int i = 0; i < loadedPreset.data.songCount; i++) {
-                        json += "{\"songName\":\"" + String(loadedPreset.data.songs[i].songName) + "\",";
-                        json += "\"songIndex\":" + String(loadedPreset.data.songs[i].songIndex) + "}";
-                        if (i < loadedPreset.data.songCount - 1) json += ",";
-                    }
-                    json += "]}";
-                    
-                    client->text(json);
+                if (!addClient(client->id())) {
+                    LOGW("Client table full, closing %u", client->id());
+                    client->close();
+                    return;
                 }
+                client->text("Welcome to the Async WebSocket Server");
+                // update() sends it the current snapshot.
             } else if (type == WS_EVT_DISCONNECT) {
                 Serial.printf("WebSocket client disconnected, id: %u\n", client->id());
+                removeClient(client->id());
             } else if (type == WS_EVT_DATA) {
-                String msg = "";
-                for (size_t i = 0; i < len; i++) {
-                    msg += (char)data[i];
+                AwsFrameInfo *info = (AwsFrameInfo *)arg;
+                // A text command always fits text[] below; say so rather than drop it.
+                if (info->opcode == WS_TEXT && info->index == 0 && info->len > WEB_MAX_TEXT_COMMAND) {
+                    LOGW("Text frame of %u bytes from %u is too long", (unsigned)info->len, client->id());
+                    client->text("Error: Command too long");
+                    return;
                 }
-                Serial.printf("WebSocket received: %s\n", msg.c_str());
-                if (msg == "prev" || msg == "next") {
-                    if (!isPlaying) {  // Only allow navigation when stopped
-                        if (msg == "prev") {
-                            if (currentTrack > 0) currentTrack--;
-                            else currentTrack = loadedPreset.data.songCount - 1;
-                        } 
-                        else {
-                            currentTrack = (currentTrack + 1) % loadedPreset.data.songCount;
-                        }
-                        notifyPresetUpdate();
+                // Commands are a few bytes; anything split across frames isn't one.
+                if (!info->final || info->index != 0 || info->len != len)
+                    return;
+                if (info->opcode == WS_BINARY) {
+                    if (len < 3) {
+                        LOGW("Short command frame from %u", client->id());
+                        return;
                     }
-                    // No response sent if playback is active
-                } else if (msg == "play") {
-                    isPlaying = true;
-                    Midi::Play(loadedPreset.data.songs[currentTrack].songIndex);
-                    notifyPresetUpdate(); // Sync state to all clients
-                    // ui->drawLoadedPreset(); // Update device display
-                } else if (msg == "stop") {
-                    isPlaying = false;
-                    Midi::Stop();
-                    notifyPresetUpdate(); // Sync state to all clients
-                    // ui->drawLoadedPreset(); // Update device display
-                }
-                // If the message starts with "GET_FILE:", read and return file content.
-                if (msg.startsWith("GET_FILE:")) {
-                    String filename = msg.substring(9); // Extract filename after "GET_FILE:"
-                    Serial.printf("Client requested file: %s\n", filename.c_str());
-                    if (!LittleFS.exists(filename)) {
-                        client->text("Error: File not found");
-                    } else {
-                        File file = LittleFS.open(filename, "r");
-                        if (!file) {
-                            client->text("Error: Unable to open file");
-                        } else {
-                            String fileContent = "";
-                            while (file.available()) {
-                                fileContent += char(file.read());
-                            }
-                            file.close();
-                            client->text(fileContent);
-                        }
-                    }
-                } else {
-                    // Echo back the received message.
-                    client->text(msg);
+                    uint8_t ack[4] = { WS_OP_ACK, data[1], data[2], runCommand(data[0]) };
+                    client->binary(ack, sizeof(ack));
+                    return;
                 }
+
+                // Text commands from older pages: same actions, no ACK.
+                char text[WEB_MAX_TEXT_COMMAND + 1];
+                memcpy(text, data, len);
+                text[len] = '\0';
+                LOGD("WebSocket text from %u: %s", client->id(), text);
+                // "GET_FILE:<path>[,<offset>[,<length>]]" starts a streamed transfer.
+                if (strncmp(text, "GET_FILE:", 9) == 0)
+                    startFileTransfer(client, String(text + 9));
+                else if (strcmp(text, "prev") == 0)
+                    runCommand(WS_OP_PREV);
+                else if (strcmp(text, "next") == 0)
+                    runCommand(WS_OP_NEXT);
+                else if (strcmp(text, "play") == 0)
+                    runCommand(WS_OP_PLAY);
+                else if (strcmp(text, "stop") == 0)
+                    runCommand(WS_OP_STOP);
             }
         });
         // Add the WebSocket handler to the HTTP server.
         server.addHandler(&ws);
     }
 
-    // Set up HTTP routes to serve static files from LittleFS.
+    // The preset state the page renders. Runs on the main loop, which is also
+    // the only writer of loadedPreset.
+    static void writePresetState(JsonWriter &w) {
+        AppState state = StateStore::get();
+        w.beginObject();
+        w.string("name", loadedPreset.name);
+        w.string("projectName", loadedPreset.data.projectName);
+        w.number("songCount", loadedPreset.data.songCount);
+        w.number("currentTrack", state.track);
+        w.string("playbackStatus", state.playing ? "PLAYING" : "STOPPED");
+        w.string("link", LinkMonitor::healthName(state.link));
+        w.number("cued", state.cued);
+        w.number("cueDepth", state.cueDepth);
+        w.beginArray("songs");
+        for (int i = 0; i < loadedPreset.data.songCount; i++) {
+            w.beginObject();
+            w.string("songName", loadedPreset.data.songs[i].name());
+            w.number("songIndex", loadedPreset.data.songs[i].songIndex);
+            w.endObject();
+        }
+        w.endArray();
+        w.endObject();
+    }
+
+    // Writes the preset state into buf, growing it to fit (PSRAM first).
+    // Returns the length, 0 if out of memory.
+    static size_t buildPresetState(char *&buf, size_t &cap) {
+        for (int attempt = 0; attempt < 3; attempt++) {
+            JsonWriter w(buf, cap);
+            writePresetState(w);
+            if (!w.overflowed())
+                return w.length();
+            free(buf);
+            cap = w.length() + 256;   // room for small changes without regrowing
+            buf = (char *)allocSongStorage(cap);
+            if (!buf) {
+                LOGE("No memory for a %u byte web payload", (unsigned)cap);
+                cap = 0;
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    // Applies a control opcode to the state store. Runs on the network task:
+    // MIDI, the display and the broadcast follow on their own tasks.
+    static WsStatus runCommand(uint8_t op) {
+        switch (op) {
+            case WS_OP_PREV:
+                // While playing, Prev and Next edit the cue queue instead.
+                if (StateStore::get().playing)
+                    return CueQueue::cancelLast() ? WS_STATUS_OK : WS_STATUS_REJECTED;
+                return StateStore::stepTrack(-1) ? WS_STATUS_OK : WS_STATUS_REJECTED;
+            case WS_OP_NEXT:
+                if (StateStore::get().playing)
+                    return CueQueue::cueNext() ? WS_STATUS_OK : WS_STATUS_REJECTED;
+                return StateStore::stepTrack(1) ? WS_STATUS_OK : WS_STATUS_REJECTED;
+            case WS_OP_PLAY:
+                return StateStore::play() ? WS_STATUS_OK : WS_STATUS_REJECTED;
+            case WS_OP_STOP:
+                StateStore::stop();
+                return WS_STATUS_OK;
+            default:
+                return WS_STATUS_UNKNOWN;
+        }
+    }
+
+    bool addClient(uint32_t id) {
+        bool added = false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (WsClient &c : clients) {
+            if (!c.id) {
+                c.id = id;
+                c.stale = true;
+                added = true;
+                break;
+            }
+        }
+        xSemaphoreGive(lock);
+        return added;
+    }
+
+    void removeClient(uint32_t id) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (WsClient &c : clients) {
+            if (c.id == id)
+                c.id = 0;
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Sends the latest snapshot to stale clients whose queue has drained.
+    void flushStaleClients() {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (WsClient &c : clients) {
+            if (!c.id || !c.stale || !snapshotLen)
+                continue;
+            AsyncWebSocketClient *client = ws.client(c.id);
+            if (!client) {
+                c.id = 0;
+            } else if (client->queueLen() < WEB_SLOW_CLIENT_QUEUE) {
+                client->text(snapshot, snapshotLen);
+                if (lastProgress[0])
+                    client->binary(lastProgress, sizeof(lastProgress));
+                c.stale = false;
+            }
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Sends the song progress every WEB_PROGRESS_MS while it changes. It is
+    // only a tick: a client that is behind skips it and catches the next one.
+    void pushProgress() {
+        SongProgress p = progress.sample(micros());
+        uint8_t frame[sizeof(lastProgress)];
+        frame[0] = WS_OP_PROGRESS;
+        frame[1] = (p.known ? WS_PROGRESS_KNOWN : 0) | (p.running ? WS_PROGRESS_RUNNING : 0);
+        uint16_t tempo = p.tempoCentiBpm > 0xFFFF ? 0xFFFF : p.tempoCentiBpm;
+        for (int i = 0; i < 4; i++) {
+            frame[2 + i] = p.elapsedMs >> (8 * i);
+            frame[6 + i] = p.lengthMs >> (8 * i);
+        }
+        frame[10] = tempo;
+        frame[11] = tempo >> 8;
+        if (memcmp(frame, lastProgress, sizeof(frame)) == 0)
+            return;
+        memcpy(lastProgress, frame, sizeof(frame));
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (WsClient &c : clients) {
+            if (!c.id || c.stale)
+                continue;
+            AsyncWebSocketClient *client = ws.client(c.id);
+            if (client && client->queueLen() < WEB_SLOW_CLIENT_QUEUE)
+                client->binary(frame, sizeof(frame));
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Replies "FILE <path> <offset> <length> <size>", then update() sends the
+    // range as WS_OP_FILE_DATA messages of up to WEB_FILE_BLOCK_SIZE bytes and ends with
+    // "FILE_END <path> <bytes sent>". A new request replaces the client's
+    // previous transfer.
+    void startFileTransfer(AsyncWebSocketClient *client, const String &args) {
+        int comma = args.indexOf(',');
+        String path = comma < 0 ? args : args.substring(0, comma);
+        uint32_t offset = 0, length = 0;
+        if (comma >= 0) {
+            int comma2 = args.indexOf(',', comma + 1);
+            offset = args.substring(comma + 1, comma2 < 0 ? args.length() : comma2).toInt();
+            if (comma2 >= 0)
+                length = args.substring(comma2 + 1).toInt();
+        }
+        LOGI("Client %u requested file %s from %u", client->id(), path.c_str(), offset);
+
+        if (!LittleFS.exists(path)) {
+            client->text("Error: File not found");
+            return;
+        }
+        File file = LittleFS.open(path, "r");
+        if (!file) {
+            client->text("Error: Unable to open file");
+            return;
+        }
+        uint32_t size = file.size();
+        if (offset > size || !file.seek(offset)) {
+            file.close();
+            client->text("Error: Offset past end of file");
+            return;
+        }
+        if (length == 0 || length > size - offset)
+            length = size - offset;
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        FileTransfer *slot = nullptr;
+        for (FileTransfer &t : transfers) {
+            if (t.clientId == client->id()) {
+                t.file.close();
+                slot = &t;
+                break;
+            }
+            if (!t.clientId && !slot)
+                slot = &t;
+        }
+        if (!slot) {
+            xSemaphoreGive(lock);
+            file.close();
+            client->text("Error: Too many transfers");
+            return;
+        }
+        client->text("FILE " + path + " " + String(offset) + " " + String(length) + " " + String(size));
+        slot->clientId = client->id();
+        slot->file = file;
+        slot->path = path;
+        slot->remaining = length;
+        slot->sent = 0;
+        xSemaphoreGive(lock);
+    }
+
+    // Sends the next blocks of every transfer while its client's send queue
+    // has room, so memory stays at a few blocks per client whatever the file
+    // size.
+    void pumpFileTransfers() {
+        static uint8_t block[1 + WEB_FILE_BLOCK_SIZE];
+        block[0] = WS_OP_FILE_DATA;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (FileTransfer &t : transfers) {
+            if (!t.clientId)
+                continue;
+            AsyncWebSocketClient *client = ws.client(t.clientId);
+            if (!client) {
+                // Disconnected mid-transfer.
+                t.file.close();
+                t.clientId = 0;
+                continue;
+            }
+            for (int i = 0; i < WEB_FILE_BLOCKS_PER_UPDATE && t.remaining > 0 &&
+                            client->queueLen() < WEB_FILE_MAX_QUEUED; i++) {
+                size_t n = t.file.read(block + 1, t.remaining < WEB_FILE_BLOCK_SIZE ? t.remaining : WEB_FILE_BLOCK_SIZE);
+                if (n == 0) {
+                    t.remaining = 0;   // file shrank; FILE_END reports what was sent
+                    break;
+                }
+                client->binary(block, 1 + n);
+                t.remaining -= n;
+                t.sent += n;
+            }
+            if (t.remaining == 0) {
+                client->text("FILE_END " + t.path + " " + String(t.sent));
+                t.file.close();
+                t.clientId = 0;
+            }
+        }
+        xSemaphoreGive(lock);
+    }
+
+    // Serve one asset: 304 when the client already holds this ETag, otherwise
+    // the file. For "/x.js" stored as "/x.js.gz" the library opens the .gz and
+    // adds Content-Encoding: gzip itself.
+    void addAssetRoute(const char *url, const String &path, const String &mime,
+                       const String &etag, bool immutable) {
+        server.on(url, HTTP_GET, [path, mime, etag, immutable](AsyncWebServerRequest *request) {
+            AsyncWebServerResponse *response;
+            if (request->hasHeader("If-None-Match") &&
+                request->getHeader("If-None-Match")->value().indexOf(etag) >= 0) {
+                response = request->beginResponse(304);
+            } else {
+                response = request->beginResponse(LittleFS, path, mime);
+            }
+            response->addHeader("ETag", etag);
+            response->addHeader("Cache-Control", immutable ? WEB_CACHE_IMMUTABLE : WEB_CACHE_REVALIDATE);
+            request->send(response);
+        });
+    }
+
+    // Set up HTTP routes from the asset manifest written by tools/build_web.py.
     void setupHTTPRoutes() {
-        server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
+        int assets = 0;
+        File manifest = LittleFS.open(WEB_ASSET_MANIFEST, "r");
+        while (manifest && manifest.available()) {
+            // "path mime etag immutable"
+            String line = manifest.readStringUntil('\n');
+            int a = line.indexOf(' ');
+            int b = line.indexOf(' ', a + 1);
+            int c = line.indexOf(' ', b + 1);
+            if (a <= 0 || b < 0 || c < 0)
+                continue;
+            String path = line.substring(0, a);
+            String mime = line.substring(a + 1, b);
+            String etag = "\"" + line.substring(b + 1, c) + "\"";
+            bool immutable = line.charAt(c + 1) == '1';
+            addAssetRoute(path.c_str(), path, mime, etag, immutable);
+            if (path == "/index.html")
+                addAssetRoute("/", path, mime, etag, immutable);
+            assets++;
+        }
+        if (manifest)
+            manifest.close();
+
+        if (assets == 0) {
+            // Image uploaded without the build step: serve data/ as it is.
+            Serial.println(F("No " WEB_ASSET_MANIFEST ", serving files uncached"));
+            server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html").setCacheControl(WEB_CACHE_REVALIDATE);
+        } else {
+            Serial.printf("Serving %d web assets\n", assets);
+        }
     }
 
 public:
     // Constructor: initialize the server and WebSocket with the given port.
     AsyncWebServerManager(uint16_t port)
-        : server(port), ws("/ws"), serverStarted(false), port(port) {}
+        : server(port), ws("/ws"), serverStarted(false), port(port), transfers(), clients(),
+          snapshot(nullptr), snapshotLen(0), snapshotCap(0), scratch(nullptr), scratchCap(0), coalesced(0),
+          lastProgress(), lastProgressMs(0), lock(nullptr) {}
 
     // Set up LittleFS, WebSocket, and HTTP routes, then start the server.
     void setup() {
@@ -124,6 +444,7 @@ public:
             Serial.println("Failed to mount LittleFS. Aborting web server setup.");
             return;
         }
+        lock = xSemaphoreCreateMutex();
         setupWebSocket();
         setupHTTPRoutes();
         server.begin();
@@ -131,9 +452,19 @@ public:
         Serial.printf("Async Web Server started on port %d\n", port);
     }
 
-    // For an asynchronous server, no periodic update is required.
+    // Called from the main loop: broadcasts state changes, streams pending
+    // GET_FILE transfers and catches up slow and new clients.
     void update() {
-        // Not needed for AsyncWebServer.
+        if (!serverStarted)
+            return;
+        if (StateStore::changes(StateSubscriber::WEB) || !snapshotLen)
+            notifyPresetUpdate();
+        if (millis() - lastProgressMs >= WEB_PROGRESS_MS) {
+            lastProgressMs = millis();
+            pushProgress();
+        }
+        pumpFileTransfers();
+        flushStaleClients();
     }
 
     // Check if the server is running.
@@ -142,46 +473,46 @@ public:
     }
 
     void notifyPresetUpdate() {
-        static String lastBroadcast;
+        if (!serverStarted)
+            return;
         uint64_t start_us = esp_timer_get_time();
         uint32_t start_ms = millis();
-        // Build a JSON string with preset data
-        String json = "{";
-        json += "\"name\":\"" + String(loadedPreset.name) + "\",";
-        json += "\"projectName\":\"" + String(loadedPreset.data.projectName) + "\",";
-        json += "\"songCount\":" + String(loadedPreset.data.songCount) + ",";
-        json += "\"currentTrack\":" + String(currentTrack) + ",";
-        json += "\"playbackStatus\":\"" + String(isPlaying ? "PLAYING" : "STOPPED") + "\",";
-        json += "\"songs\":[";
-        for (int i = 0; i < loadedPreset.data.songCount; i++) {
-          json += "{";
-          json += "\"songName\":\"" + String(loadedPreset.data.songs[i].songName) + "\",";
-          json += "\"songIndex\":" + String(loadedPreset.data.songs[i].songIndex);
-          json += "}";
-          if (i < loadedPreset.data.songCount - 1)
-            json += ",";
-        }
-        json += "]}";
-        
-        if (json == lastBroadcast) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        size_t len = buildPresetState(scratch, scratchCap);
+        if (!len || (len == snapshotLen && memcmp(scratch, snapshot, len) == 0)) {
+            xSemaphoreGive(lock);
             return;
         }
-        lastBroadcast = json;
-        ws.textAll(json);
-        // Broadcast the JSON message to all connected WebSocket clients
-        Serial.println("Preset updated and broadcasted: " + json);
-
+        std::swap(snapshot, scratch);
+        std::swap(snapshotCap, scratchCap);
+        snapshotLen = len;
 
-        if (onPresetUpdate) {
-            onPresetUpdate();
+        // Send to every client that keeps up; the others get the latest
+        // snapshot from update() once their queue drains.
+        for (WsClient &c : clients) {
+            if (!c.id)
+                continue;
+            AsyncWebSocketClient *client = ws.client(c.id);
+            if (!client) {
+                c.id = 0;
+            } else if (c.stale || client->queueLen() >= WEB_SLOW_CLIENT_QUEUE) {
+                if (!c.stale)
+                    LOGI("Client %u is slow, coalescing updates", c.id);
+                c.stale = true;
+                coalesced++;
+            } else {
+                client->text(snapshot, snapshotLen);
+            }
         }
+        xSemaphoreGive(lock);
+        LOGD("Preset update broadcast, %u bytes, %lu coalesced so far", (unsigned)snapshotLen, (unsigned long)coalesced);
         uint64_t end_us = esp_timer_get_time();
         uint32_t end_ms = millis();
-        Serial.printf("Latency: %lld µs | %d ms\n", end_us - start_us, end_ms - start_ms);
+        LOGD("Preset update took %lld us | %lu ms", (long long)(end_us - start_us), (unsigned long)(end_ms - start_ms));
     }
 
-    std::function<void()> onPresetUpdate;
-
 };
 
+extern AsyncWebServerManager webServerManager;
+
 #endif // ASYNCWEBSERVERMANAGER_H
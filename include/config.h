@@ -21,6 +21,11 @@
 #define T_CS      15
 #define T_IRQ     3
 
+// Display and touch share the default SPI bus (see _spibus.h)
+#define DISPLAY_SPI_FREQ  40000000
+#define TOUCH_SPI_FREQ    2000000     // must match the XPT2046 library's setting
+#define SPI_REPORT_INTERVAL_MS 30000
+
 // -----------------------------------------------------
 // MENU AND BUTTON MACROS
 // -----------------------------------------------------
@@ -38,6 +43,107 @@
 
 // For buttons that depend on the display width, use a fixed value or compute at runtime.
 #define DISPLAY_WIDTH 320
+#define DISPLAY_HEIGHT 240
+
+// Band renderer: two DISPLAY_WIDTH x BAND_HEIGHT RGB565 strips (12.5 KB each)
+#define BAND_HEIGHT   20
+#define BAND_MAX_OPS  1024   // display list entries per frame (16 bytes each)
+// 1 = rasterize into a full-frame 8-bit palette canvas (75 KB internal RAM)
+// and expand to RGB565 while streaming; falls back to bands if it doesn't fit
+#define RENDER_PALETTE8        1
+#define PALETTE_EXPAND_PIXELS  640  // two rows per DMA buffer
+
+// Screen regression tour, built by the screen-tour environment: after boot,
+// every screen is drawn with fixture data and its hash and SPI cost printed.
+#ifndef SCREEN_TOUR
+#define SCREEN_TOUR       0
+#endif
+#define SCREEN_TOUR_DUMP  1   // also print each frame for tools/screen_tour.py
+
+// Task topology (see _tasks.h). WiFi and AsyncTCP run on core 0 and loop() on
+// core 1 at priority 1; the MIDI task outranks loop() and the render task on
+// core 1, so a due MIDI poll preempts drawing instead of waiting for it.
+#define MIDI_TASK_CORE        1
+#define MIDI_TASK_PRIORITY    5
+#define MIDI_TASK_STACK       4096
+#define MIDI_POLL_MS          1
+#define LOOP_SLEEP_MS         10     // loop() yields this long between passes
+#define TASK_SCREEN_REFRESH_MS 1000  // diagnostics screen update rate
+
+// USB MIDI ports (see _midiport.h)
+#define MIDI_USB_CABLES         3      // virtual cables; 1 puts every port on one, as before
+#define MIDI_PORT_QUEUE_BYTES   256    // outgoing bytes queued per port, a power of two
+#define MIDI_PORT_MESSAGE_MAX   64     // longest outgoing message
+#define MIDI_USB_STALL_MS       100    // USB output stuck this long counts as down
+#define MIDI_USB_RETRY_MS       2000   // a down USB link is retried after this, and must run clean as long
+
+// DIN MIDI out (see _midiuart.h)
+#define MIDI_UART_MODE          2      // MidiUartMode: 0 off, 1 mirror USB, 2 take over while USB is down
+#define MIDI_UART_TX_PIN        17
+#define MIDI_UART_AHEAD_US      3000   // line time handed to the UART ahead of the wire (~9 bytes)
+#define MIDI_UART_STATUS_REFRESH_MS 1000  // running status is sent again after this long
+
+// Ping monitor (see _link.h)
+#define LINK_PING_INTERVAL_MS   1000   // while playing
+#define LINK_PING_IDLE_MS       3000   // stopped, link good
+#define LINK_PING_FAST_MS       250    // link degraded, lost or unknown
+#define LINK_PING_TIMEOUT_MS    1000   // a ping with no reply by then is lost
+#define LINK_PING_SLOTS         8      // pings in flight, a power of two
+#define LINK_LOSS_WINDOW        20     // pings the loss rate is taken over, at most 32
+#define LINK_LOST_PINGS         3      // lost in a row before the link counts as lost
+#define LINK_DEGRADED_LOSS_PCT  10
+#define LINK_DEGRADED_RTT_MS    50     // smoothed round trip
+#define LINK_DEGRADED_JITTER_MS 20
+#define LINK_BLINK_MS           250    // LED_PING blink half-period while degraded
+
+// MIDI clock follower (see _transport.h)
+#define TRANSPORT_PLL_PHASE_SHIFT   3     // phase follows 1/8 of each clock's error
+#define TRANSPORT_PLL_PERIOD_SHIFT  6     // period follows 1/64
+#define TRANSPORT_RELOCK_CLOCKS     3     // outliers in a row that restart the estimate
+#define TRANSPORT_LOCK_CLOCKS       24    // clocks on track before the tempo counts as settled
+#define TRANSPORT_CLOCK_GAP_MS      250   // longer between clocks is a pause (under 10 bpm)
+
+// Song progress (see _progress.h)
+#define PROGRESS_FRAME_MS           100   // home-screen bar redraw rate
+#define WEB_PROGRESS_MS             500   // progress push rate to the phones
+
+// Cue queue (see _cue.h)
+#define CUE_QUEUE_DEPTH             4     // songs that can be queued ahead
+#define CUE_LAUNCH                  0     // CueLaunch: 0 at the song's end, 1 on the next bar
+#define CUE_AUTO_ADVANCE            1     // cue the next setlist song by itself while playing
+#define CUE_BEATS_PER_BAR           4     // bar length for CueLaunch::NEXT_BAR
+#define CUE_ARM_LEAD_MS             20    // how far ahead the launch timer is started
+
+// Render task (see _render.h)
+#define RENDER_TASK_CORE      1
+#define RENDER_TASK_PRIORITY  1
+#define RENDER_TASK_STACK     4096
+#define RENDER_POLL_MS        10    // how often StateStore changes are checked
+
+// Input record/replay (see _inputlog.h): 0 = live, 1 = record, 2 = replay
+#ifndef INPUT_LOG_MODE
+#define INPUT_LOG_MODE       0
+#endif
+#define INPUT_LOG_PATH       "/input.log"
+#define INPUT_LOG_BUFFER     128          // events held between writes (12 bytes each)
+#define INPUT_LOG_MAX_BYTES  (512 * 1024)
+#define INPUT_ADC_DEADBAND   8            // pot moves smaller than this aren't logged
+#define INPUT_REPLAY_SPEED   10           // virtual ms per real ms while replaying
+
+// Deferred logging (see _log.h). LOGD and friends above LOG_LEVEL are compiled
+// out: 0 none, 1 error, 2 warn, 3 info, 4 debug.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL              3
+#endif
+#define LOG_BINARY             0      // 1 = raw records for tools/log_decode.py
+#define LOG_BUFFER_SIZE        4096   // ring size in bytes, a power of two
+#define LOG_MAX_RECORD         128    // bytes per record, arguments included
+#define LOG_MAX_STRING         48     // longest %s argument kept
+#define LOG_DRAIN_INTERVAL_MS  20
+#define LOG_TASK_PRIORITY      0      // idle priority: only runs when nothing else does
+#define LOG_TASK_CORE          0
+#define LOG_TASK_STACK         3072
+
 #define NEXT_BUTTON_WIDTH  60
 #define NEXT_BUTTON_HEIGHT 35
 #define NEXT_BUTTON_X      (DISPLAY_WIDTH - NEXT_BUTTON_WIDTH - 5)
@@ -68,12 +174,42 @@
 // Compile-Time Constants (defined as macros)
 // -----------------------------------------------------
 #define MAX_SONG_NAME_LEN 48
-#define MAX_SONGS         50
+#define MAX_SONGS         16384  // Upper bound of the 14-bit song index
+#define SONG_CHUNK_SIZE   64     // Songs per storage chunk (allocated on demand)
+#define SONG_NAME_BLOCK_SIZE 4096 // Bytes per song name pool block
+// Enough blocks for two full projects of distinct names (the scanned one and
+// a preset from another project); selectedProject only reuses their names.
+#define SONG_NAME_MAX_BLOCKS (2 * MAX_SONGS * (MAX_SONG_NAME_LEN + 1) / SONG_NAME_BLOCK_SIZE + 1)
 #define MAX_PRESETS       10   // e.g., 10 setlist slots
 
+#define SCAN_STALL_TIMEOUT_MS 3000 // Give up when no song arrives for this long
+#define SCAN_NAK_TIMEOUT_MS   500  // Ask for gaps when the end marker is this late
+#define SCAN_MAX_RETRIES      5
+#define SCAN_MAX_NAK_RANGES   8
+#define SYNC_TIMEOUT_MS       300  // Fall back to a full scan if no sync reply
+
 #define MAX_WIFI_NETWORKS 20   // Maximum number of networks to display
 #define MAX_WIFI_PASS_LEN 32
 
+// Web UI assets, built into the LittleFS image by tools/build_web.py.
+#define WEB_ASSET_MANIFEST  "/assets.txt"
+#define WEB_CACHE_IMMUTABLE "public, max-age=31536000, immutable"  // hashed names
+#define WEB_CACHE_REVALIDATE "no-cache"   // pages: reuse only after an ETag check
+
+// Streamed GET_FILE transfers over the WebSocket.
+#define WEB_FILE_BLOCK_SIZE        1024
+#define WEB_FILE_MAX_QUEUED        4   // stop sending while the client has this many messages queued
+#define WEB_FILE_BLOCKS_PER_UPDATE 4
+#define WEB_MAX_FILE_TRANSFERS     2
+#define WEB_MAX_PATH_LEN           255   // LittleFS LFS_NAME_MAX
+// Longest text command: "GET_FILE:<path>,<offset>,<length>" with u32 decimals.
+#define WEB_MAX_TEXT_COMMAND       (9 + WEB_MAX_PATH_LEN + 2 * 11)
+
+// WebSocket clients (phones). The library's own limit is DEFAULT_MAX_WS_CLIENTS
+// in platformio.ini.
+#define WEB_MAX_CLIENTS        20
+#define WEB_SLOW_CLIENT_QUEUE  8   // queued messages at which broadcasts coalesce
+
 #define NUM_MENU_ITEMS    5
 #define NUM_MENU2_ITEMS   3
 #define NUM_WIFI_MENU_ITEMS 3
@@ -85,8 +221,23 @@ extern int selectedPresetSlot;    // Preset slot currently in use
 extern bool presetChanged;
 extern bool newSetlistScanned;
 
+// One bit per scanned song, set when the user picks it for the new setlist.
+class SongSelection {
+public:
+    bool operator[](int i) const {
+        return i >= 0 && i < MAX_SONGS && (_bits[i >> 5] >> (i & 31)) & 1;
+    }
+    void toggle(int i) {
+        if (i >= 0 && i < MAX_SONGS) _bits[i >> 5] ^= 1UL << (i & 31);
+    }
+    void clear() { memset(_bits, 0, sizeof(_bits)); }
+
+private:
+    uint32_t _bits[MAX_SONGS / 32] = { 0 };
+};
+
 // User selection / reordering state
-extern bool selectedSongs[MAX_SONGS];
+extern SongSelection selectedSongs;
 extern int  selectedTrackCount;
 extern bool isReorderedSongsInitialized;
 extern bool isReordering;
@@ -95,7 +246,6 @@ extern int  reorderTarget;
 // Scanning state for songs received via SysEx
 extern bool songsReady;  // Signals that the end-of-song-list SysEx has been received
 
-extern unsigned long lastPingReplyTime;
 
 extern bool webServerStarted;  
 
@@ -104,7 +254,6 @@ extern bool webServerStarted;
 extern int currentSongItem;
 extern int scrollOffset;       // For scrolling lists on the display
 extern int totalTracks;        // Total songs in loaded preset
-extern int currentTrack;       // Currently active track
 extern bool needsRedraw;
 extern int selectedHomeSongIndex;
 
@@ -118,8 +267,7 @@ extern MenuSelection currentMenuSelection;
 
 extern int menu1Index;
 
-extern byte currentVolume;      // Current volume level
-extern bool isPlaying;
+// Track, playback and volume live in StateStore (_state.h).
 
 // On-screen keyboard variables
 extern const char* specialKeys[];
@@ -164,20 +312,101 @@ static const char wifiMenuItems[NUM_WIFI_MENU_ITEMS][16] PROGMEM = {
 // -----------------------------------------------------
 // Structure Definitions
 // -----------------------------------------------------
+// Allocates song storage, preferring PSRAM and falling back to internal RAM.
+void *allocSongStorage(size_t size);
+
+// Song names live once in songNames; SongInfo only keeps the id.
+// Id 0 is always the empty string, so a zeroed SongInfo has no name.
+// Names are stored in fixed blocks that never move, so a pointer returned by
+// get() stays valid until the next compact().
+// intern() (MIDI task) and compact() (UI task) share a lock.
+class SongNamePool {
+public:
+    SongNamePool();
+
+    // Returns the id of name, adding it if it is not stored yet.
+    // Returns 0 and logs an error when the pool is full.
+    uint32_t intern(const char *name);
+    const char *get(uint32_t id) const;
+
+    // Drops names no global ProjectInfo refers to anymore. Only call it while
+    // no temporary SongInfo copies are alive (e.g. before a scan or a load).
+    void compact();
+
+    size_t used() const;
+    size_t capacity() const { return (size_t)_blockCount * SONG_NAME_BLOCK_SIZE; }
+
+private:
+    uint32_t append(const char *name, size_t len);
+    bool     growIndex();
+    void     reset();
+
+    SemaphoreHandle_t _lock;   // recursive: compact() interns
+    char     *_blocks[SONG_NAME_MAX_BLOCKS];
+    int       _blockCount;
+    size_t    _blockUsed;   // Bytes used in the last block
+    uint32_t *_slots;       // Open-addressed hash index of ids
+    size_t    _slotCount;
+    size_t    _nameCount;
+};
+
 struct SongInfo {
-    byte  songIndex;        // Original song index from SysEx
-    int   changedIndex;     // Index after reordering
-    char  songName[MAX_SONG_NAME_LEN + 1]; // Song name (null terminated)
-    float locatorTime;      // Locator time in seconds
+    uint16_t songIndex;     // Original song index from SysEx
+    uint16_t changedIndex;  // Index after reordering
+    uint32_t nameId;        // Song name id in songNames
+    uint32_t locatorMs;     // Locator time in milliseconds
+
+    const char *name() const;
+    // False when the name pool is full and the song is left unnamed.
+    bool setName(const char *name);
+    float locatorSeconds() const { return locatorMs / 1000.0f; }
+    void setLocatorSeconds(float seconds);
 
     // Parse SysEx data for a single song.
     bool getInfo(const byte *data, unsigned length);
 };
 
+// Growable song storage made of SONG_CHUNK_SIZE chunks. Chunks are never
+// moved once allocated, so indexing stays valid while the list grows.
+// Indexing past capacity() is a caller bug: it logs an error and returns a
+// zeroed scratch entry instead of crashing. Check reserve() before filling
+// and the owner's songCount before reading.
+class SongList {
+public:
+    SongList();
+    ~SongList();
+    SongList(const SongList &other);
+    SongList(SongList &&other);
+    SongList &operator=(const SongList &other);
+    SongList &operator=(SongList &&other);
+
+    SongInfo &operator[](int i);
+    const SongInfo &operator[](int i) const;
+
+    // Makes room for count songs. False when memory runs out or count > MAX_SONGS.
+    bool reserve(int count);
+    int  capacity() const { return _chunkCount * SONG_CHUNK_SIZE; }
+    void release();
+
+private:
+    SongInfo *_chunks[MAX_SONGS / SONG_CHUNK_SIZE];
+    int       _chunkCount;
+    SongInfo  _scratch;
+};
+
 struct ProjectInfo {
-    char     projectName[MAX_SONG_NAME_LEN + 1];
-    SongInfo songs[MAX_SONGS];
-    int      songCount;
+    char     projectName[MAX_SONG_NAME_LEN + 1] = { 0 };
+    SongList songs;
+    int      songCount = 0;
+
+    // Empties the project and zeroes every entry, but keeps the allocated
+    // song storage.
+    void clear();
+    // Replaces the songs with the ones picked from another project, in
+    // order, each keeping its index there. False when storage runs out.
+    bool select(const ProjectInfo &from, const SongSelection &picked, int count);
+    // One reorder step. False when either song is past songCount.
+    bool swapSongs(int a, int b);
 };
 
 struct Preset {
@@ -191,5 +420,9 @@ struct Preset {
 extern Preset loadedPreset;          // The currently loaded preset
 extern ProjectInfo selectedProject;    // User-selected subset of songs for editing
 extern ProjectInfo currentProject;
+extern SongNamePool songNames;       // Names shared by the three projects above
+
+// Prints the song storage footprint next to the old fixed-buffer layout.
+void printLayoutReport();
 
 #endif // CONFIG_H
@@ -92,6 +92,21 @@ static const struct {
 
 #endif // end USE_SPI_DMA
 
+#if defined(USE_SPI_DMA) && defined(ESP32)
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+// SPI host behind the Arduino 'SPI' object: VSPI on the original ESP32,
+// FSPI (SPI2) on S2/S3/C3.
+#if CONFIG_IDF_TARGET_ESP32
+#define SPITFT_DMA_HOST SPI3_HOST
+#else
+#define SPITFT_DMA_HOST SPI2_HOST
+#endif
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <soc/spi_reg.h>
+#endif
+#endif // end USE_SPI_DMA && ESP32
+
 // Possible values for Adafruit_SPITFT.connection:
 #define TFT_HARD_SPI 0 ///< Display interface = hardware SPI
 #define TFT_SOFT_SPI 1 ///< Display interface = software SPI
@@ -889,6 +904,50 @@ void Adafruit_SPITFT::initSPI(uint32_t freq, uint8_t spiMode) {
     dma.free(); // Deallocate DMA channel
   }
 #endif // end USE_SPI_DMA
+
+#if defined(USE_SPI_DMA) && defined(ESP32)
+  // Only the default SPI object is supported, as its pins and host are
+  // known. The IDF driver shares the host with the Arduino SPI class;
+  // chip-select stays under manual control so a command (sent by the
+  // Arduino side) and its pixel data (sent by DMA) form one transaction.
+  if ((connection == TFT_HARD_SPI) && (hwspi._spi == &SPI) && !dmaDevice) {
+    maxFillLen = SPITFT_DMA_BUF_PIXELS;
+    pixelBuf[0] = (uint16_t *)heap_caps_malloc(
+        2 * maxFillLen * sizeof(uint16_t), MALLOC_CAP_DMA);
+    if (pixelBuf[0]) {
+      pixelBuf[1] = &pixelBuf[0][maxFillLen];
+
+      spi_bus_config_t bus;
+      memset(&bus, 0, sizeof bus);
+      bus.mosi_io_num = MOSI;
+      bus.miso_io_num = MISO;
+      bus.sclk_io_num = SCK;
+      bus.quadwp_io_num = -1;
+      bus.quadhd_io_num = -1;
+      bus.max_transfer_sz = SPITFT_DMA_MAX_PIXELS * sizeof(uint16_t);
+
+      spi_device_interface_config_t dev;
+      memset(&dev, 0, sizeof dev);
+      dev.clock_speed_hz = freq;
+      dev.mode = spiMode; // Arduino SPI_MODEn == n on ESP32
+      dev.spics_io_num = -1;
+      dev.queue_size = SPITFT_DMA_QUEUE;
+      dev.flags = SPI_DEVICE_NO_DUMMY;
+      dev.post_cb = dmaDone;
+
+      // ESP_ERR_INVALID_STATE: bus already set up by another display
+      esp_err_t err = spi_bus_initialize(SPITFT_DMA_HOST, &bus, SPI_DMA_CH_AUTO);
+      if (((err == ESP_OK) || (err == ESP_ERR_INVALID_STATE)) &&
+          (spi_bus_add_device(SPITFT_DMA_HOST, &dev, &dmaDevice) == ESP_OK)) {
+        return; // Success!
+      }
+      dmaDevice = NULL;
+      heap_caps_free(pixelBuf[0]);
+      pixelBuf[0] = pixelBuf[1] = NULL;
+    }
+    maxFillLen = 0;
+  }
+#endif // end USE_SPI_DMA && ESP32
 }
 
 /*!
@@ -923,6 +982,9 @@ void Adafruit_SPITFT::startWrite(void) {
             for all display types; not an SPI-specific function.
 */
 void Adafruit_SPITFT::endWrite(void) {
+#if defined(USE_SPI_DMA) && defined(ESP32)
+  dmaWait(); // Pixels must be out before deselect or a new transaction
+#endif
   if (_cs >= 0)
     SPI_CS_HIGH();
   SPI_END_TRANSACTION();
@@ -1005,6 +1067,46 @@ void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len, bool block,
 
 #if defined(ESP32)
   if (connection == TFT_HARD_SPI) {
+#if defined(USE_SPI_DMA)
+    if (dmaDevice && (len >= SPITFT_DMA_MIN_PIXELS)) {
+      if (bigEndian && esp_ptr_dma_capable(colors) &&
+          !((uintptr_t)colors & 3)) {
+        // Already in display order and DMA-reachable: send straight
+        // from the caller's buffer, which must stay untouched until
+        // dmaWait() if not blocking.
+        while (len) {
+          uint32_t count =
+              (len < SPITFT_DMA_MAX_PIXELS) ? len : SPITFT_DMA_MAX_PIXELS;
+          dmaQueue(colors, count * 2, -1);
+          colors += count;
+          len -= count;
+        }
+      } else {
+        // Swap (or copy) into alternating working buffers; the next
+        // chunk is prepared while the prior one is still on the wire.
+        while (len) {
+          uint32_t count = (len < maxFillLen) ? len : maxFillLen;
+          while (dmaBufUsers[pixelBufIdx])
+            dmaReap(); // Wait for buffer's last transfer to finish
+          if (bigEndian) {
+            memcpy(pixelBuf[pixelBufIdx], colors, count * 2);
+          } else {
+            swapBytes(colors, count, pixelBuf[pixelBufIdx]);
+          }
+          if (pixelBufIdx == 0)
+            lastFillLen = 0; // Fill pattern has been overwritten
+          dmaQueue(pixelBuf[pixelBufIdx], count * 2, pixelBufIdx);
+          pixelBufIdx = 1 - pixelBufIdx;
+          colors += count;
+          len -= count;
+        }
+      }
+      if (block)
+        dmaWait();
+      return;
+    }
+    dmaWait(); // CPU writes must not interleave with queued DMA
+#endif // end USE_SPI_DMA
     if (!bigEndian) {
       hwspi._spi->writePixels(colors, len * 2); // Inbuilt endian-swap
     } else {
@@ -1178,6 +1280,15 @@ void Adafruit_SPITFT::dmaWait(void) {
     pinPeripheral(tft8._wr, PIO_OUTPUT); // Switch WR back to GPIO
   }
 #endif // end __SAMD51__ || ARDUINO_SAMD_ZERO
+#elif defined(USE_SPI_DMA) && defined(ESP32)
+  if (dmaQueued) {
+    // Blocks on the driver's result queue, so other tasks get the core
+    // while the transfer finishes.
+    int64_t start = esp_timer_get_time();
+    while (dmaQueued)
+      dmaReap();
+    dmaCounters.waitUs += (uint32_t)(esp_timer_get_time() - start);
+  }
 #endif
 }
 
@@ -1189,11 +1300,78 @@ void Adafruit_SPITFT::dmaWait(void) {
 bool Adafruit_SPITFT::dmaBusy(void) const {
 #if defined(USE_SPI_DMA) && (defined(__SAMD51__) || defined(ARDUINO_SAMD_ZERO))
   return dma_busy;
+#elif defined(USE_SPI_DMA) && defined(ESP32)
+  return dmaIssued != dmaCompleted;
 #else
   return false;
 #endif
 }
 
+#if defined(USE_SPI_DMA) && defined(ESP32)
+/*!
+    @brief  Queue one DMA transaction, reaping the oldest first if the
+            driver queue is full.
+    @param  data   DMA-capable source buffer.
+    @param  bytes  Number of bytes to send.
+    @param  buf    pixelBuf index the data lives in, or -1 for caller
+                   memory. Working buffers aren't rewritten until all
+                   transactions reading them are reaped.
+*/
+void Adafruit_SPITFT::dmaQueue(const void *data, uint32_t bytes, int8_t buf) {
+  if (dmaQueued == SPITFT_DMA_QUEUE)
+    dmaReap();
+  uint8_t slot = dmaNext;
+  dmaNext = (dmaNext + 1) % SPITFT_DMA_QUEUE;
+  spi_transaction_t *t = &dmaTrans[slot];
+  memset(t, 0, sizeof *t);
+  t->length = bytes * 8;
+  t->tx_buffer = data;
+  t->user = this;
+  dmaTransBuf[slot] = buf;
+  if (buf >= 0)
+    dmaBufUsers[buf]++;
+  if (!dmaQueued)
+    dmaStartUs = esp_timer_get_time();
+  dmaQueued++;
+  dmaIssued++;
+  dmaCounters.transactions++;
+  dmaCounters.bytes += bytes;
+  spi_device_queue_trans(dmaDevice, t, portMAX_DELAY);
+}
+
+/*!
+    @brief  Block until the oldest queued DMA transaction completes and
+            release its working buffer.
+*/
+void Adafruit_SPITFT::dmaReap(void) {
+  spi_transaction_t *t;
+  if (spi_device_get_trans_result(dmaDevice, &t, portMAX_DELAY) != ESP_OK)
+    return;
+  int8_t buf = dmaTransBuf[t - dmaTrans];
+  if (buf >= 0)
+    dmaBufUsers[buf]--;
+  if (!--dmaQueued) {
+    dmaCounters.busyUs += (uint32_t)(dmaDoneUs - dmaStartUs);
+#if CONFIG_IDF_TARGET_ESP32S3
+    // The driver leaves DMA enabled on the host; the Arduino SPI class
+    // writes through the FIFO and expects it off.
+    CLEAR_PERI_REG_MASK(SPI_DMA_CONF_REG(2), SPI_DMA_TX_ENA | SPI_DMA_RX_ENA);
+#endif
+  }
+}
+
+/*!
+    @brief  SPI driver post-transaction callback (ISR context). Records
+            completion so busy time reflects the bus, not when the CPU
+            got around to reaping.
+*/
+void IRAM_ATTR Adafruit_SPITFT::dmaDone(spi_transaction_t *t) {
+  Adafruit_SPITFT *tft = (Adafruit_SPITFT *)t->user;
+  tft->dmaDoneUs = esp_timer_get_time();
+  tft->dmaCompleted++;
+}
+#endif // end USE_SPI_DMA && ESP32
+
 /*!
     @brief  Issue a series of pixels, all the same color. Not self-
             contained; should follow startWrite() and setAddrWindow() calls.
@@ -1209,11 +1387,38 @@ void Adafruit_SPITFT::writeColor(uint16_t color, uint32_t len) {
 
 #if defined(ESP32) // ESP32 has a special SPI pixel-writing function...
   if (connection == TFT_HARD_SPI) {
+#if defined(USE_SPI_DMA)
+    if (dmaDevice && (len >= SPITFT_DMA_MIN_PIXELS)) {
+      // Fills repeatedly send pixelBuf[0], which holds a run of the
+      // byte-swapped color; it's only refilled when the color changes.
+      if (!lastFillLen || (lastFillColor != color)) {
+        while (dmaBufUsers[0])
+          dmaReap();
+        uint32_t c32 = __builtin_bswap16(color) * 0x00010001u;
+        uint32_t *dst = (uint32_t *)pixelBuf[0];
+        for (uint32_t t = 0; t < maxFillLen / 2; t++) {
+          dst[t] = c32;
+        }
+        lastFillColor = color;
+        lastFillLen = maxFillLen;
+      }
+      // Returns with the tail still in flight; the next command or
+      // endWrite() waits for it.
+      while (len) {
+        uint32_t count = (len < lastFillLen) ? len : lastFillLen;
+        dmaQueue(pixelBuf[0], count * 2, 0);
+        len -= count;
+      }
+      pixelBufIdx = 1; // Keep writePixels() off the fill buffer
+      return;
+    }
+    dmaWait(); // CPU writes must not interleave with queued DMA
+#endif // end USE_SPI_DMA
 #define SPI_MAX_PIXELS_AT_ONCE 32
 #define TMPBUF_LONGWORDS (SPI_MAX_PIXELS_AT_ONCE + 1) / 2
 #define TMPBUF_PIXELS (TMPBUF_LONGWORDS * 2)
     static uint32_t temp[TMPBUF_LONGWORDS];
-    uint32_t c32 = color * 0x00010001;
+    uint32_t c32 = color * 0x00010001u;
     uint16_t bufLen = (len < TMPBUF_PIXELS) ? len : TMPBUF_PIXELS, xferLen,
              fillLen;
     // Fill temp buffer 32 bits at a time
@@ -2198,6 +2403,9 @@ void Adafruit_SPITFT::spiWrite(uint8_t b) {
     @param  cmd  8-bit command to write.
 */
 void Adafruit_SPITFT::writeCommand(uint8_t cmd) {
+#if defined(USE_SPI_DMA) && defined(ESP32)
+  dmaWait(); // DC must not change under pixel data still in flight
+#endif
   SPI_DC_LOW();
   spiWrite(cmd);
   SPI_DC_HIGH();
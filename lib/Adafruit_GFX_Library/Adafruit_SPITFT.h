@@ -92,6 +92,33 @@ typedef volatile ADAGFX_PORT_t *PORTreg_t; ///< PORT register type
 #include <Adafruit_ZeroDMA.h>
 #endif
 
+// On ESP32, USE_SPI_DMA attaches the display to the ESP-IDF SPI master
+// driver (alongside the Arduino SPI class, which still handles commands
+// and short writes) and sends pixel runs with queued DMA transactions.
+// Estimated RAM usage: 2 * SPITFT_DMA_BUF_PIXELS * 2 bytes of DMA-capable
+// internal RAM, e.g. 8,192 bytes with the default buffer size.
+#if defined(USE_SPI_DMA) && defined(ESP32)
+#include <driver/spi_master.h>
+#if !defined(SPITFT_DMA_BUF_PIXELS)
+#define SPITFT_DMA_BUF_PIXELS 2048 ///< Pixels per DMA working buffer
+#endif
+#define SPITFT_DMA_QUEUE 4          ///< Max DMA transactions in flight
+#define SPITFT_DMA_MIN_PIXELS 32    ///< Shorter runs use the CPU path
+#define SPITFT_DMA_MAX_PIXELS 16384 ///< Largest single DMA transaction
+#endif
+
+/*!
+  @brief  SPI DMA counters, for measuring how long the bus is busy with
+          pixel data versus how long the CPU actually waits on it. All
+          zero when DMA is not in use.
+*/
+typedef struct {
+  uint32_t transactions; ///< DMA transactions queued
+  uint32_t bytes;        ///< Bytes sent via DMA
+  uint32_t busyUs;       ///< Time with at least one transaction in flight
+  uint32_t waitUs;       ///< Time the CPU spent blocked in dmaWait()
+} SPITFT_DMAStats;
+
 // This is kind of a kludge. Needed a way to disambiguate the software SPI
 // and parallel constructors via their argument lists. Originally tried a
 // bool as the first argument to the parallel constructor (specifying 8-bit
@@ -236,6 +263,9 @@ public:
   // Used by writePixels() in some situations, but might have rare need in
   // user code, so it's public...
   bool dmaBusy(void) const; // true if DMA is used and busy, false otherwise
+  // DMA bus-time counters (see SPITFT_DMAStats).
+  const SPITFT_DMAStats &getDMAStats(void) const { return dmaCounters; }
+  void resetDMAStats(void) { memset(&dmaCounters, 0, sizeof dmaCounters); }
   void swapBytes(uint16_t *src, uint32_t len, uint16_t *dest = NULL);
 
   // These functions are similar to the 'write' functions above, but with
@@ -501,6 +531,27 @@ protected:
   uint32_t lastFillLen = 0;          ///< # of pixels w/last fill
   uint8_t onePixelBuf;               ///< For hi==lo fill
 #endif
+#if defined(USE_SPI_DMA) && defined(ESP32) // Used by hardware SPI only
+  spi_device_handle_t dmaDevice = NULL;         ///< IDF SPI device handle
+  spi_transaction_t dmaTrans[SPITFT_DMA_QUEUE]; ///< Transaction slots
+  int8_t dmaTransBuf[SPITFT_DMA_QUEUE];         ///< pixelBuf # per slot
+  uint8_t dmaBufUsers[2] = {0, 0};   ///< Transactions reading each pixelBuf
+  uint8_t dmaQueued = 0;             ///< Transactions not yet reaped
+  uint8_t dmaNext = 0;               ///< Next transaction slot
+  uint8_t pixelBufIdx = 0;           ///< Next pixelBuf for writePixels()
+  uint16_t *pixelBuf[2] = {NULL, NULL}; ///< Byte-swapped working buffers
+  uint16_t maxFillLen = 0;           ///< Pixels per working buffer
+  uint16_t lastFillColor = 0;        ///< Color held in pixelBuf[0]
+  uint32_t lastFillLen = 0;          ///< # of fill pixels in pixelBuf[0]
+  volatile uint32_t dmaIssued = 0;   ///< Transactions queued (ever)
+  volatile uint32_t dmaCompleted = 0; ///< Transactions finished (ever)
+  volatile int64_t dmaDoneUs = 0;    ///< Completion time of the last one
+  int64_t dmaStartUs = 0;            ///< Start of the current busy period
+  void dmaQueue(const void *data, uint32_t bytes, int8_t buf);
+  void dmaReap(void);
+  static void dmaDone(spi_transaction_t *t);
+#endif
+  SPITFT_DMAStats dmaCounters = {0, 0, 0, 0}; ///< DMA bus-time counters
 #if defined(USE_FAST_PINIO)
 #if defined(HAS_PORT_SET_CLR)
 #if !defined(KINETISK)
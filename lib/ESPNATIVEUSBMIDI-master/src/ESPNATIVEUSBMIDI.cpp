@@ -42,10 +42,21 @@ static uint16_t tusb_midi_load_descriptor(uint8_t * dst, uint8_t * itf)
     return desc_len;
 }
 
-ESPNATIVEUSBMIDI::ESPNATIVEUSBMIDI(){
+// Bytes carried by an event packet, by Code Index Number (USB MIDI 1.0, 4).
+static const uint8_t cin_length[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+
+ESPNATIVEUSBMIDI::ESPNATIVEUSBMIDI(uint8_t cables){
+    if (cables < 1)
+        cables = 1;
+    if (cables > ESPNATIVEUSBMIDI_MAX_CABLES)
+        cables = ESPNATIVEUSBMIDI_MAX_CABLES;
+    _n_cables = cables;
+    memset(_cable_name_strid, 0, sizeof(_cable_name_strid));
+    memset(_tx, 0, sizeof(_tx));
+    memset(_rx, 0, sizeof(_rx));
+    _rx_pending = false;
     if(!tinyusb_midi_device_is_initialized){
         tinyusb_midi_device_is_initialized = true;
-        _n_cables = 1;
         _midi_dev = this;
         uint16_t const desc_len = getInterfaceDescriptor(0, NULL, 0);
         tinyusb_enable_interface(USB_INTERFACE_MIDI, desc_len, tusb_midi_load_descriptor);
@@ -130,20 +141,144 @@ bool ESPNATIVEUSBMIDI::begin(void) {
     return true;
 }
 
-int ESPNATIVEUSBMIDI::available(void) { return tud_midi_available(); }
+int ESPNATIVEUSBMIDI::available(void) { return available(0); }
 
 
 void ESPNATIVEUSBMIDI::end(){
 
 }
 
-int ESPNATIVEUSBMIDI::read(void) {
-    uint8_t ch;
-    return tud_midi_stream_read(&ch, 1) ? (int)ch : (-1);
+int ESPNATIVEUSBMIDI::read(void) { return read(0); }
+
+size_t ESPNATIVEUSBMIDI::write(uint8_t b) { return write(0, b); }
+
+void ESPNATIVEUSBMIDI::setCableName(uint8_t cable, const char *name) {
+    if (cable < _n_cables)
+        _cable_name_strid[cable] = tinyusb_add_string_descriptor(name);
+}
+
+// Moves received event packets into their cable's buffer. A packet whose
+// buffer is full is held until that cable is read, which stops the others too.
+void ESPNATIVEUSBMIDI::pollPackets(void) {
+    for (;;) {
+        if (!_rx_pending) {
+            if (!tud_midi_packet_read(_rx_packet))
+                return;
+            _rx_pending = true;
+        }
+        uint8_t cable = _rx_packet[0] >> 4;
+        uint8_t n = cin_length[_rx_packet[0] & 0x0F];
+        if (cable >= _n_cables || n == 0) {
+            _rx_pending = false;
+            continue;
+        }
+        RxBuffer &rx = _rx[cable];
+        if (rx.count + n > ESPNATIVEUSBMIDI_RX_SIZE)
+            return;
+        for (uint8_t i = 0; i < n; i++)
+            rx.data[(rx.head + rx.count++) % ESPNATIVEUSBMIDI_RX_SIZE] = _rx_packet[1 + i];
+        _rx_pending = false;
+    }
+}
+
+int ESPNATIVEUSBMIDI::available(uint8_t cable) {
+    if (cable >= _n_cables)
+        return 0;
+    pollPackets();
+    return _rx[cable].count;
+}
+
+int ESPNATIVEUSBMIDI::read(uint8_t cable) {
+    if (cable >= _n_cables)
+        return -1;
+    RxBuffer &rx = _rx[cable];
+    if (!rx.count)
+        pollPackets();
+    if (!rx.count)
+        return -1;
+    uint8_t b = rx.data[rx.head];
+    rx.head = (rx.head + 1) % ESPNATIVEUSBMIDI_RX_SIZE;
+    rx.count--;
+    return b;
+}
+
+bool ESPNATIVEUSBMIDI::flush(uint8_t cable) {
+    if (cable >= _n_cables)
+        return true;
+    TxStream &tx = _tx[cable];
+    if (tx.pending && tud_midi_packet_write(tx.packet))
+        tx.pending = false;
+    return !tx.pending;
+}
+
+void ESPNATIVEUSBMIDI::reset(uint8_t cable) {
+    if (cable < _n_cables)
+        memset(&_tx[cable], 0, sizeof(TxStream));
 }
 
-size_t ESPNATIVEUSBMIDI::write(uint8_t b) {
-    return tud_midi_stream_write(0, &b, 1);
+// Same packing as TinyUSB's tud_midi_stream_write(), with one stream state
+// per cable instead of one for the interface.
+size_t ESPNATIVEUSBMIDI::write(uint8_t cable, uint8_t b) {
+    if (cable >= _n_cables || !flush(cable))
+        return 0;
+    TxStream &tx = _tx[cable];
+    uint8_t const cn = (uint8_t)(cable << 4);
+
+    if (tx.index == 0) {
+        // New event packet
+        uint8_t const msg = b >> 4;
+        tx.index = 2;
+        tx.packet[1] = b;
+        if ((tx.packet[0] & 0x0F) == MIDI_CIN_SYSEX_START) {
+            // Still inside a SysEx
+            if (b == MIDI_STATUS_SYSEX_END) {
+                tx.packet[0] = cn | MIDI_CIN_SYSEX_END_1BYTE;
+                tx.total = 2;
+            } else {
+                tx.total = 4;
+            }
+        } else if ((msg >= 0x8 && msg <= 0xB) || msg == 0xE) {
+            tx.packet[0] = cn | msg;
+            tx.total = 4;
+        } else if (msg == 0xC || msg == 0xD) {
+            tx.packet[0] = cn | msg;
+            tx.total = 3;
+        } else if (msg == 0xF) {
+            if (b == MIDI_STATUS_SYSEX_START) {
+                tx.packet[0] = cn | MIDI_CIN_SYSEX_START;
+                tx.total = 4;
+            } else if (b == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME ||
+                       b == MIDI_STATUS_SYSCOM_SONG_SELECT) {
+                tx.packet[0] = cn | MIDI_CIN_SYSCOM_2BYTE;
+                tx.total = 3;
+            } else if (b == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER) {
+                tx.packet[0] = cn | MIDI_CIN_SYSCOM_3BYTE;
+                tx.total = 4;
+            } else {
+                tx.packet[0] = cn | MIDI_CIN_SYSEX_END_1BYTE;
+                tx.total = 2;
+            }
+        } else {
+            // Stray data byte: send it on its own
+            tx.packet[0] = cn | 0x0F;
+            tx.total = 2;
+        }
+    } else {
+        // On-going packet
+        tx.packet[tx.index++] = b;
+        if ((tx.packet[0] & 0x0F) == MIDI_CIN_SYSEX_START && b == MIDI_STATUS_SYSEX_END) {
+            tx.packet[0] = cn | (uint8_t)(MIDI_CIN_SYSEX_START + (tx.index - 1));
+            tx.total = tx.index;
+        }
+    }
+
+    if (tx.index == tx.total) {
+        for (uint8_t i = tx.total; i < 4; i++)
+            tx.packet[i] = 0;
+        tx.index = tx.total = 0;
+        tx.pending = !tud_midi_packet_write(tx.packet);
+    }
+    return 1;
 }
 
 void ESPNATIVEUSBMIDI::sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel){
@@ -13,6 +13,15 @@
 #include "class/midi/midi.h"
 #include "class/midi/midi_device.h"
 
+// Virtual cables the device can expose, and bytes buffered per cable on the
+// way in. Override from the build flags.
+#ifndef ESPNATIVEUSBMIDI_MAX_CABLES
+#define ESPNATIVEUSBMIDI_MAX_CABLES 4
+#endif
+#ifndef ESPNATIVEUSBMIDI_RX_SIZE
+#define ESPNATIVEUSBMIDI_RX_SIZE 128
+#endif
+
 enum MidiMessageCodes : uint8_t {
     NoteOff = 0x80,
     NoteOn = 0x90,
@@ -20,7 +29,10 @@ enum MidiMessageCodes : uint8_t {
 
 class ESPNATIVEUSBMIDI {
 public:
-    ESPNATIVEUSBMIDI(void);
+    // One MIDI streaming interface with `cables` virtual cables (ports), each
+    // with its own embedded IN/OUT jacks. Only the first instance registers
+    // with TinyUSB.
+    ESPNATIVEUSBMIDI(uint8_t cables = 1);
 
     bool begin(void);
     // for MIDI library
@@ -36,6 +48,26 @@ public:
     void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel = 1);
     void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel = 1);
 
+    uint8_t cables(void) const { return _n_cables; }
+    // Name the host shows for a cable's jacks. Call before USB.begin().
+    void setCableName(uint8_t cable, const char *name);
+
+    // Per-cable streams; available(), read() and write() above use cable 0.
+    // Incoming event packets are sorted into a buffer per cable, and outgoing
+    // bytes are packed into event packets per cable, so messages on different
+    // cables may be interleaved byte by byte.
+    int available(uint8_t cable);
+    int read(uint8_t cable);
+    // Returns 0, without taking b, while the IN endpoint FIFO is full.
+    size_t write(uint8_t cable, uint8_t b);
+    // Retries a packet the FIFO refused; true once nothing is held back.
+    bool flush(uint8_t cable);
+    // Drops a partly packed or held-back packet, e.g. when the rest of its
+    // message won't be sent.
+    void reset(uint8_t cable);
+    // Configured by the host.
+    bool mounted(void) { return tud_midi_mounted(); }
+
 
     // from Adafruit_USBD_Interface
     virtual uint16_t getInterfaceDescriptor(uint8_t itfnum, uint8_t *buf,
@@ -46,8 +78,26 @@ public:
                          uint8_t ep_in, uint8_t ep_out);
 
 private:
+    struct TxStream {
+        uint8_t packet[4];
+        uint8_t index;
+        uint8_t total;
+        bool pending;     // complete packet the FIFO had no room for
+    };
+    struct RxBuffer {
+        uint8_t data[ESPNATIVEUSBMIDI_RX_SIZE];
+        uint16_t head;
+        uint16_t count;
+    };
+
+    void pollPackets(void);
+
     uint8_t _n_cables;
     uint8_t _cable_name_strid[16];
+    TxStream _tx[ESPNATIVEUSBMIDI_MAX_CABLES];
+    RxBuffer _rx[ESPNATIVEUSBMIDI_MAX_CABLES];
+    uint8_t _rx_packet[4];
+    bool _rx_pending;     // _rx_packet waits for room in its cable's buffer
 };
 
 
@@ -0,0 +1,422 @@
+#include "_band.h"
+#include "_log.h"
+#include "esp_heap_caps.h"
+
+enum : uint8_t {
+  OP_FILL,      // fillRect
+  OP_FRAME,     // drawRect
+  OP_PIXEL,
+  OP_LINE,
+  OP_CHAR,
+  OP_FONT
+};
+
+// --- PaletteCanvas ---
+
+bool PaletteCanvas::begin() {
+  // GFXcanvas8 uses malloc(), which may hand out PSRAM for a buffer this size.
+  free(buffer);
+  buffer = (uint8_t *)heap_caps_malloc((size_t)WIDTH * HEIGHT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!buffer)
+    return false;
+  memset(buffer, 0, (size_t)WIDTH * HEIGHT);
+  index(0x0000); // index 0 is black, matching the cleared buffer
+  return true;
+}
+
+uint8_t PaletteCanvas::index(uint16_t color) {
+  if (_lastValid && color == _lastColor)
+    return _lastIndex;
+  uint16_t i = 0;
+  while (i < _count && _colors[i] != color)
+    i++;
+  if (i == _count) {
+    if (_count == 256) {
+      _misses++;
+      i = 0;
+    } else {
+      _colors[i] = color;
+      _swapped[i] = __builtin_bswap16(color);
+      _count++;
+    }
+  }
+  _lastColor = color;
+  _lastIndex = i;
+  _lastValid = true;
+  return i;
+}
+
+uint32_t PaletteCanvas::takeMisses() {
+  uint32_t misses = _misses;
+  _misses = 0;
+  return misses;
+}
+
+// Base-class calls are qualified so an index is never mapped a second time.
+void PaletteCanvas::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  GFXcanvas8::drawPixel(x, y, index(color));
+}
+
+void PaletteCanvas::fillScreen(uint16_t color) {
+  GFXcanvas8::fillScreen(index(color));
+}
+
+void PaletteCanvas::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  GFXcanvas8::drawFastVLine(x, y, h, index(color));
+}
+
+void PaletteCanvas::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  GFXcanvas8::drawFastHLine(x, y, w, index(color));
+}
+
+void PaletteCanvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  uint8_t idx = index(color);
+  for (int16_t i = 0; i < h; i++)
+    GFXcanvas8::drawFastHLine(x, y + i, w, idx);
+}
+
+// Eight indices per pass: two 32-bit loads, four 32-bit stores of two pixels
+// each. Rows are 320 pixels, so the tail loop only runs for odd requests.
+void PaletteCanvas::expand(const uint8_t *src, uint16_t *dst, uint32_t count) const {
+  const uint16_t *pal = _swapped;
+  uint32_t blocks = count / 8;
+  if (!((uintptr_t)src & 3) && !((uintptr_t)dst & 3)) {
+    const uint32_t *in = (const uint32_t *)src;
+    uint32_t *out = (uint32_t *)dst;
+    while (blocks--) {
+      uint32_t a = in[0], b = in[1];
+      out[0] = pal[a & 0xFF] | ((uint32_t)pal[(a >> 8) & 0xFF] << 16);
+      out[1] = pal[(a >> 16) & 0xFF] | ((uint32_t)pal[a >> 24] << 16);
+      out[2] = pal[b & 0xFF] | ((uint32_t)pal[(b >> 8) & 0xFF] << 16);
+      out[3] = pal[(b >> 16) & 0xFF] | ((uint32_t)pal[b >> 24] << 16);
+      in += 2;
+      out += 4;
+    }
+    src = (const uint8_t *)in;
+    dst = (uint16_t *)out;
+    count &= 7;
+  }
+  while (count--)
+    *dst++ = pal[*src++];
+}
+
+// --- BandCanvas ---
+
+bool BandCanvas::begin() {
+  free(buffer);
+  size_t bytes = (size_t)WIDTH * HEIGHT * sizeof(uint16_t);
+  buffer = (uint16_t *)heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  if (!buffer)
+    return false;
+  memset(buffer, 0, bytes);
+  return true;
+}
+
+// --- BandRenderer ---
+
+BandRenderer::BandRenderer(Adafruit_SPITFT &display)
+    : Adafruit_GFX(DISPLAY_WIDTH, DISPLAY_HEIGHT), _display(display), _opCount(0),
+      _covered(false), _recording(false), _inChar(false), _recordedFont(NULL),
+      _frameStartUs(0) {
+  _bands[0] = _bands[1] = NULL;
+  _frame = NULL;
+  _expandBuf[0] = _expandBuf[1] = NULL;
+  memset(&_stats, 0, sizeof(_stats));
+  memset(&_report, 0, sizeof(_report));
+}
+
+bool BandRenderer::begin() {
+#if RENDER_PALETTE8
+  _frame = new PaletteCanvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  _expandBuf[0] = (uint16_t *)heap_caps_malloc(2 * PALETTE_EXPAND_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+  if (_frame && _frame->begin() && _expandBuf[0]) {
+    _expandBuf[1] = _expandBuf[0] + PALETTE_EXPAND_PIXELS;
+    return true;
+  }
+  LOGW("Palette frame doesn't fit in internal RAM, using bands");
+  delete _frame;
+  _frame = NULL;
+  heap_caps_free(_expandBuf[0]);
+  _expandBuf[0] = NULL;
+#endif
+  for (int i = 0; i < 2; i++) {
+    _bands[i] = new BandCanvas(DISPLAY_WIDTH, BAND_HEIGHT);
+    if (!_bands[i] || !_bands[i]->begin()) {
+      LOGE("Band renderer: not enough DMA memory, drawing directly");
+      delete _bands[0];
+      delete _bands[1];
+      _bands[0] = _bands[1] = NULL;
+      return false;
+    }
+  }
+  return true;
+}
+
+void BandRenderer::beginFrame() {
+  _opCount = 0;
+  _covered = false;
+  _recordedFont = NULL;
+  _recording = true;
+  _frameStartUs = micros();
+}
+
+void BandRenderer::endFrame() {
+  if (!_recording)
+    return;
+  _stats.recordUs = micros() - _frameStartUs;
+  _stats.ops = _opCount;
+  flush();
+  _recording = false;
+
+  _report.frames++;
+  _report.maxOps = max(_report.maxOps, (uint32_t)_stats.ops);
+  _report.maxRasterUs = max(_report.maxRasterUs, _stats.rasterUs);
+  _report.maxExpandUs = max(_report.maxExpandUs, _stats.expandUs);
+  _report.maxPushUs = max(_report.maxPushUs, _stats.pushUs);
+  _report.totalPushUs += _stats.pushUs;
+}
+
+BandReport BandRenderer::takeReport() {
+  BandReport r = _report;
+  if (_frame)
+    r.paletteMisses = _frame->takeMisses();
+  memset(&_report, 0, sizeof(_report));
+  return r;
+}
+
+void BandRenderer::printReport() {
+  BandReport r = takeReport();
+  Serial.printf("Band %lu frames (%lu direct), max %lu ops, raster %lu us, expand %lu us, "
+                "push avg %lu max %lu us; %lu early flushes, %lu palette misses\n",
+                (unsigned long)r.frames, (unsigned long)r.direct, (unsigned long)r.maxOps,
+                (unsigned long)r.maxRasterUs, (unsigned long)r.maxExpandUs,
+                (unsigned long)(r.frames ? r.totalPushUs / r.frames : 0), (unsigned long)r.maxPushUs,
+                (unsigned long)r.earlyFlushes, (unsigned long)r.paletteMisses);
+}
+
+// --- Recording ---
+
+void BandRenderer::reserve(uint16_t count) {
+  if (_opCount + count > BAND_MAX_OPS) {
+    // Show what we have; the rest of the frame draws over it without a fill.
+    _report.earlyFlushes++;
+    LOGD("Band renderer: display list full, flushing early");
+    flush();
+  }
+}
+
+void BandRenderer::record(uint8_t type, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (_inChar)
+    return;
+  reserve(1);
+  DrawOp &op = _ops[_opCount++];
+  op.type = type;
+  op.x = x;
+  op.y = y;
+  op.w = w;
+  op.h = h;
+  op.color = color;
+}
+
+void BandRenderer::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x >= 0 && y >= 0 && x < _width && y < _height)
+    record(OP_PIXEL, x, y, 1, 1, color);
+}
+
+void BandRenderer::writePixel(int16_t x, int16_t y, uint16_t color) {
+  drawPixel(x, y, color);
+}
+
+void BandRenderer::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (x <= 0 && y <= 0 && x + w >= _width && y + h >= _height && !_inChar) {
+    // Everything recorded so far is hidden under this fill.
+    _opCount = 0;
+    _covered = true;
+    _recordedFont = NULL;
+  }
+  record(OP_FILL, x, y, w, h, color);
+}
+
+void BandRenderer::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  fillRect(x, y, w, h, color);
+}
+
+void BandRenderer::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void BandRenderer::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  record(OP_FILL, x, y, 1, h, color);
+}
+
+void BandRenderer::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  record(OP_FILL, x, y, w, 1, color);
+}
+
+void BandRenderer::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  drawFastVLine(x, y, h, color);
+}
+
+void BandRenderer::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  drawFastHLine(x, y, w, color);
+}
+
+void BandRenderer::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  record(OP_LINE, x0, y0, x1, y1, color);
+}
+
+void BandRenderer::writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  drawLine(x0, y0, x1, y1, color);
+}
+
+void BandRenderer::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  record(OP_FRAME, x, y, w, h, color);
+}
+
+size_t BandRenderer::write(uint8_t c) {
+  reserve(2); // keep a FONT/CHAR pair in the same list
+  if (gfxFont != _recordedFont) {
+    record(OP_FONT, 0, 0, 0, 0, 0);
+    _ops[_opCount - 1].font = gfxFont;
+    _recordedFont = gfxFont;
+  }
+  // Record the character at the pre-wrap cursor; replaying it through write()
+  // on a target of the same width makes the same wrap decision.
+  record(OP_CHAR, cursor_x, cursor_y, 0, 0, textcolor);
+  DrawOp &op = _ops[_opCount - 1];
+  op.ch = c;
+  op.sizeX = textsize_x | (wrap ? 0x80 : 0);
+  op.sizeY = textsize_y;
+  op.bg = textbgcolor;
+
+  // Let Adafruit_GFX advance the cursor; its drawChar() pixels aren't recorded.
+  _inChar = true;
+  Adafruit_GFX::write(c);
+  _inChar = false;
+  return 1;
+}
+
+// --- Playback ---
+
+void BandRenderer::replayTo(Adafruit_GFX &target, int16_t top, int16_t bottom) {
+  const GFXfont *font = NULL;
+  target.setFont(NULL);
+  for (uint16_t i = 0; i < _opCount; i++) {
+    const DrawOp &op = _ops[i];
+    int16_t y0 = op.y, y1;
+    switch (op.type) {
+      case OP_LINE:
+        y0 = min(op.y, op.h);
+        y1 = max(op.y, op.h);
+        break;
+      case OP_CHAR: {
+        // Glyphs may sit above the cursor (custom fonts) or wrap one line down.
+        int16_t line = (font ? font->yAdvance : 8) * op.sizeY;
+        y0 = op.y - line;
+        y1 = op.y + 2 * line;
+        break;
+      }
+      case OP_FONT:
+        font = op.font;
+        target.setFont(font);
+        continue;
+      default:
+        y1 = op.y + op.h - 1;
+        break;
+    }
+    if (y1 < top || y0 >= bottom)
+      continue;
+
+    switch (op.type) {
+      case OP_FILL:
+        target.fillRect(op.x, op.y - top, op.w, op.h, op.color);
+        break;
+      case OP_FRAME:
+        target.drawRect(op.x, op.y - top, op.w, op.h, op.color);
+        break;
+      case OP_PIXEL:
+        target.drawPixel(op.x, op.y - top, op.color);
+        break;
+      case OP_LINE:
+        target.drawLine(op.x, op.y - top, op.w, op.h - top, op.color);
+        break;
+      case OP_CHAR:
+        target.setTextSize(op.sizeX & 0x7F, op.sizeY);
+        target.setTextWrap(op.sizeX & 0x80);
+        target.setTextColor(op.color, op.bg);
+        target.setCursor(op.x, op.y - top);
+        target.write(op.ch);
+        break;
+    }
+  }
+}
+
+void BandRenderer::flush() {
+  unsigned long start = micros();
+  _stats.rasterUs = 0;
+  _stats.bands = 0;
+  _stats.expandUs = 0;
+
+  if (!_covered || !ready()) {
+    // No known background to rasterize onto: draw the calls directly.
+    _report.direct++;
+    replayTo(_display, 0, _height);
+  } else if (paletteMode()) {
+    pushPalette();
+  } else {
+    pushBands();
+  }
+
+  _stats.pushUs = micros() - start;
+  _opCount = 0;
+  _covered = false;
+  _recordedFont = NULL;
+}
+
+void BandRenderer::pushBands() {
+  _display.startWrite();
+  _display.setAddrWindow(0, 0, _width, _height);
+  int b = 0;
+  for (int16_t top = 0; top < _height; top += BAND_HEIGHT, b ^= 1) {
+    int16_t rows = min((int16_t)BAND_HEIGHT, (int16_t)(_height - top));
+    BandCanvas *band = _bands[b];
+
+    // This canvas was last sent two bands ago; dmaWait() before each push
+    // keeps at most one band on the bus, so it is free again by now.
+    unsigned long rasterStart = micros();
+    replayTo(*band, top, top + rows);
+    band->byteSwap();
+    _stats.rasterUs += micros() - rasterStart;
+
+    _display.dmaWait();
+    _display.writePixels(band->getBuffer(), (uint32_t)DISPLAY_WIDTH * rows, false, true);
+    _stats.bands++;
+  }
+  _display.endWrite();
+}
+
+void BandRenderer::pushPalette() {
+  unsigned long rasterStart = micros();
+  replayTo(*_frame, 0, _height);
+  _stats.rasterUs = micros() - rasterStart;
+
+  // Expand a few lines into one buffer while the other is on the bus.
+  const uint8_t *src = _frame->getBuffer();
+  uint32_t remaining = (uint32_t)DISPLAY_WIDTH * DISPLAY_HEIGHT;
+  int b = 0;
+  _display.startWrite();
+  _display.setAddrWindow(0, 0, _width, _height);
+  while (remaining) {
+    uint32_t count = remaining < PALETTE_EXPAND_PIXELS ? remaining : PALETTE_EXPAND_PIXELS;
+    unsigned long expandStart = micros();
+    _frame->expand(src, _expandBuf[b], count);
+    _stats.expandUs += micros() - expandStart;
+
+    _display.dmaWait();
+    _display.writePixels(_expandBuf[b], count, false, true);
+    src += count;
+    remaining -= count;
+    b ^= 1;
+  }
+  _display.endWrite();
+}
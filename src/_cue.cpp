@@ -0,0 +1,214 @@
+#include "_cue.h"
+#include "_state.h"
+#include "_transport.h"
+#include "_progress.h"
+#include "_log.h"
+#include <esp_timer.h>
+
+struct CueEntry {
+  uint32_t serial;     // tells a cancelled head from its replacement
+  int track;
+  uint8_t length;
+  byte sysex[MIDI_PLAY_MAX_BYTES];
+};
+
+static CueEntry queue[CUE_QUEUE_DEPTH];
+static uint8_t queued = 0;
+static uint32_t nextSerial = 1;
+static portMUX_TYPE cueLock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_timer_handle_t launchTimer = NULL;
+static TaskHandle_t midiTask = NULL;
+static volatile bool timerFired = false;
+
+// MIDI task only.
+static bool armed = false;
+static uint32_t armedSerial = 0;
+static uint32_t targetUs = 0;
+static uint32_t launchTick = 0;      // NEXT_BAR: bar line chosen for the head, 0 = none yet
+static bool wasPlaying = false;
+static uint32_t presetVersion = 0;
+static int autoCuedTrack = -1;       // the track CUE_AUTO_ADVANCE last cued after
+static ProgressTracker tracker;
+
+static uint32_t launched = 0;
+static uint64_t totalLateUs = 0;
+static uint32_t maxLateUs = 0;
+
+void CueQueue::begin() {
+  midiTask = xTaskGetCurrentTaskHandle();
+  esp_timer_create_args_t args = {};
+  args.callback = onTimer;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "cue";
+  if (esp_timer_create(&args, &launchTimer) != ESP_OK)
+    LOGE("Cue timer not created, cues will launch on the next poll");
+}
+
+// esp_timer task: hand over to the MIDI task, which owns USB.
+void CueQueue::onTimer(void *arg) {
+  timerFired = true;
+  xTaskNotifyGive(midiTask);
+}
+
+void CueQueue::publish() {
+  portENTER_CRITICAL(&cueLock);
+  int head = queued ? queue[0].track : -1;
+  uint8_t depth = queued;
+  portEXIT_CRITICAL(&cueLock);
+  StateStore::setCue(head, depth);
+}
+
+// Called from the web server and the MIDI task, so songs come from
+// StateStore's table: the loop may be replacing loadedPreset meanwhile.
+bool CueQueue::cueNext() {
+  AppState state = StateStore::get();
+  bool ok = false;
+  portENTER_CRITICAL(&cueLock);
+  int next = (queued ? queue[queued - 1].track : state.track) + 1;
+  SongRef song;
+  if (queued < CUE_QUEUE_DEPTH && StateStore::song(next, song)) {
+    CueEntry &e = queue[queued++];
+    e.serial = nextSerial++;
+    e.track = next;
+    e.length = Midi::buildPlay(song.songIndex, e.sysex);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&cueLock);
+  if (ok) {
+    LOGI("Cued track %d", next);
+    publish();
+  }
+  return ok;
+}
+
+bool CueQueue::cancelLast() {
+  portENTER_CRITICAL(&cueLock);
+  bool ok = queued > 0;
+  if (ok)
+    queued--;
+  portEXIT_CRITICAL(&cueLock);
+  if (ok)
+    publish();
+  return ok;
+}
+
+// MIDI task.
+void CueQueue::clear() {
+  portENTER_CRITICAL(&cueLock);
+  queued = 0;
+  portEXIT_CRITICAL(&cueLock);
+  if (armed && launchTimer)
+    esp_timer_stop(launchTimer);
+  armed = false;
+  launchTick = 0;
+  publish();
+}
+
+void CueQueue::launch() {
+  armed = false;
+  launchTick = 0;
+  CueEntry e;
+  portENTER_CRITICAL(&cueLock);
+  bool current = queued > 0 && queue[0].serial == armedSerial;
+  if (current) {
+    e = queue[0];
+    memmove(&queue[0], &queue[1], (queued - 1) * sizeof(CueEntry));
+    queued--;
+  }
+  portEXIT_CRITICAL(&cueLock);
+  if (!current)
+    return;   // cancelled after the timer was started
+
+  Midi::sendSysEx(e.sysex, e.length);
+  Midi::flush();
+  int32_t late = (int32_t)(micros() - targetUs);
+  if (late < 0)
+    late = 0;
+  launched++;
+  totalLateUs += late;
+  if ((uint32_t)late > maxLateUs)
+    maxLateUs = late;
+
+  StateStore::cueLaunched(e.track);
+  publish();
+  LOGI("Cue launched track %d, %ld us after its target", e.track, (long)late);
+}
+
+void CueQueue::update() {
+  if (timerFired) {
+    timerFired = false;
+    launch();
+  }
+
+  AppState state = StateStore::get();
+  // Cues belong to the set that is playing.
+  if ((wasPlaying && !state.playing) || state.presetVersion != presetVersion) {
+    clear();
+    autoCuedTrack = -1;
+  }
+  wasPlaying = state.playing;
+  presetVersion = state.presetVersion;
+  if (!state.playing)
+    return;
+
+  portENTER_CRITICAL(&cueLock);
+  uint32_t head = queued ? queue[0].serial : 0;
+  portEXIT_CRITICAL(&cueLock);
+  if (armed && head != armedSerial) {
+    // The armed cue was cancelled.
+    esp_timer_stop(launchTimer);
+    armed = false;
+    launchTick = 0;
+  }
+  if (!head && CUE_AUTO_ADVANCE && autoCuedTrack != state.track) {
+    // Once per song, so a cue the user drops stays dropped.
+    autoCuedTrack = state.track;
+    if (cueNext())
+      return;   // armed from the next pass
+  }
+  if (!head || armed)
+    return;
+
+  uint32_t nowUs = micros();
+  uint32_t waitUs;
+  if ((CueLaunch)CUE_LAUNCH == CueLaunch::NEXT_BAR) {
+    const uint32_t bar = 24 * CUE_BEATS_PER_BAR;
+    if (!launchTick)
+      launchTick = (Transport::ticks() / bar + 1) * bar;
+    waitUs = Transport::usUntilTick(launchTick, nowUs);
+    if (waitUs == UINT32_MAX)
+      return;
+  } else {
+    SongProgress p = tracker.sample(nowUs);
+    if (!p.known || !p.lengthMs)
+      return;
+    waitUs = p.elapsedMs >= p.lengthMs ? 0 : (p.lengthMs - p.elapsedMs) * 1000;
+  }
+  if (waitUs > CUE_ARM_LEAD_MS * 1000UL)
+    return;
+  if (!launchTimer && waitUs > MIDI_POLL_MS * 1000UL)
+    return;   // no timer: launch from the last pass before the target
+
+  armed = true;
+  armedSerial = head;
+  targetUs = nowUs + waitUs;
+  if (!launchTimer || waitUs == 0 || esp_timer_start_once(launchTimer, waitUs) != ESP_OK)
+    launch();
+}
+
+CueStats CueQueue::stats() {
+  CueStats s;
+  s.launched = launched;
+  s.avgLateUs = launched ? totalLateUs / launched : 0;
+  s.maxLateUs = maxLateUs;
+  return s;
+}
+
+void CueQueue::printReport() {
+  CueStats s = stats();
+  AppState state = StateStore::get();
+  Serial.printf("Cue %u queued, next %d, %lu launched, late avg %lu us max %lu us\n",
+                state.cueDepth, state.cued, (unsigned long)s.launched,
+                (unsigned long)s.avgLateUs, (unsigned long)s.maxLateUs);
+}
@@ -1,4 +1,5 @@
 #include "_input.h"
+#include "_cue.h"
 
 Input::Input(XPT2046_Touchscreen &ts, Adafruit_ILI9341 &tft, UI *uiInstance)
   : ts(ts), tft(tft), ui(uiInstance)
@@ -11,14 +12,14 @@ void Input::handleTouch() {
     const unsigned long DEBOUNCE_MS = 200;
 
     int16_t tx, ty;
-    bool currentlyTouched = ui->getTouchCoordinates(tx, ty);
+    bool currentlyTouched = InputLog::readTouch(*ui, tx, ty);
 
         // if (currentlyTouched) {
         //     ui->getDisplay().fillCircle(tx, ty, 3, ILI9341_RED);
         // }
 
     if (!wasTouched && currentlyTouched) {
-        unsigned long now = millis();
+        unsigned long now = InputLog::now();
         if (now - lastTouchTime > DEBOUNCE_MS) {
         lastTouchTime = now;
         ScreenState cs = ui->getScreenState();
@@ -41,7 +42,7 @@ void Input::handleTouch() {
                     ui->setScreenState(ScreenState::NEW_SETLIST);
                     newSetlistScanned = false;
                     songsReady = false;
-                    memset(selectedSongs, 0, sizeof(selectedSongs));
+                    selectedSongs.clear();
                     selectedTrackCount = 0;
                     scrollOffset = 0;
                     currentMenuItem = 0;
@@ -71,7 +72,7 @@ void Input::handleTouch() {
             } else {
                 int touchedIndex = (ty - 60) / 30 + scrollOffset;
                 if (touchedIndex >= 0 && touchedIndex < currentProject.songCount) {
-                selectedSongs[touchedIndex] = !selectedSongs[touchedIndex];
+                selectedSongs.toggle(touchedIndex);
                 selectedTrackCount += selectedSongs[touchedIndex] ? 1 : -1;
                 ui->drawSongList();
                 ui->updateSelectedSongCount();
@@ -127,6 +128,8 @@ void Input::handleTouch() {
                     Serial.println(selectedPresetSlot);
                     if (menu1Index == 1) {
                         loadedPreset = ps::loadPresetFromDevice(selectedPresetSlot);
+                        StateStore::presetLoaded();
+                        ps::rememberLastPreset(selectedPresetSlot);
                         ui->setScreenState(ScreenState::HOME);
                     } else if (menu1Index == 3) {
                         ps::deletePresetFromDevice(selectedPresetSlot);
@@ -143,10 +146,15 @@ void Input::handleTouch() {
               if (ui->isTouch(tx, ty, BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT))
                   ui->setScreenState(ScreenState::EDIT_SETLIST);
               else if (ui->isTouch(tx, ty, SAVE_BUTTON_X, SAVE_BUTTON_Y, SAVE_BUTTON_WIDTH, SAVE_BUTTON_HEIGHT)) {
+                  int count = min(selectedTrackCount, selectedProject.songCount);
+                  if (!loadedPreset.data.songs.reserve(count)) {
+                      LOGE("Save: no room for %d songs", count);
+                      break;
+                  }
                   strcpy(loadedPreset.name, setlistName);
                   strcpy(loadedPreset.data.projectName, selectedProject.projectName);
-                  loadedPreset.data.songCount = selectedTrackCount;
-                  for (int i = 0; i < selectedTrackCount; i++) {
+                  loadedPreset.data.songCount = count;
+                  for (int i = 0; i < loadedPreset.data.songCount; i++) {
                       loadedPreset.data.songs[i] = selectedProject.songs[i];
                       loadedPreset.data.songs[i].songIndex = selectedProject.songs[i].songIndex;
                       loadedPreset.data.songs[i].changedIndex = selectedProject.songs[i].changedIndex;
@@ -155,6 +163,8 @@ void Input::handleTouch() {
                   Serial.print(F("✅ Setlist Saved in: "));
                   Serial.println(selectedPresetSlot);
                   loadedPreset = ps::loadPresetFromDevice(selectedPresetSlot);
+                  StateStore::presetLoaded();
+                  ps::rememberLastPreset(selectedPresetSlot);
                   isReorderedSongsInitialized = false;
                   ui->setScreenState(ScreenState::HOME);
               }
@@ -339,15 +349,15 @@ void Input::handleTouch() {
                             selectedSSID.c_str(), wifiPassword);
 
                 WiFi.disconnect(true);
-                delay(1000);  // Wait for a second before reconnecting
+                InputLog::sleep(1000);  // Wait for a second before reconnecting
                 WiFi.mode(WIFI_STA);
                 WiFi.persistent(false);  // Don't save the connection to flash
                 WiFi.setAutoConnect(false);
                 WiFi.setAutoReconnect(false);
                 WiFi.setSleep(false);  // Disable sleep mode
                 WiFi.begin(selectedSSID.c_str(), wifiPassword);
-                Serial.printf("SSID length: %d, Password length: %d\n", 
-                    selectedSSID.length(), strlen(wifiPassword));
+                Serial.printf("SSID length: %u, Password length: %u\n", 
+                    (unsigned)selectedSSID.length(), (unsigned)strlen(wifiPassword));
 
                 ui->setScreenState(ScreenState::MENU2_WIFICONNECTING);
 
@@ -379,8 +389,8 @@ void Input::handleTouch() {
 
 void Input::handleRotary() {
     // Read the rotary encoder pins
-    bool clkState = digitalRead(ENC_CLK);
-    bool dtState = digitalRead(ENC_DT);
+    bool clkState = InputLog::readPin(ENC_CLK);
+    bool dtState = InputLog::readPin(ENC_DT);
     static bool lastClkState = clkState;
     ScreenState cs = ui->getScreenState();
 
@@ -399,11 +409,10 @@ void Input::handleRotary() {
                 // Update currentMenuItem based on encoder input:
                 if (dtState != clkState) {
                     currentMenuItem = (currentMenuItem + 1) % NUM_MENU_ITEMS;
-                    Serial.println(currentMenuItem);
                 } else {
                     currentMenuItem = (currentMenuItem - 1 + NUM_MENU_ITEMS) % NUM_MENU_ITEMS;
-                    Serial.println(currentMenuItem);
-                } 
+                }
+                LOGD("Menu item %d", currentMenuItem);
                 // Update only the two items that changed.
                 ui->updateMenuSelection(prevIndex, currentMenuItem);
               }
@@ -455,33 +464,15 @@ void Input::handleRotary() {
                       
                       // Handle reordering with wrap-around.
                       if (dtState != clkState) {  // Clockwise rotation.
-                          if (reorderTarget == total - 1) {
-                              // Wrap-around: swap the last song with the first.
-                              SongInfo temp = selectedProject.songs[total - 1];
-                              selectedProject.songs[total - 1] = selectedProject.songs[0];
-                              selectedProject.songs[0] = temp;
-                              reorderTarget = 0;
-                          } else {
-                              // Normal swap downward.
-                              SongInfo temp = selectedProject.songs[reorderTarget];
-                              selectedProject.songs[reorderTarget] = selectedProject.songs[reorderTarget + 1];
-                              selectedProject.songs[reorderTarget + 1] = temp;
-                              reorderTarget++;
-                          }
+                          // Past the last song, swap it with the first.
+                          int next = reorderTarget == total - 1 ? 0 : reorderTarget + 1;
+                          if (selectedProject.swapSongs(reorderTarget, next))
+                              reorderTarget = next;
                       } else {  // Counter-clockwise rotation.
-                          if (reorderTarget == 0) {
-                              // Wrap-around: swap the first song with the last.
-                              SongInfo temp = selectedProject.songs[0];
-                              selectedProject.songs[0] = selectedProject.songs[total - 1];
-                              selectedProject.songs[total - 1] = temp;
-                              reorderTarget = total - 1;
-                          } else {
-                              // Normal swap upward.
-                              SongInfo temp = selectedProject.songs[reorderTarget];
-                              selectedProject.songs[reorderTarget] = selectedProject.songs[reorderTarget - 1];
-                              selectedProject.songs[reorderTarget - 1] = temp;
-                              reorderTarget--;
-                          }
+                          // Past the first song, swap it with the last.
+                          int next = reorderTarget == 0 ? total - 1 : reorderTarget - 1;
+                          if (selectedProject.swapSongs(reorderTarget, next))
+                              reorderTarget = next;
                       }
                       
                       // Adjust scrollOffset with wrap-around.
@@ -648,7 +639,7 @@ void Input::handleRotary() {
           encoderLastState = clkState;
 
     // Handle rotary encoder button.
-    bool btnState = digitalRead(ENC_SW);
+    bool btnState = InputLog::readPin(ENC_SW);
     if (btnState == LOW && encoderButtonState == HIGH) {
         switch (cs) {
         case ScreenState::HOME:
@@ -679,13 +670,12 @@ void Input::handleRotary() {
                     break;
             }
             menu1Index = ui->getCurrentMenuItem();  // Update the global menu1Index variable.
-            Serial.print(F("Menu1 Index: "));
-            Serial.println(menu1Index);
+            LOGD("Menu1 index %d", menu1Index);
             break;
           case ScreenState::NEW_SETLIST:
             if (currentProject.songCount > 0) {
                 // Toggle the selection of the current song.
-                selectedSongs[currentSongItem] = !selectedSongs[currentSongItem];
+                selectedSongs.toggle(currentSongItem);
                 selectedTrackCount += selectedSongs[currentSongItem] ? 1 : -1;
                 ui->drawSongListItem(currentSongItem, true);
                 
@@ -711,6 +701,8 @@ void Input::handleRotary() {
             Serial.println(selectedPresetSlot);
             if (menu1Index == 1) {
                 loadedPreset = ps::loadPresetFromDevice(selectedPresetSlot);
+                StateStore::presetLoaded();
+                ps::rememberLastPreset(selectedPresetSlot);
                 ui->setScreenState(ScreenState::HOME);
             } else if (menu1Index == 3) {
                 ps::deletePresetFromDevice(selectedPresetSlot);
@@ -724,7 +716,7 @@ void Input::handleRotary() {
             if (currentMenu2Item == 0) {
                 ui->setScreenState(ScreenState::MENU2_WIFISETTINGS);
             } else if (currentMenu2Item == 1) {
-            // Device Settings placeholder
+                ui->setScreenState(ScreenState::DEVICE_PROPERTIES);
             } else if (currentMenu2Item == 2) {
                 ui->setScreenState(ScreenState::HOME);
             }
@@ -749,6 +741,9 @@ void Input::handleRotary() {
             ui->setScreenState(ScreenState::MENU2_WIFIPASS);
             }
             break;
+        case ScreenState::DEVICE_PROPERTIES:
+            ui->setScreenState(ScreenState::MENU2);
+            break;
         default:
             break;
         }
@@ -762,19 +757,17 @@ void Input::StartButton() {
   static unsigned long lastDebounceTime = 0;
   const unsigned long debounceDelay = 20;
 
-  bool currentRawState = (digitalRead(BTN_START) == LOW);
+  bool currentRawState = (InputLog::readPin(BTN_START) == LOW);
   if (currentRawState != lastRawState) {
-      lastDebounceTime = millis();
+      lastDebounceTime = InputLog::now();
       lastRawState = currentRawState;
   }
-  if ((millis() - lastDebounceTime) > debounceDelay) {
+  if ((InputLog::now() - lastDebounceTime) > debounceDelay) {
       if (currentRawState != debouncedState) {
           debouncedState = currentRawState;
           if (debouncedState) { // Button pressed
-              isPlaying = true;
-              Midi::Play(loadedPreset.data.songs[currentTrack].songIndex);
-              // Update only the track display region so that the text turns green.
-              ui->drawLoadedPreset();
+              // The MIDI task sends Play and the UI turns the song green.
+              StateStore::play();
           }
 
       }
@@ -787,19 +780,16 @@ void Input::StopButton() {
   static unsigned long lastDebounceTime = 0;
   const unsigned long debounceDelay = 20;
 
-  bool currentRawState = (digitalRead(BTN_STOP) == LOW);
+  bool currentRawState = (InputLog::readPin(BTN_STOP) == LOW);
   if (currentRawState != lastRawState) {
-      lastDebounceTime = millis();
+      lastDebounceTime = InputLog::now();
       lastRawState = currentRawState;
   }
-  if ((millis() - lastDebounceTime) > debounceDelay) {
+  if ((InputLog::now() - lastDebounceTime) > debounceDelay) {
       if (currentRawState != debouncedState) {
           debouncedState = currentRawState;
           if (debouncedState) { // Button pressed.
-              Midi::Stop();
-              isPlaying = false;
-              // Update only the track display region so that the text returns to normal color.
-              ui->drawLoadedPreset();
+              StateStore::stop();
           }
       }
   }
@@ -810,24 +800,23 @@ void Input::LeftButton() {
   static unsigned long lastPressTime = 0;
   const unsigned long debounceDelay = 200; // milliseconds
 
-  bool btnLeftState = digitalRead(BTN_LEFT);
+  bool btnLeftState = InputLog::readPin(BTN_LEFT);
   
   // Check for transition from not-pressed to pressed.
   if (lastLeftState == HIGH && btnLeftState == LOW) {
-    if (!isPlaying) {
-        if (millis() - lastPressTime > debounceDelay) {
-            // Trigger event only once per press.
-            if (selectedPresetSlot != -1 && totalTracks > 0) {
-                currentTrack = (currentTrack - 1 + totalTracks) % totalTracks;
-                Serial.println(F("Moved to previous track"));
-                presetChanged = true;  // Mark that the track has changed.
-                // Update the homepage preset display partially.
-                ui->drawLoadedPreset();
-            } else {
-                Serial.println(F("No tracks available to navigate (left)."));
-            }
-            lastPressTime = millis();
+    if (InputLog::now() - lastPressTime > debounceDelay) {
+        // Trigger event only once per press.
+        if (StateStore::get().playing) {
+            // Drop the last cued song.
+            if (!CueQueue::cancelLast())
+                LOGW("No cued song to drop");
+        } else if (selectedPresetSlot != -1 && StateStore::stepTrack(-1)) {
+            LOGI("Moved to previous track");
+            presetChanged = true;  // Mark that the track has changed.
+        } else {
+            LOGW("No tracks available to navigate (left)");
         }
+        lastPressTime = InputLog::now();
     }
   }
   lastLeftState = btnLeftState;
@@ -838,21 +827,21 @@ void Input::RightButton() {
   static unsigned long lastPressTime = 0;
   const unsigned long debounceDelay = 200; // milliseconds
 
-  bool btnRightState = digitalRead(BTN_RIGHT);
+  bool btnRightState = InputLog::readPin(BTN_RIGHT);
   
   if (lastRightState == HIGH && btnRightState == LOW) {
-    if (!isPlaying) {
-        if (millis() - lastPressTime > debounceDelay) {
-            if (selectedPresetSlot != -1 && totalTracks > 0) {
-                currentTrack = (currentTrack + 1) % totalTracks;
-                Serial.println(F("Moved to next track"));
-                presetChanged = true;  // Mark that the track has changed.
-                ui->drawLoadedPreset();
-            } else {
-                Serial.println(F("No tracks available to navigate (right)."));
-            }
-            lastPressTime = millis();
+    if (InputLog::now() - lastPressTime > debounceDelay) {
+        if (StateStore::get().playing) {
+            // Queue the song after the last cued one.
+            if (!CueQueue::cueNext())
+                LOGW("Nothing more to cue");
+        } else if (selectedPresetSlot != -1 && StateStore::stepTrack(1)) {
+            LOGI("Moved to next track");
+            presetChanged = true;  // Mark that the track has changed.
+        } else {
+            LOGW("No tracks available to navigate (right)");
         }
+        lastPressTime = InputLog::now();
     }
   }
   lastRightState = btnRightState;
@@ -860,16 +849,13 @@ void Input::RightButton() {
 
 void Input::handleVolume() {
     static byte lastMidiVolume = 255;
-    int potValue = analogRead(POT_VOL);
+    int potValue = InputLog::readAnalog(POT_VOL);
     // Serial.println(potValue);
     byte midiVol = map(potValue, 0, 4095, 0, 127);
     
     if (midiVol != lastMidiVolume) {
       lastMidiVolume = midiVol;
-      currentVolume = midiVol;
-      // Call your MIDI volume function here; adjust as needed.
-      Midi::volume(midiVol);
-      if (ui->getScreenState() == ScreenState::HOME)
-        ui->displayVolume(); // Ensure displayVolume() exists in your UI class.
+      // The MIDI task sends the CC and the UI redraws the bar.
+      StateStore::setVolume(midiVol);
     }
   }
\ No newline at end of file
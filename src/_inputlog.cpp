@@ -0,0 +1,254 @@
+#include "_inputlog.h"
+#include "_ui.h"
+#include <LittleFS.h>
+
+#define INPUT_MAX_PINS 49          // GPIO0..48 on the ESP32-S3
+
+static const char LOG_MAGIC[4] = { 'I', 'N', 'P', '1' };
+
+InputMode InputLog::_mode = InputMode::LIVE;
+InputHandlerStats InputLog::_stats[(int)InputHandler::COUNT];
+
+static File logFile;
+static unsigned long startMs = 0;      // RECORD: millis() at t = 0; REPLAY: real start
+static uint32_t loggedBytes = 0;
+static uint32_t droppedEvents = 0;
+
+// RECORD: events waiting for update(), and the last value logged per channel,
+// which is also what reads return so a recorded session behaves like its replay.
+static InputEvent buffer[INPUT_LOG_BUFFER];
+static int buffered = 0;
+static unsigned long lastFlushMs = 0;
+
+// REPLAY: input state as of the virtual clock, and the next event to apply.
+static unsigned long clockBase = 0;
+static uint32_t virtualMs = 0;
+static InputEvent pending;
+static bool hasPending = false;
+static uint32_t lastEventMs = 0;
+
+// Both: current level per pin (-1 unknown), pot value and touch point.
+static int8_t  pinLevel[INPUT_MAX_PINS];
+static int16_t analogValue[INPUT_MAX_PINS];
+static bool    touched = false;
+static int16_t touchX = 0, touchY = 0;
+
+static void resetState(int8_t level, int16_t analog) {
+  memset(pinLevel, level, sizeof(pinLevel));
+  for (int i = 0; i < INPUT_MAX_PINS; i++)
+    analogValue[i] = analog;
+  touched = false;
+  touchX = touchY = 0;
+}
+
+bool InputLog::begin(InputMode mode) {
+  stop();
+  if (mode == InputMode::LIVE)
+    return true;
+
+  if (mode == InputMode::RECORD) {
+    logFile = LittleFS.open(INPUT_LOG_PATH, "w");
+    if (!logFile) {
+      Serial.println(F("Input log: cannot create " INPUT_LOG_PATH));
+      return false;
+    }
+    logFile.write((const uint8_t *)LOG_MAGIC, sizeof(LOG_MAGIC));
+    resetState(-1, -1);
+    buffered = 0;
+    loggedBytes = sizeof(LOG_MAGIC);
+    droppedEvents = 0;
+    startMs = lastFlushMs = millis();
+    Serial.println(F("Input log: recording to " INPUT_LOG_PATH));
+  } else {
+    logFile = LittleFS.open(INPUT_LOG_PATH, "r");
+    char magic[4];
+    if (!logFile || logFile.read((uint8_t *)magic, sizeof(magic)) != sizeof(magic) ||
+        memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) {
+      Serial.println(F("Input log: no recording at " INPUT_LOG_PATH));
+      if (logFile)
+        logFile.close();
+      return false;
+    }
+    // Buttons idle high (pull-ups) until the log says otherwise.
+    resetState(HIGH, 0);
+    clockBase = startMs = millis();
+    virtualMs = 0;
+    lastEventMs = 0;
+    hasPending = fetch();
+    memset(_stats, 0, sizeof(_stats));
+    Serial.printf("Input log: replaying %u bytes at %dx\n", (unsigned)logFile.size(), INPUT_REPLAY_SPEED);
+  }
+  _mode = mode;
+  return true;
+}
+
+void InputLog::stop() {
+  if (_mode == InputMode::RECORD) {
+    flush();
+    Serial.printf("Input log: recorded %lu ms, %u bytes, %u events dropped\n",
+                  millis() - startMs, loggedBytes, droppedEvents);
+  }
+  if (logFile)
+    logFile.close();
+  _mode = InputMode::LIVE;
+}
+
+unsigned long InputLog::now() {
+  return _mode == InputMode::REPLAY ? clockBase + virtualMs : millis();
+}
+
+void InputLog::sleep(unsigned long ms) {
+  if (_mode == InputMode::REPLAY) {
+    // delay(0) still yields, so the other tasks keep running.
+    virtualMs += ms;
+    delay(ms / INPUT_REPLAY_SPEED);
+  } else {
+    delay(ms);
+  }
+}
+
+int InputLog::readPin(uint8_t pin) {
+  if (_mode == InputMode::LIVE || pin >= INPUT_MAX_PINS)
+    return digitalRead(pin);
+  if (_mode == InputMode::REPLAY) {
+    apply();
+    return pinLevel[pin];
+  }
+  int level = digitalRead(pin);
+  if (level != pinLevel[pin]) {
+    pinLevel[pin] = level;
+    log(InputEventKind::PIN, pin, level, 0);
+  }
+  return level;
+}
+
+int InputLog::readAnalog(uint8_t pin) {
+  if (_mode == InputMode::LIVE || pin >= INPUT_MAX_PINS)
+    return analogRead(pin);
+  if (_mode == InputMode::REPLAY) {
+    apply();
+    return analogValue[pin];
+  }
+  // ADC noise would fill the log; only moves beyond the deadband are kept.
+  int value = analogRead(pin);
+  if (analogValue[pin] < 0 || abs(value - analogValue[pin]) >= INPUT_ADC_DEADBAND) {
+    analogValue[pin] = value;
+    log(InputEventKind::ANALOG, pin, value, 0);
+  }
+  return analogValue[pin];
+}
+
+bool InputLog::readTouch(UI &ui, int16_t &x, int16_t &y) {
+  if (_mode == InputMode::REPLAY) {
+    apply();
+  } else {
+    bool down = ui.getTouchCoordinates(x, y);
+    if (_mode == InputMode::LIVE)
+      return down;
+    if (down && (!touched || x != touchX || y != touchY))
+      log(InputEventKind::TOUCH, 0, x, y);
+    else if (!down && touched)
+      log(InputEventKind::RELEASE, 0, 0, 0);
+    touched = down;
+    if (down) {
+      touchX = x;
+      touchY = y;
+    }
+  }
+  if (touched) {
+    x = touchX;
+    y = touchY;
+  }
+  return touched;
+}
+
+void InputLog::log(InputEventKind kind, uint8_t pin, int16_t a, int16_t b) {
+  if (buffered == INPUT_LOG_BUFFER) {
+    droppedEvents++;
+    return;
+  }
+  InputEvent &e = buffer[buffered++];
+  e.t = millis() - startMs;
+  e.kind = (uint8_t)kind;
+  e.pin = pin;
+  e.a = a;
+  e.b = b;
+  e.reserved = 0;
+}
+
+void InputLog::flush() {
+  if (buffered == 0 || !logFile)
+    return;
+  logFile.write((const uint8_t *)buffer, buffered * sizeof(InputEvent));
+  logFile.flush();
+  loggedBytes += buffered * sizeof(InputEvent);
+  buffered = 0;
+  lastFlushMs = millis();
+}
+
+bool InputLog::fetch() {
+  return logFile.read((uint8_t *)&pending, sizeof(pending)) == sizeof(pending);
+}
+
+void InputLog::apply() {
+  while (hasPending && pending.t <= virtualMs) {
+    switch ((InputEventKind)pending.kind) {
+      case InputEventKind::PIN:
+        if (pending.pin < INPUT_MAX_PINS)
+          pinLevel[pending.pin] = pending.a;
+        break;
+      case InputEventKind::ANALOG:
+        if (pending.pin < INPUT_MAX_PINS)
+          analogValue[pending.pin] = pending.a;
+        break;
+      case InputEventKind::TOUCH:
+        touched = true;
+        touchX = pending.a;
+        touchY = pending.b;
+        break;
+      case InputEventKind::RELEASE:
+        touched = false;
+        break;
+    }
+    lastEventMs = pending.t;
+    hasPending = fetch();
+  }
+}
+
+void InputLog::update() {
+  if (_mode == InputMode::RECORD) {
+    if (buffered >= INPUT_LOG_BUFFER / 2 || (buffered > 0 && millis() - lastFlushMs >= 1000))
+      flush();
+    if (loggedBytes >= INPUT_LOG_MAX_BYTES) {
+      Serial.println(F("Input log: size limit reached"));
+      stop();
+    }
+  } else if (_mode == InputMode::REPLAY) {
+    apply();
+    // Give the handlers a second past the last event to settle.
+    if (!hasPending && virtualMs > lastEventMs + 1000) {
+      Serial.printf("Input log: replayed %lu ms of input in %lu ms\n",
+                    (unsigned long)virtualMs, millis() - startMs);
+      stop();
+      printProfile();
+    }
+  }
+}
+
+void InputLog::profile(InputHandler handler, uint32_t us) {
+  InputHandlerStats &s = _stats[(int)handler];
+  s.calls++;
+  s.totalUs += us;
+  if (us > s.maxUs)
+    s.maxUs = us;
+}
+
+void InputLog::printProfile() {
+  static const char *names[] = { "touch", "rotary", "start", "stop", "left", "right", "volume" };
+  Serial.println(F("Input handler   calls    avg us    max us   total ms"));
+  for (int i = 0; i < (int)InputHandler::COUNT; i++) {
+    const InputHandlerStats &s = _stats[i];
+    Serial.printf("  %-10s %8u %9u %9u %10u\n", names[i], s.calls,
+                  s.calls ? s.totalUs / s.calls : 0, s.maxUs, s.totalUs / 1000);
+  }
+}
@@ -0,0 +1,151 @@
+#include "_json.h"
+
+JsonWriter::JsonWriter(char *buf, size_t cap)
+  : _buf(buf), _cap(buf ? cap : 0), _len(0), _hasItems(0), _depth(0) {}
+
+void JsonWriter::put(char c) {
+  if (_len < _cap)
+    _buf[_len] = c;
+  _len++;
+}
+
+void JsonWriter::put(const char *s, size_t n) {
+  if (_len + n <= _cap)
+    memcpy(_buf + _len, s, n);
+  else if (_len < _cap)
+    memcpy(_buf + _len, s, _cap - _len);
+  _len += n;
+}
+
+// Comma before every item but the first at this level, then the key.
+void JsonWriter::member(const char *key) {
+  uint32_t bit = 1UL << (_depth & 31);
+  if (_hasItems & bit)
+    put(',');
+  _hasItems |= bit;
+  if (key) {
+    quoted(key);
+    put(':');
+  }
+}
+
+// Length of the UTF-8 sequence at s, or 0 if it isn't a valid one.
+static int utf8Length(const uint8_t *s) {
+  uint8_t c = s[0];
+  int n;
+  uint32_t min;
+  if (c < 0x80)
+    return 1;
+  if ((c & 0xE0) == 0xC0) {
+    n = 2;
+    min = 0x80;
+  } else if ((c & 0xF0) == 0xE0) {
+    n = 3;
+    min = 0x800;
+  } else if ((c & 0xF8) == 0xF0) {
+    n = 4;
+    min = 0x10000;
+  } else {
+    return 0;
+  }
+  uint32_t cp = c & (0x7F >> n);
+  for (int i = 1; i < n; i++) {
+    if ((s[i] & 0xC0) != 0x80)
+      return 0;   // also stops at the terminator
+    cp = (cp << 6) | (s[i] & 0x3F);
+  }
+  // Overlong forms, UTF-16 surrogates and code points past U+10FFFF.
+  if (cp < min || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+    return 0;
+  return n;
+}
+
+void JsonWriter::quoted(const char *s) {
+  static const char hex[] = "0123456789abcdef";
+  put('"');
+  const uint8_t *p = (const uint8_t *)(s ? s : "");
+  while (*p) {
+    // Runs of plain characters are the common case.
+    const uint8_t *run = p;
+    while (*p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\')
+      p++;
+    put((const char *)run, p - run);
+    if (!*p)
+      break;
+
+    uint8_t c = *p;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put((char)c);
+      p++;
+    } else if (c < 0x20) {
+      put('\\');
+      switch (c) {
+        case '\n': put('n'); break;
+        case '\r': put('r'); break;
+        case '\t': put('t'); break;
+        case '\b': put('b'); break;
+        case '\f': put('f'); break;
+        default:
+          put("u00", 3);
+          put(hex[c >> 4]);
+          put(hex[c & 15]);
+      }
+      p++;
+    } else {
+      int n = utf8Length(p);
+      if (n) {
+        put((const char *)p, n);
+        p += n;
+      } else {
+        put("\\ufffd", 6);
+        p++;
+      }
+    }
+  }
+  put('"');
+}
+
+void JsonWriter::beginObject(const char *key) {
+  member(key);
+  put('{');
+  _depth++;
+  _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endObject() {
+  _depth--;
+  put('}');
+}
+
+void JsonWriter::beginArray(const char *key) {
+  member(key);
+  put('[');
+  _depth++;
+  _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endArray() {
+  _depth--;
+  put(']');
+}
+
+void JsonWriter::string(const char *key, const char *value) {
+  member(key);
+  quoted(value);
+}
+
+void JsonWriter::number(const char *key, long value) {
+  member(key);
+  char digits[24];
+  int n = snprintf(digits, sizeof(digits), "%ld", value);
+  put(digits, n);
+}
+
+void JsonWriter::boolean(const char *key, bool value) {
+  member(key);
+  if (value)
+    put("true", 4);
+  else
+    put("false", 5);
+}
@@ -0,0 +1,177 @@
+#include "_link.h"
+#include "_midi.h"
+#include "_render.h"
+#include "_log.h"
+
+LinkHealth LinkMonitor::_health = LinkHealth::UNKNOWN;
+
+struct OpenPing {
+  uint16_t seq;
+  bool open;
+  uint32_t sentUs;
+};
+
+static OpenPing pings[LINK_PING_SLOTS];
+static uint16_t nextSeq = 0;
+static unsigned long lastSendMs = 0;
+static bool everReplied = false;
+static uint32_t lossHistory = 0;      // bit per resolved ping, 1 = lost, newest in bit 0
+static uint8_t historyCount = 0;
+static LinkStats linkStats;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+const char *LinkMonitor::healthName(LinkHealth health) {
+  switch (health) {
+    case LinkHealth::GOOD:     return "good";
+    case LinkHealth::DEGRADED: return "degraded";
+    case LinkHealth::LOST:     return "lost";
+    default:                   return "unknown";
+  }
+}
+
+static uint32_t pingInterval(LinkHealth health) {
+  if (health != LinkHealth::GOOD)
+    return LINK_PING_FAST_MS;
+  return StateStore::get().playing ? LINK_PING_INTERVAL_MS : LINK_PING_IDLE_MS;
+}
+
+// Called on the MIDI task with the ping's slot still open.
+void LinkMonitor::resolve(int slot, bool replied, uint32_t nowUs) {
+  pings[slot].open = false;
+  lossHistory = (lossHistory << 1) | (replied ? 0 : 1);
+  if (historyCount < LINK_LOSS_WINDOW)
+    historyCount++;
+  uint32_t window = historyCount < 32 ? (1UL << historyCount) - 1 : 0xFFFFFFFF;
+  uint8_t lossPct = __builtin_popcount(lossHistory & window) * 100 / historyCount;
+
+  portENTER_CRITICAL(&statsLock);
+  linkStats.lossPct = lossPct;
+  if (!replied) {
+    linkStats.lost++;
+  } else {
+    uint32_t rtt = nowUs - pings[slot].sentUs;
+    if (linkStats.replies == 0) {
+      linkStats.srttUs = rtt;
+    } else {
+      int32_t delta = (int32_t)rtt - (int32_t)linkStats.rttUs;
+      linkStats.jitterUs += ((delta < 0 ? -delta : delta) - (int32_t)linkStats.jitterUs) / 16;
+      linkStats.srttUs += ((int32_t)rtt - (int32_t)linkStats.srttUs) / 8;
+    }
+    linkStats.rttUs = rtt;
+    if (rtt > linkStats.maxRttUs)
+      linkStats.maxRttUs = rtt;
+    linkStats.replies++;
+  }
+  portEXIT_CRITICAL(&statsLock);
+}
+
+void LinkMonitor::onReply(const uint8_t *data, unsigned length) {
+  uint32_t nowUs = micros();
+  int slot = -1;
+  if (length >= 8) {
+    uint16_t seq = data[5] | (data[6] << 7);
+    int i = seq % LINK_PING_SLOTS;
+    if (pings[i].open && pings[i].seq == seq)
+      slot = i;
+  } else {
+    // Legacy reply: the oldest open ping.
+    for (int i = 0; i < LINK_PING_SLOTS; i++) {
+      if (pings[i].open && (slot < 0 || (int32_t)(pings[i].sentUs - pings[slot].sentUs) < 0))
+        slot = i;
+    }
+  }
+  if (slot < 0) {
+    portENTER_CRITICAL(&statsLock);
+    linkStats.late++;
+    portEXIT_CRITICAL(&statsLock);
+    return;
+  }
+  resolve(slot, true, nowUs);
+  everReplied = true;
+  evaluate();
+  Render::request(REGION_LINK);
+}
+
+// A lost ping degrades the link at once, which speeds up the pings, and
+// LINK_LOST_PINGS in a row mark it lost. Thresholds are eased by a quarter on
+// the way back to GOOD so the health doesn't flap around them.
+void LinkMonitor::evaluate() {
+  const uint32_t lostRun = (1UL << LINK_LOST_PINGS) - 1;
+  LinkStats s = stats();
+  LinkHealth health;
+  if (!everReplied) {
+    health = LinkHealth::UNKNOWN;
+  } else if (historyCount >= LINK_LOST_PINGS && (lossHistory & lostRun) == lostRun) {
+    health = LinkHealth::LOST;
+  } else {
+    uint32_t scale = _health == LinkHealth::GOOD ? 4 : 3;
+    bool degraded = (lossHistory & 1) ||
+                    s.lossPct * 4 > LINK_DEGRADED_LOSS_PCT * scale ||
+                    s.srttUs * 4 > LINK_DEGRADED_RTT_MS * 1000UL * scale ||
+                    s.jitterUs * 4 > LINK_DEGRADED_JITTER_MS * 1000UL * scale;
+    health = degraded ? LinkHealth::DEGRADED : LinkHealth::GOOD;
+  }
+  if (health != _health) {
+    LOGI("Link %s: rtt %lu us, jitter %lu us, %u%% loss", healthName(health),
+         (unsigned long)s.srttUs, (unsigned long)s.jitterUs, s.lossPct);
+    _health = health;
+    StateStore::setLink(health);
+  }
+}
+
+void LinkMonitor::update() {
+  uint32_t nowUs = micros();
+  bool changed = false;
+  for (int i = 0; i < LINK_PING_SLOTS; i++) {
+    if (pings[i].open && nowUs - pings[i].sentUs > LINK_PING_TIMEOUT_MS * 1000UL) {
+      resolve(i, false, nowUs);
+      changed = true;
+    }
+  }
+
+  uint32_t interval = pingInterval(_health);
+  if (millis() - lastSendMs >= interval) {
+    lastSendMs = millis();
+    uint16_t seq = nextSeq;
+    nextSeq = (nextSeq + 1) & 0x3FFF;
+    OpenPing &p = pings[seq % LINK_PING_SLOTS];
+    if (p.open)
+      resolve(seq % LINK_PING_SLOTS, false, nowUs);   // slot reused before its timeout
+    p.seq = seq;
+    p.open = true;
+    p.sentUs = micros();
+    Midi::Ping(seq);
+    portENTER_CRITICAL(&statsLock);
+    linkStats.sent++;
+    linkStats.intervalMs = interval;
+    portEXIT_CRITICAL(&statsLock);
+  }
+
+  evaluate();
+  if (changed)
+    Render::request(REGION_LINK);
+
+  bool led = _health == LinkHealth::GOOD ||
+             (_health == LinkHealth::DEGRADED && (millis() / LINK_BLINK_MS) % 2 == 0);
+  digitalWrite(LED_PING, led ? HIGH : LOW);
+}
+
+LinkStats LinkMonitor::stats() {
+  portENTER_CRITICAL(&statsLock);
+  LinkStats copy = linkStats;
+  portEXIT_CRITICAL(&statsLock);
+  return copy;
+}
+
+void LinkMonitor::printReport() {
+  LinkStats s = stats();
+  Serial.printf("Link %-8s rtt %lu us (smoothed %lu, max %lu), jitter %lu us, %u%% loss, "
+                "%lu sent, %lu lost, %lu late, every %lu ms\n",
+                healthName(_health), (unsigned long)s.rttUs, (unsigned long)s.srttUs,
+                (unsigned long)s.maxRttUs, (unsigned long)s.jitterUs, s.lossPct,
+                (unsigned long)s.sent, (unsigned long)s.lost, (unsigned long)s.late,
+                (unsigned long)s.intervalMs);
+  portENTER_CRITICAL(&statsLock);
+  linkStats.maxRttUs = 0;
+  portEXIT_CRITICAL(&statsLock);
+}
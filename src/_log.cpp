@@ -0,0 +1,266 @@
+#include "_log.h"
+#include "_tasks.h"
+#include <ctype.h>
+
+volatile uint32_t Log::_dropped = 0;
+
+// Record layout in the ring (and, with LOG_BINARY, on the wire after the
+// "\x1bL" sync bytes; fmt is sent as its 32-bit flash address):
+//   size u8 | level u8 | timeUs u32 | fmt | args
+// Arguments follow the format's conversions: 4 bytes for int, long, size_t,
+// char and pointers, 8 for long long and double, u8 length + bytes for %s.
+struct __attribute__((packed)) LogHeader {
+  uint8_t size;
+  uint8_t level;
+  uint32_t timeUs;
+  const char *fmt;
+};
+
+enum LogArg : uint8_t { ARG_INT, ARG_LONG, ARG_LLONG, ARG_SIZE, ARG_DOUBLE, ARG_STR, ARG_PTR };
+
+static uint8_t ring[LOG_BUFFER_SIZE];
+static uint32_t head = 0, tail = 0;       // free-running byte counts
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTask = NULL;
+
+// Finds the next conversion at or after p. Returns the character after it,
+// or NULL at the end of the format.
+static const char *nextSpec(const char *p, const char *&spec, LogArg &type) {
+  for (; *p; p++) {
+    if (*p != '%')
+      continue;
+    spec = p++;
+    if (*p == '%')
+      continue;
+    while (*p && strchr("-+ #0", *p))
+      p++;
+    while (isdigit((unsigned char)*p) || *p == '.')
+      p++;
+    int longs = 0;
+    bool sized = false;
+    while (*p && strchr("hlzjtL", *p)) {
+      if (*p == 'l')
+        longs++;
+      else if (*p == 'j')
+        longs = 2;
+      else if (*p == 'z' || *p == 't')
+        sized = true;
+      p++;
+    }
+    if (!*p)
+      return NULL;
+    if (strchr("fFeEgGaA", *p))
+      type = ARG_DOUBLE;
+    else if (*p == 's')
+      type = ARG_STR;
+    else if (*p == 'p')
+      type = ARG_PTR;
+    else
+      type = longs >= 2 ? ARG_LLONG : longs ? ARG_LONG : sized ? ARG_SIZE : ARG_INT;
+    return p + 1;
+  }
+  return NULL;
+}
+
+void Log::write(uint8_t level, const char *fmt, ...) {
+  uint8_t rec[LOG_MAX_RECORD];
+  LogHeader hdr = { 0, level, (uint32_t)micros(), fmt };
+  size_t n = sizeof(hdr);
+
+  va_list ap;
+  va_start(ap, fmt);
+  const char *spec;
+  LogArg type;
+  for (const char *p = fmt; (p = nextSpec(p, spec, type)) != NULL;) {
+    if (type == ARG_STR) {
+      const char *s = va_arg(ap, const char *);
+      if (!s)
+        s = "(null)";
+      if (n + 1 >= sizeof(rec))
+        break;
+      size_t len = strnlen(s, LOG_MAX_STRING);
+      if (len > sizeof(rec) - n - 1)
+        len = sizeof(rec) - n - 1;
+      rec[n++] = (uint8_t)len;
+      memcpy(&rec[n], s, len);
+      n += len;
+      continue;
+    }
+    uint32_t word = 0;
+    uint64_t wide = 0;
+    size_t argSize = 4;
+    switch (type) {
+      case ARG_INT:    word = va_arg(ap, int); break;
+      case ARG_LONG:   word = va_arg(ap, long); break;
+      case ARG_SIZE:   word = va_arg(ap, size_t); break;
+      case ARG_PTR:    word = (uint32_t)(uintptr_t)va_arg(ap, void *); break;
+      case ARG_LLONG:  wide = va_arg(ap, long long); argSize = 8; break;
+      case ARG_DOUBLE: {
+        double d = va_arg(ap, double);
+        memcpy(&wide, &d, 8);
+        argSize = 8;
+        break;
+      }
+      case ARG_STR:
+        break;
+    }
+    if (n + argSize > sizeof(rec))
+      break;
+    if (argSize == 4)
+      memcpy(&rec[n], &word, 4);
+    else
+      memcpy(&rec[n], &wide, 8);
+    n += argSize;
+  }
+  va_end(ap);
+
+  hdr.size = (uint8_t)n;
+  memcpy(rec, &hdr, sizeof(hdr));
+
+  portENTER_CRITICAL_SAFE(&ringLock);
+  if (LOG_BUFFER_SIZE - (head - tail) < n) {
+    _dropped++;
+  } else {
+    size_t at = head % LOG_BUFFER_SIZE;
+    size_t first = n < LOG_BUFFER_SIZE - at ? n : LOG_BUFFER_SIZE - at;
+    memcpy(&ring[at], rec, first);
+    memcpy(ring, rec + first, n - first);
+    head += n;
+  }
+  portEXIT_CRITICAL_SAFE(&ringLock);
+}
+
+#if !LOG_BINARY
+// Formats one record the way printf would have.
+static size_t formatRecord(const uint8_t *rec, size_t size, char *out, size_t cap) {
+  LogHeader hdr;
+  memcpy(&hdr, rec, sizeof(hdr));
+  static const char levels[] = "-EWID";
+  int len = snprintf(out, cap, "%5lu.%03lu %c ", (unsigned long)(hdr.timeUs / 1000000),
+                     (unsigned long)(hdr.timeUs / 1000 % 1000), levels[hdr.level < 5 ? hdr.level : 0]);
+  size_t used = len > 0 ? len : 0;
+  size_t at = sizeof(hdr);
+
+  const char *p = hdr.fmt, *spec, *next;
+  LogArg type;
+  while (used + 1 < cap) {
+    const char *stop = (next = nextSpec(p, spec, type)) != NULL ? spec : p + strlen(p);
+    // Literal text, with "%%" collapsed.
+    for (; p < stop && used + 1 < cap; p++) {
+      out[used++] = *p;
+      if (*p == '%' && p[1] == '%')
+        p++;
+    }
+    if (!next)
+      break;
+
+    char conv[16];
+    size_t specLen = next - spec < (int)sizeof(conv) ? next - spec : sizeof(conv) - 1;
+    memcpy(conv, spec, specLen);
+    conv[specLen] = '\0';
+
+    size_t argSize = type == ARG_LLONG || type == ARG_DOUBLE ? 8 : type == ARG_STR ? 1 : 4;
+    if (at + argSize > size) {
+      len = snprintf(out + used, cap - used, "%s", conv);   // argument didn't fit
+    } else if (type == ARG_STR) {
+      char str[LOG_MAX_STRING + 1];
+      size_t slen = rec[at++];
+      if (at + slen > size)
+        slen = size - at;
+      memcpy(str, &rec[at], slen);
+      str[slen] = '\0';
+      at += slen;
+      len = snprintf(out + used, cap - used, conv, str);
+    } else if (argSize == 8) {
+      uint64_t wide;
+      memcpy(&wide, &rec[at], 8);
+      at += 8;
+      if (type == ARG_DOUBLE) {
+        double d;
+        memcpy(&d, &wide, 8);
+        len = snprintf(out + used, cap - used, conv, d);
+      } else {
+        len = snprintf(out + used, cap - used, conv, (long long)wide);
+      }
+    } else {
+      uint32_t word;
+      memcpy(&word, &rec[at], 4);
+      at += 4;
+      if (type == ARG_LONG)
+        len = snprintf(out + used, cap - used, conv, (long)(int32_t)word);
+      else if (type == ARG_SIZE)
+        len = snprintf(out + used, cap - used, conv, (size_t)word);
+      else if (type == ARG_PTR)
+        len = snprintf(out + used, cap - used, conv, (void *)(uintptr_t)word);
+      else
+        len = snprintf(out + used, cap - used, conv, (int)word);
+    }
+    if (len > 0)
+      used = used + len < cap ? used + len : cap - 1;
+    p = next;
+  }
+  // Messages already ending in a newline don't get a second one.
+  if (used > 0 && out[used - 1] == '\n')
+    used--;
+  out[used] = '\0';
+  return used;
+}
+#endif
+
+bool Log::drainOne() {
+  uint8_t rec[LOG_MAX_RECORD];
+  portENTER_CRITICAL_SAFE(&ringLock);
+  if (head == tail) {
+    portEXIT_CRITICAL_SAFE(&ringLock);
+    return false;
+  }
+  size_t at = tail % LOG_BUFFER_SIZE;
+  size_t n = ring[at];
+  size_t first = n < LOG_BUFFER_SIZE - at ? n : LOG_BUFFER_SIZE - at;
+  memcpy(rec, &ring[at], first);
+  memcpy(rec + first, ring, n - first);
+  tail += n;
+  portEXIT_CRITICAL_SAFE(&ringLock);
+
+#if LOG_BINARY
+  LogHeader hdr;
+  memcpy(&hdr, rec, sizeof(hdr));
+  uint32_t fmtAddr = (uint32_t)(uintptr_t)hdr.fmt;
+  static const uint8_t sync[2] = { 0x1B, 'L' };
+  Serial.write(sync, 2);
+  Serial.write(rec, 6);
+  Serial.write((const uint8_t *)&fmtAddr, 4);
+  Serial.write(rec + sizeof(hdr), n - sizeof(hdr));
+#else
+  char line[160];
+  size_t len = formatRecord(rec, n, line, sizeof(line) - 1);
+  line[len++] = '\n';
+  Serial.write((const uint8_t *)line, len);
+#endif
+  return true;
+}
+
+void Log::flush() {
+  while (drainOne()) {
+  }
+}
+
+void Log::task(void *param) {
+  uint32_t reportedDrops = 0;
+  TaskMonitor::attach(AppTask::LOG);
+  TaskPeriod period(AppTask::LOG, LOG_DRAIN_INTERVAL_MS);
+  for (;;) {
+    while (drainOne()) {
+    }
+    if (_dropped != reportedDrops) {
+      Serial.printf("[log] %lu records dropped\n", (unsigned long)(_dropped - reportedDrops));
+      reportedDrops = _dropped;
+    }
+    period.wait();
+  }
+}
+
+void Log::begin() {
+  if (!drainTask)
+    xTaskCreatePinnedToCore(task, "Log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, &drainTask, LOG_TASK_CORE);
+}
@@ -1,35 +1,95 @@
 #include "_midi.h"
+#include "_scan.h"
+#include "_sync.h"
+#include "_log.h"
+#include "_state.h"
+#include "_link.h"
+#include "_transport.h"
+#include "_midiport.h"
 
-ESPNATIVEUSBMIDI usbmidi;
-MIDI_CREATE_INSTANCE(ESPNATIVEUSBMIDI, usbmidi, MIDI)
+// One MIDI library instance per port (see _midiport.h).
+static MidiPortStream controlStream(MidiPort::CONTROL);
+static MidiPortStream performanceStream(MidiPort::PERFORMANCE);
+static MidiPortStream syncStream(MidiPort::SYNC);
+MIDI_CREATE_INSTANCE(MidiPortStream, controlStream, MIDI_CONTROL)
+MIDI_CREATE_INSTANCE(MidiPortStream, performanceStream, MIDI_PERFORMANCE)
+MIDI_CREATE_INSTANCE(MidiPortStream, syncStream, MIDI_SYNC)
+
+typedef midi::MidiInterface<midi::SerialMIDI<MidiPortStream>> PortInterface;
+static PortInterface *const ports[(int)MidiPort::COUNT] = {
+    &MIDI_CONTROL, &MIDI_PERFORMANCE, &MIDI_SYNC
+};
+
+// Read order: the sync port first, so clocks and ping replies are never
+// stuck behind a burst of scan replies.
+static const MidiPort readOrder[(int)MidiPort::COUNT] = {
+    MidiPort::SYNC, MidiPort::CONTROL, MidiPort::PERFORMANCE
+};
+
+static void sendSysExOn(MidiPort port, const byte *data, unsigned length) {
+    MidiPorts::acquire(port);
+    ports[(int)port]->sendSysEx(length, data, true);
+    MidiPorts::release(port);
+}
+
+// Transport messages from Ableton, timestamped as the MIDI task reads them.
+static void onClock() { Transport::clock(micros()); }
+static void onStart() { Transport::start(); }
+static void onContinue() { Transport::resume(); }
+static void onStop() { Transport::stop(); }
+static void onSongPosition(unsigned beats) { Transport::songPosition(beats); }
 
 void Midi::begin() {
+    MidiPorts::begin();
     USB.productName("AbletonThesis");
     if (!USB.begin()) {
     Serial.println(F("USB Initialization Failed!"));
     while (1);
     }
-    MIDI.begin(MIDI_CHANNEL_OMNI);
-    MIDI.setHandleSystemExclusive(handleSysEx);
-    Serial.println(F("MIDI initialized."));
+    for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+        PortInterface &port = *ports[p];
+        port.begin(MIDI_CHANNEL_OMNI);
+        // The library echoes input by default, which would send every clock
+        // and scan reply straight back to Ableton.
+        port.turnThruOff();
+        if (!MidiPorts::reader((MidiPort)p))
+            continue;
+        // Replies are handled whichever port Ableton answers on, but the
+        // transport only follows the sync cable, so a clock routed to two
+        // ports isn't counted twice.
+        port.setHandleSystemExclusive(handleSysEx);
+        if (MidiPorts::cable((MidiPort)p) == MidiPorts::cable(MidiPort::SYNC)) {
+            port.setHandleClock(onClock);
+            port.setHandleStart(onStart);
+            port.setHandleContinue(onContinue);
+            port.setHandleStop(onStop);
+            port.setHandleSongPosition(onSongPosition);
+        }
+    }
+    Serial.printf("MIDI initialized, %u USB cable(s).\n", usbmidi.cables());
 }
 
 void Midi::handleSysEx(byte *data, unsigned length) {
     if (length < 6) {
-        Serial.println(F("⚠️ SysEx message too short. Ignoring."));
+        LOGW("SysEx message too short (%u bytes), ignoring", length);
         return;
     }
     // Validate Manufacturer ID: expecting 0x00, 0x01, 0x61 (example).
     if (data[1] != 0x00 || data[2] != 0x01 || data[3] != 0x61) {
-        Serial.println(F("Invalid Manufacturer ID."));
+        LOGW("Invalid manufacturer ID");
         return;
     }
 
     if (data[4] == 0x00 && data[5] == 0x7F) {
-        Serial.println(F("End signal received. Song list complete."));
-        Serial.print(F("Final total songs received: "));
-        Serial.println(currentProject.songCount);
-        songsReady = true;
+        LOGI("End signal received");
+        ScanSession::onEnd();
+        return;
+    }
+
+    // Sequenced scan: total song count header.
+    if (data[4] == 0x03) {
+        if (length >= 8)
+            ScanSession::onHeader(data[5] | (data[6] << 7));
         return;
     }
 
@@ -40,70 +100,136 @@ void Midi::handleSysEx(byte *data, unsigned length) {
           currentProject.projectName[j++] = (char)data[i++];
         }
         currentProject.projectName[j] = '\0';
-        Serial.print(F("Project Name Received: "));
-        Serial.println(currentProject.projectName);
+        LOGI("Project name received: %s", currentProject.projectName);
         return;
     }
     
-    // Example: handle a ping reply (if data[4] == 0x31).
+    // Incremental sync replies (see _sync.h).
+    if (data[4] == 0x05) {
+        ProjectSync::onUnchanged();
+        return;
+    }
+    if (data[4] == 0x06) {
+        ProjectSync::onDiff(data, length);
+        return;
+    }
+    if (data[4] == 0x07) {
+        if (length >= 11)
+            ProjectSync::onDiffEnd(ProjectSync::decodeHash(&data[5]));
+        return;
+    }
+
+    // Ping reply, echoing the ping's sequence number (see _link.h).
     if (data[4] == 0x31) {
-        // Flash the LED to indicate a ping was received
-        lastPingReplyTime = millis();
-        // Serial.println(lastPingReplyTime);
+        LinkMonitor::onReply(data, length);
         return;
     }
 
-    if (currentProject.songCount == 0) {
-        memset(&currentProject.songs[0], 0, sizeof(currentProject.songs));
-        currentProject.songCount = 0;
-      }
-      if (currentProject.songCount < MAX_SONGS) {
-        Serial.printf("Processing Song %d...\n", currentProject.songCount + 1);
-        if (currentProject.songs[currentProject.songCount].getInfo(data, length)) {
-          Serial.printf("Song %d added: %s\n",
-                        currentProject.songCount + 1,
-                        currentProject.songs[currentProject.songCount].songName);
-          currentProject.songCount++;
-        } else {
-          Serial.println(F("Failed to parse song info."));
+    // Song data: sequenced (0x04) songs carry their position, legacy (0x00)
+    // songs are appended in arrival order.
+    SongInfo song;
+    if (song.getInfo(data, length)) {
+        int seq = currentProject.songCount;
+        if (data[4] == 0x04) {
+            seq = data[5] | (data[6] << 7);
+            song.songIndex = seq;
         }
-      } else {
-        Serial.println(F("Song list is full. Cannot add more songs."));
-      }
-    
-    // Process other SysEx commands (project name, song data, etc.)
-    Serial.println(F("Processing SysEx message..."));
-    // (Insert additional parsing logic here.)
+        if (ScanSession::onSong(seq, song)) {
+            LOGD("Song %d added: %s", seq + 1, song.name());
+        }
+    } else {
+        LOGW("Failed to parse song info");
+    }
 }
 
-void Midi::Play(byte songIndex) {
-    byte sysexMessage[7] = { 0xF0, 0x00, 0x01, 0x61, 0x01, songIndex, 0xF7 };
-    MIDI.sendSysEx(sizeof(sysexMessage), sysexMessage, true);
-    Serial.print(F("Sent SysEx for Song Index: "));
-    Serial.println(songIndex);
+uint8_t Midi::buildPlay(uint16_t songIndex, byte *out) {
+    static const byte header[] = { 0xF0, 0x00, 0x01, 0x61, 0x01 };
+    memcpy(out, header, sizeof(header));
+    uint8_t n = sizeof(header);
+    out[n++] = songIndex & 0x7F;
+    // Indices past 127 don't fit one data byte: send LSB then MSB, 7 bits each.
+    if (songIndex >= 0x80)
+        out[n++] = (songIndex >> 7) & 0x7F;
+    out[n++] = 0xF7;
+    return n;
+}
+
+void Midi::sendSysEx(const byte *data, unsigned length) {
+    sendSysExOn(MidiPort::CONTROL, data, length);
+}
+
+void Midi::Play(uint16_t songIndex) {
+    byte sysexMessage[MIDI_PLAY_MAX_BYTES];
+    sendSysEx(sysexMessage, buildPlay(songIndex, sysexMessage));
+    LOGI("Sent SysEx for song index %u", songIndex);
 }
 
 void Midi::Scan() {
-    byte sysexMessage[] = {0xF0, 0x00, 0x01, 0x61, 0x10, 0xF7};
-    MIDI.sendSysEx(sizeof(sysexMessage), sysexMessage, true);
-    Serial.println(F("Sent SysEx to Notify Ableton"));
+    // Trailing 0x01 requests the sequenced protocol (see _scan.h).
+    byte sysexMessage[] = {0xF0, 0x00, 0x01, 0x61, 0x10, 0x01, 0xF7};
+    sendSysExOn(MidiPort::CONTROL, sysexMessage, sizeof(sysexMessage));
+    LOGI("Sent scan request");
+}
+
+void Midi::Sync(uint32_t projectHash) {
+    byte sysexMessage[11] = { 0xF0, 0x00, 0x01, 0x61, 0x13 };
+    ProjectSync::encodeHash(projectHash, &sysexMessage[5]);
+    sysexMessage[10] = 0xF7;
+    sendSysExOn(MidiPort::CONTROL, sysexMessage, sizeof(sysexMessage));
+    LOGI("Sent project hash %08lX", (unsigned long)projectHash);
+}
+
+void Midi::Nak(uint16_t from, uint16_t to) {
+    byte sysexMessage[] = { 0xF0, 0x00, 0x01, 0x61, 0x12,
+                            (byte)(from & 0x7F), (byte)((from >> 7) & 0x7F),
+                            (byte)(to & 0x7F), (byte)((to >> 7) & 0x7F), 0xF7 };
+    sendSysExOn(MidiPort::CONTROL, sysexMessage, sizeof(sysexMessage));
+    LOGI("Requested resend of songs %u-%u", from, to);
 }
 
 void Midi::Stop() {
     byte sysexStopMessage[] = { 0xF0, 0x00, 0x01, 0x61, 0x11, 0xF7 };
-    MIDI.sendSysEx(sizeof(sysexStopMessage), sysexStopMessage, true);
-    Serial.println(F("Stop SysEx Command Sent"));
+    sendSysExOn(MidiPort::CONTROL, sysexStopMessage, sizeof(sysexStopMessage));
+    LOGI("Sent stop");
 }
 
-void Midi::Ping() {
-    byte sysexPingMessage[] = { 0xF0, 0x00, 0x01, 0x61, 0x30, 0xF7 };
-    MIDI.sendSysEx(sizeof(sysexPingMessage), sysexPingMessage, true);
+void Midi::Ping(uint16_t seq) {
+    byte sysexPingMessage[] = { 0xF0, 0x00, 0x01, 0x61, 0x30,
+                                (byte)(seq & 0x7F), (byte)((seq >> 7) & 0x7F), 0xF7 };
+    sendSysExOn(MidiPort::SYNC, sysexPingMessage, sizeof(sysexPingMessage));
 }
 
 void Midi::read() {
-    MIDI.read();
+    for (MidiPort port : readOrder) {
+        if (MidiPorts::reader(port))
+            ports[(int)port]->read();
+    }
+}
+
+void Midi::flush() {
+    MidiPorts::flush();
 }
 
 void Midi::volume(byte vol) {
-    MIDI.sendControlChange(7, vol, 1);
+    MidiPorts::acquire(MidiPort::PERFORMANCE);
+    MIDI_PERFORMANCE.sendControlChange(7, vol, 1);
+    MidiPorts::release(MidiPort::PERFORMANCE);
+}
+
+void Midi::applyState() {
+    uint32_t changed = StateStore::changes(StateSubscriber::MIDI);
+    if (!changed)
+        return;
+    AppState state = StateStore::get();
+    if (changed & STATE_PLAYING) {
+        if (!state.playing)
+            Stop();
+        else {
+            SongRef song;
+            if (StateStore::song(state.track, song))
+                Play(song.songIndex);
+        }
+    }
+    if (changed & STATE_VOLUME)
+        volume(state.volume);
 }
\ No newline at end of file
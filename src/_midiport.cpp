@@ -0,0 +1,300 @@
+#include "_midiport.h"
+#include "_midiuart.h"
+#include "_log.h"
+#include "freertos/semphr.h"
+
+ESPNATIVEUSBMIDI usbmidi(MIDI_USB_CABLES);
+
+static const char *const portNames[(int)MidiPort::COUNT] = { "Control", "Performance", "Sync" };
+static const char *const linkNames[] = { "up", "down", "probing" };
+
+// Drain order of flush().
+static const MidiPort drainOrder[(int)MidiPort::COUNT] = {
+  MidiPort::SYNC, MidiPort::CONTROL, MidiPort::PERFORMANCE
+};
+
+// Event packets on the port's cable.
+class UsbBackend : public MidiBackend {
+public:
+  uint8_t stream(MidiPort port) override { return MidiPorts::cable(port); }
+
+  uint16_t send(MidiPort port, const uint8_t *msg, uint16_t len, uint16_t done) override {
+    uint8_t c = MidiPorts::cable(port);
+    uint16_t took = 0;
+    while (done + took < len && usbmidi.write(c, msg[done + took]))
+      took++;
+    return took;
+  }
+
+  void abandon(MidiPort port) override { usbmidi.reset(MidiPorts::cable(port)); }
+};
+
+static UsbBackend usbBackend;
+static MidiBackend *const backends[(int)MidiTransport::COUNT] = { &usbBackend, &uartMidi };
+
+struct PortQueue {
+  SemaphoreHandle_t sender;              // held between acquire and release
+  uint8_t staged[MIDI_PORT_MESSAGE_MAX]; // message being written by the holder
+  uint16_t stagedLen;
+  bool overflow;                         // the message outgrew staged
+  uint8_t ring[MIDI_PORT_QUEUE_BYTES];   // length-prefixed messages
+  uint32_t written;                      // bytes ever queued
+  // Per transport, MIDI task only: start of the message it is on, and how
+  // much of that message it has taken.
+  uint32_t at[(int)MidiTransport::COUNT];
+  uint16_t done[(int)MidiTransport::COUNT];
+  MidiPortStats stats;
+};
+
+static PortQueue queues[(int)MidiPort::COUNT];
+static portMUX_TYPE queueLock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool transportActive[(int)MidiTransport::COUNT] = { true, false };
+static UsbLink usbState = UsbLink::UP;
+static uint32_t linkSinceMs = 0;
+static uint32_t usbProgressMs = 0;     // USB last took a byte or had nothing to send
+static uint32_t failovers = 0;
+
+// Bytes the transports haven't all moved past. Call with queueLock held.
+static uint16_t used(const PortQueue &q) {
+  uint32_t oldest = 0;
+  for (int t = 0; t < (int)MidiTransport::COUNT; t++) {
+    if (q.written - q.at[t] > oldest)
+      oldest = q.written - q.at[t];
+  }
+  return oldest;
+}
+
+uint8_t MidiPorts::cable(MidiPort port) {
+  uint8_t p = (uint8_t)port;
+  return p < usbmidi.cables() ? p : usbmidi.cables() - 1;
+}
+
+bool MidiPorts::reader(MidiPort port) {
+  return (uint8_t)port == 0 || cable(port) != cable((MidiPort)((uint8_t)port - 1));
+}
+
+const char *MidiPorts::name(MidiPort port) {
+  return portNames[(int)port];
+}
+
+UsbLink MidiPorts::usbLink() {
+  return usbState;
+}
+
+bool MidiPorts::active(MidiTransport transport) {
+  return transportActive[(int)transport];
+}
+
+void MidiPorts::begin() {
+  for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+    queues[p].sender = xSemaphoreCreateMutex();
+    if (reader((MidiPort)p))
+      usbmidi.setCableName(cable((MidiPort)p), portNames[p]);
+  }
+  if ((MidiUartMode)MIDI_UART_MODE != MidiUartMode::OFF)
+    uartMidi.begin();
+  linkSinceMs = usbProgressMs = millis();
+  route(linkSinceMs, true);
+}
+
+void MidiPorts::acquire(MidiPort port) {
+  PortQueue &q = queues[(int)port];
+  xSemaphoreTake(q.sender, portMAX_DELAY);
+  q.stagedLen = 0;
+  q.overflow = false;
+}
+
+void MidiPorts::stage(MidiPort port, uint8_t b) {
+  PortQueue &q = queues[(int)port];
+  if (q.stagedLen < sizeof(q.staged))
+    q.staged[q.stagedLen++] = b;
+  else
+    q.overflow = true;
+}
+
+void MidiPorts::release(MidiPort port) {
+  PortQueue &q = queues[(int)port];
+  if (q.stagedLen) {
+    portENTER_CRITICAL(&queueLock);
+    uint16_t queued = used(q);
+    if (!q.overflow && queued + 1 + q.stagedLen <= MIDI_PORT_QUEUE_BYTES) {
+      q.ring[q.written % MIDI_PORT_QUEUE_BYTES] = (uint8_t)q.stagedLen;
+      for (uint16_t i = 0; i < q.stagedLen; i++)
+        q.ring[(q.written + 1 + i) % MIDI_PORT_QUEUE_BYTES] = q.staged[i];
+      q.written += 1 + q.stagedLen;
+      queued += 1 + q.stagedLen;
+      if (queued > q.stats.peakQueued)
+        q.stats.peakQueued = queued;
+    } else {
+      q.stats.dropped++;
+    }
+    portEXIT_CRITICAL(&queueLock);
+  }
+  xSemaphoreGive(q.sender);
+}
+
+// Hands one port's messages to a transport. False when the transport ran
+// out of room, which holds back every port after this one too.
+bool MidiPorts::drain(MidiTransport transport, MidiPort port, bool &progressed) {
+  int t = (int)transport;
+  PortQueue &q = queues[(int)port];
+  MidiBackend *backend = backends[t];
+  uint8_t s = backend->stream(port);
+  for (int other = 0; other < (int)MidiPort::COUNT; other++) {
+    if (other != (int)port && queues[other].done[t] && backend->stream((MidiPort)other) == s)
+      return true;   // another port is part way through a message on this stream
+  }
+
+  uint8_t msg[MIDI_PORT_MESSAGE_MAX];
+  for (;;) {
+    portENTER_CRITICAL(&queueLock);
+    bool any = q.written != q.at[t];
+    uint8_t len = any ? q.ring[q.at[t] % MIDI_PORT_QUEUE_BYTES] : 0;
+    for (uint8_t i = 0; i < len; i++)
+      msg[i] = q.ring[(q.at[t] + 1 + i) % MIDI_PORT_QUEUE_BYTES];
+    portEXIT_CRITICAL(&queueLock);
+    if (!any)
+      return true;
+
+    uint16_t took = backend->send(port, msg, len, q.done[t]);
+    if (took)
+      progressed = true;
+    q.done[t] += took;
+    if (q.done[t] < len)
+      return false;
+    portENTER_CRITICAL(&queueLock);
+    q.at[t] += 1 + len;
+    q.stats.sent[t]++;
+    portEXIT_CRITICAL(&queueLock);
+    q.done[t] = 0;
+  }
+}
+
+// Moves the USB link state on and picks the active transports.
+void MidiPorts::route(uint32_t nowMs, bool usbProgressed) {
+  if (usbProgressed || usbState == UsbLink::DOWN)
+    usbProgressMs = nowMs;
+  bool mounted = usbmidi.mounted();
+  bool stalled = nowMs - usbProgressMs >= MIDI_USB_STALL_MS;
+  UsbLink next = usbState;
+  switch (usbState) {
+    case UsbLink::UP:
+      if (!mounted || stalled)
+        next = UsbLink::DOWN;
+      break;
+    case UsbLink::DOWN:
+      if (mounted && nowMs - linkSinceMs >= MIDI_USB_RETRY_MS)
+        next = UsbLink::PROBING;
+      break;
+    case UsbLink::PROBING:
+      if (!mounted || stalled)
+        next = UsbLink::DOWN;
+      else if (nowMs - linkSinceMs >= MIDI_USB_RETRY_MS)
+        next = UsbLink::UP;
+      break;
+  }
+  if (next != usbState) {
+    if (next == UsbLink::DOWN && usbState == UsbLink::UP) {
+      failovers++;
+      LOGW("USB MIDI %s", mounted ? "stalled" : "disconnected");
+    } else if (next == UsbLink::UP) {
+      LOGI("USB MIDI back up");
+    }
+    usbState = next;
+    linkSinceMs = usbProgressMs = nowMs;
+  }
+
+  MidiUartMode mode = (MidiUartMode)MIDI_UART_MODE;
+  transportActive[(int)MidiTransport::USB] = usbState != UsbLink::DOWN;
+  transportActive[(int)MidiTransport::UART] =
+      mode == MidiUartMode::MIRROR || (mode == MidiUartMode::FAILOVER && usbState != UsbLink::UP);
+}
+
+void MidiPorts::flush() {
+  bool usbProgressed = false;
+  for (int t = 0; t < (int)MidiTransport::COUNT; t++) {
+    if (!transportActive[t])
+      continue;
+    if (t == (int)MidiTransport::USB) {
+      bool held = false;
+      for (uint8_t c = 0; c < usbmidi.cables(); c++)
+        held |= !usbmidi.flush(c);
+      if (held)
+        continue;
+    }
+    bool progressed = false, room = true;
+    for (MidiPort port : drainOrder) {
+      if (!drain((MidiTransport)t, port, progressed)) {
+        room = false;
+        break;
+      }
+    }
+    if (t == (int)MidiTransport::USB)
+      usbProgressed = progressed || room;
+  }
+
+  // Inactive transports keep an active one's place: the oldest message it
+  // hasn't finished. With neither active the queues are emptied.
+  for (PortQueue &q : queues) {
+    portENTER_CRITICAL(&queueLock);
+    uint32_t lead = q.written;
+    for (int t = 0; t < (int)MidiTransport::COUNT; t++) {
+      if (transportActive[t] && q.written - q.at[t] > q.written - lead)
+        lead = q.at[t];
+    }
+    portEXIT_CRITICAL(&queueLock);
+    for (int t = 0; t < (int)MidiTransport::COUNT; t++) {
+      if (transportActive[t])
+        continue;
+      if (q.done[t])
+        backends[t]->abandon((MidiPort)(&q - queues));
+      q.done[t] = 0;
+      portENTER_CRITICAL(&queueLock);
+      q.at[t] = lead;
+      portEXIT_CRITICAL(&queueLock);
+    }
+  }
+
+  route(millis(), usbProgressed);
+}
+
+MidiPortStats MidiPorts::stats(MidiPort port) {
+  portENTER_CRITICAL(&queueLock);
+  MidiPortStats s = queues[(int)port].stats;
+  s.queued = used(queues[(int)port]);
+  portEXIT_CRITICAL(&queueLock);
+  return s;
+}
+
+void MidiPorts::printReport() {
+  for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+    MidiPortStats s = stats((MidiPort)p);
+    Serial.printf("MIDI port %-11s cable %u: %lu sent, %lu on DIN, %lu dropped, %u queued (peak %u)\n",
+                  portNames[p], cable((MidiPort)p) + 1,
+                  (unsigned long)s.sent[(int)MidiTransport::USB],
+                  (unsigned long)s.sent[(int)MidiTransport::UART],
+                  (unsigned long)s.dropped, s.queued, s.peakQueued);
+    portENTER_CRITICAL(&queueLock);
+    queues[p].stats.peakQueued = used(queues[p]);
+    portEXIT_CRITICAL(&queueLock);
+  }
+  MidiUartStats u = uartMidi.stats();
+  Serial.printf("MIDI USB %s, %lu failovers; DIN %s, %lu bytes, %lu status bytes saved\n",
+                linkNames[(int)usbState], (unsigned long)failovers,
+                active(MidiTransport::UART) ? "active" : "idle",
+                (unsigned long)u.bytes, (unsigned long)u.statusSaved);
+}
+
+int MidiPortStream::available() {
+  return MidiPorts::reader(_port) ? usbmidi.available(MidiPorts::cable(_port)) : 0;
+}
+
+int MidiPortStream::read() {
+  return MidiPorts::reader(_port) ? usbmidi.read(MidiPorts::cable(_port)) : -1;
+}
+
+size_t MidiPortStream::write(uint8_t b) {
+  MidiPorts::stage(_port, b);
+  return 1;
+}
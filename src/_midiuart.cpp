@@ -0,0 +1,60 @@
+#include "_midiuart.h"
+
+#define MIDI_UART_BAUD    31250
+#define MIDI_UART_BYTE_US 320      // start, 8 data and stop bits
+
+UartMidi uartMidi;
+
+void UartMidi::begin() {
+  Serial1.begin(MIDI_UART_BAUD, SERIAL_8N1, -1, MIDI_UART_TX_PIN);
+  _lineFreeUs = micros();
+}
+
+uint16_t UartMidi::send(MidiPort port, const uint8_t *msg, uint16_t len, uint16_t done) {
+  uint32_t nowUs = micros();
+  if ((int32_t)(_lineFreeUs - nowUs) < 0)
+    _lineFreeUs = nowUs;
+  uint32_t ahead = _lineFreeUs - nowUs;
+  if (ahead >= MIDI_UART_AHEAD_US)
+    return 0;
+  int room = min((int)((MIDI_UART_AHEAD_US - ahead) / MIDI_UART_BYTE_US), (int)Serial1.availableForWrite());
+  if (room <= 0)
+    return 0;
+
+  uint16_t took = 0;
+  bool newStatus = false;
+  if (done == 0) {
+    uint8_t status = msg[0];
+    if (status < 0xF0) {
+      if (status == _runningStatus && nowUs - _statusUs < MIDI_UART_STATUS_REFRESH_MS * 1000UL) {
+        took = 1;
+        _stats.statusSaved++;
+      } else {
+        newStatus = true;
+      }
+    } else if (status < 0xF8) {
+      // SysEx and system common cancel running status; real-time leaves it.
+      _runningStatus = 0;
+    }
+  }
+
+  uint16_t n = len - done - took;
+  if (n > room)
+    n = room;
+  if (n) {
+    Serial1.write(msg + done + took, n);
+    _lineFreeUs += n * MIDI_UART_BYTE_US;
+    _stats.bytes += n;
+    if (newStatus) {
+      _runningStatus = msg[0];
+      _statusUs = nowUs;
+    }
+  }
+  return took + n;
+}
+
+void UartMidi::abandon(MidiPort port) {
+  // The receiver may be left expecting data bytes; start the next message
+  // with its status.
+  _runningStatus = 0;
+}
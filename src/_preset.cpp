@@ -1,39 +1,131 @@
 #include "_preset.h"
+#include <LittleFS.h>
+#include "_log.h"
 
 Preferences preferences;
 
-void ps::savePresetToDevice(int presetNumber, const Preset &preset) {
-  preferences.begin("Setlists", false);
-  
-  preferences.putString(("p" + String(presetNumber) + "_name").c_str(), preset.name);
-  preferences.putString(("p" + String(presetNumber) + "_proj").c_str(), preset.data.projectName);
-  preferences.putInt(("p" + String(presetNumber) + "_count").c_str(), preset.data.songCount);
+// Setlist files hold the songs; NVS only keeps the name, project and count
+// that the preset list needs. Layout (little endian):
+//   "PCS1" | nameLen u8 | name | projLen u8 | projectName | songCount u32
+//   per song: songIndex u16 | changedIndex u16 | locatorMs u32 | nameLen u8 | name
+static const char SETLIST_MAGIC[4] = { 'P', 'C', 'S', '1' };
 
-  for (int i = 0; i < preset.data.songCount; i++) {
-    String songKey    = "p" + String(presetNumber) + "_song"  + String(i);
-    String indexKey   = "p" + String(presetNumber) + "_index" + String(i);
-    String timeKey    = "p" + String(presetNumber) + "_time"  + String(i);
-    String cindexKey  = "p" + String(presetNumber) + "_cindex"+ String(i);
+static String setlistPath(int presetNumber) {
+  return "/setlists/p" + String(presetNumber) + ".bin";
+}
 
-    preferences.putString(songKey.c_str(), preset.data.songs[i].songName);
-    preferences.putInt(indexKey.c_str(), preset.data.songs[i].songIndex);
-    preferences.putInt(cindexKey.c_str(), preset.data.songs[i].changedIndex);
-    preferences.putFloat(timeKey.c_str(), preset.data.songs[i].locatorTime);
+static bool writeString(File &file, const char *str) {
+  uint8_t len = (uint8_t)strnlen(str, MAX_SONG_NAME_LEN);
+  return file.write(&len, 1) == 1 && file.write((const uint8_t *)str, len) == len;
+}
+
+static bool readString(File &file, char *dst) {
+  uint8_t len = 0;
+  if (file.read(&len, 1) != 1 || len > MAX_SONG_NAME_LEN)
+    return false;
+  if (file.read((uint8_t *)dst, len) != len)
+    return false;
+  dst[len] = '\0';
+  return true;
+}
+
+bool ps::writeSetlist(const char *path, const char *name, const ProjectInfo &project) {
+  File file = LittleFS.open(path, "w");
+  if (!file) {
+    Serial.printf("Unable to open %s for writing\n", path);
+    return false;
   }
-  
-  preferences.end();
+  uint32_t count = project.songCount;
+  bool ok = file.write((const uint8_t *)SETLIST_MAGIC, sizeof(SETLIST_MAGIC)) == sizeof(SETLIST_MAGIC) &&
+            writeString(file, name) &&
+            writeString(file, project.projectName) &&
+            file.write((const uint8_t *)&count, sizeof(count)) == sizeof(count);
+
+  for (int i = 0; ok && i < project.songCount; i++) {
+    const SongInfo &song = project.songs[i];
+    const char *songName = song.name();
+    uint8_t record[9 + MAX_SONG_NAME_LEN];
+    uint8_t nameLen = (uint8_t)strnlen(songName, MAX_SONG_NAME_LEN);
+    memcpy(&record[0], &song.songIndex, 2);
+    memcpy(&record[2], &song.changedIndex, 2);
+    memcpy(&record[4], &song.locatorMs, 4);
+    record[8] = nameLen;
+    memcpy(&record[9], songName, nameLen);
+    ok = file.write(record, 9 + nameLen) == 9u + nameLen;
+  }
+  file.close();
+  if (!ok)
+    LOGE("Short write to %s, filesystem full?", path);
+  return ok;
 }
 
-Preset ps::loadPresetFromDevice(int presetNumber) {
-  preferences.begin("Setlists", true);
-  
-  Preset preset;
-  String loadedName = preferences.getString(("p" + String(presetNumber) + "_name").c_str(), "No Preset");
-  String projName   = preferences.getString(("p" + String(presetNumber) + "_proj").c_str(), "");
-  int songCount     = preferences.getInt(("p" + String(presetNumber) + "_count").c_str(), 0);
-  
-  strlcpy(preset.name, loadedName.c_str(), sizeof(preset.name));
-  strlcpy(preset.data.projectName, projName.c_str(), sizeof(preset.data.projectName));
+bool ps::readSetlist(const char *path, char *name, ProjectInfo &project) {
+  File file = LittleFS.open(path, "r");
+  if (!file)
+    return false;
+
+  char magic[4];
+  uint32_t count = 0;
+  if (file.read((uint8_t *)magic, sizeof(magic)) != sizeof(magic) ||
+      memcmp(magic, SETLIST_MAGIC, sizeof(magic)) != 0 ||
+      !readString(file, name) ||
+      !readString(file, project.projectName) ||
+      file.read((uint8_t *)&count, sizeof(count)) != sizeof(count)) {
+    Serial.printf("Invalid setlist file: %s\n", path);
+    file.close();
+    return false;
+  }
+  if (!project.songs.reserve(count)) {
+    Serial.printf("Not enough memory for %u songs\n", (unsigned)count);
+    file.close();
+    return false;
+  }
+
+  project.songCount = 0;
+  char songName[MAX_SONG_NAME_LEN + 1];
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t header[8];
+    if (file.read(header, sizeof(header)) != sizeof(header) || !readString(file, songName)) {
+      Serial.printf("Setlist file truncated at song %u\n", (unsigned)i);
+      project.songCount = 0;
+      file.close();
+      return false;
+    }
+    SongInfo &song = project.songs[i];
+    memcpy(&song.songIndex, &header[0], 2);
+    memcpy(&song.changedIndex, &header[2], 2);
+    memcpy(&song.locatorMs, &header[4], 4);
+    if (!song.setName(songName)) {
+      project.songCount = 0;
+      file.close();
+      return false;
+    }
+    project.songCount++;
+  }
+  file.close();
+  return true;
+}
+
+// Removes the per-song NVS keys written before setlists moved to LittleFS.
+static void removeLegacySongKeys(int presetNumber) {
+  for (int i = 0; ; i++) {
+    String songKey = "p" + String(presetNumber) + "_song" + String(i);
+    if (!preferences.isKey(songKey.c_str()))
+      break;
+    preferences.remove(songKey.c_str());
+    preferences.remove(("p" + String(presetNumber) + "_index"  + String(i)).c_str());
+    preferences.remove(("p" + String(presetNumber) + "_cindex" + String(i)).c_str());
+    preferences.remove(("p" + String(presetNumber) + "_time"   + String(i)).c_str());
+  }
+}
+
+// Reads a preset saved with one NVS key per song field.
+static void loadLegacyPreset(int presetNumber, Preset &preset) {
+  int songCount = preferences.getInt(("p" + String(presetNumber) + "_count").c_str(), 0);
+  if (!preset.data.songs.reserve(songCount)) {
+    LOGE("Preset %d: no room for %d legacy songs", presetNumber, songCount);
+    return;
+  }
   preset.data.songCount = songCount;
 
   for (int i = 0; i < songCount; i++) {
@@ -47,38 +139,76 @@ Preset ps::loadPresetFromDevice(int presetNumber) {
     int cIndex    = preferences.getInt(cindexKey.c_str(), i);
     float sTime   = preferences.getFloat(timeKey.c_str(), 0.0);
 
-    strlcpy(preset.data.songs[i].songName, sName.c_str(), sizeof(preset.data.songs[i].songName));
+    preset.data.songs[i].setName(sName.c_str());
     preset.data.songs[i].songIndex    = sIndex;
     preset.data.songs[i].changedIndex = cIndex;
-    preset.data.songs[i].locatorTime  = sTime;
-  }
-
-  Serial.println("----- Preset Data -----");
-  Serial.print("Preset Name: ");
-  Serial.println(preset.name);
-  
-  Serial.print("Project Name: ");
-  Serial.println(preset.data.projectName);
-  
-  Serial.print("Song Count: ");
-  Serial.println(preset.data.songCount);
-  
-  for (int i = 0; i < preset.data.songCount; i++) {
-    Serial.print("Song ");
-    Serial.print(i);
-    Serial.println(":");
-    Serial.print("  Song Name: ");
-    Serial.println(preset.data.songs[i].songName);
-    Serial.print("  Original Index: ");
-    Serial.println(preset.data.songs[i].songIndex);
-    Serial.print("  Changed Index: ");
-    Serial.println(preset.data.songs[i].changedIndex);
-    Serial.print("  Locator Time: ");
-    Serial.println(preset.data.songs[i].locatorTime);
-  }
-  Serial.println("-----------------------");
-  
+    preset.data.songs[i].setLocatorSeconds(sTime);
+  }
+}
+
+void ps::savePresetToDevice(int presetNumber, const Preset &preset) {
+  unsigned long start = millis();
+  if (!LittleFS.exists("/setlists"))
+    LittleFS.mkdir("/setlists");
+  // As with the cache, a failed write must not cost the saved preset.
+  String path = setlistPath(presetNumber);
+  String tmp = path + ".tmp";
+  if (!writeSetlist(tmp.c_str(), preset.name, preset.data)) {
+    LittleFS.remove(tmp);
+    return;
+  }
+  if (!LittleFS.rename(tmp, path)) {
+    LOGE("Unable to replace %s", path.c_str());
+    return;
+  }
+
+  preferences.begin("Setlists", false);
+  preferences.putString(("p" + String(presetNumber) + "_name").c_str(), preset.name);
+  preferences.putString(("p" + String(presetNumber) + "_proj").c_str(), preset.data.projectName);
+  preferences.putInt(("p" + String(presetNumber) + "_count").c_str(), preset.data.songCount);
+  removeLegacySongKeys(presetNumber);
   preferences.end();
+
+  Serial.printf("Saved preset %d (%d songs) in %lu ms\n",
+                presetNumber, preset.data.songCount, millis() - start);
+}
+
+Preset ps::loadPresetFromDevice(int presetNumber) {
+  unsigned long start = millis();
+  // Free names of the preset being replaced before interning the new ones.
+  songNames.compact();
+
+  Preset preset;
+  strcpy(preset.name, "No Preset");
+  String path = setlistPath(presetNumber);
+  if (LittleFS.exists(path)) {
+    // A damaged file loads nothing: its _count key would otherwise turn the
+    // legacy path into placeholder songs.
+    if (!readSetlist(path.c_str(), preset.name, preset.data)) {
+      LOGE("Preset %d: %s is unreadable, nothing loaded", presetNumber, path.c_str());
+      strcpy(preset.name, "No Preset");
+      preset.data.clear();
+    }
+  } else {
+    preferences.begin("Setlists", true);
+    // Only presets saved before the LittleFS format have per-song keys.
+    if (preferences.isKey(("p" + String(presetNumber) + "_song0").c_str())) {
+      String loadedName = preferences.getString(("p" + String(presetNumber) + "_name").c_str(), "No Preset");
+      String projName   = preferences.getString(("p" + String(presetNumber) + "_proj").c_str(), "");
+      strlcpy(preset.name, loadedName.c_str(), sizeof(preset.name));
+      strlcpy(preset.data.projectName, projName.c_str(), sizeof(preset.data.projectName));
+      loadLegacyPreset(presetNumber, preset);
+    }
+    preferences.end();
+  }
+
+  LOGD("Preset '%s', project '%s', %d songs", preset.name, preset.data.projectName, preset.data.songCount);
+  for (int i = 0; i < preset.data.songCount; i++) {
+    const SongInfo &song = preset.data.songs[i];
+    LOGD("  %3d %-24s orig %u changed %u at %.2f s", i, song.name(), song.songIndex,
+         song.changedIndex, song.locatorSeconds());
+  }
+  LOGI("Loaded preset %d in %lu ms", presetNumber, millis() - start);
   return preset;
 }
 
@@ -91,25 +221,61 @@ void ps::deletePresetFromDevice(int presetNumber) {
   preferences.remove(("p" + String(presetNumber) + "_proj").c_str());
   preferences.remove(("p" + String(presetNumber) + "_count").c_str());
 
-  // Get the song count that was saved for this preset.
-  int songCount = preferences.getInt(("p" + String(presetNumber) + "_count").c_str(), 0);
+  // Remove song keys left by presets saved before the LittleFS format.
+  removeLegacySongKeys(presetNumber);
 
-  // Remove all song-related keys.
-  for (int i = 0; i < songCount; i++) {
-    String songKey    = "p" + String(presetNumber) + "_song"  + String(i);
-    String indexKey   = "p" + String(presetNumber) + "_index" + String(i);
-    String cindexKey  = "p" + String(presetNumber) + "_cindex"+ String(i);
-    String timeKey    = "p" + String(presetNumber) + "_time"  + String(i);
-    
-    preferences.remove(songKey.c_str());
-    preferences.remove(indexKey.c_str());
-    preferences.remove(cindexKey.c_str());
-    preferences.remove(timeKey.c_str());
+  preferences.end();
+
+  String path = setlistPath(presetNumber);
+  if (LittleFS.exists(path))
+    LittleFS.remove(path);
+
+  if (getLastPresetSlot() == presetNumber)
+    rememberLastPreset(-1);
+}
+
+void ps::saveCachedProject(const ProjectInfo &project) {
+  unsigned long start = millis();
+  if (!LittleFS.exists("/cache"))
+    LittleFS.mkdir("/cache");
+  // Write next to the old snapshot and swap, so a power cut keeps the old one.
+  // LittleFS renames over an existing file atomically; removing it first
+  // would reopen the window where there is no snapshot at all.
+  if (!writeSetlist(PROJECT_CACHE_PATH ".tmp", "", project)) {
+    LittleFS.remove(PROJECT_CACHE_PATH ".tmp");
+    return;
+  }
+  if (!LittleFS.rename(PROJECT_CACHE_PATH ".tmp", PROJECT_CACHE_PATH)) {
+    LOGE("Unable to replace %s", PROJECT_CACHE_PATH);
+    return;
+  }
+  Serial.printf("Cached project (%d songs) in %lu ms\n", project.songCount, millis() - start);
+}
+
+bool ps::loadCachedProject(ProjectInfo &project) {
+  char unused[MAX_SONG_NAME_LEN + 1];
+  project.clear();
+  if (!LittleFS.exists(PROJECT_CACHE_PATH) || !readSetlist(PROJECT_CACHE_PATH, unused, project)) {
+    project.clear();
+    return false;
   }
+  return true;
+}
 
+void ps::rememberLastPreset(int presetNumber) {
+  preferences.begin("Setlists", false);
+  if (preferences.getInt("last_slot", -1) != presetNumber)
+    preferences.putInt("last_slot", presetNumber);
   preferences.end();
 }
 
+int ps::getLastPresetSlot() {
+  preferences.begin("Setlists", true);
+  int slot = preferences.getInt("last_slot", -1);
+  preferences.end();
+  return slot;
+}
+
 void ps::initPreferences() {
   if (!preferences.begin("Setlists", false)) {
       Serial.println("Error initializing preferences");
@@ -119,4 +285,9 @@ void ps::initPreferences() {
       // preferences.clear();
   }
   preferences.end();
-}
\ No newline at end of file
+
+  // Setlist songs are stored on LittleFS; format it on first boot.
+  if (!LittleFS.begin(true)) {
+      Serial.println("LittleFS mount failed, setlists cannot be saved");
+  }
+}
@@ -0,0 +1,35 @@
+#include "_progress.h"
+#include "_state.h"
+#include "_transport.h"
+
+void ProgressTracker::findBounds(int track) {
+  _track = track;
+  SongRef song;
+  if (!StateStore::song(track, song)) {
+    _startMs = _endMs = 0;
+    return;
+  }
+  _startMs = song.startMs;
+  _endMs = song.endMs;
+}
+
+SongProgress ProgressTracker::sample(uint32_t nowUs) {
+  AppState state = StateStore::get();
+  if (state.presetVersion != _presetVersion || state.track != _track) {
+    _presetVersion = state.presetVersion;
+    findBounds(state.track);
+  }
+
+  SongProgress p = {};
+  p.running = Transport::running();
+  p.tempoCentiBpm = Transport::tempoCentiBpm();
+  if (_track < 0 || _track >= state.songCount || p.tempoCentiBpm == 0)
+    return p;
+  uint32_t playhead = Transport::playheadMs(nowUs);
+  if (playhead < _startMs || (_endMs && playhead >= _endMs))
+    return p;   // Ableton is somewhere else in the arrangement
+  p.known = true;
+  p.elapsedMs = playhead - _startMs;
+  p.lengthMs = _endMs ? _endMs - _startMs : 0;
+  return p;
+}
@@ -0,0 +1,112 @@
+#include "_render.h"
+#include "_ui.h"
+#include "_state.h"
+#include "_tasks.h"
+
+UI *Render::_ui = nullptr;
+RenderStats Render::_stats;
+
+static TaskHandle_t renderTask = NULL;
+static SemaphoreHandle_t displayLock = NULL;
+static volatile uint32_t pendingRegions = 0;
+static uint32_t requestedUs = 0;   // when pendingRegions last became non-empty
+static portMUX_TYPE pendingLock = portMUX_INITIALIZER_UNLOCKED;
+
+Render::Lock::Lock() {
+  if (displayLock)
+    xSemaphoreTakeRecursive(displayLock, portMAX_DELAY);
+}
+
+Render::Lock::~Lock() {
+  if (displayLock)
+    xSemaphoreGiveRecursive(displayLock);
+}
+
+bool Render::Lock::held() {
+  return !displayLock || xSemaphoreGetMutexHolder(displayLock) == xTaskGetCurrentTaskHandle();
+}
+
+void Render::request(uint32_t regions) {
+  portENTER_CRITICAL(&pendingLock);
+  _stats.requests++;
+  if (pendingRegions & regions)
+    _stats.coalesced++;
+  if (!pendingRegions)
+    requestedUs = micros();
+  pendingRegions |= regions;
+  portEXIT_CRITICAL(&pendingLock);
+  if (renderTask)
+    xTaskNotifyGive(renderTask);
+}
+
+static uint32_t regionsFor(uint32_t changes) {
+  uint32_t regions = 0;
+  if (changes & (STATE_TRACK | STATE_PLAYING | STATE_TRANSPORT | STATE_PRESET | STATE_CUE))
+    regions |= REGION_PRESET;
+  if (changes & STATE_VOLUME)
+    regions |= REGION_VOLUME;
+  if (changes & STATE_LINK)
+    regions |= REGION_LINK;
+  return regions;
+}
+
+void Render::task(void *param) {
+  TaskMonitor::attach(AppTask::RENDER);
+  unsigned long lastTasksDraw = 0, lastProgressDraw = 0;
+  for (;;) {
+    // Explicit requests wake the task at once; store changes are picked up
+    // within RENDER_POLL_MS.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RENDER_POLL_MS));
+    uint32_t regions = regionsFor(StateStore::changes(StateSubscriber::UI));
+    // Regions that change with time are redrawn at a fixed rate while shown.
+    ScreenState screen = _ui->getScreenState();
+    unsigned long now = millis();
+    if (screen == ScreenState::DEVICE_PROPERTIES && now - lastTasksDraw >= TASK_SCREEN_REFRESH_MS) {
+      lastTasksDraw = now;
+      regions |= REGION_TASKS;
+    }
+    if (screen == ScreenState::HOME && now - lastProgressDraw >= PROGRESS_FRAME_MS) {
+      lastProgressDraw = now;
+      regions |= REGION_PROGRESS;
+    }
+    unsigned long start = micros();
+    portENTER_CRITICAL(&pendingLock);
+    bool requested = pendingRegions != 0;
+    uint32_t since = requestedUs;
+    regions |= pendingRegions;
+    pendingRegions = 0;
+    portEXIT_CRITICAL(&pendingLock);
+    // Latency is measured for explicit requests only; polled changes wait
+    // up to RENDER_POLL_MS by design.
+    if (requested)
+      TaskMonitor::woke(AppTask::RENDER, start - since);
+    if (!regions)
+      continue;
+
+    {
+      Lock lock;
+      _ui->drawRegions(regions);
+    }
+    uint32_t us = micros() - start;
+    TaskMonitor::busy(AppTask::RENDER, us);
+    _stats.passes++;
+    if (us > _stats.maxPassUs)
+      _stats.maxPassUs = us;
+  }
+}
+
+void Render::begin(UI &ui) {
+  if (renderTask)
+    return;
+  _ui = &ui;
+  displayLock = xSemaphoreCreateRecursiveMutex();
+  // Changes made while booting are already on screen.
+  StateStore::changes(StateSubscriber::UI);
+  xTaskCreatePinnedToCore(task, "Render", RENDER_TASK_STACK, NULL, RENDER_TASK_PRIORITY, &renderTask, RENDER_TASK_CORE);
+}
+
+void Render::printReport() {
+  Serial.printf("Render: %u requests, %u coalesced, %u passes, max %u us\n",
+                _stats.requests, _stats.coalesced, _stats.passes, _stats.maxPassUs);
+  _stats.maxPassUs = 0;
+}
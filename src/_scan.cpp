@@ -0,0 +1,134 @@
+#include "_scan.h"
+#include "_midi.h"
+#include "_log.h"
+#include "freertos/semphr.h"
+
+volatile bool ScanSession::_active = false;
+volatile bool ScanSession::_endSeen = false;
+volatile int  ScanSession::_received = 0;
+volatile int  ScanSession::_total = 0;
+
+static uint32_t receivedBits[MAX_SONGS / 32];
+static SemaphoreHandle_t progressEvent = NULL;
+
+static bool isReceived(int seq) {
+  return (receivedBits[seq >> 5] >> (seq & 31)) & 1;
+}
+
+// Songs the scan should end with: the header's count, or without a header
+// everything up to the highest seq seen, so a gap still counts as missing.
+static int expected(int total) {
+  return total > 0 ? total : currentProject.songCount;
+}
+
+static void signalProgress() {
+  if (progressEvent)
+    xSemaphoreGive(progressEvent);
+}
+
+void ScanSession::begin() {
+  if (!progressEvent)
+    progressEvent = xSemaphoreCreateBinary();
+  xSemaphoreTake(progressEvent, 0);
+
+  memset(receivedBits, 0, sizeof(receivedBits));
+  _endSeen = false;
+  _received = 0;
+  _total = 0;
+  songsReady = false;
+  currentProject.clear();
+  _active = true;
+}
+
+void ScanSession::abandon() {
+  _active = false;
+  int kept = 0;
+  for (int seq = 0; seq < currentProject.songCount; seq++) {
+    if (!isReceived(seq))
+      continue;
+    if (kept != seq)
+      currentProject.songs[kept] = currentProject.songs[seq];
+    kept++;
+  }
+  for (int i = kept; i < currentProject.songCount; i++)
+    memset(&currentProject.songs[i], 0, sizeof(SongInfo));
+  LOGW("Scan abandoned, kept %d of %d songs", kept, expected(_total));
+  currentProject.songCount = kept;
+}
+
+void ScanSession::onHeader(uint16_t total) {
+  if (!_active)
+    return;
+  if (total > MAX_SONGS)
+    total = MAX_SONGS;
+  _total = total;
+  if (!currentProject.songs.reserve(total))
+    LOGE("Not enough memory for %u songs", total);
+  LOGI("Scan header: %u songs", total);
+  signalProgress();
+}
+
+bool ScanSession::onSong(int seq, const SongInfo &song) {
+  if (!_active)
+    return false;
+  if (seq < 0 || seq >= MAX_SONGS || (_total > 0 && seq >= _total))
+    return false;
+  if (isReceived(seq))
+    return true;  // Duplicate from a retransmit
+  if (!currentProject.songs.reserve(seq + 1)) {
+    LOGE("Song list is full, song %d dropped", seq);
+    return false;
+  }
+  currentProject.songs[seq] = song;
+  receivedBits[seq >> 5] |= 1UL << (seq & 31);
+  _received = _received + 1;
+  if (seq >= currentProject.songCount)
+    currentProject.songCount = seq + 1;
+  signalProgress();
+  return true;
+}
+
+void ScanSession::onEnd() {
+  if (!_active)
+    return;
+  _endSeen = true;
+  songsReady = complete();
+  LOGI("Scan pass ended: %d / %d songs", (int)_received, expected(_total));
+  signalProgress();
+}
+
+bool ScanSession::complete() {
+  return _endSeen && _received >= expected(_total);
+}
+
+int ScanSession::missing() {
+  return expected(_total) - _received;
+}
+
+bool ScanSession::waitForProgress(uint32_t timeoutMs) {
+  if (!progressEvent) {
+    delay(timeoutMs);
+    return false;
+  }
+  return xSemaphoreTake(progressEvent, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+int ScanSession::requestMissing() {
+  int ranges = 0;
+  int seq = 0;
+  int count = expected(_total);
+  while (seq < count && ranges < SCAN_MAX_NAK_RANGES) {
+    if (isReceived(seq)) {
+      seq++;
+      continue;
+    }
+    int from = seq;
+    while (seq < count && !isReceived(seq))
+      seq++;
+    Midi::Nak(from, seq - 1);
+    ranges++;
+  }
+  // The remote closes the retransmit with another end marker.
+  _endSeen = false;
+  return ranges;
+}
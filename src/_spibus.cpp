@@ -0,0 +1,105 @@
+#include "_spibus.h"
+#include "_render.h"
+
+Adafruit_SPITFT *SpiBus::_display = NULL;
+SpiDeviceStats SpiBus::_stats[(int)SpiDevice::COUNT];
+uint32_t SpiBus::_clockDiv[(int)SpiDevice::COUNT];
+uint32_t SpiBus::_clockSwitches = 0;
+
+// Guarded by Render::Lock.
+static int owner = -1;             // device whose divider is loaded
+static int depth = 0;              // nesting of the current holder
+static int holder = -1;            // device currently between acquire/release
+static unsigned long acquiredUs = 0;
+static unsigned long windowStartMs = 0;
+
+void SpiBus::begin(Adafruit_SPITFT &display) {
+  _display = &display;
+  _clockDiv[(int)SpiDevice::DISPLAY] = spiFrequencyToClockDiv(DISPLAY_SPI_FREQ);
+  _clockDiv[(int)SpiDevice::TOUCH] = spiFrequencyToClockDiv(TOUCH_SPI_FREQ);
+
+  // The display's transaction settings must match its cached divider exactly.
+  display.setSPISpeed(spiClockDivToFrequency(_clockDiv[(int)SpiDevice::DISPLAY]));
+
+  memset(_stats, 0, sizeof(_stats));
+  windowStartMs = millis();
+}
+
+void SpiBus::acquire(SpiDevice dev) {
+  configASSERT(Render::Lock::held());
+  int d = (int)dev;
+  if (holder == d) {
+    depth++;
+    return;
+  }
+  if (owner != d) {
+    // Outside any transaction: loading the divider here keeps beginTransaction()
+    // from recomputing it.
+    SPI.setClockDivider(_clockDiv[d]);
+    owner = d;
+    _clockSwitches++;
+  }
+  holder = d;
+  depth = 1;
+  acquiredUs = micros();
+  _stats[d].transactions++;
+}
+
+void SpiBus::release(SpiDevice dev) {
+  if (holder != (int)dev || --depth > 0)
+    return;
+  _stats[(int)dev].busyUs += micros() - acquiredUs;
+  holder = -1;
+}
+
+bool SpiBus::sampleTouch(XPT2046_Touchscreen &ts, TS_Point &point) {
+  configASSERT(Render::Lock::held());
+  // No IRQ since the last pen-up: nothing to read, leave the bus alone.
+  if (!ts.tirqTouched())
+    return false;
+  // Under Render::Lock the display is between bursts, its DMA drained.
+  configASSERT(holder != (int)SpiDevice::DISPLAY && !(_display && _display->dmaBusy()));
+
+  acquire(SpiDevice::TOUCH);
+  bool touched = ts.touched();
+  if (touched)
+    point = ts.getPoint();
+  release(SpiDevice::TOUCH);
+  return touched;
+}
+
+void SpiBus::printReport() {
+  // Reads and resets counters the bus users update.
+  Render::Lock lock;
+  unsigned long elapsedMs = millis() - windowStartMs;
+  if (elapsedMs == 0)
+    return;
+  static const char *names[] = {"display", "touch"};
+  for (int d = 0; d < (int)SpiDevice::COUNT; d++) {
+    Serial.printf("SPI %-7s %6lu txn  %3lu.%lu%% busy\n", names[d], (unsigned long)_stats[d].transactions,
+                  (unsigned long)_stats[d].busyUs / (elapsedMs * 10),
+                  ((unsigned long)_stats[d].busyUs / elapsedMs) % 10);
+  }
+  if (_display) {
+    const SPITFT_DMAStats &dma = _display->getDMAStats();
+    Serial.printf("SPI dma     %6lu txn  %lu KB, %lu ms on bus, %lu ms waited\n",
+                  (unsigned long)dma.transactions, (unsigned long)dma.bytes / 1024,
+                  (unsigned long)dma.busyUs / 1000, (unsigned long)dma.waitUs / 1000);
+    _display->resetDMAStats();
+  }
+  Serial.printf("SPI clock switches %lu\n", (unsigned long)_clockSwitches);
+
+  memset(_stats, 0, sizeof(_stats));
+  _clockSwitches = 0;
+  windowStartMs = millis();
+}
+
+void SharedBusTFT::startWrite(void) {
+  SpiBus::acquire(SpiDevice::DISPLAY);
+  Adafruit_ILI9341::startWrite();
+}
+
+void SharedBusTFT::endWrite(void) {
+  Adafruit_ILI9341::endWrite();
+  SpiBus::release(SpiDevice::DISPLAY);
+}
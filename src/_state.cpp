@@ -0,0 +1,193 @@
+#include "_state.h"
+#include "_log.h"
+
+AppState StateStore::_state = { 0, 0, 0, false, 0, 0, LinkHealth::UNKNOWN, -1, 0 };
+uint32_t StateStore::_pending[(int)StateSubscriber::COUNT];
+
+static portMUX_TYPE stateLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Resolved by presetLoaded(), _state.songCount entries. Read and swapped
+// only with stateLock held, so a reader never sees a freed table.
+static SongRef *songTable = NULL;
+
+static int compareMs(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Fills table[0..count) from loadedPreset. A setlist may leave songs out, so
+// a song ends at the next locator of the full project when it is scanned.
+static void buildSongTable(SongRef *table, int count) {
+  const ProjectInfo &preset = loadedPreset.data;
+  bool scanned = currentProject.songCount > 0 &&
+                 strcmp(currentProject.projectName, preset.projectName) == 0;
+  const ProjectInfo &project = scanned ? currentProject : preset;
+
+  int n = project.songCount;
+  uint32_t *locators = n ? (uint32_t *)allocSongStorage(n * sizeof(uint32_t)) : NULL;
+  if (locators) {
+    for (int i = 0; i < n; i++)
+      locators[i] = project.songs[i].locatorMs;
+    qsort(locators, n, sizeof(uint32_t), compareMs);
+  } else {
+    n = 0;
+  }
+
+  for (int i = 0; i < count; i++) {
+    const SongInfo &song = preset.songs[i];
+    table[i].songIndex = song.songIndex;
+    table[i].startMs = song.locatorMs;
+    // First locator after this one.
+    int lo = 0, hi = n;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (locators[mid] <= song.locatorMs)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    table[i].endMs = lo < n ? locators[lo] : 0;
+  }
+  free(locators);
+}
+
+// Called with stateLock held.
+void StateStore::commit(uint32_t bits) {
+  _state.version++;
+  for (int i = 0; i < (int)StateSubscriber::COUNT; i++)
+    _pending[i] |= bits;
+}
+
+AppState StateStore::get() {
+  portENTER_CRITICAL(&stateLock);
+  AppState copy = _state;
+  portEXIT_CRITICAL(&stateLock);
+  return copy;
+}
+
+bool StateStore::stepTrack(int delta) {
+  bool ok = false;
+  portENTER_CRITICAL(&stateLock);
+  int count = _state.songCount;
+  if (!_state.playing && count > 0) {
+    _state.track = ((_state.track + delta) % count + count) % count;
+    commit(STATE_TRACK);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&stateLock);
+  return ok;
+}
+
+bool StateStore::play() {
+  bool ok = false;
+  portENTER_CRITICAL(&stateLock);
+  if (_state.songCount > 0) {
+    _state.playing = true;
+    commit(STATE_PLAYING);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&stateLock);
+  return ok;
+}
+
+void StateStore::stop() {
+  portENTER_CRITICAL(&stateLock);
+  _state.playing = false;
+  commit(STATE_PLAYING);
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::setVolume(uint8_t volume) {
+  portENTER_CRITICAL(&stateLock);
+  if (volume != _state.volume) {
+    _state.volume = volume;
+    commit(STATE_VOLUME);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::setTrack(int track) {
+  portENTER_CRITICAL(&stateLock);
+  if (track >= 0 && track < _state.songCount && track != _state.track) {
+    _state.track = track;
+    commit(STATE_TRACK);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::presetLoaded() {
+  int count = loadedPreset.data.songCount;
+  SongRef *table = count ? (SongRef *)allocSongStorage(count * sizeof(SongRef)) : NULL;
+  if (table) {
+    buildSongTable(table, count);
+  } else if (count) {
+    LOGE("No memory for the table of %d songs, nothing can play", count);
+    count = 0;
+  }
+
+  portENTER_CRITICAL(&stateLock);
+  SongRef *old = songTable;
+  songTable = table;
+  _state.songCount = count;
+  if (_state.track >= count)
+    _state.track = 0;
+  _state.presetVersion++;
+  commit(STATE_PRESET | STATE_TRACK);
+  portEXIT_CRITICAL(&stateLock);
+  free(old);
+}
+
+bool StateStore::song(int track, SongRef &ref) {
+  portENTER_CRITICAL(&stateLock);
+  bool ok = track >= 0 && track < _state.songCount;
+  if (ok)
+    ref = songTable[track];
+  portEXIT_CRITICAL(&stateLock);
+  return ok;
+}
+
+void StateStore::setLink(LinkHealth link) {
+  portENTER_CRITICAL(&stateLock);
+  if (link != _state.link) {
+    _state.link = link;
+    commit(STATE_LINK);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::setTransport(bool playing) {
+  portENTER_CRITICAL(&stateLock);
+  if (playing != _state.playing) {
+    _state.playing = playing;
+    commit(STATE_TRANSPORT);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::setCue(int cued, uint8_t depth) {
+  portENTER_CRITICAL(&stateLock);
+  if (cued != _state.cued || depth != _state.cueDepth) {
+    _state.cued = cued;
+    _state.cueDepth = depth;
+    commit(STATE_CUE);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void StateStore::cueLaunched(int track) {
+  portENTER_CRITICAL(&stateLock);
+  if (track >= 0 && track < _state.songCount) {
+    _state.track = track;
+    _state.playing = true;
+    commit(STATE_TRACK | STATE_TRANSPORT);
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+uint32_t StateStore::changes(StateSubscriber subscriber) {
+  portENTER_CRITICAL(&stateLock);
+  uint32_t bits = _pending[(int)subscriber];
+  _pending[(int)subscriber] = 0;
+  portEXIT_CRITICAL(&stateLock);
+  return bits;
+}
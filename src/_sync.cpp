@@ -0,0 +1,157 @@
+#include "_sync.h"
+#include "_midi.h"
+#include "_log.h"
+#include "freertos/semphr.h"
+
+volatile SyncResult ProjectSync::_result = SyncResult::PENDING;
+volatile bool       ProjectSync::_opFailed = false;
+volatile bool       ProjectSync::_active = false;
+
+static SemaphoreHandle_t syncEvent = NULL;
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= bytes[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+uint32_t ProjectSync::hash(const ProjectInfo &project) {
+  static const uint8_t separator = 0x00;
+  uint32_t h = 2166136261UL;
+  h = fnv1a(h, project.projectName, strnlen(project.projectName, MAX_SONG_NAME_LEN));
+  h = fnv1a(h, &separator, 1);
+  for (int i = 0; i < project.songCount; i++) {
+    const SongInfo &song = project.songs[i];
+    const char *name = song.name();
+    uint8_t fields[6] = { (uint8_t)song.locatorMs, (uint8_t)(song.locatorMs >> 8),
+                          (uint8_t)(song.locatorMs >> 16), (uint8_t)(song.locatorMs >> 24),
+                          (uint8_t)song.songIndex, (uint8_t)(song.songIndex >> 8) };
+    h = fnv1a(h, name, strlen(name));
+    h = fnv1a(h, &separator, 1);
+    h = fnv1a(h, fields, sizeof(fields));
+  }
+  return h;
+}
+
+void ProjectSync::encodeHash(uint32_t hash, byte out[5]) {
+  for (int i = 0; i < 5; i++)
+    out[i] = (hash >> (7 * i)) & 0x7F;
+}
+
+uint32_t ProjectSync::decodeHash(const byte in[5]) {
+  uint32_t hash = 0;
+  for (int i = 0; i < 5; i++)
+    hash |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+  return hash;
+}
+
+bool ProjectSync::applyAdd(ProjectInfo &project, int seq, const SongInfo &song) {
+  if (seq < 0 || seq > project.songCount || !project.songs.reserve(project.songCount + 1))
+    return false;
+  // Songs after seq move down one place in Ableton's list too.
+  for (int i = project.songCount; i > seq; i--) {
+    project.songs[i] = project.songs[i - 1];
+    project.songs[i].songIndex++;
+  }
+  project.songs[seq] = song;
+  project.songCount++;
+  return true;
+}
+
+bool ProjectSync::applyRemove(ProjectInfo &project, int seq) {
+  if (seq < 0 || seq >= project.songCount)
+    return false;
+  for (int i = seq; i < project.songCount - 1; i++) {
+    project.songs[i] = project.songs[i + 1];
+    project.songs[i].songIndex--;
+  }
+  memset(&project.songs[project.songCount - 1], 0, sizeof(SongInfo));
+  project.songCount--;
+  return true;
+}
+
+bool ProjectSync::applyRename(ProjectInfo &project, int seq, const char *name) {
+  if (seq < 0 || seq >= project.songCount)
+    return false;
+  return project.songs[seq].setName(name);
+}
+
+static void signalSync() {
+  if (syncEvent)
+    xSemaphoreGive(syncEvent);
+}
+
+void ProjectSync::begin() {
+  if (!syncEvent)
+    syncEvent = xSemaphoreCreateBinary();
+  xSemaphoreTake(syncEvent, 0);
+  _result = SyncResult::PENDING;
+  _opFailed = false;
+  _active = true;
+  Midi::Sync(hash(currentProject));
+}
+
+void ProjectSync::onUnchanged() {
+  if (!_active)
+    return;
+  _active = false;
+  _result = SyncResult::UNCHANGED;
+  signalSync();
+}
+
+void ProjectSync::onDiff(const byte *data, unsigned length) {
+  if (!_active)
+    return;
+  if (length < 9) {
+    _opFailed = true;
+    return;
+  }
+  byte op = data[5];
+  int seq = data[6] | (data[7] << 7);
+  bool ok = false;
+
+  if (op == 0x01) {
+    SongInfo song;
+    ok = song.getInfo(data, length);
+    // Like a sequenced scan song, it is played by its place in the list.
+    song.songIndex = seq;
+    ok = ok && applyAdd(currentProject, seq, song);
+  } else if (op == 0x02) {
+    ok = applyRemove(currentProject, seq);
+  } else if (op == 0x03) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    unsigned i = 8, j = 0;
+    while (i < length - 1 && data[i] != 0x00 && j < MAX_SONG_NAME_LEN)
+      name[j++] = (char)data[i++];
+    name[j] = '\0';
+    ok = applyRename(currentProject, seq, name);
+  }
+  if (!ok) {
+    LOGW("Sync op 0x%02X at %d failed", op, seq);
+    _opFailed = true;
+  }
+  signalSync();
+}
+
+void ProjectSync::onDiffEnd(uint32_t remoteHash) {
+  if (!_active)
+    return;
+  _active = false;
+  bool match = !_opFailed && hash(currentProject) == remoteHash;
+  _result = match ? SyncResult::UPDATED : SyncResult::MISMATCH;
+  LOGI("Sync diff applied, hash %s", match ? "matches" : "mismatch");
+  signalSync();
+}
+
+SyncResult ProjectSync::wait(uint32_t timeoutMs) {
+  while (_result == SyncResult::PENDING) {
+    if (!syncEvent || xSemaphoreTake(syncEvent, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+      _active = false;
+      break;
+    }
+  }
+  return _result;
+}
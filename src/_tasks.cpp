@@ -0,0 +1,122 @@
+#include "_tasks.h"
+
+struct TaskLoad {
+  uint64_t busyUs;
+  uint64_t lateUs;
+  uint32_t passes;
+  uint32_t maxLateUs;
+};
+
+struct TaskEntry {
+  TaskHandle_t handle;
+  int8_t core;
+  TaskLoad load[(int)TaskView::COUNT];
+};
+
+static const char *const taskNames[] = { "midi", "render", "loop", "log" };
+static TaskEntry entries[(int)AppTask::COUNT];
+static uint32_t windowStartUs[(int)TaskView::COUNT];
+static portMUX_TYPE monitorLock = portMUX_INITIALIZER_UNLOCKED;
+
+void TaskMonitor::attach(AppTask task) {
+  TaskEntry &e = entries[(int)task];
+  portENTER_CRITICAL(&monitorLock);
+  e.handle = xTaskGetCurrentTaskHandle();
+  e.core = xPortGetCoreID();
+  portEXIT_CRITICAL(&monitorLock);
+}
+
+void TaskMonitor::busy(AppTask task, uint32_t us) {
+  TaskEntry &e = entries[(int)task];
+  portENTER_CRITICAL(&monitorLock);
+  for (int v = 0; v < (int)TaskView::COUNT; v++) {
+    e.load[v].busyUs += us;
+    e.load[v].passes++;
+  }
+  portEXIT_CRITICAL(&monitorLock);
+}
+
+void TaskMonitor::woke(AppTask task, uint32_t lateUs) {
+  TaskEntry &e = entries[(int)task];
+  portENTER_CRITICAL(&monitorLock);
+  for (int v = 0; v < (int)TaskView::COUNT; v++) {
+    e.load[v].lateUs += lateUs;
+    if (lateUs > e.load[v].maxLateUs)
+      e.load[v].maxLateUs = lateUs;
+  }
+  portEXIT_CRITICAL(&monitorLock);
+}
+
+void TaskMonitor::collect(TaskView view, TaskStatus out[(int)AppTask::COUNT]) {
+  TaskLoad loads[(int)AppTask::COUNT];
+  TaskHandle_t handles[(int)AppTask::COUNT];
+  int v = (int)view;
+
+  portENTER_CRITICAL(&monitorLock);
+  uint32_t now = micros();
+  uint32_t elapsedUs = now - windowStartUs[v];
+  windowStartUs[v] = now;
+  for (int t = 0; t < (int)AppTask::COUNT; t++) {
+    loads[t] = entries[t].load[v];
+    handles[t] = entries[t].handle;
+    out[t].core = entries[t].handle ? entries[t].core : -1;
+    memset(&entries[t].load[v], 0, sizeof(TaskLoad));
+  }
+  portEXIT_CRITICAL(&monitorLock);
+
+  for (int t = 0; t < (int)AppTask::COUNT; t++) {
+    const TaskLoad &l = loads[t];
+    TaskStatus &s = out[t];
+    s.name = taskNames[t];
+    s.priority = handles[t] ? uxTaskPriorityGet(handles[t]) : 0;
+    // ESP-IDF counts stack in bytes.
+    s.stackFree = handles[t] ? uxTaskGetStackHighWaterMark(handles[t]) : 0;
+    uint64_t permille = elapsedUs ? l.busyUs * 1000 / elapsedUs : 0;
+    s.cpuPermille = permille > 1000 ? 1000 : permille;
+    s.passes = l.passes;
+    s.avgLateUs = l.passes ? l.lateUs / l.passes : 0;
+    s.maxLateUs = l.maxLateUs;
+  }
+}
+
+void TaskMonitor::printReport() {
+  TaskStatus status[(int)AppTask::COUNT];
+  collect(TaskView::REPORT, status);
+  for (int t = 0; t < (int)AppTask::COUNT; t++) {
+    const TaskStatus &s = status[t];
+    if (s.core < 0)
+      continue;  // not started
+    Serial.printf("Task %-6s core %d prio %2u  %3u.%u%% cpu  %6u passes  stack %5u B free  late avg %5u us max %6u us\n",
+                  s.name, s.core, s.priority, s.cpuPermille / 10, s.cpuPermille % 10, s.passes,
+                  s.stackFree, s.avgLateUs, s.maxLateUs);
+  }
+}
+
+TaskPeriod::TaskPeriod(AppTask task, uint32_t periodMs)
+    : _task(task), _lastWake(xTaskGetTickCount()), _periodTicks(pdMS_TO_TICKS(periodMs)),
+      _periodUs(periodMs * 1000), _dueUs(micros()), _passStartUs(micros()) {
+  if (_periodTicks == 0)
+    _periodTicks = 1;
+}
+
+void TaskPeriod::wait() {
+  TaskMonitor::busy(_task, micros() - _passStartUs);
+  TickType_t due = _lastWake + _periodTicks;
+  TickType_t left = due - xTaskGetTickCount();
+  if (left <= _periodTicks && left > 0 && ulTaskNotifyTake(pdTRUE, left)) {
+    // Woken for something that can't wait for the next period.
+    _passStartUs = micros();
+    return;
+  }
+  _lastWake = due;
+  uint32_t now = micros();
+  _dueUs += _periodUs;
+  int32_t late = (int32_t)(now - _dueUs);
+  if (late < 0) {
+    // Earlier than any wake so far: this is the on-time phase.
+    _dueUs = now;
+    late = 0;
+  }
+  TaskMonitor::woke(_task, late);
+  _passStartUs = now;
+}
@@ -0,0 +1,170 @@
+#include "_tour.h"
+
+static const char *const fixtureSongs[] = {
+  "Intro", "Opening Night", "Glass Harbour", "Slow Burn", "Northern Lights",
+  "Interlude (Tape)", "Paper Planes", "A Very Long Song Title For Truncation",
+  "Undertow", "Encore", "Outro", "Soundcheck"
+};
+static const int fixtureSongCount = sizeof(fixtureSongs) / sizeof(fixtureSongs[0]);
+
+static const char *const fixtureNetworks[] = {
+  "StudioNet", "Backstage-5G", "FOH_Desk", "Guest", "Van"
+};
+static const int fixtureRssi[] = { -35, -52, -67, -78, -91 };
+static const int fixtureNetworkCount = sizeof(fixtureNetworks) / sizeof(fixtureNetworks[0]);
+
+void ScreenTour::loadFixtures() {
+  currentProject.clear();
+  currentProject.songs.reserve(fixtureSongCount);
+  strcpy(currentProject.projectName, "Tour Project");
+  for (int i = 0; i < fixtureSongCount; i++) {
+    SongInfo &song = currentProject.songs[i];
+    song.songIndex = i;
+    song.changedIndex = i;
+    song.setName(fixtureSongs[i]);
+    song.locatorMs = i * 240000UL;
+  }
+  currentProject.songCount = fixtureSongCount;
+
+  // Every other song of the first eight is picked for the new setlist.
+  selectedSongs.clear();
+  selectedTrackCount = 0;
+  for (int i = 0; i < 8; i += 2) {
+    selectedSongs.toggle(i);
+    selectedTrackCount++;
+  }
+
+  strcpy(loadedPreset.name, "Tour Setlist");
+  loadedPreset.data.clear();
+  loadedPreset.data.songs.reserve(6);
+  strcpy(loadedPreset.data.projectName, currentProject.projectName);
+  for (int i = 0; i < 6; i++) {
+    loadedPreset.data.songs[i] = currentProject.songs[i + 1];
+    loadedPreset.data.songs[i].changedIndex = i;
+  }
+  loadedPreset.data.songCount = 6;
+  StateStore::presetLoaded();
+
+  wifiCount = fixtureNetworkCount;
+  for (int i = 0; i < fixtureNetworkCount; i++) {
+    wifiSSIDs[i] = fixtureNetworks[i];
+    wifiRSSI[i] = fixtureRssi[i];
+  }
+  selectedSSID = fixtureNetworks[0];
+  strcpy(wifiPassword, "hunter22");
+  strcpy(setlistName, "Friday Show");
+
+  // Slot 0 is never stored, so SAVE_SETLIST keeps the fixture name.
+  selectedPresetSlot = 0;
+  newSetlistScanned = true;
+  songsReady = true;
+  StateStore::setVolume(96);
+  StateStore::stop();
+}
+
+// Screens scroll, highlight and consume flags as they draw; put everything
+// back so each screen starts from the same state on both passes.
+void ScreenTour::resetScreenState(UI &ui) {
+  currentMenuItem = 0;
+  currentMenu2Item = 0;
+  currentWifiMenuItem = 0;
+  currentSongItem = 0;
+  scrollOffset = 0;
+  menu1Index = 0;
+  isShifted = false;
+  isReordering = false;
+  isReorderedSongsInitialized = false;
+  presetChanged = true;
+  StateStore::setTrack(2);
+  wifiScanInProgress = false;
+  wifiScanDone = true;       // WifiScan() draws the fixture list instead of scanning
+  wifiScrollOffset = 0;
+  wifiCurrentItem = 0;
+  ui.currentPresetIndex = 0;
+  ui.presetScrollOffset = 0;
+}
+
+uint32_t ScreenTour::hashFrame(const GFXcanvas16 &frame) {
+  const uint8_t *p = (const uint8_t *)frame.getBuffer();
+  size_t n = (size_t)frame.width() * frame.height() * 2;
+  uint32_t h = 2166136261UL;
+  while (n--) {
+    h ^= *p++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+// One line per row of "length:color" runs in hex; UI screens are mostly flat
+// fills, so a frame is a few KB of text instead of 150 KB.
+void ScreenTour::dumpFrame(Print &out, const char *name, const GFXcanvas16 &frame) {
+  const uint16_t *pixels = frame.getBuffer();
+  int16_t w = frame.width(), h = frame.height();
+  out.printf("SHOT %s %d %d\n", name, w, h);
+  for (int16_t y = 0; y < h; y++) {
+    const uint16_t *row = pixels + (size_t)y * w;
+    out.print('|');
+    int16_t x = 0;
+    while (x < w) {
+      int16_t run = 1;
+      while (x + run < w && row[x + run] == row[x])
+        run++;
+      out.printf(" %x:%04x", run, row[x]);
+      x += run;
+    }
+    out.println();
+  }
+  out.println(F("SHOT end"));
+}
+
+TourResult ScreenTour::shoot(UI &ui, ScreenState state, GFXcanvas16 &frame) {
+  TourResult r;
+  r.state = state;
+
+  resetScreenState(ui);
+  ui.setCaptureTarget(&frame);
+  ui.setScreenState(state);
+  ui.setCaptureTarget(NULL);
+  r.hash = hashFrame(frame);
+
+  resetScreenState(ui);
+  Adafruit_SPITFT &display = ui.getDisplay();
+  SPITFT_DMAStats before = display.getDMAStats();
+  uint32_t busBefore = SpiBus::stats(SpiDevice::DISPLAY).transactions;
+  unsigned long start = micros();
+  ui.setScreenState(state);
+  r.totalUs = micros() - start;
+  const SPITFT_DMAStats &after = display.getDMAStats();
+  r.spiBytes = after.bytes - before.bytes;
+  r.spiTxns = after.transactions - before.transactions;
+  r.busHolds = SpiBus::stats(SpiDevice::DISPLAY).transactions - busBefore;
+  r.ops = ui.lastFrameStats().ops;
+  r.pushUs = ui.lastFrameStats().pushUs;
+  return r;
+}
+
+void ScreenTour::run(UI &ui, Print &out, bool dumpFrames) {
+  GFXcanvas16 frame(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  if (!frame.getBuffer()) {
+    out.println(F("Screen tour: no memory for the capture canvas"));
+    return;
+  }
+
+  loadFixtures();
+  const int screenCount = (int)ScreenState::WIFI_PROPERTIES + 1;
+  unsigned long totalBytes = 0, totalUs = 0;
+  out.printf("TOUR begin %d screens\n", screenCount);
+
+  for (int i = 0; i < screenCount; i++) {
+    TourResult r = shoot(ui, (ScreenState)i, frame);
+    if (dumpFrames)
+      dumpFrame(out, UI::screenName(r.state), frame);
+    out.printf("TOUR %-20s hash=%08lx ops=%u bytes=%lu dma=%lu bus=%lu push=%lu total=%lu\n",
+               UI::screenName(r.state), (unsigned long)r.hash, r.ops, (unsigned long)r.spiBytes,
+               (unsigned long)r.spiTxns, (unsigned long)r.busHolds, (unsigned long)r.pushUs,
+               (unsigned long)r.totalUs);
+    totalBytes += r.spiBytes;
+    totalUs += r.totalUs;
+  }
+  out.printf("TOUR end bytes=%lu total=%lu\n", totalBytes, totalUs);
+}
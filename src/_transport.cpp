@@ -0,0 +1,187 @@
+#include "_transport.h"
+#include "_state.h"
+
+static bool isRunning = false;
+static bool awaitingClock = false;    // Start/Continue seen, position moves from the next clock on
+static bool haveClock = false;
+static uint32_t lastClockUs = 0;      // raw arrival of the last clock
+static uint32_t phaseUs = 0;          // filtered time of the last clock
+static int32_t periodQ8 = 0;          // filtered clock period in 1/256 us, 0 = unknown
+static uint32_t clocksSinceLock = 0;
+static uint8_t outliers = 0;
+static uint32_t outlierStartUs = 0;
+static uint32_t tickCount = 0;
+static uint64_t playheadQ8 = 0;       // song time at the last clock, 1/256 us
+static TransportStats transportStats;
+static portMUX_TYPE transportLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Called with transportLock held.
+static void track(uint32_t nowUs) {
+  if (!haveClock || nowUs - lastClockUs > TRANSPORT_CLOCK_GAP_MS * 1000UL) {
+    // First clock after a pause: keep the old period as a guess, restart the phase.
+    haveClock = true;
+    phaseUs = nowUs;
+    clocksSinceLock = 0;
+    outliers = 0;
+    return;
+  }
+  if (periodQ8 == 0) {
+    periodQ8 = (int32_t)((nowUs - lastClockUs) << 8);
+    phaseUs = nowUs;
+    return;
+  }
+
+  int32_t period = periodQ8 >> 8;
+  uint32_t predicted = phaseUs + period;
+  int32_t error = (int32_t)(nowUs - predicted);
+  if (error > period / 2 || error < -period / 2) {
+    if (outliers++ == 0)
+      outlierStartUs = lastClockUs;
+    if (outliers >= TRANSPORT_RELOCK_CLOCKS) {
+      periodQ8 = (int32_t)(((uint64_t)(nowUs - outlierStartUs) << 8) / outliers);
+      phaseUs = nowUs;
+      outliers = 0;
+      clocksSinceLock = 0;
+      transportStats.relocks++;
+      return;
+    }
+    // Could be a late or bunched clock: follow it only half a period.
+    error = error < 0 ? -period / 2 : period / 2;
+  } else {
+    outliers = 0;
+    periodQ8 += error * 256 / (1 << TRANSPORT_PLL_PERIOD_SHIFT);
+    clocksSinceLock++;
+    if (clocksSinceLock > TRANSPORT_LOCK_CLOCKS) {
+      int32_t magnitude = error < 0 ? -error : error;
+      if (magnitude > transportStats.maxErrorUs)
+        transportStats.maxErrorUs = magnitude;
+    }
+  }
+  phaseUs = predicted + error / (1 << TRANSPORT_PLL_PHASE_SHIFT);
+}
+
+void Transport::clock(uint32_t nowUs) {
+  portENTER_CRITICAL(&transportLock);
+  transportStats.clocks++;
+  track(nowUs);
+  lastClockUs = nowUs;
+  if (isRunning) {
+    if (awaitingClock) {
+      awaitingClock = false;   // this clock is the current position itself
+    } else {
+      tickCount++;
+      playheadQ8 += periodQ8;
+    }
+  }
+  portEXIT_CRITICAL(&transportLock);
+}
+
+void Transport::start() {
+  portENTER_CRITICAL(&transportLock);
+  tickCount = 0;
+  playheadQ8 = 0;
+  isRunning = true;
+  awaitingClock = true;
+  portEXIT_CRITICAL(&transportLock);
+  StateStore::setTransport(true);
+}
+
+void Transport::resume() {
+  portENTER_CRITICAL(&transportLock);
+  isRunning = true;
+  awaitingClock = true;
+  portEXIT_CRITICAL(&transportLock);
+  StateStore::setTransport(true);
+}
+
+void Transport::stop() {
+  portENTER_CRITICAL(&transportLock);
+  isRunning = false;
+  portEXIT_CRITICAL(&transportLock);
+  StateStore::setTransport(false);
+}
+
+// Song Position Pointer counts sixteenth notes, six clocks each.
+void Transport::songPosition(uint16_t sixteenths) {
+  portENTER_CRITICAL(&transportLock);
+  tickCount = (uint32_t)sixteenths * 6;
+  playheadQ8 = (uint64_t)tickCount * periodQ8;
+  portEXIT_CRITICAL(&transportLock);
+}
+
+bool Transport::running() {
+  return isRunning;
+}
+
+bool Transport::locked() {
+  return periodQ8 != 0 && clocksSinceLock >= TRANSPORT_LOCK_CLOCKS;
+}
+
+uint32_t Transport::tempoCentiBpm() {
+  int32_t period = periodQ8;
+  if (period <= 0)
+    return 0;
+  // 24 clocks per beat: bpm = 60e6 / (24 * period us)
+  return (uint32_t)(250000000ULL * 256 / (uint32_t)period);
+}
+
+uint32_t Transport::ticks() {
+  return tickCount;
+}
+
+uint32_t Transport::playheadMs(uint32_t nowUs) {
+  portENTER_CRITICAL(&transportLock);
+  uint64_t us = playheadQ8 >> 8;
+  if (isRunning && !awaitingClock && periodQ8 > 0) {
+    // Between clocks: advance at the estimated rate, but never past the next clock.
+    int32_t since = (int32_t)(nowUs - phaseUs);
+    int32_t period = periodQ8 >> 8;
+    us += since < 0 ? 0 : since > period ? period : since;
+  }
+  portEXIT_CRITICAL(&transportLock);
+  return (uint32_t)(us / 1000);
+}
+
+uint32_t Transport::usUntilTick(uint32_t tick, uint32_t nowUs) {
+  portENTER_CRITICAL(&transportLock);
+  bool known = isRunning && periodQ8 > 0;
+  uint64_t dueQ8 = 0;
+  if (known && tick > tickCount)
+    dueQ8 = (uint64_t)(tick - tickCount) * periodQ8;
+  uint32_t lastUs = phaseUs;
+  portEXIT_CRITICAL(&transportLock);
+  if (!known)
+    return UINT32_MAX;
+  int64_t us = (int64_t)(dueQ8 >> 8) - (int32_t)(nowUs - lastUs);
+  return us <= 0 ? 0 : us >= UINT32_MAX ? UINT32_MAX - 1 : (uint32_t)us;
+}
+
+TransportStats Transport::stats() {
+  portENTER_CRITICAL(&transportLock);
+  TransportStats copy = transportStats;
+  portEXIT_CRITICAL(&transportLock);
+  return copy;
+}
+
+void Transport::printReport() {
+  TransportStats s = stats();
+  uint32_t tempo = tempoCentiBpm();
+  Serial.printf("Transport %s%s, %lu.%02lu bpm, tick %lu, %lu clocks, %lu relocks, max error %ld us\n",
+                isRunning ? "running" : "stopped", locked() ? "" : " (unlocked)",
+                (unsigned long)(tempo / 100), (unsigned long)(tempo % 100), (unsigned long)tickCount,
+                (unsigned long)s.clocks, (unsigned long)s.relocks, (long)s.maxErrorUs);
+  portENTER_CRITICAL(&transportLock);
+  transportStats.maxErrorUs = 0;
+  portEXIT_CRITICAL(&transportLock);
+}
+
+void Transport::reset() {
+  portENTER_CRITICAL(&transportLock);
+  isRunning = awaitingClock = haveClock = false;
+  periodQ8 = 0;
+  clocksSinceLock = tickCount = 0;
+  outliers = 0;
+  playheadQ8 = 0;
+  memset(&transportStats, 0, sizeof(transportStats));
+  portEXIT_CRITICAL(&transportLock);
+}
@@ -1,10 +1,13 @@
 #include "_ui.h"
+#include "_log.h"
 
 AsyncWebServerManager webServerManager(80);
 
 // Constructor: Initialize with the provided display.
 UI::UI() :  tft(TFT_CS, TFT_DC, TFT_RST) , 
             ts(T_CS, T_IRQ) ,
+            band(tft) ,
+            gfx(&tft) ,
             currentState(ScreenState::LOADING),
             previousState(ScreenState::LOADING) {}
 
@@ -20,8 +23,10 @@ void UI::init() {
         Serial.println(F("Touchscreen Initialization Failed!"));
         while (1);
     }
-    tft.begin();
+    tft.begin(DISPLAY_SPI_FREQ);
     tft.setRotation(1);
+    SpiBus::begin(tft);
+    band.begin();
 }
 
 ScreenState UI::getScreenState() const {
@@ -37,8 +42,60 @@ void UI::restorePreviousScreenState() {
     updateScreen();
 }
 
+const char *UI::screenName(ScreenState state) {
+  static const char *const names[] = {
+    "LOADING", "HOME", "MENU1", "NEW_SETLIST", "EDIT_SETLIST", "SELECT_SETLIST",
+    "SAVE_SETLIST", "MENU2", "MENU2_WIFISETTINGS", "MENU2_WIFICONNECT",
+    "MENU2_WIFIPASS", "MENU2_WIFICONFIRM", "MENU2_WIFICONNECTING",
+    "DEVICE_PROPERTIES", "WIFI_PROPERTIES"
+  };
+  size_t i = (size_t)state;
+  return i < sizeof(names) / sizeof(names[0]) ? names[i] : "?";
+}
+
+// Full screens are recorded and sent in bands; nested screen changes join the
+// outer frame. While capturing they go to the capture target instead.
+void UI::beginFrame() {
+  if (frameDepth++ > 0)
+    return;
+  if (captureTarget) {
+    gfx = captureTarget;
+  } else if (band.ready()) {
+    band.beginFrame();
+    gfx = &band;
+  }
+}
+
+void UI::endFrame() {
+  if (--frameDepth > 0)
+    return;
+  if (captureTarget)
+    gfx = &tft;
+  else
+    presentFrame();
+}
+
+// Sends what has been drawn so far and switches to direct drawing. Screens
+// call this before blocking so their progress output is visible.
+void UI::presentFrame() {
+  if (!band.recording())
+    return;
+  band.endFrame();
+  gfx = &tft;
+  const FrameStats &f = band.lastFrame();
+  LOGD("Frame %-20s %4u ops %2u bands  record %5lu us  raster %5lu us  expand %5lu us  push %5lu us",
+       screenName(currentState), f.ops, f.bands, (unsigned long)f.recordUs,
+       (unsigned long)f.rasterUs, (unsigned long)f.expandUs, (unsigned long)f.pushUs);
+}
+
+void UI::printFrameReport() {
+  Render::Lock lock;
+  band.printReport();
+}
+
 // Call the appropriate screen handler based on currentState.
 void UI::updateScreen() {
+  beginFrame();
   switch (currentState) {
     case ScreenState::LOADING:
       loadingScreen();
@@ -89,15 +146,16 @@ void UI::updateScreen() {
       homeScreen(); // Default fallback
       break;
   }
+  endFrame();
 }
 
 // --- Basic UI Drawing Functions ---
 
 void UI::drawText(const char* text, int16_t x, int16_t y, uint16_t color, uint8_t size) {
-  tft.setTextColor(color);
-  tft.setTextSize(size);
-  tft.setCursor(x, y);
-  tft.print(text);
+  gfx->setTextColor(color);
+  gfx->setTextSize(size);
+  gfx->setCursor(x, y);
+  gfx->print(text);
 }
 
 void UI::drawTextCenter(const String &text, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
@@ -105,36 +163,36 @@ void UI::drawTextCenter(const String &text, int16_t x, int16_t y, int16_t w, int
     int16_t th = 16;                   // approximate text height for size 2
     int16_t xc = x + (w - tw) / 2;
     int16_t yc = y + (h - th) / 2;
-    tft.setCursor(xc, yc);
-    tft.setTextColor(color);
-    tft.setTextSize(2);
-    tft.print(text);
+    gfx->setCursor(xc, yc);
+    gfx->setTextColor(color);
+    gfx->setTextSize(2);
+    gfx->print(text);
 }
 
 void UI::drawTextTopCenter(const char *text, int16_t yOffset, bool underline , uint16_t textColor) {
     int16_t tw = strlen(text) * 6 * 2;
-    int16_t xc = (tft.width() - tw) / 2;
-    tft.setCursor(xc, yOffset);
-    tft.setTextColor(textColor);
-    tft.setTextSize(2);
-    tft.print(text);
+    int16_t xc = (gfx->width() - tw) / 2;
+    gfx->setCursor(xc, yOffset);
+    gfx->setTextColor(textColor);
+    gfx->setTextSize(2);
+    gfx->print(text);
     if (underline) {
-        tft.drawLine(xc, yOffset + 16, xc + tw, yOffset + 16, textColor);
+        gfx->drawLine(xc, yOffset + 16, xc + tw, yOffset + 16, textColor);
     }
 }
 
 void UI::drawRectButton(int16_t x, int16_t y, int16_t w, int16_t h, const char* label, uint16_t color) {
-  tft.drawRect(x, y, w, h, color);
+  gfx->drawRect(x, y, w, h, color);
   drawTextCenter(String(label), x, y, w, h, color);
 }
 
 void UI::drawKeyboard(bool shifted) {
     int keyStartY = 88;              // Starting Y position for the keyboard
     int keyHeight = 30;              // Height of each key
-    int keyWidth  = tft.width() / 10; // Divide the display width evenly for 10 keys
+    int keyWidth  = gfx->width() / 10; // Divide the display width evenly for 10 keys
 
     // Clear the keyboard area
-    tft.fillRect(0, keyStartY, tft.width(), 5 * keyHeight, ILI9341_BLACK);
+    gfx->fillRect(0, keyStartY, gfx->width(), 5 * keyHeight, ILI9341_BLACK);
 
     // Draw 4 rows of keys (using the keys array defined in config)
     for (int row = 0; row < 4; row++) {
@@ -142,7 +200,7 @@ void UI::drawKeyboard(bool shifted) {
             int x = col * keyWidth;
             int y = keyStartY + row * keyHeight;
             // Draw key border
-            tft.drawRect(x, y, keyWidth, keyHeight, ILI9341_WHITE);
+            gfx->drawRect(x, y, keyWidth, keyHeight, ILI9341_WHITE);
             // Select the character: for rows after the first, if shifted then uppercase.
             char displayKey = keys[row][col];
             if (shifted && row > 0) {
@@ -176,45 +234,46 @@ void UI::displayVolume() {
     int interiorHeight = barHeight - 2;
     
     // Map the current and previous volume values to interior width.
-    static byte lastVolume = currentVolume;  // Initialize with currentVolume.
-    int filledWidth = map(currentVolume, 0, 127, 0, interiorWidth);
+    byte volume = StateStore::get().volume;
+    static byte lastVolume = volume;  // Initialize with the current volume.
+    int filledWidth = map(volume, 0, 127, 0, interiorWidth);
     int lastFilledWidth = map(lastVolume, 0, 127, 0, interiorWidth);
 
     // Update only the interior based on volume changes.
     if (filledWidth > lastFilledWidth) {
         // Volume increased: fill the extra portion in green.
-        tft.fillRect(interiorX + lastFilledWidth, interiorY, filledWidth - lastFilledWidth, interiorHeight, ILI9341_GREEN);
+        gfx->fillRect(interiorX + lastFilledWidth, interiorY, filledWidth - lastFilledWidth, interiorHeight, ILI9341_GREEN);
     } else if (filledWidth < lastFilledWidth) {
         // Volume decreased: clear the portion that is no longer filled.
-        tft.fillRect(interiorX + filledWidth, interiorY, lastFilledWidth - filledWidth, interiorHeight, ILI9341_BLACK);
+        gfx->fillRect(interiorX + filledWidth, interiorY, lastFilledWidth - filledWidth, interiorHeight, ILI9341_BLACK);
     } else {
         // On the first call or if no change, ensure the interior is drawn correctly.
-        tft.fillRect(interiorX, interiorY, filledWidth, interiorHeight, ILI9341_GREEN);
+        gfx->fillRect(interiorX, interiorY, filledWidth, interiorHeight, ILI9341_GREEN);
         if (filledWidth < interiorWidth) {
-            tft.fillRect(interiorX + filledWidth, interiorY, interiorWidth - filledWidth, interiorHeight, ILI9341_BLACK);
+            gfx->fillRect(interiorX + filledWidth, interiorY, interiorWidth - filledWidth, interiorHeight, ILI9341_BLACK);
         }
     }
     
     // Update lastVolume for future comparisons.
-    lastVolume = currentVolume;
+    lastVolume = volume;
 }
 
 void UI::drawHomeMenuBox() {
     // Draw Box 1
     if (currentHomeMenuSelection == 0) {
-        tft.drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
+        gfx->drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
         drawTextCenter("1", BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
     } else {
-        tft.drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
+        gfx->drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
         drawTextCenter("1", BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
     }
 
     // Draw Box 2
     if (currentHomeMenuSelection == 1) {
-        tft.drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
+        gfx->drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
         drawTextCenter("2", BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
     } else {
-        tft.drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
+        gfx->drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
         drawTextCenter("2", BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
     }
 }
@@ -232,24 +291,24 @@ void UI::updateHomeMenuSelection(int delta) {
         // Redraw the box that lost selection.
         if (previousSelection == 0) {
             // Clear and redraw Box 1 un-highlighted.
-            tft.fillRect(BOX1_X - 1, BOX1_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
-            tft.drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
+            gfx->fillRect(BOX1_X - 1, BOX1_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
+            gfx->drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
             drawTextCenter("1", BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
         } else if (previousSelection == 1) {
             // Clear and redraw Box 2 un-highlighted.
-            tft.fillRect(BOX2_X - 1, BOX2_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
-            tft.drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
+            gfx->fillRect(BOX2_X - 1, BOX2_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
+            gfx->drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
             drawTextCenter("2", BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_WHITE);
         }
 
         // Redraw the box that gained selection.
         if (currentHomeMenuSelection == 0) {
-            tft.fillRect(BOX1_X - 1, BOX1_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
-            tft.drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
+            gfx->fillRect(BOX1_X - 1, BOX1_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
+            gfx->drawRect(BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
             drawTextCenter("1", BOX1_X, BOX1_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
         } else if (currentHomeMenuSelection == 1) {
-            tft.fillRect(BOX2_X - 1, BOX2_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
-            tft.drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
+            gfx->fillRect(BOX2_X - 1, BOX2_Y - 1, BOX_WIDTH + 2, BOX_HEIGHT + 2, ILI9341_BLACK);
+            gfx->drawRect(BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
             drawTextCenter("2", BOX2_X, BOX2_Y, BOX_WIDTH, BOX_HEIGHT, ILI9341_YELLOW);
         }
     }
@@ -260,25 +319,25 @@ void UI::drawMenuItem(int index, bool selected) {
     int y = 60 + index * 30;
     
     // Clear the menu item region (we assume a width of 220 and height of 30).
-    tft.fillRect(10, y, 220, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, 220, 30, ILI9341_BLACK);
     
     // Set the cursor position (adjust as needed).
-    tft.setCursor(15, y + 5);
+    gfx->setCursor(15, y + 5);
     
     // If using an external font, set it here:
-    // tft.setFont(&FreeSans9pt7b);
+    // gfx->setFont(&FreeSans9pt7b);
     
     // Set the text color based on selection.
-    tft.setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
+    gfx->setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
     
     // Set text size.
-    tft.setTextSize(2);
+    gfx->setTextSize(2);
     
     // Copy the menu item text (assuming menuItems is stored in PROGMEM).
     char buffer[16];
     strncpy_P(buffer, menuItems[index], sizeof(buffer));
     buffer[sizeof(buffer) - 1] = '\0'; // ensure null-termination
-    tft.print(buffer);
+    gfx->print(buffer);
 }
 
 void UI::updateMenuSelection(int previousIndex, int currentIndex) {
@@ -294,25 +353,25 @@ void UI::drawMenu2Item(int index, bool selected) {
     int y = 60 + index * 30;
     
     // Clear the menu item region (we assume a width of 220 and height of 30).
-    tft.fillRect(10, y, 220, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, 220, 30, ILI9341_BLACK);
     
     // Set the cursor position (adjust as needed).
-    tft.setCursor(15, y + 5);
+    gfx->setCursor(15, y + 5);
     
     // If using an external font, set it here:
-    // tft.setFont(&FreeSans9pt7b);
+    // gfx->setFont(&FreeSans9pt7b);
     
     // Set the text color based on selection.
-    tft.setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
+    gfx->setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
     
     // Set text size.
-    tft.setTextSize(2);
+    gfx->setTextSize(2);
     
     // Copy the menu item text (assuming menuItems is stored in PROGMEM).
     char buffer[16];
     strncpy_P(buffer, menu2Items[index], sizeof(buffer));
     buffer[sizeof(buffer) - 1] = '\0'; // ensure null-termination
-    tft.print(buffer);
+    gfx->print(buffer);
 }
 
 void UI::updateMenu2Selection(int previousIndex, int currentIndex) {
@@ -328,25 +387,25 @@ void UI::drawWifiMenuItem(int index, bool selected) {
     int y = 60 + index * 30;
     
     // Clear the menu item region (we assume a width of 220 and height of 30).
-    tft.fillRect(10, y, 220, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, 220, 30, ILI9341_BLACK);
     
     // Set the cursor position (adjust as needed).
-    tft.setCursor(15, y + 5);
+    gfx->setCursor(15, y + 5);
     
     // If using an external font, set it here:
-    // tft.setFont(&FreeSans9pt7b);
+    // gfx->setFont(&FreeSans9pt7b);
     
     // Set the text color based on selection.
-    tft.setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
+    gfx->setTextColor(selected ? ILI9341_YELLOW : ILI9341_WHITE);
     
     // Set text size.
-    tft.setTextSize(2);
+    gfx->setTextSize(2);
     
     // Copy the menu item text (assuming menuItems is stored in PROGMEM).
     char buffer[16];
     strncpy_P(buffer, wifiMenuItems[index], sizeof(buffer));
     buffer[sizeof(buffer) - 1] = '\0'; // ensure null-termination
-    tft.print(buffer);
+    gfx->print(buffer);
 }
 
 void UI::updateWifiMenuSelection(int previousIndex, int currentIndex) {
@@ -360,12 +419,12 @@ void UI::updateWifiMenuSelection(int previousIndex, int currentIndex) {
 void UI::drawSongList() {
     int listX = 10;
     int listY = 60;
-    int listWidth = tft.width() - 20;
+    int listWidth = gfx->width() - 20;
     int itemsPerPage = 5;
     int listHeight = itemsPerPage * 30; // 5 items, 30 px each
 
     // Clear the list area.
-    tft.fillRect(listX, listY, listWidth, listHeight, ILI9341_BLACK);
+    gfx->fillRect(listX, listY, listWidth, listHeight, ILI9341_BLACK);
 
     // Draw each visible song.
     for (int i = 0; i < itemsPerPage && (i + scrollOffset) < currentProject.songCount; i++) {
@@ -386,11 +445,11 @@ void UI::drawSongListItem(int absoluteIndex, bool highlighted) {
     int y = 60 + relativeIndex * 30;
     
     // Clear the region for this song item.
-    tft.fillRect(10, y, 220, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, 220, 30, ILI9341_BLACK);
     
     // Set the cursor and text size.
-    tft.setCursor(10, y + 5);
-    tft.setTextSize(2);
+    gfx->setCursor(10, y + 5);
+    gfx->setTextSize(2);
     
     // Determine the text color based on selection state.
     // If the song is toggled selected (via button press), color it green.
@@ -403,12 +462,12 @@ void UI::drawSongListItem(int absoluteIndex, bool highlighted) {
         textColor = highlighted ? ILI9341_YELLOW : ILI9341_WHITE;
     }
     
-    tft.setTextColor(textColor, ILI9341_BLACK);
+    gfx->setTextColor(textColor, ILI9341_BLACK);
     
     // Print the song number and name.
-    tft.print(absoluteIndex + 1);
-    tft.print(". ");
-    tft.print(currentProject.songs[absoluteIndex].songName);
+    gfx->print(absoluteIndex + 1);
+    gfx->print(". ");
+    gfx->print(currentProject.songs[absoluteIndex].name());
 }
 
 void UI::updateSelectedSongCount() {
@@ -417,7 +476,7 @@ void UI::updateSelectedSongCount() {
     int statusHeight = 20;  // Height of the status text area.
 
     // Clear only the region where the status text is drawn.
-    tft.fillRect(120, listY -27, 30, statusHeight, ILI9341_BLACK);
+    gfx->fillRect(120, listY -27, 30, statusHeight, ILI9341_BLACK);
 
     // Update the status text with the number of selected songs.
     char buff[32];
@@ -429,11 +488,11 @@ void UI::drawEditedSongList() {
     int listX = 10;
     int listY = 60;
     int itemsPerPage = 5;  // Always show 5 items if available.
-    int listWidth = tft.width() - 20;
+    int listWidth = gfx->width() - 20;
     int listHeight = itemsPerPage * 30; // 30 pixels per item.
 
     // Clear the entire list area.
-    tft.fillRect(listX, listY, listWidth, listHeight, ILI9341_BLACK);
+    gfx->fillRect(listX, listY, listWidth, listHeight, ILI9341_BLACK);
 
     // Redraw each visible song item.
     for (int i = 0; i < itemsPerPage && (i + scrollOffset) < selectedProject.songCount; i++) {
@@ -452,11 +511,11 @@ void UI::drawEditedSongListItem(int absoluteIndex, bool highlighted) {
     int y = 60 + relativeIndex * 30;
     
     // Clear the area for this song item.
-    tft.fillRect(10, y, 270, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, 270, 30, ILI9341_BLACK);
     
     // Set the cursor and text size.
-    tft.setCursor(10, y + 5);
-    tft.setTextSize(2);
+    gfx->setCursor(10, y + 5);
+    gfx->setTextSize(2);
     
     // When reordering mode is active and the item is highlighted, use green.
     // Otherwise, highlighted items are yellow; non-highlighted items are white.
@@ -477,12 +536,12 @@ void UI::drawEditedSongListItem(int absoluteIndex, bool highlighted) {
                    : ILI9341_WHITE;
     }
     
-    tft.setTextColor(textColor, ILI9341_BLACK);
+    gfx->setTextColor(textColor, ILI9341_BLACK);
     
     // Print the song number and name.
-    tft.print(absoluteIndex + 1);
-    tft.print(". ");
-    tft.print(selectedProject.songs[absoluteIndex].songName);
+    gfx->print(absoluteIndex + 1);
+    gfx->print(". ");
+    gfx->print(selectedProject.songs[absoluteIndex].name());
 }
 
 void UI::drawPresetList() {
@@ -496,17 +555,17 @@ void UI::drawPresetList() {
         if (absoluteIndex >= MAX_PRESETS)
             break;
         int y = listY + i * 30;
-        tft.fillRect(listX, y, tft.width() - 20, 30, ILI9341_BLACK); // Clear the region
+        gfx->fillRect(listX, y, gfx->width() - 20, 30, ILI9341_BLACK); // Clear the region
 
-        tft.setCursor(listX, y + 5);
-        tft.setTextSize(2);
+        gfx->setCursor(listX, y + 5);
+        gfx->setTextSize(2);
         uint16_t color = (absoluteIndex == currentPresetIndex) ? ILI9341_YELLOW : ILI9341_WHITE;
-        tft.setTextColor(color, ILI9341_BLACK);
+        gfx->setTextColor(color, ILI9341_BLACK);
 
         String presetName = preferences.getString(("p" + String(absoluteIndex + 1) + "_name").c_str(), "No Data");
-        tft.print(absoluteIndex + 1);
-        tft.print(". ");
-        tft.print(presetName);
+        gfx->print(absoluteIndex + 1);
+        gfx->print(". ");
+        gfx->print(presetName);
     }
     preferences.end();
 }
@@ -517,24 +576,24 @@ void UI::drawPresetListItem(int index, bool highlighted) {
     int relativeIndex = index - presetScrollOffset;
     int y = listY + relativeIndex * 30;
 
-    tft.fillRect(10, y, tft.width() - 20, 30, ILI9341_BLACK);
-    tft.setCursor(10, y + 5);
-    tft.setTextSize(2);
+    gfx->fillRect(10, y, gfx->width() - 20, 30, ILI9341_BLACK);
+    gfx->setCursor(10, y + 5);
+    gfx->setTextSize(2);
     uint16_t color = highlighted ? ILI9341_YELLOW : ILI9341_WHITE;
-    tft.setTextColor(color, ILI9341_BLACK);
+    gfx->setTextColor(color, ILI9341_BLACK);
     preferences.begin("Setlists", true);
     String presetName = preferences.getString(("p" + String(index + 1) + "_name").c_str(), "No Data");
     preferences.end();
-    tft.print(index + 1);
-    tft.print(". ");
-    tft.print(presetName);
+    gfx->print(index + 1);
+    gfx->print(". ");
+    gfx->print(presetName);
 }
 
 void UI::drawSetlistName() {
     // Define the input box dimensions.
     int x = 10;
     int y = 50;
-    int w = tft.width() - 20;
+    int w = gfx->width() - 20;
     int h = 30;
     int btnWidth = 30;  // Width of the clear "X" button.
     
@@ -542,16 +601,16 @@ void UI::drawSetlistName() {
     int textAreaWidth = w - btnWidth;  // only clear text area
     
     // Clear only the text area.
-    tft.fillRect(x, y, textAreaWidth, h, ILI9341_BLACK);
+    gfx->fillRect(x, y, textAreaWidth, h, ILI9341_BLACK);
     
     // Draw the input box border around the entire area.
-    tft.drawRect(x, y, w, h, ILI9341_WHITE);
+    gfx->drawRect(x, y, w, h, ILI9341_WHITE);
     
     // Update the text in the text area.
-    tft.setCursor(x + 5, y + 5);
-    tft.setTextSize(2);
-    tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
-    tft.print(setlistName);
+    gfx->setCursor(x + 5, y + 5);
+    gfx->setTextSize(2);
+    gfx->setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+    gfx->print(setlistName);
     
     // Now, draw the clear button if it hasn't already been drawn.
     // Instead of redrawing it every time, you might want to draw it once
@@ -563,19 +622,20 @@ void UI::drawSetlistName() {
     // Option 2: Redraw the clear button only if necessary.
     // In this example, we assume the text area is cleared only up to btnX,
     // so the button area remains intact.
-    tft.fillRect(btnX, btnY, btnWidth, h, ILI9341_RED);
-    tft.drawRect(btnX, btnY, btnWidth, h, ILI9341_WHITE);
-    tft.setCursor(btnX + 8, btnY + 5);  // adjust these offsets as needed.
-    tft.setTextSize(2);
-    tft.setTextColor(ILI9341_WHITE, ILI9341_RED);
-    tft.print("X");
+    gfx->fillRect(btnX, btnY, btnWidth, h, ILI9341_RED);
+    gfx->drawRect(btnX, btnY, btnWidth, h, ILI9341_WHITE);
+    gfx->setCursor(btnX + 8, btnY + 5);  // adjust these offsets as needed.
+    gfx->setTextSize(2);
+    gfx->setTextColor(ILI9341_WHITE, ILI9341_RED);
+    gfx->print("X");
 }
 
 void UI::drawLoadedPreset() {
+    AppState state = StateStore::get();
     int textY = 100;
-    tft.fillRect(10, textY, tft.width()-20, 45, ILI9341_BLACK);
-    tft.drawRect(10, textY, tft.width()-20, 45, ILI9341_WHITE);
-    tft.fillRect(150, 13, 60, 20, ILI9341_BLACK);
+    gfx->fillRect(10, textY, gfx->width()-20, 45, ILI9341_BLACK);
+    gfx->drawRect(10, textY, gfx->width()-20, 45, ILI9341_WHITE);
+    gfx->fillRect(150, 13, 60, 20, ILI9341_BLACK);
     
     if (strcmp(loadedPreset.name, "No Preset") == 0 ||
         strlen(loadedPreset.data.projectName) == 0 ||
@@ -625,14 +685,14 @@ void UI::drawLoadedPreset() {
         
         // Handle song color
         uint16_t songColor = presetChanged ? ILI9341_WHITE : 
-                           (isPlaying ? ILI9341_GREEN : ILI9341_WHITE);
+                           (state.playing ? ILI9341_GREEN : ILI9341_WHITE);
 
         // SAFE VERSION: Proper array indexing
         constexpr int MAX_DISPLAY_CHARS = 14;
         char displayName[MAX_DISPLAY_CHARS + 3] = {0};  // Initialize buffer
         
-        if (currentTrack < totalTracks) {  // Ensure valid track index
-            const char* songName = loadedPreset.data.songs[currentTrack].songName;
+        if (state.track < totalTracks) {  // Ensure valid track index
+            const char* songName = loadedPreset.data.songs[state.track].name();
             
             if (songName != nullptr) {
                 // Truncate with safe operations
@@ -656,44 +716,198 @@ void UI::drawLoadedPreset() {
 
         // Draw the song name
         drawText(displayName, 15, textY+10, songColor, 3);
+
+        // The song that follows, and how many more are queued behind it
+        if (state.cued >= 0 && state.cued < totalTracks) {
+            char cueLine[40];
+            int n = snprintf(cueLine, sizeof(cueLine), "Next: %.24s",
+                             loadedPreset.data.songs[state.cued].name());
+            if (state.cueDepth > 1 && n > 0 && n < (int)sizeof(cueLine))
+                snprintf(cueLine + n, sizeof(cueLine) - n, " +%u", state.cueDepth - 1);
+            drawText(cueLine, 15, textY+36, ILI9341_CYAN, 1);
+        }
         
         // Draw track counter
         if (totalTracks > 0) {
-            drawText((String(currentTrack + 1) + "/" + String(totalTracks)).c_str(),
+            drawText((String(state.track + 1) + "/" + String(totalTracks)).c_str(),
                      150, 16, ILI9341_WHITE, 2);
         }
     }
     
-    webServerManager.notifyPresetUpdate();
     presetChanged = false;
 }
 
+void UI::drawRegions(uint32_t regions) {
+    // A region is only drawn on the screen that shows it; entering that screen
+    // redraws it in full anyway.
+    if (currentState == ScreenState::DEVICE_PROPERTIES) {
+        if (regions & REGION_TASKS)
+            drawTaskTable();
+        return;
+    }
+    if (currentState != ScreenState::HOME)
+        return;
+    if ((regions & REGION_PRESET) && selectedPresetSlot != -1)
+        drawLoadedPreset();
+    if (regions & REGION_VOLUME)
+        displayVolume();
+    if (regions & REGION_LINK)
+        drawLinkStatus();
+    if (regions & REGION_PROGRESS)
+        drawSongProgress(false);
+}
+
+// "m:ss" up to "99:59", so "-99:59" fits the label's fixed-width fields.
+static void formatTime(char *buf, size_t size, bool negative, uint32_t ms) {
+    uint32_t s = ms / 1000;
+    unsigned minutes = s / 60 < 99 ? s / 60 : 99;
+    unsigned seconds = s / 60 < 99 ? s % 60 : 59;
+    snprintf(buf, size, "%s%u:%02u", negative ? "-" : "", minutes, seconds);
+}
+
+// Bar from the song's locator to the next one, elapsed time on the left and
+// remaining time on the right. Only the columns the bar gained or lost since
+// the last frame are filled, and the times are drawn over themselves with a
+// background color when their text changes.
+void UI::drawSongProgress(bool full) {
+    const int x = 10, y = 180, w = gfx->width() - 20, h = 10;
+    SongProgress p = progress.sample(micros());
+
+    if (full) {
+        gfx->fillRect(x, y, w, h + 24, ILI9341_BLACK);
+        gfx->drawRect(x, y, w, h, ILI9341_WHITE);
+        progressFill = 0;
+        progressLabel[0] = '\0';
+    }
+
+    int inner = w - 2;
+    int fill = 0;
+    if (p.known && p.lengthMs)
+        fill = (uint64_t)inner * (p.elapsedMs < p.lengthMs ? p.elapsedMs : p.lengthMs) / p.lengthMs;
+    if (fill > progressFill)
+        gfx->fillRect(x + 1 + progressFill, y + 1, fill - progressFill, h - 2, ILI9341_GREEN);
+    else if (fill < progressFill)
+        gfx->fillRect(x + 1 + fill, y + 1, progressFill - fill, h - 2, ILI9341_BLACK);
+    progressFill = fill;
+
+    char elapsed[8] = "--:--", remaining[8] = "";
+    if (p.known) {
+        formatTime(elapsed, sizeof(elapsed), false, p.elapsedMs);
+        if (p.lengthMs)
+            formatTime(remaining, sizeof(remaining), true, p.lengthMs > p.elapsedMs ? p.lengthMs - p.elapsedMs : 0);
+    }
+    // Fixed-width fields, so a shorter time overwrites a longer one.
+    char label[sizeof(progressLabel)];
+    snprintf(label, sizeof(label), "%-6s%7s", elapsed, remaining);
+    if (strcmp(label, progressLabel) == 0)
+        return;
+    strcpy(progressLabel, label);
+    gfx->setTextSize(2);
+    gfx->setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+    gfx->setCursor(x + w - 7 * 12, y + h + 6);
+    gfx->print(label + 6);
+    label[6] = '\0';
+    gfx->setCursor(x, y + h + 6);
+    gfx->print(label);
+}
+
+// Dot in the health color, then the smoothed round trip, jitter and loss.
+void UI::drawLinkStatus() {
+    const int y = 50;
+    LinkHealth health = LinkMonitor::health();
+    LinkStats s = LinkMonitor::stats();
+    uint16_t color = health == LinkHealth::GOOD     ? ILI9341_GREEN :
+                     health == LinkHealth::DEGRADED ? ILI9341_ORANGE :
+                     health == LinkHealth::LOST     ? ILI9341_RED : ILI9341_DARKGREY;
+
+    gfx->fillRect(10, y - 2, gfx->width() - 20, 16, ILI9341_BLACK);
+    gfx->fillCircle(16, y + 5, 5, color);
+    char line[56];
+    if (health == LinkHealth::UNKNOWN)
+        snprintf(line, sizeof(line), "Ableton: waiting for reply");
+    else if (health == LinkHealth::LOST)
+        snprintf(line, sizeof(line), "Ableton: no reply");
+    else
+        snprintf(line, sizeof(line), "Ableton: %lu.%lu ms  jitter %lu.%lu ms  %u%% loss",
+                 (unsigned long)(s.srttUs / 1000), (unsigned long)(s.srttUs / 100 % 10),
+                 (unsigned long)(s.jitterUs / 1000), (unsigned long)(s.jitterUs / 100 % 10), s.lossPct);
+    drawText(line, 28, y + 1, color, 1);
+}
+
+// One row per task: core, priority, CPU share, free stack and wake-up latency
+// over the last TASK_SCREEN_REFRESH_MS.
+void UI::drawTaskTable() {
+    const int top = 110, rowHeight = 14;
+    TaskStatus status[(int)AppTask::COUNT];
+    TaskMonitor::collect(TaskView::SCREEN, status);
+
+    gfx->fillRect(0, top, gfx->width(), rowHeight * ((int)AppTask::COUNT + 2), ILI9341_BLACK);
+    drawText("task   core prio   cpu  stack  late avg/max us", 10, top, ILI9341_CYAN, 1);
+    char line[64];
+    for (int t = 0; t < (int)AppTask::COUNT; t++) {
+        const TaskStatus &s = status[t];
+        int y = top + rowHeight * (t + 1);
+        if (s.core < 0) {
+            snprintf(line, sizeof(line), "%-6s   not running", s.name);
+            drawText(line, 10, y, ILI9341_DARKGREY, 1);
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-6s  %d   %2u  %3u.%u%%  %5u  %5u/%u", s.name, s.core,
+                 s.priority, s.cpuPermille / 10, s.cpuPermille % 10, (unsigned)s.stackFree,
+                 (unsigned)s.avgLateUs, (unsigned)s.maxLateUs);
+        drawText(line, 10, y, ILI9341_WHITE, 1);
+    }
+    snprintf(line, sizeof(line), "heap %u B free, %u B min", (unsigned)ESP.getFreeHeap(),
+             (unsigned)ESP.getMinFreeHeap());
+    drawText(line, 10, top + rowHeight * ((int)AppTask::COUNT + 1), ILI9341_WHITE, 1);
+}
+
+void UI::drawScanProgress() {
+    int received = ScanSession::received();
+    int total = ScanSession::total();
+    int barWidth = gfx->width() - 20;
+
+    gfx->fillRect(10, 60, barWidth, 30, ILI9341_BLACK);
+    char buff[32];
+    if (total > 0)
+        snprintf(buff, sizeof(buff), "Scanning %d / %d", received, total);
+    else
+        snprintf(buff, sizeof(buff), "Scanning %d", received);
+    drawText(buff, 10, 60, ILI9341_WHITE, 2);
+
+    gfx->drawRect(10, 80, barWidth, 8, ILI9341_WHITE);
+    if (total > 0) {
+        int filled = (long)(barWidth - 2) * received / total;
+        gfx->fillRect(11, 81, filled, 6, ILI9341_BLUE);
+    }
+}
+
 void UI::drawWiFiList() {
-    tft.fillRect(10, 60, tft.width() - 20, 160, ILI9341_BLACK);
+    gfx->fillRect(10, 60, gfx->width() - 20, 160, ILI9341_BLACK);
     const int itemsPerPage = 5;
     const int lineSpacing = 30;
     for (int i = 0; i < itemsPerPage && (i + wifiScrollOffset) < wifiCount; i++) {
       int index = wifiScrollOffset + i;
       int y = 60 + i * lineSpacing;
       if (index == wifiCurrentItem)
-        tft.setTextColor(ILI9341_YELLOW, ILI9341_BLACK);
+        gfx->setTextColor(ILI9341_YELLOW, ILI9341_BLACK);
       else
-        tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
-      tft.setTextSize(2);
-      tft.setCursor(10, y);
-      tft.print(String(index + 1) + ". " + wifiSSIDs[index]);
+        gfx->setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+      gfx->setTextSize(2);
+      gfx->setCursor(10, y);
+      gfx->print(String(index + 1) + ". " + wifiSSIDs[index]);
   
       int rssiVal = wifiRSSI[index];
       int bars = map(rssiVal, -90, -30, 0, 5);
       bars = constrain(bars, 0, 5);
       int barWidth = 5, barHeight = 10, barSpacing = 3;
-      int barBaseX = tft.width() - 60, barBaseY = y + 2;
+      int barBaseX = gfx->width() - 60, barBaseY = y + 2;
       for (int b = 0; b < 5; b++) {
         int bx = barBaseX + b * (barWidth + barSpacing) + 5;
         if (b < bars)
-          tft.fillRect(bx, barBaseY, barWidth, barHeight, ILI9341_GREEN);
+          gfx->fillRect(bx, barBaseY, barWidth, barHeight, ILI9341_GREEN);
         else
-          tft.drawRect(bx, barBaseY, barWidth, barHeight, ILI9341_WHITE);
+          gfx->drawRect(bx, barBaseY, barWidth, barHeight, ILI9341_WHITE);
       }
     }
 }
@@ -704,27 +918,27 @@ void UI::drawWiFiListItem(int absoluteIndex, bool highlighted) {
     int y = 60 + relativeIndex * 30;
     
     // Clear the region for this Wi-Fi item.
-    tft.fillRect(10, y, tft.width() - 70, 30, ILI9341_BLACK);
+    gfx->fillRect(10, y, gfx->width() - 70, 30, ILI9341_BLACK);
     
     // Set text color based on selection state.
     uint16_t textColor = highlighted ? ILI9341_YELLOW : ILI9341_WHITE;
-    tft.setTextColor(textColor, ILI9341_BLACK);
-    tft.setTextSize(2);
-    tft.setCursor(10, y);
-    tft.print(String(absoluteIndex + 1) + ". " + wifiSSIDs[absoluteIndex]);
+    gfx->setTextColor(textColor, ILI9341_BLACK);
+    gfx->setTextSize(2);
+    gfx->setCursor(10, y);
+    gfx->print(String(absoluteIndex + 1) + ". " + wifiSSIDs[absoluteIndex]);
     
     // Draw signal strength bars.
     int rssiVal = wifiRSSI[absoluteIndex];
     int bars = map(rssiVal, -90, -30, 0, 5);
       bars = constrain(bars, 0, 5);
       int barWidth = 5, barHeight = 10, barSpacing = 3;
-      int barBaseX = tft.width() - 60, barBaseY = y + 2;
+      int barBaseX = gfx->width() - 60, barBaseY = y + 2;
       for (int b = 0; b < 5; b++) {
         int bx = barBaseX + b * (barWidth + barSpacing) + 5;
         if (b < bars)
-          tft.fillRect(bx, barBaseY, barWidth, barHeight, ILI9341_GREEN);
+          gfx->fillRect(bx, barBaseY, barWidth, barHeight, ILI9341_GREEN);
         else
-          tft.drawRect(bx, barBaseY, barWidth, barHeight, ILI9341_WHITE);
+          gfx->drawRect(bx, barBaseY, barWidth, barHeight, ILI9341_WHITE);
       }
 }
 
@@ -751,7 +965,7 @@ void UI::checkWifiConnection() {
         if (WiFi.status() == WL_CONNECTED && !wifiFullyConnected) {
             wifiFullyConnected = true;
             digitalWrite(LED_WIFI, HIGH);
-            tft.fillScreen(ILI9341_BLACK);
+            gfx->fillScreen(ILI9341_BLACK);
             drawTextTopCenter("Connected!", 7, true, ILI9341_GREEN);
             drawText("Successfully connected to: ", 10, 60, ILI9341_WHITE, 2);
             drawText(selectedSSID.c_str(), 10, 80, ILI9341_YELLOW, 2);
@@ -759,14 +973,8 @@ void UI::checkWifiConnection() {
             static bool webServerSetupDone = false;
             if (!webServerSetupDone) {
                 webServerManager.setup();
-                webServerManager.onPresetUpdate = [this]() {
-                    if (selectedPresetSlot != -1) {
-                        drawLoadedPreset(); // Redraw only if a preset is selected
-                    }
-                };
                 webServerSetupDone = true;
             }
-            // webServerManager.update(); // This call is optional here.
 
             delay(2000);
             setScreenState(ScreenState::HOME);
@@ -790,8 +998,9 @@ void UI::WifiScan() {
     if (wifiScanInProgress) {
         int n = WiFi.scanComplete();  // Check if scan is completed
         Serial.println(n);  // Debug print to check scan result
-        tft.fillRect(10, 60, tft.width() - 20, 160, ILI9341_BLACK);  // Clear previous content
+        gfx->fillRect(10, 60, gfx->width() - 20, 160, ILI9341_BLACK);  // Clear previous content
         drawText("Scanning...", 10, 60, ILI9341_YELLOW, 2);  // Show scanning message
+        presentFrame();
 
         // Keep scanning until we get a positive result (scan complete)
         while (n <= 0) {
@@ -814,7 +1023,7 @@ void UI::WifiScan() {
     }
 
     if (wifiScanDone) {
-        tft.fillRect(10, 60, tft.width() - 20, 160, ILI9341_BLACK);  // Clear previous content
+        gfx->fillRect(10, 60, gfx->width() - 20, 160, ILI9341_BLACK);  // Clear previous content
         drawWiFiList();  // Draw the Wi-Fi list
     }
     wifiScanDone = false;
@@ -822,41 +1031,47 @@ void UI::WifiScan() {
 
 void UI::drawWiFiPassword() {
     // Clear only the text area inside the input box.
-    // (Assuming the input box was drawn at x=10, y=50, with width = tft.width()-20 and height = 30.)
-    tft.fillRect(11, 51, tft.width()-22, 28, ILI9341_BLACK);
-    tft.setCursor(15, 57);
-    tft.setTextSize(2);
-    tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
-    tft.print(wifiPassword);
+    // (Assuming the input box was drawn at x=10, y=50, with width = gfx->width()-20 and height = 30.)
+    gfx->fillRect(11, 51, gfx->width()-22, 28, ILI9341_BLACK);
+    gfx->setCursor(15, 57);
+    gfx->setTextSize(2);
+    gfx->setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+    gfx->print(wifiPassword);
 }
 
 
 // --- INTERFACE ---
 
 void UI::loadingScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawText("AbletonThesis", 20, 60, ILI9341_GREEN, 3);
     drawText("Loading...", 40, 120, ILI9341_WHITE, 2);
-    for (int i = 0; i <= 260; i += 20) {
-        tft.fillRect(20, 160, i, 10, ILI9341_BLUE);
-        delay(200);
-    }
-    setScreenState(ScreenState::HOME);
+    gfx->drawRect(19, 159, 262, 12, ILI9341_WHITE);
+}
+
+// Advance the boot bar; setup() calls this as each subsystem comes up.
+void UI::drawLoadingProgress(int step, int totalSteps, const char *label) {
+    int width = 260 * step / totalSteps;
+    gfx->fillRect(20, 160, width, 10, ILI9341_BLUE);
+    gfx->fillRect(20, 180, gfx->width() - 20, 16, ILI9341_BLACK);
+    drawText(label, 20, 180, ILI9341_LIGHTGREY, 2);
 }
 
 void UI::homeScreen() {
     Serial.println("HomePage");
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
 
     // Draw volume display.
     drawText("Vol ", 10, 15, ILI9341_GREEN, 2);
-    tft.drawRect(50, 10, 80, 25, ILI9341_WHITE);
+    gfx->drawRect(50, 10, 80, 25, ILI9341_WHITE);
 
     drawText("Preset:", 10, 80, ILI9341_YELLOW, 2);
-    tft.drawRect(10, 100, tft.width()-20, 45, ILI9341_WHITE);
+    gfx->drawRect(10, 100, gfx->width()-20, 45, ILI9341_WHITE);
     drawText("Project:", 10, 150, ILI9341_ORANGE, 2);
 
     displayVolume();
+    drawLinkStatus();
+    drawSongProgress(true);
 
     String ip = WiFi.localIP().toString();
     if (ip == "0.0.0.0")
@@ -878,11 +1093,10 @@ void UI::homeScreen() {
     } else {
         // drawText("No Preset Selected", 10, 80, ILI9341_RED, 2);
     }
-    webServerManager.notifyPresetUpdate();
 }
 
 void UI::menuScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("SETLIST SETTINGS", 7, true, ILI9341_WHITE);
     for (int i = 0; i < NUM_MENU_ITEMS; i++) {
         drawMenuItem(i, i == currentMenuItem);
@@ -890,29 +1104,61 @@ void UI::menuScreen() {
 }
 
 void UI::newSetlistScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(NEXT_BUTTON_X, NEXT_BUTTON_Y, NEXT_BUTTON_WIDTH, NEXT_BUTTON_HEIGHT, "Next");
     drawTextTopCenter("New Setlist", 7, true, ILI9341_WHITE);
+    presentFrame();
+
+    // With a cached project, ask Ableton for a diff before scanning everything.
+    if (!newSetlistScanned && currentProject.songCount > 0) {
+        unsigned long startTime = millis();
+        ProjectSync::begin();
+        SyncResult result = ProjectSync::wait(SYNC_TIMEOUT_MS);
+        if (result == SyncResult::UNCHANGED || result == SyncResult::UPDATED) {
+            Serial.printf("Project synced in %lu ms\n", millis() - startTime);
+            if (result == SyncResult::UPDATED)
+                ps::saveCachedProject(currentProject);
+            newSetlistScanned = true;
+        }
+    }
 
     // Send SysEx and wait for song list if not already scanned
     if (!newSetlistScanned) {
-        unsigned long startTime = millis();
+        ScanSession::begin();
+        songNames.compact();
         Midi::Scan();
-        Serial.println(F("Sent SysEx to Notify Ableton"));
 
-        memset(&currentProject, 0, sizeof(currentProject));
-        currentProject.songCount = 0;
-
-        while ((currentProject.songCount == 0 || !songsReady) &&
-            (millis() - startTime < 7000)) {
-        delay(50);  // Wait for up to 7 seconds
+        // Wait on progress events; only a stalled transfer times out, so large
+        // projects can take as long as they need.
+        unsigned long lastActivity = millis();
+        int retries = 0;
+        drawScanProgress();
+        while (!ScanSession::complete()) {
+            if (ScanSession::waitForProgress(100)) {
+                lastActivity = millis();
+                drawScanProgress();
+                continue;
+            }
+            unsigned long idle = millis() - lastActivity;
+            bool passOver = ScanSession::endSeen() || idle > SCAN_NAK_TIMEOUT_MS;
+            if (passOver && ScanSession::missing() > 0 && retries < SCAN_MAX_RETRIES) {
+                retries++;
+                Serial.printf("Scan missing %d songs, retry %d\n", ScanSession::missing(), retries);
+                ScanSession::requestMissing();
+                lastActivity = millis();
+            } else if (idle > SCAN_STALL_TIMEOUT_MS) {
+                break;
+            }
         }
-        if (!songsReady) {
+        if (!ScanSession::complete()) {
+        ScanSession::abandon();
         Serial.println(F("⏳ Timeout! Songs not fully received."));
         drawText("Error: Incomplete setlist", 10, 60, ILI9341_RED, 2);
         return;
         }
+        gfx->fillRect(10, 60, gfx->width() - 20, 30, ILI9341_BLACK);
+        ps::saveCachedProject(currentProject);
         newSetlistScanned = true;
     }
     isReorderedSongsInitialized = false;
@@ -927,7 +1173,7 @@ void UI::editSetlistScreen() {
     scrollOffset = 0;         // Reset scroll position
     isReordering = false;     // Ensure reordering mode is off
 
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(SAVE_BUTTON_X, SAVE_BUTTON_Y, SAVE_BUTTON_WIDTH, SAVE_BUTTON_HEIGHT, "Next");
     drawTextTopCenter("Edit Setlist", 7, true, ILI9341_WHITE);
@@ -935,42 +1181,39 @@ void UI::editSetlistScreen() {
     // If we're creating a NEW setlist (currentMenuItem == 0), require at least one song selected.
     // If we're editing an existing preset (currentMenuItem == 2), use the loaded preset data.
     if (selectedTrackCount == 0 && menu1Index == 0) {
-        tft.setCursor(10, 60);
-        tft.setTextColor(ILI9341_WHITE);
-        tft.setTextSize(2);
-        tft.print("No songs selected.");
+        gfx->setCursor(10, 60);
+        gfx->setTextColor(ILI9341_WHITE);
+        gfx->setTextSize(2);
+        gfx->print("No songs selected.");
         return;
     }
             
     // Initialize reordering if needed.
     if (!isReorderedSongsInitialized) { 
-        memset(&selectedProject, 0, sizeof(selectedProject));
+        selectedProject.clear();
         int idx = 0;
         if (menu1Index == 0) {
             // New Setlist: copy songs from currentProject where selectedSongs is true.
-            strcpy(selectedProject.projectName, currentProject.projectName);
-            for (int i = 0; i < currentProject.songCount; i++) {
-                if (selectedSongs[i]) {
-                    selectedProject.songs[idx] = currentProject.songs[i];
-                    selectedProject.songs[idx].songIndex  = i;
-                    selectedProject.songs[idx].changedIndex = idx;
-                    idx++;
-                }
-            }
-            selectedProject.songCount = idx;
+            selectedProject.select(currentProject, selectedSongs, selectedTrackCount);
+            selectedTrackCount = selectedProject.songCount;
         } else if (menu1Index == 2) {
             // Edit Setlist: load songs from the loaded preset.
             strcpy(selectedProject.projectName, loadedPreset.data.projectName);
-            for (int i = 0; i < loadedPreset.data.songCount; i++) {
+            int count = loadedPreset.data.songCount;
+            if (!selectedProject.songs.reserve(count)) {
+                LOGE("Edit: no room for %d songs", count);
+                count = 0;
+            }
+            for (int i = 0; i < count; i++) {
                 // For editing, copy all songs from loadedPreset.
                 selectedProject.songs[idx] = loadedPreset.data.songs[i];
                 selectedProject.songs[idx].songIndex  = loadedPreset.data.songs[i].songIndex;
                 selectedProject.songs[idx].changedIndex = idx;
                 idx++;
             }
-            selectedProject.songCount = loadedPreset.data.songCount;
+            selectedProject.songCount = count;
             // Update selectedTrackCount to reflect the loaded preset's song count.
-            selectedTrackCount = loadedPreset.data.songCount;
+            selectedTrackCount = count;
         }
         
         Serial.println(F("Selected Project Info:"));
@@ -980,7 +1223,7 @@ void UI::editSetlistScreen() {
             Serial.print(" (OrigIdx ");
             Serial.print(selectedProject.songs[i].songIndex);
             Serial.print(") - ");
-            Serial.println(selectedProject.songs[i].songName);
+            Serial.println(selectedProject.songs[i].name());
         }
         isReorderedSongsInitialized = true;
     }
@@ -998,7 +1241,7 @@ void UI::editSetlistScreen() {
 }
 
 void UI::selectSetlistScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Select Preset", 7, true, ILI9341_WHITE);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(SAVE_BUTTON_X, SAVE_BUTTON_Y, SAVE_BUTTON_WIDTH, SAVE_BUTTON_HEIGHT, "Save");
@@ -1008,7 +1251,7 @@ void UI::selectSetlistScreen() {
 }
 
 void UI::saveSetlistScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(SAVE_BUTTON_X, SAVE_BUTTON_Y, SAVE_BUTTON_WIDTH, SAVE_BUTTON_HEIGHT, "Save");
     drawTextTopCenter("Save Setlist", 7, true, ILI9341_WHITE);
@@ -1036,7 +1279,7 @@ void UI::saveSetlistScreen() {
 }
 
 void UI::menu2Screen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("System Settings", 7, true, ILI9341_WHITE);
     for (int i = 0; i < NUM_MENU2_ITEMS; i++) {
         drawMenu2Item(i, i == currentMenu2Item);
@@ -1044,21 +1287,21 @@ void UI::menu2Screen() {
 }
 
 void UI::menu2WifiSettingsScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Wi-Fi Settings", 7, true, ILI9341_WHITE);
     for (int i = 0; i < NUM_WIFI_MENU_ITEMS; i++) {
         int y = 60 + i * 30;
-        tft.setCursor(15, y + 5);
-        tft.setTextSize(2);
-        tft.setTextColor((i == currentWifiMenuItem) ? ILI9341_YELLOW : ILI9341_WHITE);
+        gfx->setCursor(15, y + 5);
+        gfx->setTextSize(2);
+        gfx->setTextColor((i == currentWifiMenuItem) ? ILI9341_YELLOW : ILI9341_WHITE);
         char buffer[16];
         strncpy_P(buffer, wifiMenuItems[i], sizeof(buffer));
-        tft.print(buffer);
+        gfx->print(buffer);
     }
 }
 
 void UI::menu2WifiConnectScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(NEXT_BUTTON_X, NEXT_BUTTON_Y, NEXT_BUTTON_WIDTH, NEXT_BUTTON_HEIGHT, "Re");
     drawTextTopCenter("Wi-Fi Connect", 7, true, ILI9341_WHITE);
@@ -1067,14 +1310,14 @@ void UI::menu2WifiConnectScreen() {
 }
 
 void UI::menu2WifiPasswordScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Enter Password", 7, true, ILI9341_WHITE);
     drawTextTopCenter(selectedSSID.c_str(), 27, false, ILI9341_YELLOW);
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
     drawRectButton(SAVE_BUTTON_X, SAVE_BUTTON_Y, SAVE_BUTTON_WIDTH, SAVE_BUTTON_HEIGHT, "OK");
 
     // Draw the input box border once.
-    tft.drawRect(10, 50, tft.width() - 20, 30, ILI9341_WHITE);
+    gfx->drawRect(10, 50, gfx->width() - 20, 30, ILI9341_WHITE);
     // Draw the initial password (if any) in the text area.
     drawWiFiPassword();
 
@@ -1083,7 +1326,7 @@ void UI::menu2WifiPasswordScreen() {
 }
 
 void UI::menu2WifiConfirmScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Confirmation", 7, true, ILI9341_WHITE);
     drawText("SSID: ", 10, 50, ILI9341_WHITE, 2);
     drawText(selectedSSID.c_str(), 85, 50, ILI9341_YELLOW, 2);
@@ -1094,7 +1337,7 @@ void UI::menu2WifiConfirmScreen() {
 }
 
 void UI::menu2WifiConnectingScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Connecting to Wi-Fi", 7, true, ILI9341_WHITE);
     drawText("SSID: ", 10, 60, ILI9341_WHITE, 2);
     drawText(selectedSSID.c_str(), 85, 60, ILI9341_YELLOW, 2);
@@ -1102,24 +1345,20 @@ void UI::menu2WifiConnectingScreen() {
 }
 
 void UI::devicePropertiesScreen() {
-tft.fillScreen(ILI9341_BLACK);
+gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Properties", 7, true, ILI9341_WHITE);
 
-    // Example device properties (customize as needed)
     drawText("Device: AbletonThesis", 10, 50, ILI9341_WHITE, 2);
     drawText("Firmware: v1.0", 10, 80, ILI9341_WHITE, 2);
-    // drawText("Chip Model: " + String(ESP.getChipModel()), 10, 110, ILI9341_WHITE, 2);
-    // drawText("Chip Revision: " + String(ESP.getChipRevision()), 10, 140, ILI9341_WHITE, 2);
-    // drawText("Free Heap: " + String(ESP.getFreeHeap()), 10, 170, ILI9341_WHITE, 2);
-
-    // Add more information as needed
+    // Task diagnostics, refreshed by the render task while this screen is up
+    drawTaskTable();
 
     // Draw a Back button to return to the previous menu
     drawRectButton(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_WIDTH, BACK_BUTTON_HEIGHT, "Back");
 }
 
 void UI::wifiPropertiesScreen() {
-    tft.fillScreen(ILI9341_BLACK);
+    gfx->fillScreen(ILI9341_BLACK);
     drawTextTopCenter("Wi-Fi Properties", 7, true, ILI9341_WHITE);
 
     // Gather Wi-Fi details
@@ -1139,11 +1378,11 @@ void UI::wifiPropertiesScreen() {
 }
 
 bool UI::getTouchCoordinates(int16_t &x, int16_t &y) {
-    if (ts.touched()) {
-        TS_Point point = ts.getPoint();
+    TS_Point point;
+    if (SpiBus::sampleTouch(ts, point)) {
         // Adjust calibration values as needed.
-        x = map(point.x, 3800, 300, 0, tft.width());
-        y = map(point.y, 3800, 300, 0, tft.height());
+        x = map(point.x, 3800, 300, 0, gfx->width());
+        y = map(point.y, 3800, 300, 0, gfx->height());
         return true;
     }
     return false;
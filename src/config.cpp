@@ -1,4 +1,6 @@
 #include "config.h"
+#include <esp_heap_caps.h>
+#include "_log.h"
 
 // -----------------------------------------------------
 // Global Variable Definitions
@@ -7,7 +9,7 @@ int selectedPresetSlot = -1;
 bool presetChanged = false;
 bool newSetlistScanned = false;
 
-bool selectedSongs[MAX_SONGS] = { false };
+SongSelection selectedSongs;
 int  selectedTrackCount = 0;
 bool isReorderedSongsInitialized = false;
 bool isReordering = false;
@@ -15,7 +17,6 @@ int  reorderTarget = -1;
 
 bool songsReady = false;
 
-unsigned long lastPingReplyTime = 0;
 
 bool webServerStarted = false;  
 
@@ -24,7 +25,6 @@ int menu1Index = 0;
 int currentSongItem = 0;
 int scrollOffset = 0;
 int totalTracks = 0;
-int currentTrack = 0;
 bool needsRedraw = true;
 int selectedHomeSongIndex = 0;
 
@@ -34,9 +34,6 @@ int currentWifiMenuItem = 0;
 
 MenuSelection currentMenuSelection = MENU1_SELECTED;
 
-byte currentVolume = 0;
-bool isPlaying = false;
-
 const char* specialKeys[] = { "^", "Space", "<-" };
 const char keys[4][10] = {
   {'1','2','3','4','5','6','7','8','9','0'},
@@ -70,36 +67,357 @@ bool wifiFullyConnected = false;
 Preset loadedPreset;
 ProjectInfo selectedProject;
 ProjectInfo currentProject;
+SongNamePool songNames;
+
+// -----------------------------------------------------
+// Song storage
+// -----------------------------------------------------
+void *allocSongStorage(size_t size) {
+  void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return ptr ? ptr : malloc(size);
+}
+
+static uint32_t hashName(const char *name, size_t len) {
+  uint32_t h = 2166136261UL;  // FNV-1a
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)name[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+SongNamePool::SongNamePool()
+  : _lock(xSemaphoreCreateRecursiveMutex()), _blockCount(0), _blockUsed(0),
+    _slots(nullptr), _slotCount(0), _nameCount(0) {}
+
+const char *SongNamePool::get(uint32_t id) const {
+  uint32_t block = id / SONG_NAME_BLOCK_SIZE;
+  if ((int)block >= _blockCount)
+    return "";
+  return &_blocks[block][id % SONG_NAME_BLOCK_SIZE];
+}
+
+size_t SongNamePool::used() const {
+  if (_blockCount == 0)
+    return 0;
+  return (size_t)(_blockCount - 1) * SONG_NAME_BLOCK_SIZE + _blockUsed;
+}
+
+uint32_t SongNamePool::append(const char *name, size_t len) {
+  if (_blockCount == 0 || _blockUsed + len + 1 > SONG_NAME_BLOCK_SIZE) {
+    if (_blockCount >= SONG_NAME_MAX_BLOCKS)
+      return 0;
+    char *block = (char *)allocSongStorage(SONG_NAME_BLOCK_SIZE);
+    if (!block)
+      return 0;
+    _blocks[_blockCount++] = block;
+    _blockUsed = 0;
+    if (_blockCount == 1) {
+      block[0] = '\0';  // Id 0 is the empty name
+      _blockUsed = 1;
+    }
+  }
+  uint32_t id = (uint32_t)(_blockCount - 1) * SONG_NAME_BLOCK_SIZE + _blockUsed;
+  char *dst = &_blocks[_blockCount - 1][_blockUsed];
+  memcpy(dst, name, len);
+  dst[len] = '\0';
+  _blockUsed += len + 1;
+  return id;
+}
+
+bool SongNamePool::growIndex() {
+  size_t newCount = _slotCount ? _slotCount * 2 : 256;
+  uint32_t *newSlots = (uint32_t *)allocSongStorage(newCount * sizeof(uint32_t));
+  if (!newSlots)
+    return false;
+  memset(newSlots, 0, newCount * sizeof(uint32_t));
+  for (size_t i = 0; i < _slotCount; i++) {
+    uint32_t id = _slots[i];
+    if (id == 0)
+      continue;
+    const char *name = get(id);
+    size_t pos = hashName(name, strlen(name)) & (newCount - 1);
+    while (newSlots[pos] != 0)
+      pos = (pos + 1) & (newCount - 1);
+    newSlots[pos] = id;
+  }
+  free(_slots);
+  _slots = newSlots;
+  _slotCount = newCount;
+  return true;
+}
+
+uint32_t SongNamePool::intern(const char *name) {
+  if (name == nullptr || name[0] == '\0')
+    return 0;
+  size_t len = strnlen(name, MAX_SONG_NAME_LEN);
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+
+  // Keep the index at most 3/4 full so probe chains stay short.
+  if ((_nameCount + 1) * 4 > _slotCount * 3 && !growIndex()) {
+    xSemaphoreGiveRecursive(_lock);
+    LOGE("Song name index is full, '%s' dropped", name);
+    return 0;
+  }
+
+  size_t pos = hashName(name, len) & (_slotCount - 1);
+  while (_slots[pos] != 0) {
+    const char *entry = get(_slots[pos]);
+    if (strncmp(entry, name, len) == 0 && entry[len] == '\0') {
+      xSemaphoreGiveRecursive(_lock);
+      return _slots[pos];
+    }
+    pos = (pos + 1) & (_slotCount - 1);
+  }
+
+  uint32_t id = append(name, len);
+  if (id != 0) {
+    _slots[pos] = id;
+    _nameCount++;
+  }
+  xSemaphoreGiveRecursive(_lock);
+  if (id == 0)
+    LOGE("Song name pool is full (%u bytes), '%s' dropped", (unsigned)used(), name);
+  return id;
+}
+
+void SongNamePool::reset() {
+  _blockCount = 0;
+  _blockUsed = 0;
+  free(_slots);
+  _slots = nullptr;
+  _slotCount = 0;
+  _nameCount = 0;
+}
+
+static void remapNames(ProjectInfo &project, char *const *oldBlocks, int oldBlockCount) {
+  for (int i = 0; i < project.songCount; i++) {
+    uint32_t id = project.songs[i].nameId;
+    uint32_t block = id / SONG_NAME_BLOCK_SIZE;
+    const char *name = (int)block < oldBlockCount ? &oldBlocks[block][id % SONG_NAME_BLOCK_SIZE] : "";
+    project.songs[i].nameId = songNames.intern(name);
+  }
+}
+
+void SongNamePool::compact() {
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  int oldBlockCount = _blockCount;
+  char **oldBlocks = (char **)malloc((oldBlockCount ? oldBlockCount : 1) * sizeof(char *));
+  if (!oldBlocks) {
+    xSemaphoreGiveRecursive(_lock);
+    LOGW("Song name pool not compacted, out of memory");
+    return;
+  }
+  memcpy(oldBlocks, _blocks, oldBlockCount * sizeof(char *));
+
+  reset();
+  remapNames(currentProject, oldBlocks, oldBlockCount);
+  remapNames(selectedProject, oldBlocks, oldBlockCount);
+  remapNames(loadedPreset.data, oldBlocks, oldBlockCount);
+  xSemaphoreGiveRecursive(_lock);
+
+  for (int i = 0; i < oldBlockCount; i++)
+    free(oldBlocks[i]);
+  free(oldBlocks);
+}
+
+SongList::SongList() : _chunkCount(0) {
+  memset(&_scratch, 0, sizeof(_scratch));
+}
+
+SongList::~SongList() {
+  release();
+}
+
+SongList::SongList(const SongList &other) : SongList() {
+  *this = other;
+}
+
+SongList::SongList(SongList &&other) : SongList() {
+  *this = std::move(other);
+}
+
+SongList &SongList::operator=(const SongList &other) {
+  if (this == &other)
+    return *this;
+  reserve(other.capacity());
+  int chunks = min(_chunkCount, other._chunkCount);
+  for (int c = 0; c < chunks; c++)
+    memcpy(_chunks[c], other._chunks[c], SONG_CHUNK_SIZE * sizeof(SongInfo));
+  return *this;
+}
+
+SongList &SongList::operator=(SongList &&other) {
+  if (this == &other)
+    return *this;
+  release();
+  memcpy(_chunks, other._chunks, other._chunkCount * sizeof(SongInfo *));
+  _chunkCount = other._chunkCount;
+  other._chunkCount = 0;
+  return *this;
+}
+
+SongInfo &SongList::operator[](int i) {
+  if (i < 0 || i >= capacity()) {
+    LOGE("SongList: song %d out of range (capacity %d)", i, capacity());
+    memset(&_scratch, 0, sizeof(_scratch));
+    return _scratch;
+  }
+  return _chunks[i / SONG_CHUNK_SIZE][i % SONG_CHUNK_SIZE];
+}
+
+const SongInfo &SongList::operator[](int i) const {
+  return const_cast<SongList &>(*this)[i];
+}
+
+bool SongList::reserve(int count) {
+  if (count > MAX_SONGS)
+    return false;
+  int needed = (count + SONG_CHUNK_SIZE - 1) / SONG_CHUNK_SIZE;
+  while (_chunkCount < needed) {
+    SongInfo *chunk = (SongInfo *)allocSongStorage(SONG_CHUNK_SIZE * sizeof(SongInfo));
+    if (!chunk)
+      return false;
+    memset(chunk, 0, SONG_CHUNK_SIZE * sizeof(SongInfo));
+    _chunks[_chunkCount++] = chunk;
+  }
+  return true;
+}
+
+void SongList::release() {
+  for (int c = 0; c < _chunkCount; c++)
+    free(_chunks[c]);
+  _chunkCount = 0;
+}
+
+void ProjectInfo::clear() {
+  memset(projectName, 0, sizeof(projectName));
+  // Entries past songCount may be left from a longer list; wipe them all so
+  // a slot filled out of order never shows an old song.
+  for (int i = 0; i < songs.capacity(); i++)
+    memset(&songs[i], 0, sizeof(SongInfo));
+  songCount = 0;
+}
+
+bool ProjectInfo::select(const ProjectInfo &from, const SongSelection &picked, int count) {
+  clear();
+  strcpy(projectName, from.projectName);
+  if (!songs.reserve(count)) {
+    LOGE("Select: no room for %d songs", count);
+    return false;
+  }
+  for (int i = 0; i < from.songCount && songCount < count; i++) {
+    if (!picked[i])
+      continue;
+    songs[songCount] = from.songs[i];
+    songs[songCount].songIndex = i;
+    songs[songCount].changedIndex = songCount;
+    songCount++;
+  }
+  return true;
+}
+
+bool ProjectInfo::swapSongs(int a, int b) {
+  if (a < 0 || b < 0 || a >= songCount || b >= songCount)
+    return false;
+  SongInfo temp = songs[a];
+  songs[a] = songs[b];
+  songs[b] = temp;
+  return true;
+}
+
+const char *SongInfo::name() const {
+  return songNames.get(nameId);
+}
+
+bool SongInfo::setName(const char *name) {
+  nameId = songNames.intern(name);
+  return nameId != 0 || name == nullptr || name[0] == '\0';
+}
+
+void SongInfo::setLocatorSeconds(float seconds) {
+  locatorMs = seconds > 0 ? (uint32_t)(seconds * 1000.0f + 0.5f) : 0;
+}
+
+// The fixed-buffer layout used before the name pool, kept for the report.
+#define LEGACY_MAX_SONGS 50
+
+struct LegacySongInfo {
+  byte  songIndex;
+  int   changedIndex;
+  char  songName[MAX_SONG_NAME_LEN + 1];
+  float locatorTime;
+};
+
+struct LegacyProjectInfo {
+  char           projectName[MAX_SONG_NAME_LEN + 1];
+  LegacySongInfo songs[LEGACY_MAX_SONGS];
+  int            songCount;
+};
+
+static size_t projectBytes(const ProjectInfo &project) {
+  return sizeof(ProjectInfo) + project.songs.capacity() * sizeof(SongInfo);
+}
+
+void printLayoutReport() {
+  Serial.println(F("----- Song Layout -----"));
+  Serial.printf("SongInfo: %u bytes (was %u)\n",
+                (unsigned)sizeof(SongInfo), (unsigned)sizeof(LegacySongInfo));
+  Serial.printf("Projects: %u + %u + %u bytes (was 3 x %u, max %d songs)\n",
+                (unsigned)projectBytes(currentProject),
+                (unsigned)projectBytes(selectedProject),
+                (unsigned)projectBytes(loadedPreset.data),
+                (unsigned)sizeof(LegacyProjectInfo), LEGACY_MAX_SONGS);
+  Serial.printf("Name pool in use: %u / %u bytes\n",
+                (unsigned)songNames.used(), (unsigned)songNames.capacity());
+  Serial.printf("PSRAM free: %u bytes\n",
+                (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  Serial.println(F("-----------------------"));
+}
 
 // -----------------------------------------------------
 // Implementation of SongInfo::getInfo
 // -----------------------------------------------------
 bool SongInfo::getInfo(const byte *data, unsigned length) {
   if (data[1] != 0x00 || data[2] != 0x01 || data[3] != 0x61) {
-    Serial.println(F("Invalid Manufacturer ID"));
+    LOGW("Invalid manufacturer ID");
+    return false;
+  }
+  // Legacy songs (0x00) start at byte 5, sequenced songs (0x04) after the
+  // seq bytes and sync adds (0x06 0x01) after the op and seq bytes.
+  int i;
+  if (data[4] == 0x00) {
+    i = 5;
+  } else if (data[4] == 0x04) {
+    i = 7;
+  } else if (data[4] == 0x06) {
+    i = 8;
+  } else {
+    LOGW("Unknown message type 0x%02X", data[4]);
     return false;
   }
-  if (data[4] != 0x00) {
-    Serial.println(F("Unknown message type"));
+  if (i >= (int)length - 1) {
+    LOGW("Invalid format: missing song index");
     return false;
   }
   // Extract song index (ASCII '0'..'9' or fallback)
-  if (data[5] >= '0' && data[5] <= '9')
-    songIndex = data[5] - '0';
+  if (data[i] >= '0' && data[i] <= '9')
+    songIndex = data[i] - '0';
   else
-    songIndex = data[5];
+    songIndex = data[i];
+  i++;
     
   // Extract song name
-  memset(songName, 0, sizeof(songName));
-  int i = 6, j = 0;
+  char nameBuf[MAX_SONG_NAME_LEN + 1];
+  int j = 0;
   while (i < (int)length - 1 && data[i] != 0x00 && j < MAX_SONG_NAME_LEN) {
-    songName[j++] = (char)data[i++];
+    nameBuf[j++] = (char)data[i++];
   }
-  songName[j] = '\0';
+  nameBuf[j] = '\0';
 
   // Check for valid separator and time bytes
   if (data[i] != 0x00 || i + 1 >= (int)length - 1) {
-    Serial.println(F("Invalid format: Missing separator or time bytes"));
+    LOGW("Invalid format: missing separator or time bytes");
     return false;
   }
   
@@ -112,13 +430,10 @@ bool SongInfo::getInfo(const byte *data, unsigned length) {
     timeBuf[k++] = (char)data[i++];
   }
   timeBuf[k] = '\0';
-  locatorTime = atof(timeBuf);
-
-  Serial.print(F("Parsed Song: "));
-  Serial.print(songName);
-  Serial.print(F(" / Index: "));
-  Serial.print(songIndex);
-  Serial.print(F(" / Time: "));
-  Serial.println(locatorTime);
+  setLocatorSeconds(atof(timeBuf));
+  if (!setName(nameBuf))
+    return false;
+
+  LOGD("Parsed song: %s / index %u / time %.2f", name(), songIndex, locatorSeconds());
   return true;
 }
\ No newline at end of file
@@ -5,30 +5,60 @@
 #include "_input.h"
 #include "_preset.h"
 #include "_webserver.h"
+#include "_tour.h"
+#include "_log.h"
+#include "_state.h"
+#include "_render.h"
+#include "_tasks.h"
+#include "_link.h"
+#include "_transport.h"
+#include "_cue.h"
+#include "_midiport.h"
 
 UI ui;
 
 Input input(ui.getTouchscreen(), ui.getDisplay(), &ui);
 
+// MIDI I/O, cue launches and the keep-alive pings share one task: it outranks
+// loop() and the render task, so neither drawing nor input handling can delay
+// a poll.
 void midiTask(void *pvParameters) {
+  TaskMonitor::attach(AppTask::MIDI);
+  CueQueue::begin();
+  TaskPeriod period(AppTask::MIDI, MIDI_POLL_MS);
   for (;;) {
+    CueQueue::update();
     Midi::read();
-    vTaskDelay(pdMS_TO_TICKS(1));
+    Midi::applyState();
+    LinkMonitor::update();
+    Midi::flush();
+    period.wait();
   }
 }
 
-void pingTask(void *pvParameters) {
-  for (;;) {
-    Midi::Ping();
-    // Check if a ping reply was received in the last 2 seconds
-    if (millis() - lastPingReplyTime < 2000) {
-      digitalWrite(LED_PING, HIGH);  // Connection is active: LED on
-    } else {
-      digitalWrite(LED_PING, LOW);   // No recent reply: LED off
-    }
-    
-    vTaskDelay(pdMS_TO_TICKS(1000));  // Wait 1 second before sending the next ping
+// Boot profile: time at which each init phase finished.
+#define BOOT_STEPS 5
+static const char *bootPhase[BOOT_STEPS];
+static unsigned long bootPhaseMs[BOOT_STEPS];
+static int bootStep = 0;
+
+static void bootMark(const char *phase, const char *next) {
+  if (bootStep < BOOT_STEPS) {
+    bootPhase[bootStep] = phase;
+    bootPhaseMs[bootStep] = millis();
+    bootStep++;
+  }
+  ui.drawLoadingProgress(bootStep, BOOT_STEPS, next);
+}
+
+static void printBootProfile(unsigned long startMs) {
+  Serial.println(F("Boot profile:"));
+  unsigned long previous = startMs;
+  for (int i = 0; i < bootStep; i++) {
+    Serial.printf("  %-14s %5lu ms\n", bootPhase[i], bootPhaseMs[i] - previous);
+    previous = bootPhaseMs[i];
   }
+  Serial.printf("  %-14s %5lu ms\n", "total", previous);
 }
 
 // const char* ssid = "Minatorz";
@@ -40,7 +70,14 @@ void pingTask(void *pvParameters) {
 void setup() {
   Serial.begin(115200);
   while (!Serial);  // Optional: wait for serial port to connect
-  Serial.println("Boot complete");
+  Log::begin();
+  unsigned long bootStart = millis();
+
+  // Bring the display up first so the loading bar tracks real progress
+  ui.init();
+  ui.updateScreen();
+  bootMark("display", "USB MIDI");
+
   Midi::begin();
 
   // Configure pins
@@ -58,12 +95,27 @@ void setup() {
   pinMode(ENC_DT, INPUT);
   pinMode(ENC_SW, INPUT_PULLUP);
 
-  ui.init();
+  bootMark("usb midi", "Storage");
+
   // Initialize preferences
   ps::initPreferences();
-
-  // Start with LOADING screen
-  ui.updateScreen();
+  printLayoutReport();
+  InputLog::begin((InputMode)INPUT_LOG_MODE);
+  bootMark("storage", "Project");
+
+  // Restore the last scanned project and loaded setlist
+  if (ps::loadCachedProject(currentProject))
+    Serial.printf("Restored cached project '%s' (%d songs)\n", currentProject.projectName, currentProject.songCount);
+  bootMark("project cache", "Setlist");
+
+  int lastSlot = ps::getLastPresetSlot();
+  if (lastSlot > 0 && lastSlot <= MAX_PRESETS) {
+    selectedPresetSlot = lastSlot;
+    loadedPreset = ps::loadPresetFromDevice(lastSlot);
+    StateStore::presetLoaded();
+    presetChanged = true;
+  }
+  bootMark("setlist", "Ready");
 
   // pinMode(LED_BUILTIN, OUTPUT);
   // digitalWrite(LED_BUILTIN, LOW); // Make sure LED is off initially
@@ -89,21 +141,64 @@ void setup() {
   //   digitalWrite(LED_BUILTIN, LOW);
   // }
 
-  xTaskCreatePinnedToCore(midiTask, "MIDI Task", 2048, NULL, 1, NULL, 1);
-  xTaskCreatePinnedToCore(pingTask, "PingTask", 2048, NULL, 1, NULL, 1);
+  xTaskCreatePinnedToCore(midiTask, "MIDI", MIDI_TASK_STACK, NULL, MIDI_TASK_PRIORITY, NULL, MIDI_TASK_CORE);
+
+  printBootProfile(bootStart);
+  Serial.println("Boot complete");
+
+#if SCREEN_TOUR
+  // The globals now hold fixture data; stop here rather than let it be saved.
+  ScreenTour::run(ui, Serial, SCREEN_TOUR_DUMP);
+  Serial.println(F("Screen tour done, flash the normal build to use the device"));
+  for (;;)
+    delay(1000);
+#endif
+  ui.setScreenState(ScreenState::HOME);
+  Render::begin(ui);
+  TaskMonitor::attach(AppTask::LOOP);
+}
+
+static void runHandler(InputHandler id, void (Input::*handler)()) {
+  unsigned long start = micros();
+  (input.*handler)();
+  InputLog::profile(id, micros() - start);
 }
 
 void loop() {
-  // Continuously handle touch and encoder inputs and check WiFi state
-  input.handleTouch();
-  input.handleRotary();
-  input.StartButton();
-  input.StopButton();
-  input.LeftButton();
-  input.RightButton();
-  input.handleVolume();
-  
-  ui.checkWifiConnection();
+  unsigned long passStart = micros();
+  {
+    // Input handlers draw screens and menus; keep the render task off the
+    // display meanwhile.
+    Render::Lock lock;
+    // Continuously handle touch and encoder inputs and check WiFi state
+    runHandler(InputHandler::TOUCH, &Input::handleTouch);
+    runHandler(InputHandler::ROTARY, &Input::handleRotary);
+    runHandler(InputHandler::START, &Input::StartButton);
+    runHandler(InputHandler::STOP, &Input::StopButton);
+    runHandler(InputHandler::LEFT, &Input::LeftButton);
+    runHandler(InputHandler::RIGHT, &Input::RightButton);
+    runHandler(InputHandler::VOLUME, &Input::handleVolume);
+    ui.checkWifiConnection();
+  }
+  InputLog::update();
+  webServerManager.update();
+
+  static unsigned long lastSpiReport = 0;
+  if (millis() - lastSpiReport >= SPI_REPORT_INTERVAL_MS) {
+    lastSpiReport = millis();
+    SpiBus::printReport();
+    Render::printReport();
+    ui.printFrameReport();
+    TaskMonitor::printReport();
+    LinkMonitor::printReport();
+    Transport::printReport();
+    CueQueue::printReport();
+    MidiPorts::printReport();
+  }
 
-  delay(10);  // Yield time to other tasks
+  TaskMonitor::busy(AppTask::LOOP, micros() - passStart);
+  unsigned long sleepStart = micros();
+  InputLog::sleep(LOOP_SLEEP_MS);  // Yield time to other tasks (virtual time while replaying)
+  long late = (long)(micros() - sleepStart) - LOOP_SLEEP_MS * 1000L;
+  TaskMonitor::woke(AppTask::LOOP, late > 0 ? late : 0);
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino core the tested modules use.
+// The clock only moves when a test calls hostAdvanceUs().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+// Adafruit_GFX.cpp defines a min() macro; the containers the other stand-ins
+// use are included first so suites can include it anywhere.
+#include <array>
+#include <deque>
+#include <map>
+#include <set>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "pgmspace.h"
+#include "pins_arduino.h"
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define F(s) s
+#define HIGH 1
+#define LOW  0
+#define INPUT  0x01
+#define INPUT_PULLUP 0x05
+#define OUTPUT 0x03
+
+using std::min;
+using std::max;
+
+inline uint64_t hostNowUs = 0;
+
+inline void hostAdvanceUs(uint64_t us) { hostNowUs += us; }
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostNowUs; }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(hostNowUs / 1000); }
+inline void delay(unsigned long ms) { hostAdvanceUs((uint64_t)ms * 1000); }
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+// newlib has it, glibc only from 2.38.
+inline size_t hostStrlcpy(char *dst, const char *src, size_t size) {
+    size_t n = strlen(src);
+    if (size) {
+        size_t c = n < size - 1 ? n : size - 1;
+        memcpy(dst, src, c);
+        dst[c] = '\0';
+    }
+    return n;
+}
+#define strlcpy hostStrlcpy
+
+// GPIO levels. hostPinHook sees each write before it lands; the SPI mock
+// uses it to catch DC and CS changing under queued DMA.
+inline uint8_t hostPinLevel[64];
+inline void (*hostPinHook)(uint8_t pin, uint8_t level) = nullptr;
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    if (hostPinHook)
+        hostPinHook(pin, level);
+    hostPinLevel[pin & 63] = level;
+}
+inline int digitalRead(uint8_t pin) { return hostPinLevel[pin & 63]; }
+
+// ADC readings, set by the tests.
+inline int hostAnalogLevel[64];
+inline int analogRead(uint8_t pin) { return hostAnalogLevel[pin & 63]; }
+
+#define FALLING 0x02
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(int, void (*)(void), int) {}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return 200000; }
+    uint32_t getMinFreeHeap() { return 150000; }
+};
+
+inline EspClass ESP;
+
+class __FlashStringHelper;
+
+class String {
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    const char *c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    char charAt(size_t i) const { return i < _s.size() ? _s[i] : 0; }
+    char operator[](size_t i) const { return charAt(i); }
+    int indexOf(char c, size_t from = 0) const { return found(_s.find(c, from)); }
+    int indexOf(const String &s, size_t from = 0) const { return found(_s.find(s._s, from)); }
+    String substring(size_t from, size_t to = std::string::npos) const {
+        from = from < _s.size() ? from : _s.size();
+        to = to < _s.size() ? to : _s.size();
+        return String(_s.substr(from, to > from ? to - from : 0).c_str());
+    }
+    void toCharArray(char *buf, size_t size) const {
+        if (size) {
+            strncpy(buf, _s.c_str(), size - 1);
+            buf[size - 1] = '\0';
+        }
+    }
+    long toInt() const { return atol(_s.c_str()); }
+    String operator+(const String &o) const { return String((_s + o._s).c_str()); }
+    String &operator+=(const String &o) { _s += o._s; return *this; }
+    bool operator==(const String &o) const { return _s == o._s; }
+    bool operator!=(const String &o) const { return _s != o._s; }
+
+private:
+    static int found(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+
+    std::string _s;
+};
+
+inline String operator+(const char *a, const String &b) { return String(a) + b; }
+
+#include "Print.h"
+
+// Serial output goes to stdout; set hostSerialQuiet to keep test output short.
+inline bool hostSerialQuiet = true;
+
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    using Print::write;
+    size_t write(uint8_t b) override { return hostSerialQuiet ? 1 : (putchar(b), 1); }
+    size_t write(const uint8_t *data, size_t n) override { return hostSerialQuiet ? n : fwrite(data, 1, n, stdout); }
+    void flush() {}
+};
+
+inline HostSerial Serial;
+
+#define SERIAL_8N1 0x800001c
+
+// UART: bytes written are kept in sent; room is what availableForWrite()
+// reports and shrinks as bytes are written.
+class HardwareSerial {
+public:
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+        this->baud = baud;
+    }
+    int availableForWrite() { return room; }
+    size_t write(uint8_t b) { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t n) {
+        if ((int)n > room)
+            n = room;
+        sent.insert(sent.end(), data, data + n);
+        room -= n;
+        return n;
+    }
+
+    unsigned long baud = 0;
+    int room = 128;
+    std::vector<uint8_t> sent;
+};
+
+inline HardwareSerial Serial1;
+
+#endif
@@ -0,0 +1 @@
+// Host stand-in: included by _webserver.h, nothing from it is used.
@@ -0,0 +1,226 @@
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+// Host stand-in for the parts of ESPAsyncWebServer _webserver.h uses. Tests
+// play the browser: AsyncWebServer::get() runs a route's handler the way the
+// library would and returns the response it sent. The WebSocket side is
+// driven the same way: connect(), receive() and disconnect() raise the
+// events a browser would, and each client keeps what the server sent it.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include <map>
+#include <memory>
+
+typedef enum { HTTP_GET = 1, HTTP_POST = 2, HTTP_ANY = 0x7F } WebRequestMethod;
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String &value) : _value(value) {}
+    const String &value() const { return _value; }
+
+private:
+    String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code = 200) : code(code) {}
+    void addHeader(const String &name, const String &value) { headers[name.c_str()] = value.c_str(); }
+    std::string header(const char *name) const {
+        auto it = headers.find(name);
+        return it == headers.end() ? "" : it->second;
+    }
+
+    int code;
+    std::map<std::string, std::string> headers;
+    std::vector<uint8_t> body;
+};
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(const std::map<std::string, std::string> &headers) {
+        for (const auto &h : headers)
+            _headers.emplace(h.first, AsyncWebHeader(String(h.second.c_str())));
+    }
+    bool hasHeader(const char *name) const { return _headers.count(name) > 0; }
+    AsyncWebHeader *getHeader(const char *name) {
+        auto it = _headers.find(name);
+        return it == _headers.end() ? nullptr : &it->second;
+    }
+    AsyncWebServerResponse *beginResponse(int code) {
+        _response = AsyncWebServerResponse(code);
+        return &_response;
+    }
+    // As the library's file response: a file that isn't there is served from
+    // its .gz twin, with Content-Encoding: gzip.
+    AsyncWebServerResponse *beginResponse(FS &fs, const String &path, const String &mime) {
+        String served = path;
+        _response = AsyncWebServerResponse(200);
+        if (!fs.exists(served) && fs.exists(served + ".gz")) {
+            served += ".gz";
+            _response.addHeader("Content-Encoding", "gzip");
+        }
+        File file = fs.open(served, "r");
+        if (!file) {
+            _response = AsyncWebServerResponse(404);
+            return &_response;
+        }
+        _response.body.resize(file.size());
+        file.read(_response.body.data(), _response.body.size());
+        _response.addHeader("Content-Type", mime);
+        return &_response;
+    }
+    void send(AsyncWebServerResponse *response) { sent = response; }
+
+    AsyncWebServerResponse *sent = nullptr;
+
+private:
+    std::map<std::string, AsyncWebHeader> _headers;
+    AsyncWebServerResponse _response;
+};
+
+typedef std::function<void(AsyncWebServerRequest *)> ArRequestHandlerFunction;
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncStaticWebHandler : public AsyncWebHandler {
+public:
+    AsyncStaticWebHandler &setDefaultFile(const char *) { return *this; }
+    AsyncStaticWebHandler &setCacheControl(const char *) { return *this; }
+};
+
+class AsyncWebServer {
+public:
+    AsyncWebServer(uint16_t port) { host = this; }
+    void begin() {}
+    void addHandler(AsyncWebHandler *) {}
+    void on(const char *url, WebRequestMethod, ArRequestHandlerFunction handler) {
+        routes.push_back(url);
+        _handlers[url] = handler;
+    }
+    AsyncStaticWebHandler &serveStatic(const char *, FS &, const char *) { return _static; }
+
+    // A GET with the given request headers; 404 for a URL with no route.
+    AsyncWebServerResponse get(const char *url, const std::map<std::string, std::string> &headers = {}) {
+        auto it = _handlers.find(url);
+        if (it == _handlers.end())
+            return AsyncWebServerResponse(404);
+        AsyncWebServerRequest request(headers);
+        it->second(&request);
+        return request.sent ? *request.sent : AsyncWebServerResponse(500);
+    }
+
+    std::vector<std::string> routes;
+    static inline AsyncWebServer *host = nullptr;   // the last one made, for tests
+
+private:
+    AsyncStaticWebHandler _static;
+    std::map<std::string, ArRequestHandlerFunction> _handlers;
+};
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+
+typedef struct {
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebSocketClient {
+public:
+    struct Message {
+        bool binary;
+        std::vector<uint8_t> data;
+        std::string str() const { return std::string(data.begin(), data.end()); }
+    };
+
+    AsyncWebSocketClient(uint32_t id) : _id(id) {}
+    uint32_t id() const { return _id; }
+    void close() { closed = true; }
+    size_t queueLen() const { return queued; }
+    void text(const char *s) { text(s, strlen(s)); }
+    void text(const String &s) { text(s.c_str(), s.length()); }
+    void text(const char *s, size_t len) { sent.push_back({ false, std::vector<uint8_t>(s, s + len) }); }
+    void binary(const uint8_t *data, size_t len) { sent.push_back({ true, std::vector<uint8_t>(data, data + len) }); }
+
+    std::vector<Message> sent;
+    size_t queued = 0;        // what queueLen() reports; tests set it to model a slow client
+    bool closed = false;
+
+private:
+    uint32_t _id;
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    typedef std::function<void(AsyncWebSocket *, AsyncWebSocketClient *, AwsEventType, void *, uint8_t *, size_t)>
+        AwsEventHandler;
+
+    AsyncWebSocket(const String &url) { host = this; }
+    void onEvent(AwsEventHandler handler) { _handler = handler; }
+    AsyncWebSocketClient *client(uint32_t id) {
+        for (auto &c : _clients) {
+            if (c->id() == id)
+                return c.get();
+        }
+        return nullptr;
+    }
+
+    AsyncWebSocketClient *connect() {
+        _clients.push_back(std::make_unique<AsyncWebSocketClient>(++_lastId));
+        AsyncWebSocketClient *c = _clients.back().get();
+        if (_handler)
+            _handler(this, c, WS_EVT_CONNECT, nullptr, nullptr, 0);
+        return c;
+    }
+
+    // One whole, unfragmented message.
+    void receive(AsyncWebSocketClient *c, AwsFrameType opcode, const void *data, size_t len) {
+        receivePart(c, opcode, data, len, 0, len);
+    }
+
+    // Part of a message of total bytes that starts at index, as the library
+    // hands over frames larger than a TCP segment.
+    void receivePart(AsyncWebSocketClient *c, AwsFrameType opcode, const void *data, size_t len,
+                     uint64_t index, uint64_t total) {
+        AwsFrameInfo info = {};
+        info.message_opcode = info.opcode = opcode;
+        info.final = 1;
+        info.index = index;
+        info.len = total;
+        // Never null, like the library's receive buffer.
+        std::vector<uint8_t> copy((const uint8_t *)data, (const uint8_t *)data + len);
+        copy.reserve(1);
+        if (_handler)
+            _handler(this, c, WS_EVT_DATA, &info, copy.data(), len);
+    }
+
+    void disconnect(AsyncWebSocketClient *c) {
+        if (_handler)
+            _handler(this, c, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+        for (size_t i = 0; i < _clients.size(); i++) {
+            if (_clients[i].get() == c)
+                _clients.erase(_clients.begin() + i);
+        }
+    }
+
+    static inline AsyncWebSocket *host = nullptr;   // the last one made, for tests
+
+private:
+    AwsEventHandler _handler;
+    std::vector<std::unique_ptr<AsyncWebSocketClient>> _clients;
+    uint32_t _lastId = 0;
+};
+
+#endif
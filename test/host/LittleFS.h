@@ -0,0 +1,94 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// Host stand-in for LittleFS: files live in memory for the whole run.
+// Opening for "w" truncates at once, as on the device.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+class File {
+public:
+    File() {}
+    File(std::shared_ptr<std::vector<uint8_t>> data, bool append) : _data(data), _pos(append ? data->size() : 0) {}
+
+    explicit operator bool() const { return (bool)_data; }
+    size_t size() const { return _data ? _data->size() : 0; }
+    size_t position() const { return _pos; }
+    int available() { return _data ? (int)(_data->size() - _pos) : 0; }
+    bool seek(uint32_t pos) {
+        if (!_data || pos > _data->size())
+            return false;
+        _pos = pos;
+        return true;
+    }
+    int read() {
+        uint8_t b;
+        return read(&b, 1) ? b : -1;
+    }
+    size_t read(uint8_t *buf, size_t n) {
+        if (n > (size_t)available())
+            n = available();
+        if (n)
+            memcpy(buf, _data->data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+    size_t write(uint8_t b) { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t n) {
+        if (!_data)
+            return 0;
+        if (_pos + n > _data->size())
+            _data->resize(_pos + n);
+        memcpy(_data->data() + _pos, buf, n);
+        _pos += n;
+        return n;
+    }
+    String readStringUntil(char end) {
+        std::string s;
+        int c;
+        while ((c = read()) >= 0 && c != end)
+            s += (char)c;
+        return String(s.c_str());
+    }
+    void flush() {}
+    void close() { _data.reset(); }
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> _data;
+    size_t _pos = 0;
+};
+
+namespace fs {
+class FS {
+public:
+    bool begin(bool formatOnFail = false) { return true; }
+    bool exists(const String &path) { return files.count(path.c_str()) > 0; }
+    bool mkdir(const String &) { return true; }
+    bool remove(const String &path) { return files.erase(path.c_str()) > 0; }
+    bool rename(const String &from, const String &to) {
+        auto it = files.find(from.c_str());
+        if (it == files.end())
+            return false;
+        files[to.c_str()] = it->second;
+        files.erase(it);
+        return true;
+    }
+    File open(const String &path, const char *mode = "r") {
+        auto it = files.find(path.c_str());
+        if (mode[0] == 'r')
+            return it == files.end() ? File() : File(it->second, false);
+        if (mode[0] == 'w' || it == files.end())
+            files[path.c_str()] = std::make_shared<std::vector<uint8_t>>();
+        return File(files[path.c_str()], mode[0] == 'a');
+    }
+
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+};
+}
+
+using fs::FS;
+inline fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef HOST_MIDI_H
+#define HOST_MIDI_H
+
+// Host stand-in for the FortySevenEffects MIDI Library: the same
+// MIDI_CREATE_INSTANCE / SerialMIDI / MidiInterface shape, writing and
+// reading through the transport like the library does with its default
+// settings (no running status, thru off here). Input parsing covers what the
+// firmware listens for: SysEx, real-time transport and Song Position.
+
+#include <Arduino.h>
+
+#define MIDI_CHANNEL_OMNI 0
+#define MIDI_NAMESPACE midi
+
+namespace midi {
+
+template <class SerialPort>
+class SerialMIDI {
+public:
+    explicit SerialMIDI(SerialPort &port) : _port(port) {}
+    void begin() { _port.begin(31250); }
+    void write(byte b) { _port.write(b); }
+    unsigned available() { return _port.available(); }
+    byte read() { return (byte)_port.read(); }
+
+private:
+    SerialPort &_port;
+};
+
+template <class Transport>
+class MidiInterface {
+public:
+    static const unsigned SysExMaxSize = 128;
+
+    explicit MidiInterface(Transport &transport) : _transport(transport) {}
+
+    void begin(int) { _transport.begin(); }
+    void turnThruOff() {}
+
+    void setHandleSystemExclusive(void (*fn)(byte *, unsigned)) { _sysEx = fn; }
+    void setHandleClock(void (*fn)()) { _clock = fn; }
+    void setHandleStart(void (*fn)()) { _start = fn; }
+    void setHandleContinue(void (*fn)()) { _continue = fn; }
+    void setHandleStop(void (*fn)()) { _stop = fn; }
+    void setHandleSongPosition(void (*fn)(unsigned)) { _songPosition = fn; }
+
+    void sendSysEx(unsigned length, const byte *data, bool containsBoundaries = false) {
+        if (!containsBoundaries)
+            _transport.write(0xF0);
+        for (unsigned i = 0; i < length; i++)
+            _transport.write(data[i]);
+        if (!containsBoundaries)
+            _transport.write(0xF7);
+    }
+
+    void sendControlChange(byte number, byte value, byte channel) {
+        _transport.write(0xB0 | ((channel - 1) & 0x0F));
+        _transport.write(number & 0x7F);
+        _transport.write(value & 0x7F);
+    }
+
+    // Parses until one message is complete. True if one was.
+    bool read() {
+        while (_transport.available()) {
+            byte b = _transport.read();
+            if (b >= 0xF8) {
+                void (*fn)() = b == 0xF8 ? _clock : b == 0xFA ? _start : b == 0xFB ? _continue
+                             : b == 0xFC ? _stop : nullptr;
+                if (fn)
+                    fn();
+                return true;
+            }
+            if (b == 0xF0) {
+                _status = b;
+                _length = 0;
+                _sysExBuffer[_length++] = b;
+                continue;
+            }
+            if (_status == 0xF0) {
+                if (_length < SysExMaxSize)
+                    _sysExBuffer[_length++] = b;
+                if (b == 0xF7) {
+                    _status = 0;
+                    if (_length <= SysExMaxSize && _sysEx)
+                        _sysEx(_sysExBuffer, _length);
+                    return true;
+                }
+                continue;
+            }
+            if (b & 0x80) {
+                _status = b;
+                _length = 0;
+                continue;
+            }
+            if (_status == 0xF2) {
+                _data[_length++] = b;
+                if (_length == 2) {
+                    _status = 0;
+                    if (_songPosition)
+                        _songPosition(_data[0] | (_data[1] << 7));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    Transport &_transport;
+    byte _status = 0;
+    unsigned _length = 0;
+    byte _data[2] = {};
+    byte _sysExBuffer[SysExMaxSize];
+    void (*_sysEx)(byte *, unsigned) = nullptr;
+    void (*_clock)() = nullptr;
+    void (*_start)() = nullptr;
+    void (*_continue)() = nullptr;
+    void (*_stop)() = nullptr;
+    void (*_songPosition)(unsigned) = nullptr;
+};
+
+}  // namespace midi
+
+#define MIDI_CREATE_INSTANCE(Type, SerialPort, Name)                          \
+    midi::SerialMIDI<Type> serial##Name(SerialPort);                          \
+    midi::MidiInterface<midi::SerialMIDI<Type>> Name((midi::SerialMIDI<Type> &)serial##Name);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// Host stand-in for the ESP32 NVS Preferences: one in-memory store per
+// namespace, kept for the whole run.
+
+#include <Arduino.h>
+#include <map>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false) {
+        _ns = &store()[name];
+        return true;
+    }
+    void end() { _ns = nullptr; }
+
+    bool clear() { ns().clear(); return true; }
+    bool remove(const char *key) { return ns().erase(key) > 0; }
+    bool isKey(const char *key) { return ns().count(key) > 0; }
+
+    size_t putString(const char *key, const String &value) { ns()[key] = value.c_str(); return value.length(); }
+    size_t putInt(const char *key, int32_t value) { ns()[key] = std::to_string(value); return 4; }
+    size_t putFloat(const char *key, float value) { ns()[key] = std::to_string(value); return 4; }
+
+    String getString(const char *key, const String &fallback = String()) {
+        auto it = ns().find(key);
+        return it == ns().end() ? fallback : String(it->second.c_str());
+    }
+    int32_t getInt(const char *key, int32_t fallback = 0) {
+        auto it = ns().find(key);
+        return it == ns().end() ? fallback : atoi(it->second.c_str());
+    }
+    float getFloat(const char *key, float fallback = 0) {
+        auto it = ns().find(key);
+        return it == ns().end() ? fallback : (float)atof(it->second.c_str());
+    }
+
+    // Every namespace, for tests that seed or inspect the store.
+    static std::map<std::string, std::map<std::string, std::string>> &store() {
+        static std::map<std::string, std::map<std::string, std::string>> s;
+        return s;
+    }
+
+private:
+    std::map<std::string, std::string> &ns() {
+        assert(_ns && "Preferences used outside begin()/end()");
+        return *_ns;
+    }
+
+    std::map<std::string, std::string> *_ns = nullptr;
+};
+
+#endif
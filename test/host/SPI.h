@@ -0,0 +1,71 @@
+#ifndef HOST_SPI_CLASS_H
+#define HOST_SPI_CLASS_H
+
+// Arduino SPI writing straight to hostSpi.wire.
+
+#include "host_spi.h"
+
+#define SPI_HAS_TRANSACTION
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+#define MSBFIRST 1
+#define LSBFIRST 0
+
+class SPISettings {
+public:
+    SPISettings(uint32_t clock = 1000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+        : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+    uint32_t clock;
+    uint8_t bitOrder;
+    uint8_t dataMode;
+};
+
+// The ESP32 core's divider helpers. A divider is 80 MHz APB over the clock
+// here; only the round trip between the two matters to SpiBus.
+inline uint32_t spiFrequencyToClockDiv(uint32_t freq) { return 80000000UL / freq; }
+inline uint32_t spiClockDivToFrequency(uint32_t div) { return 80000000UL / div; }
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+    void end() {}
+    void beginTransaction(SPISettings) { inTransaction++; }
+    void endTransaction() { inTransaction--; }
+    void setFrequency(uint32_t) {}
+    void setClockDivider(uint32_t) {}
+    void setBitOrder(uint8_t) {}
+    void setDataMode(uint8_t) {}
+
+    uint8_t transfer(uint8_t b) {
+        hostSpi.cpuWrite(&b, 1);
+        return 0;
+    }
+    uint16_t transfer16(uint16_t w) {
+        write16(w);
+        return 0;
+    }
+    void write(uint8_t b) { hostSpi.cpuWrite(&b, 1); }
+    void write16(uint16_t w) {
+        uint8_t b[2] = { (uint8_t)(w >> 8), (uint8_t)w };
+        hostSpi.cpuWrite(b, 2);
+    }
+    void write32(uint32_t l) {
+        uint8_t b[4] = { (uint8_t)(l >> 24), (uint8_t)(l >> 16), (uint8_t)(l >> 8), (uint8_t)l };
+        hostSpi.cpuWrite(b, 4);
+    }
+    void writeBytes(const uint8_t *data, uint32_t size) { hostSpi.cpuWrite(data, size); }
+    // Like the ESP32 core: 16-bit pixels sent most significant byte first.
+    void writePixels(const void *data, uint32_t size) {
+        const uint16_t *px = (const uint16_t *)data;
+        for (uint32_t i = 0; i < size / 2; i++)
+            write16(px[i]);
+    }
+
+    int inTransaction = 0;
+};
+
+inline SPIClass SPI;
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_USB_H
+#define HOST_USB_H
+
+// Host stand-in for the Arduino core's USB device object.
+class ESPUSB {
+public:
+    void productName(const char *) {}
+    bool begin() { return true; }
+};
+
+inline ESPUSB USB;
+
+#endif
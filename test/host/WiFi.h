@@ -0,0 +1,59 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Host stand-in for the ESP32 WiFi station: a fixed connection state and
+// scan result that tests set directly.
+
+#include <Arduino.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _b{ a, b, c, d } {}
+    String toString() const {
+        char s[16];
+        snprintf(s, sizeof(s), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+        return String(s);
+    }
+
+private:
+    uint8_t _b[4];
+};
+
+struct HostNetwork {
+    std::string ssid;
+    int rssi;
+};
+
+class WiFiClass {
+public:
+    wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool mode(wifi_mode_t) { return true; }
+    bool setSleep(bool) { return true; }
+    bool persistent(bool) { return true; }
+    bool setAutoConnect(bool) { return true; }
+    bool setAutoReconnect(bool) { return true; }
+    bool disconnect(bool wifiOff = false) { connected = false; return true; }
+    wl_status_t begin(const char *ssid, const char *pass) { return status(); }
+    int16_t scanNetworks(bool async = false) { return async ? WIFI_SCAN_RUNNING : (int16_t)networks.size(); }
+    int16_t scanComplete() { return (int16_t)networks.size(); }
+    String SSID() { return String(ssid.c_str()); }
+    String SSID(uint8_t i) { return String(networks[i].ssid.c_str()); }
+    int32_t RSSI() { return rssi; }
+    int32_t RSSI(uint8_t i) { return networks[i].rssi; }
+    IPAddress localIP() { return connected ? ip : IPAddress(); }
+
+    bool connected = false;
+    std::string ssid;
+    int32_t rssi = 0;
+    IPAddress ip;
+    std::vector<HostNetwork> networks;
+};
+
+inline WiFiClass WiFi;
+
+#endif
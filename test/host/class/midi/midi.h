@@ -0,0 +1,56 @@
+#ifndef HOST_CLASS_MIDI_H
+#define HOST_CLASS_MIDI_H
+
+// Host stand-in for the TinyUSB definitions ESPNATIVEUSBMIDI uses, with
+// TinyUSB's values.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TU_VERIFY(cond) do { if (!(cond)) return 0; } while (0)
+#define U16_TO_U8S_LE(u16) (uint8_t)((u16) & 0xFF), (uint8_t)(((u16) >> 8) & 0xFF)
+
+enum {
+    TUSB_DESC_INTERFACE    = 0x04,
+    TUSB_DESC_ENDPOINT     = 0x05,
+    TUSB_DESC_CS_INTERFACE = 0x24,
+    TUSB_DESC_CS_ENDPOINT  = 0x25,
+    TUSB_CLASS_AUDIO       = 1,
+    TUSB_XFER_BULK         = 2,
+};
+
+enum {
+    AUDIO_SUBCLASS_CONTROL         = 0x01,
+    AUDIO_SUBCLASS_MIDI_STREAMING  = 0x03,
+    AUDIO_FUNC_PROTOCOL_CODE_UNDEF = 0x00,
+    AUDIO_CS_AC_INTERFACE_HEADER   = 0x01,
+};
+
+enum {
+    MIDI_CS_INTERFACE_HEADER   = 0x01,
+    MIDI_CS_INTERFACE_IN_JACK  = 0x02,
+    MIDI_CS_INTERFACE_OUT_JACK = 0x03,
+    MIDI_CS_ENDPOINT_GENERAL   = 0x01,
+    MIDI_JACK_EMBEDDED         = 0x01,
+    MIDI_JACK_EXTERNAL         = 0x02,
+};
+
+enum {
+    MIDI_CIN_SYSCOM_2BYTE    = 2,
+    MIDI_CIN_SYSCOM_3BYTE    = 3,
+    MIDI_CIN_SYSEX_START     = 4,
+    MIDI_CIN_SYSEX_END_1BYTE = 5,
+    MIDI_CIN_SYSEX_END_2BYTE = 6,
+    MIDI_CIN_SYSEX_END_3BYTE = 7,
+};
+
+enum {
+    MIDI_STATUS_SYSEX_START                   = 0xF0,
+    MIDI_STATUS_SYSEX_END                     = 0xF7,
+    MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME = 0xF1,
+    MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER  = 0xF2,
+    MIDI_STATUS_SYSCOM_SONG_SELECT            = 0xF3,
+};
+
+#endif
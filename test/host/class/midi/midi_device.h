@@ -0,0 +1,54 @@
+#ifndef HOST_CLASS_MIDI_DEVICE_H
+#define HOST_CLASS_MIDI_DEVICE_H
+
+// Host stand-in for TinyUSB's MIDI device class: the descriptor templates as
+// TinyUSB defines them, and packet I/O against hostUsb (see host_usb.h).
+
+#include "midi.h"
+#include "host_usb.h"
+
+#define TUD_MIDI_DESC_HEAD_LEN (9 + 9 + 9 + 7)
+#define TUD_MIDI_DESC_HEAD(_itfnum, _stridx, _numcables) \
+    9, TUSB_DESC_INTERFACE, _itfnum, 0, 0, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_CONTROL, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, _stridx, \
+    9, TUSB_DESC_CS_INTERFACE, AUDIO_CS_AC_INTERFACE_HEADER, U16_TO_U8S_LE(0x0100), U16_TO_U8S_LE(0x0009), 1, (uint8_t)((_itfnum) + 1), \
+    9, TUSB_DESC_INTERFACE, (uint8_t)((_itfnum) + 1), 0, 2, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_MIDI_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0, \
+    7, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_HEADER, U16_TO_U8S_LE(0x0100), \
+    U16_TO_U8S_LE(7 + (_numcables) * TUD_MIDI_DESC_JACK_LEN + 2 * TUD_MIDI_DESC_EP_LEN(_numcables))
+
+#define TUD_MIDI_JACKID_IN_EMB(_cablenum)  (uint8_t)(((_cablenum) - 1) * 4 + 1)
+#define TUD_MIDI_JACKID_IN_EXT(_cablenum)  (uint8_t)(((_cablenum) - 1) * 4 + 2)
+#define TUD_MIDI_JACKID_OUT_EMB(_cablenum) (uint8_t)(((_cablenum) - 1) * 4 + 3)
+#define TUD_MIDI_JACKID_OUT_EXT(_cablenum) (uint8_t)(((_cablenum) - 1) * 4 + 4)
+
+#define TUD_MIDI_DESC_JACK_LEN (6 + 6 + 9 + 9)
+#define TUD_MIDI_DESC_JACK_DESC(_cablenum, _stridx) \
+    6, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_IN_JACK, MIDI_JACK_EMBEDDED, TUD_MIDI_JACKID_IN_EMB(_cablenum), _stridx, \
+    6, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_IN_JACK, MIDI_JACK_EXTERNAL, TUD_MIDI_JACKID_IN_EXT(_cablenum), _stridx, \
+    9, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_OUT_JACK, MIDI_JACK_EMBEDDED, TUD_MIDI_JACKID_OUT_EMB(_cablenum), 1, TUD_MIDI_JACKID_IN_EXT(_cablenum), 1, _stridx, \
+    9, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_OUT_JACK, MIDI_JACK_EXTERNAL, TUD_MIDI_JACKID_OUT_EXT(_cablenum), 1, TUD_MIDI_JACKID_IN_EMB(_cablenum), 1, _stridx
+
+#define TUD_MIDI_DESC_EP_LEN(_numcables) (9 + 4 + (_numcables))
+#define TUD_MIDI_DESC_EP(_epout, _epsize, _numcables) \
+    9, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, 0, 0, \
+    (uint8_t)(4 + (_numcables)), TUSB_DESC_CS_ENDPOINT, MIDI_CS_ENDPOINT_GENERAL, _numcables
+
+inline bool tud_midi_mounted() { return hostUsb.mounted; }
+
+inline bool tud_midi_packet_read(uint8_t packet[4]) {
+    if (!hostUsb.mounted || hostUsb.toDevice.empty())
+        return false;
+    memcpy(packet, hostUsb.toDevice.front().data(), 4);
+    hostUsb.toDevice.pop_front();
+    return true;
+}
+
+inline bool tud_midi_packet_write(const uint8_t packet[4]) {
+    if (!hostUsb.mounted || hostUsb.inRoom == 0)
+        return false;
+    if (hostUsb.inRoom != SIZE_MAX)
+        hostUsb.inRoom--;
+    hostUsb.fromDevice.push_back({ packet[0], packet[1], packet[2], packet[3] });
+    return true;
+}
+
+#endif
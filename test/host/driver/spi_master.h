@@ -0,0 +1,98 @@
+#ifndef HOST_SPI_MASTER_H
+#define HOST_SPI_MASTER_H
+
+// IDF SPI master driver over hostSpi. A transaction goes out when it is
+// reaped, the latest the real bus could send it, so a buffer rewritten too
+// early shows up in hostSpi.overwritten.
+
+#include "host_spi.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+typedef enum { SPI1_HOST = 0, SPI2_HOST = 1, SPI3_HOST = 2 } spi_host_device_t;
+
+#define SPI_DMA_CH_AUTO      3
+#define SPI_DEVICE_NO_DUMMY  (1 << 6)
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+    uint32_t flags;
+} spi_bus_config_t;
+
+struct spi_transaction_t {
+    uint32_t flags;
+    uint16_t cmd;
+    uint64_t addr;
+    size_t length;
+    size_t rxlength;
+    void *user;
+    const void *tx_buffer;
+    void *rx_buffer;
+};
+
+typedef void (*transaction_cb_t)(spi_transaction_t *trans);
+
+typedef struct {
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    uint32_t flags;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+struct spi_device_t {
+    int unused;
+};
+typedef spi_device_t *spi_device_handle_t;
+
+inline esp_err_t hostSpiBusResult = ESP_OK;   // what spi_bus_initialize returns
+inline spi_device_t hostSpiDevice;
+
+inline esp_err_t spi_bus_initialize(spi_host_device_t, const spi_bus_config_t *, int) {
+    return hostSpiBusResult;
+}
+
+inline esp_err_t spi_bus_add_device(spi_host_device_t, const spi_device_interface_config_t *dev,
+                                    spi_device_handle_t *handle) {
+    hostSpi.queueSize = dev->queue_size;
+    hostSpi.postCb = dev->post_cb;
+    *handle = &hostSpiDevice;
+    return ESP_OK;
+}
+
+inline esp_err_t spi_device_queue_trans(spi_device_handle_t, spi_transaction_t *t, TickType_t) {
+    if ((int)hostSpi.pending.size() >= hostSpi.queueSize)
+        hostSpi.overQueued++;   // would block forever: nothing reaps while we wait
+    const uint8_t *data = (const uint8_t *)t->tx_buffer;
+    hostSpi.pending.push_back({ t, std::vector<uint8_t>(data, data + t->length / 8) });
+    hostSpi.maxPending = std::max(hostSpi.maxPending, hostSpi.pending.size());
+    hostSpi.dmaTransactions++;
+    return ESP_OK;
+}
+
+inline esp_err_t spi_device_get_trans_result(spi_device_handle_t, spi_transaction_t **out, TickType_t) {
+    if (hostSpi.pending.empty()) {
+        hostSpi.reapedNothing++;
+        return ESP_ERR_TIMEOUT;
+    }
+    HostSpiBus::Pending p = hostSpi.pending.front();
+    hostSpi.pending.pop_front();
+    if (memcmp(p.trans->tx_buffer, p.bytes.data(), p.bytes.size()) != 0)
+        hostSpi.overwritten++;
+    for (uint8_t b : p.bytes)
+        hostSpi.send(b);
+    hostAdvanceUs(p.bytes.size() / 5);   // 40 MHz
+    if (hostSpi.postCb)
+        hostSpi.postCb(p.trans);
+    *out = p.trans;
+    return ESP_OK;
+}
+
+#endif
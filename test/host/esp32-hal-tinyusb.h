@@ -0,0 +1,24 @@
+#ifndef HOST_ESP32_HAL_TINYUSB_H
+#define HOST_ESP32_HAL_TINYUSB_H
+
+// Host stand-in for the Arduino core's TinyUSB glue (see host_usb.h).
+
+#include "host_usb.h"
+
+enum { USB_INTERFACE_MIDI = 4 };
+
+inline int tinyusb_enable_interface(int, uint16_t descriptorLen, tusb_desc_cb_t cb) {
+    hostUsb.loadDescriptor = cb;
+    hostUsb.descriptorLen = descriptorLen;
+    return 0;
+}
+
+inline uint8_t tinyusb_get_free_in_endpoint() { return hostUsb.nextEndpoint; }
+inline uint8_t tinyusb_get_free_out_endpoint() { return hostUsb.nextEndpoint++; }
+
+inline uint8_t tinyusb_add_string_descriptor(const char *str) {
+    hostUsb.strings.push_back(str);
+    return (uint8_t)(hostUsb.strings.size() - 1);
+}
+
+#endif
@@ -0,0 +1 @@
+// Host stand-in: included by ESPNATIVEUSBMIDI.h, nothing from it is used.
@@ -0,0 +1,40 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <map>
+
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// Blocks allocated with MALLOC_CAP_DMA, for esp_ptr_dma_capable().
+inline std::map<const void *, size_t> hostDmaBlocks;
+// Larger requests fail, to exercise out-of-memory fallbacks.
+inline size_t hostHeapCapsLimit = SIZE_MAX;
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+    if (size > hostHeapCapsLimit)
+        return nullptr;
+    void *ptr = malloc(size);
+    if (ptr && (caps & MALLOC_CAP_DMA))
+        hostDmaBlocks[ptr] = size;
+    return ptr;
+}
+inline void heap_caps_free(void *ptr) {
+    hostDmaBlocks.erase(ptr);
+    free(ptr);
+}
+inline size_t heap_caps_get_free_size(uint32_t) { return 0; }
+
+inline bool esp_ptr_dma_capable(const void *p) {
+    auto it = hostDmaBlocks.upper_bound(p);
+    if (it == hostDmaBlocks.begin())
+        return false;
+    --it;
+    return (const uint8_t *)p < (const uint8_t *)it->first + it->second;
+}
+
+#endif
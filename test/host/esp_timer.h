@@ -0,0 +1,59 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <Arduino.h>
+#include "esp_err.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostNowUs; }
+
+// One-shot timers on the host clock; hostRunTimers() calls the ones due,
+// as the esp_timer task would.
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    uint64_t dueUs;
+};
+typedef esp_timer *esp_timer_handle_t;
+
+inline std::vector<esp_timer_handle_t> hostTimers;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    *out = new esp_timer{ *args, false, 0 };
+    hostTimers.push_back(*out);
+    return ESP_OK;
+}
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us) {
+    if (t->armed)
+        return ESP_ERR_INVALID_STATE;
+    t->armed = true;
+    t->dueUs = hostNowUs + us;
+    return ESP_OK;
+}
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    if (!t->armed)
+        return ESP_ERR_INVALID_STATE;
+    t->armed = false;
+    return ESP_OK;
+}
+
+inline void hostRunTimers() {
+    for (esp_timer_handle_t t : hostTimers) {
+        if (t->armed && hostNowUs >= t->dueUs) {
+            t->armed = false;
+            t->args.callback(t->args.arg);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+// Binary semaphores keep their count so "given" can be checked.
+struct HostSemaphore { int count; };
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore{ 0 }; }
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore{ 1 }; }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new HostSemaphore{ 1 }; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t) {
+    HostSemaphore *h = (HostSemaphore *)s;
+    if (h->count == 0)
+        return pdFALSE;
+    h->count--;
+    return pdTRUE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { ((HostSemaphore *)s)->count = 1; return pdTRUE; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t) { return pdTRUE; }
+// One task on the host, and xTaskGetCurrentTaskHandle() is null.
+inline TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t) { return nullptr; }
+
+#endif
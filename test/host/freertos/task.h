@@ -0,0 +1,24 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline BaseType_t xPortGetCoreID() { return 1; }
+inline UBaseType_t uxTaskPriorityGet(TaskHandle_t) { return 1; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 4096; }
+// The tick is the host clock's millisecond count (portTICK_PERIOD_MS is 1).
+TickType_t xTaskGetTickCount();
+typedef void (*TaskFunction_t)(void *);
+
+// Tasks are never started on the host; suites call their bodies directly.
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                                          TaskHandle_t *handle, BaseType_t) {
+    if (handle)
+        *handle = nullptr;
+    return pdPASS;
+}
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+#endif
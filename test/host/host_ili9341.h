@@ -0,0 +1,83 @@
+#ifndef HOST_ILI9341_H
+#define HOST_ILI9341_H
+
+// The panel end of hostSpi: address windows and memory writes decoded from
+// the wire into a framebuffer. Coordinates are the ones the driver sends,
+// i.e. the rotated, logical ones; MADCTL is not modelled.
+
+#include "host_spi.h"
+
+class HostPanel {
+public:
+    HostPanel(uint16_t w, uint16_t h) : width(w), height(h), fb((size_t)w * h, 0) {}
+
+    // Decodes and drops what has reached the wire since the last call.
+    void update() {
+        for (uint16_t e : hostSpi.wire) {
+            if (!(e & HOST_SPI_DATA)) {
+                command((uint8_t)e);
+                continue;
+            }
+            uint8_t b = (uint8_t)e;
+            if (cmd == 0x2C) {
+                if (!haveHigh) {
+                    high = b;
+                    haveHigh = true;
+                    continue;
+                }
+                haveHigh = false;
+                pixel((uint16_t)(high << 8 | b));
+            } else if (nargs < sizeof(args)) {
+                args[nargs++] = b;
+                if (nargs == 4 && cmd == 0x2A) {
+                    x0 = args[0] << 8 | args[1];
+                    x1 = args[2] << 8 | args[3];
+                } else if (nargs == 4 && cmd == 0x2B) {
+                    y0 = args[0] << 8 | args[1];
+                    y1 = args[2] << 8 | args[3];
+                }
+            }
+        }
+        hostSpi.wire.clear();
+    }
+
+    uint16_t at(int x, int y) const { return fb[(size_t)y * width + x]; }
+
+    const uint16_t width, height;
+    std::vector<uint16_t> fb;
+    uint32_t pixelsWritten = 0;
+    uint32_t outside = 0;        // pixels written past the window or the panel
+
+private:
+    void command(uint8_t c) {
+        cmd = c;
+        nargs = 0;
+        haveHigh = false;
+        if (c == 0x2C) {
+            x = x0;
+            y = y0;
+        }
+    }
+
+    void pixel(uint16_t color) {
+        pixelsWritten++;
+        if (y > y1 || x >= width || y >= height)
+            outside++;
+        else
+            fb[(size_t)y * width + x] = color;
+        if (++x > x1) {
+            x = x0;
+            y++;
+        }
+    }
+
+    uint8_t cmd = 0;
+    uint8_t args[4];
+    uint8_t nargs = 0;
+    bool haveHigh = false;
+    uint8_t high = 0;
+    uint16_t x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    uint16_t x = 0, y = 0;
+};
+
+#endif
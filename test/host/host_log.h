@@ -0,0 +1,25 @@
+#ifndef HOST_LOG_H
+#define HOST_LOG_H
+
+// Host definition of Log for the tests: counts records per level and prints
+// them unless hostSerialQuiet is set. Include it once per test program.
+
+#include "_log.h"
+
+inline int hostLogCount[LOG_LEVEL_DEBUG + 1];
+
+volatile uint32_t Log::_dropped = 0;
+
+void Log::write(uint8_t level, const char *fmt, ...) {
+    if (level <= LOG_LEVEL_DEBUG)
+        hostLogCount[level]++;
+    if (hostSerialQuiet)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
+
+#endif
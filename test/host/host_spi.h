@@ -0,0 +1,85 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+// The display's SPI bus as the panel sees it, shared by the Arduino SPI
+// class and the IDF master driver stand-in. Every byte that goes out is
+// logged with the DC level it went out under, and the ways the two sides
+// can trip over each other are counted instead of hanging or corrupting.
+
+#include <Arduino.h>
+#include <deque>
+
+#define HOST_SPI_DATA 0x100   // wire entry was sent with DC high
+
+struct spi_transaction_t;
+
+struct HostSpiBus {
+    std::vector<uint16_t> wire;   // byte | HOST_SPI_DATA
+    int dcPin = -1;
+    int csPin = -1;
+
+    // Transactions queued and not yet reaped, with the bytes they held
+    // when queued.
+    struct Pending {
+        spi_transaction_t *trans;
+        std::vector<uint8_t> bytes;
+    };
+    std::deque<Pending> pending;
+    int queueSize = 0;
+    void (*postCb)(spi_transaction_t *) = nullptr;
+
+    uint32_t dmaTransactions = 0;
+    uint32_t cpuBytes = 0;
+    size_t maxPending = 0;
+
+    // Protocol errors.
+    int cpuDuringDma = 0;     // Arduino SPI wrote with DMA still queued
+    int pinDuringDma = 0;     // DC or CS moved with DMA still queued
+    int overQueued = 0;       // more than queue_size unreaped
+    int overwritten = 0;      // a tx buffer changed before its transaction finished
+    int reapedNothing = 0;    // waited for a result with nothing queued
+    int deselected = 0;       // bytes sent with CS high
+
+    void send(uint8_t b) {
+        if (csPin >= 0 && hostPinLevel[csPin])
+            deselected++;
+        wire.push_back(b | (dcPin >= 0 && hostPinLevel[dcPin] ? HOST_SPI_DATA : 0));
+    }
+
+    void cpuWrite(const uint8_t *data, size_t n) {
+        if (!pending.empty())
+            cpuDuringDma++;
+        cpuBytes += n;
+        while (n--)
+            send(*data++);
+    }
+
+    int errors() const {
+        return cpuDuringDma + pinDuringDma + overQueued + overwritten + reapedNothing + deselected;
+    }
+
+    // Data bytes on the wire after the last command byte cmd.
+    std::vector<uint8_t> dataAfter(uint8_t cmd) const {
+        std::vector<uint8_t> out;
+        for (size_t i = wire.size(); i-- > 0;) {
+            if (wire[i] == cmd) {
+                for (size_t j = i + 1; j < wire.size() && (wire[j] & HOST_SPI_DATA); j++)
+                    out.push_back((uint8_t)wire[j]);
+                break;
+            }
+        }
+        return out;
+    }
+
+    void reset() { *this = HostSpiBus(); }
+};
+
+inline HostSpiBus hostSpi;
+
+inline void hostSpiPinHook(uint8_t pin, uint8_t level) {
+    if (((int)pin == hostSpi.dcPin || (int)pin == hostSpi.csPin) &&
+        hostPinLevel[pin] != level && !hostSpi.pending.empty())
+        hostSpi.pinDuringDma++;
+}
+
+#endif
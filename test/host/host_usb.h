@@ -0,0 +1,32 @@
+#ifndef HOST_HOST_USB_H
+#define HOST_HOST_USB_H
+
+// Host stand-in for the TinyUSB MIDI endpoints and the Arduino core's
+// interface registration. Tests play the USB host: they queue event
+// packets in toDevice and read what the device wrote from fromDevice.
+
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <deque>
+#include <string>
+#include <vector>
+
+typedef uint16_t (*tusb_desc_cb_t)(uint8_t *dst, uint8_t *itf);
+typedef std::array<uint8_t, 4> HostUsbPacket;
+
+struct HostUsbMidi {
+    std::deque<HostUsbPacket> toDevice;     // OUT endpoint
+    std::vector<HostUsbPacket> fromDevice;  // IN endpoint
+    size_t inRoom = SIZE_MAX;               // packets the IN FIFO still takes
+    bool mounted = true;
+
+    tusb_desc_cb_t loadDescriptor = nullptr;
+    uint16_t descriptorLen = 0;
+    std::vector<std::string> strings = { "", "", "", "", "" };  // 0-4 belong to the device
+    uint8_t nextEndpoint = 1;
+};
+
+inline HostUsbMidi hostUsb;
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_PINS_ARDUINO_H
+#define HOST_PINS_ARDUINO_H
+
+#include <stdint.h>
+
+// Default SPI pins of the ESP32-S3.
+static const uint8_t SS   = 10;
+static const uint8_t MOSI = 11;
+static const uint8_t SCK  = 12;
+static const uint8_t MISO = 13;
+
+#endif
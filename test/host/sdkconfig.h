@@ -0,0 +1,2 @@
+// Host stand-in: the TinyUSB MIDI class is enabled, as in the device build.
+#define CONFIG_TINYUSB_MIDI_ENABLED 1
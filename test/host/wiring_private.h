@@ -0,0 +1,6 @@
+#ifndef HOST_WIRING_PRIVATE_H
+#define HOST_WIRING_PRIVATE_H
+
+// Included by Adafruit_ILI9341.cpp; nothing in it is used on the ESP32.
+
+#endif
@@ -0,0 +1,207 @@
+// BandRenderer end to end on the host: frames recorded through it go out
+// over the SPI DMA mock to a model ILI9341, and what lands on the panel
+// must match the same calls drawn straight into a full-frame GFXcanvas16,
+// in palette, band and direct mode.
+
+#define ESP32 1
+#define USE_SPI_DMA
+#include <unity.h>
+#include "host_log.h"
+#include "host_ili9341.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_ILI9341/Adafruit_ILI9341.cpp"
+#include "../../src/_band.cpp"
+#include <Fonts/FreeSans9pt7b.h>
+
+static const uint16_t GREY = 0x8410;
+
+// One display for the whole run, as on the device: Adafruit_ILI9341 keeps
+// the last address window in statics shared by all instances.
+static Adafruit_ILI9341 tft(TFT_CS, TFT_DC, TFT_RST);
+static HostPanel panel(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+// A renderer on the shared display, and a canvas that starts out as what
+// the panel shows.
+struct Rig {
+    BandRenderer band;
+    GFXcanvas16 reference;
+
+    Rig() : band(tft), reference(DISPLAY_WIDTH, DISPLAY_HEIGHT) {
+        memcpy(reference.getBuffer(), panel.fb.data(), panel.fb.size() * sizeof(uint16_t));
+    }
+
+    template <typename Draw> void frame(Draw draw) {
+        band.beginFrame();
+        draw(band);
+        band.endFrame();
+        draw(reference);
+        panel.update();
+    }
+
+    void assertPanelMatches() {
+        TEST_ASSERT_EQUAL(0, hostSpi.errors());
+        TEST_ASSERT_EQUAL(0, panel.outside);
+        const uint16_t *ref = reference.getBuffer();
+        for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+            for (int x = 0; x < DISPLAY_WIDTH; x++) {
+                if (panel.at(x, y) != ref[y * DISPLAY_WIDTH + x]) {
+                    char msg[80];
+                    snprintf(msg, sizeof(msg), "pixel %d,%d: panel 0x%04X, expected 0x%04X", x, y,
+                             panel.at(x, y), ref[y * DISPLAY_WIDTH + x]);
+                    TEST_FAIL_MESSAGE(msg);
+                }
+            }
+        }
+    }
+};
+
+// A screen's worth of the primitives the UI uses, with text and lines
+// crossing band edges.
+static void drawScreen(Adafruit_GFX &g) {
+    g.fillScreen(ILI9341_BLACK);
+    g.fillRect(0, 0, DISPLAY_WIDTH, 30, ILI9341_NAVY);
+    g.setFont(NULL);
+    g.setTextSize(2);
+    g.setTextColor(ILI9341_WHITE);
+    g.setCursor(10, 8);
+    g.print("Setlist: Live Set");
+    g.drawRect(5, BAND_HEIGHT - 3, 60, 35, ILI9341_YELLOW);
+    g.fillRoundRect(80, 50, 100, 40, 8, ILI9341_DARKGREEN);
+    g.drawRoundRect(80, 50, 100, 40, 8, ILI9341_WHITE);
+    g.drawLine(0, DISPLAY_HEIGHT - 1, DISPLAY_WIDTH - 1, 35, ILI9341_RED);
+    g.drawLine(200, 39, 319, 41, GREY);
+    g.drawCircle(260, 120, 30, ILI9341_CYAN);
+    g.fillTriangle(20, 200, 60, 150, 100, 210, ILI9341_MAGENTA);
+    for (int i = 0; i < 40; i++)
+        g.drawPixel(140 + i, 2 * BAND_HEIGHT + (i % 3) - 1, ILI9341_ORANGE);
+    g.setFont(&FreeSans9pt7b);
+    g.setTextSize(1);
+    g.setTextColor(ILI9341_GREENYELLOW);
+    g.setCursor(10, 6 * BAND_HEIGHT + 2);    // baseline just past a band edge
+    g.print("Song 12 of 48");
+    g.setFont(NULL);
+    g.setTextColor(ILI9341_BLACK, ILI9341_LIGHTGREY);   // opaque background
+    g.setTextWrap(true);
+    g.setCursor(250, 215);
+    g.print("wraps onto the next line");
+}
+
+void setUp() {
+    hostSpi.cpuDuringDma = hostSpi.pinDuringDma = hostSpi.overQueued = 0;
+    hostSpi.overwritten = hostSpi.reapedNothing = hostSpi.deselected = 0;
+    panel.outside = 0;
+    hostHeapCapsLimit = SIZE_MAX;
+}
+
+void tearDown() {}
+
+void test_palette_frame_matches_reference() {
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    TEST_ASSERT_TRUE(rig.band.paletteMode());
+    uint32_t before = hostSpi.dmaTransactions;
+    rig.frame(drawScreen);
+    rig.assertPanelMatches();
+    // Expansion buffers are DMA-capable, so each goes out as it is.
+    TEST_ASSERT_EQUAL(DISPLAY_WIDTH * DISPLAY_HEIGHT / PALETTE_EXPAND_PIXELS,
+                      hostSpi.dmaTransactions - before);
+}
+
+void test_band_frame_matches_reference() {
+    hostHeapCapsLimit = 32 * 1024;   // no room for the palette frame
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    TEST_ASSERT_FALSE(rig.band.paletteMode());
+    uint32_t before = hostSpi.dmaTransactions;
+    rig.frame(drawScreen);
+    rig.assertPanelMatches();
+    TEST_ASSERT_EQUAL(DISPLAY_HEIGHT / BAND_HEIGHT, rig.band.lastFrame().bands);
+    // One in-place transaction per strip: the strips are in DMA-capable RAM.
+    TEST_ASSERT_EQUAL(DISPLAY_HEIGHT / BAND_HEIGHT, hostSpi.dmaTransactions - before);
+}
+
+void test_frame_without_a_fill_draws_over_the_last() {
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    rig.frame(drawScreen);
+    rig.frame([](Adafruit_GFX &g) {
+        g.fillRect(100, 100, 50, 50, ILI9341_BLUE);
+        g.setCursor(0, 0);
+        g.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+        g.print("partial");
+    });
+    rig.assertPanelMatches();
+    TEST_ASSERT_EQUAL(1, rig.band.takeReport().direct);
+}
+
+void test_full_display_list_flushes_early() {
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    rig.frame([](Adafruit_GFX &g) {
+        g.fillScreen(ILI9341_DARKGREY);
+        for (int i = 0; i < BAND_MAX_OPS + 200; i++)
+            g.drawPixel(i % DISPLAY_WIDTH, i / DISPLAY_WIDTH * 7, (uint16_t)(i % 50 * 1311));
+    });
+    rig.assertPanelMatches();
+    BandReport r = rig.band.takeReport();
+    TEST_ASSERT_EQUAL(1, r.frames);
+    TEST_ASSERT_EQUAL(1, r.earlyFlushes);
+    TEST_ASSERT_EQUAL(1, r.direct);        // the part after the flush
+}
+
+void test_full_palette_is_counted_not_printed() {
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    int records = hostLogCount[LOG_LEVEL_WARN] + hostLogCount[LOG_LEVEL_ERROR];
+    rig.band.beginFrame();
+    rig.band.fillScreen(ILI9341_BLACK);
+    for (int i = 0; i < 300; i++)
+        rig.band.drawPixel(i, 100, (uint16_t)(i * 211 + 1));
+    rig.band.endFrame();
+    BandReport r = rig.band.takeReport();
+    TEST_ASSERT_EQUAL(300 - 255, r.paletteMisses);   // black holds the first entry
+    TEST_ASSERT_EQUAL(records, hostLogCount[LOG_LEVEL_WARN] + hostLogCount[LOG_LEVEL_ERROR]);
+    TEST_ASSERT_EQUAL(0, rig.band.takeReport().paletteMisses);
+}
+
+void test_report_keeps_the_worst_frame() {
+    Rig rig;
+    TEST_ASSERT_TRUE(rig.band.begin());
+    for (int i = 0; i < 3; i++)
+        rig.frame(drawScreen);
+    rig.band.printReport();
+    rig.frame([](Adafruit_GFX &g) { g.fillScreen(ILI9341_BLACK); });
+    BandReport r = rig.band.takeReport();
+    TEST_ASSERT_EQUAL(1, r.frames);
+    TEST_ASSERT_EQUAL(1, r.maxOps);
+    TEST_ASSERT_GREATER_THAN(0, r.maxPushUs);
+}
+
+void test_no_memory_draws_directly() {
+    hostHeapCapsLimit = 1024;
+    Rig rig;
+    TEST_ASSERT_FALSE(rig.band.begin());
+    TEST_ASSERT_FALSE(rig.band.ready());
+    rig.frame(drawScreen);
+    rig.assertPanelMatches();
+}
+
+int main() {
+    hostSpi.dcPin = TFT_DC;
+    hostSpi.csPin = TFT_CS;
+    hostPinHook = hostSpiPinHook;
+    tft.begin();
+    tft.setRotation(1);
+    panel.update();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_palette_frame_matches_reference);
+    RUN_TEST(test_band_frame_matches_reference);
+    RUN_TEST(test_frame_without_a_fill_draws_over_the_last);
+    RUN_TEST(test_full_display_list_flushes_early);
+    RUN_TEST(test_full_palette_is_counted_not_printed);
+    RUN_TEST(test_report_keeps_the_worst_frame);
+    RUN_TEST(test_no_memory_draws_directly);
+    return UNITY_END();
+}
@@ -0,0 +1,280 @@
+// The cue queue on the host, with the MIDI task run on the virtual clock:
+// cueNext() from the web server's side, auto-advance through a setlist at
+// each song's end, and how late a launch's Play SysEx reaches USB. Ableton
+// is modelled as a clock at 120 bpm from the start of the arrangement, so
+// the playhead walks from one song's locator into the next.
+
+#include <unity.h>
+#include <chrono>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_transport.cpp"
+#include "../../src/_progress.cpp"
+#include "../../src/_cue.cpp"
+#include "../../src/_preset.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_link.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+// No screen here: the link monitor's redraw requests go nowhere.
+void Render::request(uint32_t regions) {}
+
+static const int SONGS = 6;
+static const uint32_t SONG_MS = 8000;                   // four bars at 120 bpm
+static const uint32_t CLOCK_US = 60000000UL / (24 * 120);
+static const uint32_t STEP_US = 10;
+
+static uint64_t clockDueUs;          // next clock from Ableton, 0 while stopped
+static uint64_t songZeroUs;          // when the arrangement started
+static uint64_t nextPassUs;
+static std::vector<uint64_t> playSentUs;
+static std::vector<int> playIndices;
+static double launchCpuUs;
+
+static int songIndexOf(int track) { return 100 + 50 * track; }   // past 127 too
+
+static void loadSetlist(int count, int indexOffset) {
+  loadedPreset = Preset();
+  strcpy(loadedPreset.name, "Cue Set");
+  strcpy(loadedPreset.data.projectName, "Cue Project");
+  loadedPreset.data.songs.reserve(count);
+  for (int i = 0; i < count; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "Cue %d", i);
+    loadedPreset.data.songs[i].setName(name);
+    loadedPreset.data.songs[i].songIndex = songIndexOf(i) + indexOffset;
+    loadedPreset.data.songs[i].locatorMs = i * SONG_MS;
+  }
+  loadedPreset.data.songCount = count;
+  StateStore::presetLoaded();
+}
+
+// Play SysEx on the control cable since the last call, as song indices.
+static void collectPlays() {
+  static std::vector<uint8_t> sysex;
+  static const int bytes[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+  for (const HostUsbPacket &p : hostUsb.fromDevice) {
+    if ((p[0] >> 4) != (int)MidiPort::CONTROL)
+      continue;
+    for (int i = 0; i < bytes[p[0] & 0x0F]; i++) {
+      uint8_t b = p[1 + i];
+      if (b == 0xF0)
+        sysex.clear();
+      sysex.push_back(b);
+      if (b != 0xF7 || sysex.size() < 7 || sysex[4] != 0x01)
+        continue;
+      int index = sysex[5] | (sysex.size() == 8 ? sysex[6] << 7 : 0);
+      playIndices.push_back(index);
+      playSentUs.push_back(hostNowUs);
+    }
+  }
+  hostUsb.fromDevice.clear();
+}
+
+// One pass of midiTask() in main.cpp.
+static void midiPass() {
+  CueQueue::update();
+  Midi::read();
+  Midi::applyState();
+  Midi::flush();
+  collectPlays();
+}
+
+// Runs the MIDI task for ms: a pass every poll period, and one at once when
+// the cue timer notifies it, as the notification wakes the task on the
+// device. Ableton's clocks are read the moment they are due.
+static void runFor(uint32_t ms) {
+  uint64_t end = hostNowUs + ms * 1000ULL;
+  while (hostNowUs < end) {
+    hostAdvanceUs(STEP_US);
+    if (clockDueUs && hostNowUs >= clockDueUs) {
+      Transport::clock(micros());
+      clockDueUs += CLOCK_US;
+    }
+    hostRunTimers();
+    if (timerFired) {
+      auto t0 = std::chrono::steady_clock::now();
+      midiPass();
+      launchCpuUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    } else if (hostNowUs >= nextPassUs) {
+      midiPass();
+    }
+    if (hostNowUs >= nextPassUs)
+      nextPassUs += MIDI_POLL_MS * 1000;
+  }
+}
+
+// The user presses Start on track 0; Ableton follows with Start and clocks.
+static void startPlaying() {
+  for (int i = 0; i < 48; i++) {       // tempo known before Start
+    Transport::clock(micros());
+    hostAdvanceUs(CLOCK_US);
+  }
+  TEST_ASSERT_TRUE(StateStore::play());
+  midiPass();
+  Transport::start();
+  songZeroUs = hostNowUs;
+  clockDueUs = hostNowUs;
+}
+
+static void stopPlaying() {
+  StateStore::stop();
+  Transport::stop();
+  clockDueUs = 0;
+  runFor(5);
+}
+
+void setUp() {
+  stopPlaying();
+  Transport::reset();
+  StateStore::setTrack(0);
+  loadSetlist(SONGS, 0);
+  runFor(5);
+  playIndices.clear();
+  playSentUs.clear();
+  launchCpuUs = 0;
+}
+
+void tearDown() {}
+
+// Web server side: each cue follows the last queued one, up to the depth
+// and the end of the setlist, and carries its song's Play.
+void test_cue_next_queues_following_songs() {
+  for (int i = 1; i <= CUE_QUEUE_DEPTH; i++)
+    TEST_ASSERT_TRUE(CueQueue::cueNext());
+  TEST_ASSERT_FALSE(CueQueue::cueNext());
+  AppState state = StateStore::get();
+  TEST_ASSERT_EQUAL(1, state.cued);
+  TEST_ASSERT_EQUAL(CUE_QUEUE_DEPTH, state.cueDepth);
+  for (int i = 0; i < CUE_QUEUE_DEPTH; i++) {
+    TEST_ASSERT_EQUAL(i + 1, queue[i].track);
+    TEST_ASSERT_EQUAL(songIndexOf(i + 1) & 0x7F, queue[i].sysex[5]);
+  }
+
+  while (CueQueue::cancelLast()) {}
+  TEST_ASSERT_EQUAL(-1, StateStore::get().cued);
+  StateStore::setTrack(SONGS - 2);
+  TEST_ASSERT_TRUE(CueQueue::cueNext());
+  TEST_ASSERT_FALSE(CueQueue::cueNext());     // no song after the last
+  CueQueue::cancelLast();
+}
+
+// The loop replaces loadedPreset, freeing its songs, before it calls
+// presetLoaded(). Cues and Play in that window still use the songs the
+// store resolved, and nothing reads the freed storage (ASan).
+void test_cues_and_play_survive_a_preset_swap() {
+  loadedPreset = Preset();
+  loadedPreset.data.songCount = 0;
+  TEST_ASSERT_TRUE(CueQueue::cueNext());
+  TEST_ASSERT_EQUAL(songIndexOf(1) - 128, queue[0].sysex[5]);
+  TEST_ASSERT_EQUAL(1, queue[0].sysex[6]);
+  TEST_ASSERT_TRUE(StateStore::play());
+  midiPass();
+  TEST_ASSERT_EQUAL(1, playIndices.size());
+  TEST_ASSERT_EQUAL(songIndexOf(0), playIndices[0]);
+  stopPlaying();
+
+  // Once the new preset is published, cues are dropped and use its songs.
+  loadSetlist(SONGS, 1000);
+  TEST_ASSERT_TRUE(CueQueue::cueNext());
+  runFor(5);
+  TEST_ASSERT_EQUAL(0, StateStore::get().cueDepth);
+  TEST_ASSERT_TRUE(CueQueue::cueNext());
+  TEST_ASSERT_EQUAL(1, queue[0].track);
+  TEST_ASSERT_EQUAL((songIndexOf(1) + 1000) & 0x7F, queue[0].sysex[5]);
+  CueQueue::cancelLast();
+}
+
+// With auto-advance each song cues the next, which launches at the song's
+// end: one Play per song, in order, without a second Play from the state
+// change, until the last song has nothing after it.
+void test_auto_advance_plays_through_the_setlist() {
+  uint32_t before = CueQueue::stats().launched;
+  startPlaying();
+  runFor(SONGS * SONG_MS + 2000);
+  TEST_ASSERT_EQUAL(SONGS, playIndices.size());
+  for (int i = 0; i < SONGS; i++)
+    TEST_ASSERT_EQUAL(songIndexOf(i), playIndices[i]);
+  AppState state = StateStore::get();
+  TEST_ASSERT_EQUAL(SONGS - 1, state.track);
+  TEST_ASSERT_TRUE(state.playing);
+  TEST_ASSERT_EQUAL(0, state.cueDepth);
+  TEST_ASSERT_EQUAL(SONGS - 1, CueQueue::stats().launched - before);
+}
+
+// A cue the user drops stays dropped: the song plays on past its end.
+void test_dropped_auto_cue_is_not_requeued() {
+  startPlaying();
+  runFor(5);
+  TEST_ASSERT_EQUAL(1, StateStore::get().cueDepth);
+  TEST_ASSERT_TRUE(CueQueue::cancelLast());
+  runFor(SONG_MS + 1000);
+  TEST_ASSERT_EQUAL(1, playIndices.size());
+  TEST_ASSERT_EQUAL(0, StateStore::get().track);
+}
+
+// How far each launch's Play reaches USB from the true end of its song
+// (Ableton's playhead reaching the next locator), and from the target the
+// cue queue computed from the PLL. The one-shot timer is compared with the
+// fallback without one, which launches from the last 1 ms poll before the
+// target.
+void test_launch_latency() {
+  struct Run { const char *how; int32_t avgUs, maxUs; } runs[2];
+  for (int r = 0; r < 2; r++) {
+    setUp();
+    esp_timer_handle_t timer = launchTimer;
+    if (r == 1)
+      launchTimer = NULL;
+    uint32_t before = launched;
+    uint64_t totalBefore = totalLateUs;
+    startPlaying();
+    runFor(SONGS * SONG_MS + 2000);
+    launchTimer = timer;
+
+    TEST_ASSERT_EQUAL(SONGS, playSentUs.size());
+    int64_t total = 0, worst = 0;
+    for (int i = 1; i < SONGS; i++) {
+      int64_t off = (int64_t)(playSentUs[i] - songZeroUs) - (int64_t)i * SONG_MS * 1000;
+      off = off < 0 ? -off : off;
+      total += off;
+      worst = off > worst ? off : worst;
+    }
+    runs[r] = { r ? "1 ms poll" : "timer", (int32_t)(total / (SONGS - 1)), (int32_t)worst };
+
+    char line[128];
+    if (r == 0) {
+      uint32_t count = launched - before;
+      snprintf(line, sizeof(line), "timer: target to USB avg %lu us, launch pass %.1f us CPU per cue",
+               (unsigned long)((totalLateUs - totalBefore) / count), launchCpuUs / count);
+      TEST_MESSAGE(line);
+      TEST_ASSERT_LESS_OR_EQUAL(STEP_US, maxLateUs);
+    }
+    snprintf(line, sizeof(line), "%-9s: song end to USB avg %ld us, max %ld us off", runs[r].how,
+             (long)runs[r].avgUs, (long)runs[r].maxUs);
+    TEST_MESSAGE(line);
+  }
+  // Sub-millisecond from the timer. Without it a launch may come a poll
+  // early, on top of the target being known to the millisecond.
+  TEST_ASSERT_LESS_THAN(1000, runs[0].maxUs);
+  TEST_ASSERT_LESS_OR_EQUAL(2 * MIDI_POLL_MS * 1000, runs[1].maxUs);
+  TEST_ASSERT_LESS_THAN(runs[1].avgUs, runs[0].avgUs);
+}
+
+int main() {
+  hostSerialQuiet = true;
+  hostAdvanceUs(1000000);
+  Midi::begin();
+  CueQueue::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_cue_next_queues_following_songs);
+  RUN_TEST(test_cues_and_play_survive_a_preset_swap);
+  RUN_TEST(test_auto_advance_plays_through_the_setlist);
+  RUN_TEST(test_dropped_auto_cue_is_not_requeued);
+  RUN_TEST(test_launch_latency);
+  return UNITY_END();
+}
@@ -0,0 +1,284 @@
+// Input record and replay on the host. A session recorded through InputLog
+// must read back the same on replay, and a log replayed through the real
+// Input handlers and UI, with main's loop around them, must drive the
+// screens and the state store as the live input would, faster than real
+// time.
+
+#define ESP32 1
+#define USE_SPI_DMA
+#include <unity.h>
+#include "host_log.h"
+#include "host_ili9341.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_ILI9341/Adafruit_ILI9341.cpp"
+#include "../../lib/XPT2046_Touchscreen/XPT2046_Touchscreen.cpp"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_render.cpp"
+#include "../../src/_spibus.cpp"
+#include "../../src/_band.cpp"
+#include "../../src/_ui.cpp"
+#include "../../src/_input.cpp"
+#include "../../src/_inputlog.cpp"
+#include "../../src/_tour.cpp"
+#include "../../src/_preset.cpp"
+#include "../../src/_progress.cpp"
+#include "../../src/_transport.cpp"
+#include "../../src/_link.cpp"
+#include "../../src/_cue.cpp"
+#include "../../src/_tasks.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+static UI ui;
+static Input input(ui.getTouchscreen(), ui.getDisplay(), &ui);
+static HostPanel panel(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+// main.cpp's loop() without the web server and the reports.
+static void runHandler(InputHandler id, void (Input::*handler)()) {
+    unsigned long start = micros();
+    (input.*handler)();
+    InputLog::profile(id, micros() - start);
+}
+
+static void loopPass() {
+    {
+        Render::Lock lock;
+        runHandler(InputHandler::TOUCH, &Input::handleTouch);
+        runHandler(InputHandler::ROTARY, &Input::handleRotary);
+        runHandler(InputHandler::START, &Input::StartButton);
+        runHandler(InputHandler::STOP, &Input::StopButton);
+        runHandler(InputHandler::LEFT, &Input::LeftButton);
+        runHandler(InputHandler::RIGHT, &Input::RightButton);
+        runHandler(InputHandler::VOLUME, &Input::handleVolume);
+        ui.checkWifiConnection();
+    }
+    InputLog::update();
+    InputLog::sleep(LOOP_SLEEP_MS);
+    panel.update();
+}
+
+static InputEvent pinEvent(uint32_t t, uint8_t pin, int level) {
+    return { t, (uint8_t)InputEventKind::PIN, pin, (int16_t)level, 0, 0 };
+}
+
+static InputEvent analogEvent(uint32_t t, uint8_t pin, int value) {
+    return { t, (uint8_t)InputEventKind::ANALOG, pin, (int16_t)value, 0, 0 };
+}
+
+static InputEvent touchEvent(uint32_t t, int x, int y) {
+    return { t, (uint8_t)InputEventKind::TOUCH, 0, (int16_t)x, (int16_t)y, 0 };
+}
+
+static InputEvent releaseEvent(uint32_t t) {
+    return { t, (uint8_t)InputEventKind::RELEASE, 0, 0, 0, 0 };
+}
+
+// A press of a pull-up button: low at t, high again after ms.
+static void press(std::vector<InputEvent> &log, uint32_t t, uint8_t pin, uint32_t ms = 80) {
+    log.push_back(pinEvent(t, pin, LOW));
+    log.push_back(pinEvent(t + ms, pin, HIGH));
+}
+
+static void writeLog(const std::vector<InputEvent> &events) {
+    File f = LittleFS.open(INPUT_LOG_PATH, "w");
+    f.write((const uint8_t *)"INP1", 4);
+    f.write((const uint8_t *)events.data(), events.size() * sizeof(InputEvent));
+    f.close();
+}
+
+// Loop passes until the replay ends by itself.
+static int replayToEnd() {
+    int passes = 0;
+    while (InputLog::mode() == InputMode::REPLAY && passes < 1000000) {
+        loopPass();
+        passes++;
+    }
+    TEST_ASSERT_EQUAL(InputMode::LIVE, InputLog::mode());
+    return passes;
+}
+
+void setUp() {
+    for (uint8_t pin : { BTN_START, BTN_STOP, BTN_LEFT, BTN_RIGHT, ENC_CLK, ENC_DT, ENC_SW })
+        hostPinLevel[pin] = HIGH;
+    hostAnalogLevel[POT_VOL] = 0;
+}
+
+void tearDown() {
+    InputLog::stop();
+}
+
+void test_recorded_session_replays_the_same_reads() {
+    const int passes = 300;
+    std::vector<std::array<int, 3>> recorded;
+    int changes = 0, last[3] = { -1, -1, -1 };
+
+    TEST_ASSERT_TRUE(InputLog::begin(InputMode::RECORD));
+    for (int pass = 0; pass < passes; pass++) {
+        hostPinLevel[BTN_START] = (pass / 37) % 2 ? LOW : HIGH;
+        hostPinLevel[ENC_CLK] = (pass / 5) % 2;
+        // ADC noise inside the deadband, and one real move.
+        hostAnalogLevel[POT_VOL] = 2000 + pass * 7 % 5 - 2 + (pass >= 150 ? 1000 : 0);
+        std::array<int, 3> reads = { InputLog::readPin(BTN_START), InputLog::readPin(ENC_CLK),
+                                     InputLog::readAnalog(POT_VOL) };
+        recorded.push_back(reads);
+        for (int i = 0; i < 3; i++) {
+            changes += reads[i] != last[i];
+            last[i] = reads[i];
+        }
+        InputLog::update();
+        InputLog::sleep(LOOP_SLEEP_MS);
+    }
+    InputLog::stop();
+    TEST_ASSERT_EQUAL(recorded[0][2], recorded[149][2]);   // noise isn't a move
+    TEST_ASSERT_INT_WITHIN(INPUT_ADC_DEADBAND, 3000, recorded[150][2]);
+    TEST_ASSERT_EQUAL(4 + changes * sizeof(InputEvent), LittleFS.open(INPUT_LOG_PATH).size());
+
+    // The hardware now reads something else; the replay must not see it.
+    hostPinLevel[BTN_START] = LOW;
+    hostAnalogLevel[POT_VOL] = 17;
+    TEST_ASSERT_TRUE(InputLog::begin(InputMode::REPLAY));
+    for (int pass = 0; pass < passes; pass++) {
+        TEST_ASSERT_EQUAL(recorded[pass][0], InputLog::readPin(BTN_START));
+        TEST_ASSERT_EQUAL(recorded[pass][1], InputLog::readPin(ENC_CLK));
+        TEST_ASSERT_EQUAL(recorded[pass][2], InputLog::readAnalog(POT_VOL));
+        InputLog::update();
+        InputLog::sleep(LOOP_SLEEP_MS);
+    }
+    TEST_ASSERT_EQUAL(InputMode::REPLAY, InputLog::mode());
+    int settle = 0;
+    while (InputLog::mode() == InputMode::REPLAY && settle++ < 200) {
+        InputLog::update();
+        InputLog::sleep(LOOP_SLEEP_MS);
+    }
+    // Stops a second after the last event.
+    TEST_ASSERT_INT_WITHIN(2, 1000 / LOOP_SLEEP_MS, settle);
+}
+
+void test_missing_or_foreign_log_is_refused() {
+    LittleFS.remove(INPUT_LOG_PATH);
+    TEST_ASSERT_FALSE(InputLog::begin(InputMode::REPLAY));
+    File f = LittleFS.open(INPUT_LOG_PATH, "w");
+    f.write((const uint8_t *)"JUNK", 4);
+    f.close();
+    TEST_ASSERT_FALSE(InputLog::begin(InputMode::REPLAY));
+    TEST_ASSERT_EQUAL(InputMode::LIVE, InputLog::mode());
+}
+
+// Touch, encoder, buttons and the pot, through the real handlers.
+void test_replay_drives_screens_and_state() {
+    ui.setScreenState(ScreenState::HOME);
+    StateStore::stop();
+    StateStore::setTrack(0);
+    currentMenuItem = 0;
+
+    std::vector<InputEvent> log;
+    log.push_back(touchEvent(100, BOX1_X + 10, BOX1_Y + 10));   // HOME: menu box 1
+    log.push_back(releaseEvent(160));
+    // Two encoder steps forward: CLK falls with DT high, rises with DT low.
+    log.push_back(pinEvent(400, ENC_CLK, LOW));
+    log.push_back(pinEvent(420, ENC_DT, LOW));
+    log.push_back(pinEvent(440, ENC_CLK, HIGH));
+    log.push_back(pinEvent(460, ENC_DT, HIGH));
+    log.push_back(touchEvent(600, 50, 60 + 4 * 30 + 10));   // MENU1: the last item, home
+    log.push_back(releaseEvent(650));
+    press(log, 800, BTN_RIGHT);         // stopped: next track
+    log.push_back(analogEvent(1000, POT_VOL, 4095));
+    press(log, 1200, BTN_START);
+    press(log, 1500, BTN_RIGHT);        // playing: cue the next song
+    press(log, 2000, BTN_STOP);
+    writeLog(log);
+
+    TEST_ASSERT_TRUE(InputLog::begin(InputMode::REPLAY));
+    bool sawMenu1 = false, sawPlaying = false;
+    int menuItem = -1, cued = -1;
+    while (InputLog::mode() == InputMode::REPLAY) {
+        loopPass();
+        AppState state = StateStore::get();
+        if (ui.getScreenState() == ScreenState::MENU1) {
+            sawMenu1 = true;
+            menuItem = currentMenuItem;
+        }
+        if (state.playing) {
+            sawPlaying = true;
+            cued = state.cued;
+        }
+    }
+
+    TEST_ASSERT_TRUE(sawMenu1);
+    TEST_ASSERT_EQUAL(2, menuItem);
+    TEST_ASSERT_EQUAL(ScreenState::HOME, ui.getScreenState());
+    TEST_ASSERT_TRUE(sawPlaying);
+    TEST_ASSERT_EQUAL(2, cued);          // the song after track 1
+    AppState state = StateStore::get();
+    TEST_ASSERT_FALSE(state.playing);
+    TEST_ASSERT_EQUAL(1, state.track);
+    TEST_ASSERT_EQUAL(127, state.volume);
+    TEST_ASSERT_EQUAL(0, hostSpi.errors());
+}
+
+// Ten minutes of input replay in a fraction of that on the clock the
+// handlers see, and every handler is timed on every pass.
+void test_long_session_replays_faster_than_real_time() {
+    ui.setScreenState(ScreenState::HOME);
+    std::vector<InputEvent> log;
+    const uint32_t sessionMs = 10 * 60 * 1000;
+    uint32_t seed = 1;
+    for (uint32_t t = 500; t < sessionMs; t += 250) {
+        seed = seed * 1103515245UL + 12345UL;
+        switch ((seed >> 16) % 4) {
+            case 0: log.push_back(analogEvent(t, POT_VOL, (seed >> 4) % 4096)); break;
+            case 1: press(log, t, BTN_LEFT); break;
+            case 2: press(log, t, BTN_RIGHT); break;
+            case 3:
+                log.push_back(pinEvent(t, ENC_CLK, LOW));
+                log.push_back(pinEvent(t + 20, ENC_CLK, HIGH));
+                break;
+        }
+    }
+    writeLog(log);
+
+    TEST_ASSERT_TRUE(InputLog::begin(InputMode::REPLAY));
+    uint64_t startUs = hostNowUs;
+    int passes = replayToEnd();
+    uint64_t elapsedMs = (hostNowUs - startUs) / 1000;
+
+    TEST_ASSERT_INT_WITHIN(1000 / LOOP_SLEEP_MS + 2, (sessionMs + 1000) / LOOP_SLEEP_MS, passes);
+    TEST_ASSERT_LESS_THAN(sessionMs / 2, elapsedMs);
+    for (int h = 0; h < (int)InputHandler::COUNT; h++)
+        TEST_ASSERT_EQUAL(passes, InputLog::stats((InputHandler)h).calls);
+
+    char line[120];
+    snprintf(line, sizeof(line), "%lu ms of input in %lu ms, %d passes", (unsigned long)sessionMs,
+             (unsigned long)elapsedMs, passes);
+    TEST_MESSAGE(line);
+    static const char *const names[] = { "touch", "rotary", "start", "stop", "left", "right", "volume" };
+    for (int h = 0; h < (int)InputHandler::COUNT; h++) {
+        const InputHandlerStats &s = InputLog::stats((InputHandler)h);
+        snprintf(line, sizeof(line), "%-7s avg %5lu us  max %6lu us", names[h],
+                 (unsigned long)(s.totalUs / s.calls), (unsigned long)s.maxUs);
+        TEST_MESSAGE(line);
+    }
+}
+
+int main() {
+    hostSpi.dcPin = TFT_DC;
+    hostSpi.csPin = TFT_CS;
+    hostPinHook = hostSpiPinHook;
+    Render::begin(ui);
+    ui.init();
+    ScreenTour::loadFixtures();   // a six-song setlist to step through and cue
+    panel.update();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_recorded_session_replays_the_same_reads);
+    RUN_TEST(test_missing_or_foreign_log_is_refused);
+    RUN_TEST(test_replay_drives_screens_and_state);
+    RUN_TEST(test_long_session_replays_faster_than_real_time);
+    return UNITY_END();
+}
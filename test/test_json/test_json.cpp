@@ -0,0 +1,514 @@
+// JsonWriter on the host. Documents built at random, with random bytes in
+// every string, must parse back to what was written with a strict parser,
+// give valid UTF-8, and stay inside the buffer however small it is. The
+// benchmark writes preset broadcasts of 50, 500 and 5,000 songs, against
+// the String concatenation the writer replaced.
+
+#include <unity.h>
+#include <chrono>
+#include <climits>
+#include <string>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_json.cpp"
+
+// Heap allocations through new, which String makes for every temporary and
+// every growth.
+static size_t heapAllocs = 0;
+
+void *operator new(size_t size) {
+  heapAllocs++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// A parsed value, or the document the test meant to write.
+struct Value {
+  enum Type { OBJECT, ARRAY, STRING, NUMBER, BOOLEAN } type;
+  std::string text;                 // STRING: decoded bytes
+  long number = 0;                  // NUMBER and BOOLEAN
+  std::vector<std::string> keys;    // OBJECT
+  std::vector<Value> items;         // OBJECT and ARRAY
+};
+
+// Well-formed UTF-8 after the Unicode standard's table of byte ranges.
+static bool validUtf8(const std::string &s) {
+  const uint8_t *p = (const uint8_t *)s.data(), *end = p + s.size();
+  while (p < end) {
+    uint8_t c = *p;
+    int n;
+    uint8_t lo = 0x80, hi = 0xBF;
+    if (c < 0x80) {
+      p++;
+      continue;
+    } else if (c >= 0xC2 && c <= 0xDF) {
+      n = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      n = 2;
+      if (c == 0xE0) lo = 0xA0;
+      if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      n = 3;
+      if (c == 0xF0) lo = 0x90;
+      if (c == 0xF4) hi = 0x8F;
+    } else {
+      return false;
+    }
+    if (end - p <= n || p[1] < lo || p[1] > hi)
+      return false;
+    for (int i = 2; i <= n; i++) {
+      if (p[i] < 0x80 || p[i] > 0xBF)
+        return false;
+    }
+    p += n + 1;
+  }
+  return true;
+}
+
+// Strict RFC 8259 parser for what the writer produces: no whitespace, no
+// floats, no null. Fails the test on anything else.
+class Parser {
+public:
+  Parser(const std::string &s) : p(s.c_str()), end(s.c_str() + s.size()) {}
+
+  Value document() {
+    Value v = value();
+    TEST_ASSERT_TRUE_MESSAGE(p == end, "trailing bytes");
+    return v;
+  }
+
+private:
+  const char *p, *end;
+
+  char next() {
+    TEST_ASSERT_TRUE_MESSAGE(p < end, "unexpected end");
+    return *p++;
+  }
+
+  void expect(char c) {
+    char got = next();
+    if (got != c) {
+      char msg[40];
+      snprintf(msg, sizeof(msg), "expected '%c', got 0x%02x", c, (uint8_t)got);
+      TEST_FAIL_MESSAGE(msg);
+    }
+  }
+
+  Value value() {
+    TEST_ASSERT_TRUE_MESSAGE(p < end, "unexpected end");
+    Value v;
+    if (*p == '{') {
+      v.type = Value::OBJECT;
+      p++;
+      if (*p == '}') {
+        p++;
+        return v;
+      }
+      do {
+        v.keys.push_back(string());
+        expect(':');
+        v.items.push_back(value());
+      } while (p < end && *p == ',' && p++);
+      expect('}');
+    } else if (*p == '[') {
+      v.type = Value::ARRAY;
+      p++;
+      if (*p == ']') {
+        p++;
+        return v;
+      }
+      do {
+        v.items.push_back(value());
+      } while (p < end && *p == ',' && p++);
+      expect(']');
+    } else if (*p == '"') {
+      v.type = Value::STRING;
+      v.text = string();
+    } else if (*p == 't' || *p == 'f') {
+      v.type = Value::BOOLEAN;
+      v.number = *p == 't';
+      const char *word = v.number ? "true" : "false";
+      for (const char *w = word; *w; w++)
+        expect(*w);
+    } else {
+      v.type = Value::NUMBER;
+      bool negative = *p == '-' && p++;
+      TEST_ASSERT_TRUE_MESSAGE(p < end && *p >= '0' && *p <= '9', "bad number");
+      TEST_ASSERT_FALSE_MESSAGE(*p == '0' && p + 1 < end && p[1] >= '0' && p[1] <= '9', "leading zero");
+      unsigned long magnitude = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        magnitude = magnitude * 10 + (*p++ - '0');
+      v.number = negative ? (long)(0 - magnitude) : (long)magnitude;
+    }
+    return v;
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    TEST_FAIL_MESSAGE("bad \\u escape");
+    return 0;
+  }
+
+  std::string string() {
+    std::string s;
+    expect('"');
+    for (;;) {
+      uint8_t c = next();
+      if (c == '"')
+        return s;
+      TEST_ASSERT_TRUE_MESSAGE(c >= 0x20, "raw control character");
+      if (c != '\\') {
+        s += (char)c;
+        continue;
+      }
+      switch (next()) {
+        case '"': s += '"'; break;
+        case '\\': s += '\\'; break;
+        case '/': s += '/'; break;
+        case 'b': s += '\b'; break;
+        case 'f': s += '\f'; break;
+        case 'n': s += '\n'; break;
+        case 'r': s += '\r'; break;
+        case 't': s += '\t'; break;
+        case 'u': {
+          unsigned cp = 0;
+          for (int i = 0; i < 4; i++)
+            cp = cp << 4 | hexDigit(next());
+          TEST_ASSERT_FALSE_MESSAGE(cp >= 0xD800 && cp <= 0xDFFF, "surrogate escape");
+          if (cp < 0x80) {
+            s += (char)cp;
+          } else if (cp < 0x800) {
+            s += (char)(0xC0 | cp >> 6);
+            s += (char)(0x80 | (cp & 0x3F));
+          } else {
+            s += (char)(0xE0 | cp >> 12);
+            s += (char)(0x80 | (cp >> 6 & 0x3F));
+            s += (char)(0x80 | (cp & 0x3F));
+          }
+          break;
+        }
+        default:
+          TEST_FAIL_MESSAGE("bad escape");
+      }
+    }
+  }
+};
+
+static void assertSame(const Value &expected, const Value &actual) {
+  TEST_ASSERT_EQUAL(expected.type, actual.type);
+  TEST_ASSERT_EQUAL(expected.number, actual.number);
+  TEST_ASSERT_TRUE(expected.text == actual.text);
+  TEST_ASSERT_EQUAL(expected.items.size(), actual.items.size());
+  TEST_ASSERT_TRUE(expected.keys == actual.keys);
+  for (size_t i = 0; i < expected.items.size(); i++)
+    assertSame(expected.items[i], actual.items[i]);
+}
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 8) % range;
+}
+
+static void appendUtf8(std::string &s, uint32_t cp) {
+  if (cp < 0x80) {
+    s += (char)cp;
+  } else if (cp < 0x800) {
+    s += (char)(0xC0 | cp >> 6);
+    s += (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    s += (char)(0xE0 | cp >> 12);
+    s += (char)(0x80 | (cp >> 6 & 0x3F));
+    s += (char)(0x80 | (cp & 0x3F));
+  } else {
+    s += (char)(0xF0 | cp >> 18);
+    s += (char)(0x80 | (cp >> 12 & 0x3F));
+    s += (char)(0x80 | (cp >> 6 & 0x3F));
+    s += (char)(0x80 | (cp & 0x3F));
+  }
+}
+
+// Valid UTF-8 from every range, with the characters JSON has to escape.
+static std::string randomText() {
+  std::string s;
+  int n = nextRandom(12);
+  for (int i = 0; i < n; i++) {
+    switch (nextRandom(6)) {
+      case 0: s += "\"\\/\b\f\n\r\t\x01\x1f\x7f"[nextRandom(11)]; break;
+      case 1: appendUtf8(s, 0x80 + nextRandom(0x800 - 0x80)); break;
+      case 2: {
+        uint32_t cp = 0x800 + nextRandom(0x10000 - 0x800);
+        appendUtf8(s, cp >= 0xD800 && cp <= 0xDFFF ? 0xFFFD : cp);
+        break;
+      }
+      case 3: appendUtf8(s, 0x10000 + nextRandom(0x110000 - 0x10000)); break;
+      default: s += (char)(0x20 + nextRandom(0x5F)); break;
+    }
+  }
+  return s;
+}
+
+// Writes a random value at depth and returns what it should parse to.
+static Value writeRandom(JsonWriter &w, const char *key, int depth) {
+  Value v;
+  int kind = depth >= 6 ? 2 + nextRandom(3) : nextRandom(5);
+  if (kind == 0 || kind == 1) {
+    v.type = kind == 0 ? Value::OBJECT : Value::ARRAY;
+    kind == 0 ? w.beginObject(key) : w.beginArray(key);
+    int n = nextRandom(5);
+    for (int i = 0; i < n; i++) {
+      std::string k = randomText();
+      if (v.type == Value::OBJECT)
+        v.keys.push_back(k);
+      v.items.push_back(writeRandom(w, v.type == Value::OBJECT ? k.c_str() : nullptr, depth + 1));
+    }
+    kind == 0 ? w.endObject() : w.endArray();
+  } else if (kind == 2) {
+    v.type = Value::STRING;
+    v.text = randomText();
+    w.string(key, v.text.c_str());
+  } else if (kind == 3) {
+    v.type = Value::NUMBER;
+    static const long edges[] = { 0, -1, 1, LONG_MIN, LONG_MAX };
+    v.number = nextRandom(4) ? (long)(nextRandom(2000001)) - 1000000 : edges[nextRandom(5)];
+    w.number(key, v.number);
+  } else {
+    v.type = Value::BOOLEAN;
+    v.number = nextRandom(2);
+    w.boolean(key, v.number);
+  }
+  return v;
+}
+
+static std::string written(const char *buf, const JsonWriter &w) {
+  TEST_ASSERT_FALSE(w.overflowed());
+  return std::string(buf, w.length());
+}
+
+void setUp() {
+  seed = 12345;
+}
+
+void tearDown() {}
+
+void test_escapes() {
+  char buf[128];
+  JsonWriter w(buf, sizeof(buf));
+  w.beginObject();
+  w.string("a\"b", "q\"\\/\n\r\t\b\f\x01\x1f");
+  w.string("n", nullptr);
+  w.endObject();
+  TEST_ASSERT_EQUAL_STRING("{\"a\\\"b\":\"q\\\"\\\\/\\n\\r\\t\\b\\f\\u0001\\u001f\",\"n\":\"\"}",
+                           written(buf, w).c_str());
+}
+
+void test_invalid_utf8_becomes_replacement() {
+  // Lone continuation, overlong '/', surrogate, past U+10FFFF, truncated
+  // 3-byte sequence at the end.
+  static const char *const bad[] = { "\x80", "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "a\xE2\x82" };
+  static const char *const expected[] = { "\"\\ufffd\"", "\"\\ufffd\\ufffd\"", "\"\\ufffd\\ufffd\\ufffd\"",
+                                          "\"\\ufffd\\ufffd\\ufffd\\ufffd\"", "\"a\\ufffd\\ufffd\"" };
+  for (int i = 0; i < 5; i++) {
+    char buf[64];
+    JsonWriter w(buf, sizeof(buf));
+    w.string(nullptr, bad[i]);
+    TEST_ASSERT_EQUAL_STRING(expected[i], written(buf, w).c_str());
+  }
+  char buf[64];
+  JsonWriter w(buf, sizeof(buf));
+  w.string(nullptr, "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x8E\xB9");   // e-acute, euro, keyboard
+  TEST_ASSERT_EQUAL_STRING("\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x8E\xB9\"", written(buf, w).c_str());
+}
+
+// Random documents of valid text parse back to exactly what was written.
+void test_random_documents_round_trip() {
+  for (int i = 0; i < 2000; i++) {
+    uint32_t docSeed = seed;
+    JsonWriter counter;
+    writeRandom(counter, nullptr, 0);
+    std::vector<char> buf(counter.length());
+    seed = docSeed;
+    JsonWriter w(buf.data(), buf.size());
+    Value expected = writeRandom(w, nullptr, 0);
+    TEST_ASSERT_EQUAL(counter.length(), w.length());
+    std::string json = written(buf.data(), w);
+    TEST_ASSERT_TRUE(validUtf8(json));
+    Parser parser(json);
+    assertSame(expected, parser.document());
+  }
+}
+
+// Random bytes in keys and values: always parses and is valid UTF-8, and no
+// ASCII byte of the input is lost to a replacement.
+void test_random_bytes_stay_valid() {
+  for (int i = 0; i < 20000; i++) {
+    std::string bytes;
+    int n = 1 + nextRandom(16);
+    for (int j = 0; j < n; j++)
+      bytes += (char)(1 + nextRandom(255));
+    char buf[256];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    w.string(bytes.c_str(), bytes.c_str());
+    w.endObject();
+    std::string json = written(buf, w);
+    TEST_ASSERT_TRUE(validUtf8(json));
+    Parser parser(json);
+    Value v = parser.document();
+    TEST_ASSERT_TRUE(v.keys[0] == v.items[0].text);
+
+    std::string asciiIn, asciiOut;
+    for (char c : bytes)
+      if ((uint8_t)c < 0x80) asciiIn += c;
+    for (char c : v.keys[0])
+      if ((uint8_t)c < 0x80) asciiOut += c;
+    TEST_ASSERT_TRUE(asciiIn == asciiOut);
+  }
+}
+
+// Every buffer size short of the document: exactly the bytes that fit are
+// written, nothing past them (the buffer is exactly sized for ASan), and the
+// length still reports what a full write needs.
+void test_truncated_buffers() {
+  for (int i = 0; i < 200; i++) {
+    uint32_t docSeed = seed;
+    JsonWriter counter;
+    writeRandom(counter, nullptr, 0);
+    size_t len = counter.length();
+    std::vector<char> full(len);
+    seed = docSeed;
+    JsonWriter fw(full.data(), len);
+    writeRandom(fw, nullptr, 0);
+    TEST_ASSERT_FALSE(fw.overflowed());
+    for (size_t cap = 0; cap < len; cap++) {
+      char *buf = (char *)malloc(cap ? cap : 1);
+      seed = docSeed;
+      JsonWriter w(buf, cap);
+      writeRandom(w, nullptr, 0);
+      TEST_ASSERT_TRUE(w.overflowed());
+      TEST_ASSERT_EQUAL(len, w.length());
+      TEST_ASSERT_EQUAL(0, memcmp(buf, full.data(), cap));
+      free(buf);
+    }
+  }
+}
+
+// The web server's preset broadcast, as writePresetState() lays it out.
+static void writePreset(JsonWriter &w, int songs) {
+  char name[MAX_SONG_NAME_LEN + 1];
+  w.beginObject();
+  w.string("name", "Friday \"late\" set");
+  w.string("projectName", "Tour 2024 / Caf\xC3\xA9");
+  w.number("songCount", songs);
+  w.number("currentTrack", 3);
+  w.string("playbackStatus", "PLAYING");
+  w.string("link", "OK");
+  w.number("cued", 4);
+  w.number("cueDepth", 1);
+  w.beginArray("songs");
+  for (int i = 0; i < songs; i++) {
+    snprintf(name, sizeof(name), i % 4 ? "Song number %d" : "Song \"%d\" \xE2\x80\x94 reprise", i);
+    w.beginObject();
+    w.string("songName", name);
+    w.number("songIndex", i);
+    w.endObject();
+  }
+  w.endArray();
+  w.endObject();
+}
+
+// The same broadcast built the way the web server did before JsonWriter:
+// String concatenation, names spliced in unescaped.
+static String stringPreset(int songs) {
+  char name[MAX_SONG_NAME_LEN + 1];
+  String json = "{";
+  json += "\"name\":\"" + String("Friday \"late\" set") + "\",";
+  json += "\"projectName\":\"" + String("Tour 2024 / Caf\xC3\xA9") + "\",";
+  json += "\"songCount\":" + String(songs) + ",";
+  json += "\"currentTrack\":" + String(3) + ",";
+  json += "\"playbackStatus\":\"" + String("PLAYING") + "\",";
+  json += "\"link\":\"" + String("OK") + "\",";
+  json += "\"cued\":" + String(4) + ",";
+  json += "\"cueDepth\":" + String(1) + ",";
+  json += "\"songs\":[";
+  for (int i = 0; i < songs; i++) {
+    snprintf(name, sizeof(name), i % 4 ? "Song number %d" : "Song \"%d\" \xE2\x80\x94 reprise", i);
+    json += "{\"songName\":\"" + String(name) + "\",";
+    json += "\"songIndex\":" + String(i) + "}";
+    if (i < songs - 1)
+      json += ",";
+  }
+  json += "]}";
+  return json;
+}
+
+// Not a pass/fail timing check: prints the cost of each size for the
+// String baseline and for JsonWriter (measure, then write into a buffer of
+// that size, as buildPresetState() does when it must grow), so a regression
+// shows up next to the previous run. Only the allocation counts are checked.
+void test_benchmark_preset_broadcast() {
+  for (int songs : { 50, 500, 5000 }) {
+    const int rounds = songs >= 5000 ? 20 : 200;
+    JsonWriter counter;
+    writePreset(counter, songs);
+    std::vector<char> buf(counter.length());
+
+    size_t allocs = heapAllocs;
+    auto start = std::chrono::steady_clock::now();
+    size_t stringLen = 0;
+    for (int r = 0; r < rounds; r++)
+      stringLen += stringPreset(songs).length();
+    double stringUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    size_t stringAllocs = (heapAllocs - allocs) / rounds;
+
+    allocs = heapAllocs;
+    start = std::chrono::steady_clock::now();
+    size_t measured = 0;
+    for (int r = 0; r < rounds; r++) {
+      JsonWriter w;
+      writePreset(w, songs);
+      measured += w.length();
+    }
+    double measureUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      JsonWriter w(buf.data(), buf.size());
+      writePreset(w, songs);
+      TEST_ASSERT_FALSE(w.overflowed());
+    }
+    double writeUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(0, heapAllocs - allocs);
+    TEST_ASSERT_EQUAL(counter.length() * rounds, measured);
+    TEST_ASSERT_GREATER_THAN((size_t)songs * 4, stringAllocs);
+
+    std::string json(buf.data(), buf.size());
+    Parser parser(json);
+    TEST_ASSERT_EQUAL(songs, parser.document().items[8].items.size());
+
+    char line[192];
+    snprintf(line, sizeof(line), "%5d songs: String %7u bytes %9.1f us %6u allocs | JsonWriter %7u bytes, "
+             "measure %8.1f us, write %8.1f us, 0 allocs", songs, (unsigned)(stringLen / rounds),
+             stringUs / rounds, (unsigned)stringAllocs, (unsigned)buf.size(), measureUs / rounds, writeUs / rounds);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_escapes);
+  RUN_TEST(test_invalid_utf8_becomes_replacement);
+  RUN_TEST(test_random_documents_round_trip);
+  RUN_TEST(test_random_bytes_stay_valid);
+  RUN_TEST(test_truncated_buffers);
+  RUN_TEST(test_benchmark_preset_broadcast);
+  return UNITY_END();
+}
@@ -0,0 +1,411 @@
+// DIN MIDI out on the host. The running-status encoder must drop only
+// status bytes a receiver can infer, and what it writes must decode to the
+// exact messages it was given. Through MidiPorts the same messages must come
+// out of USB while it is up and out of the UART once it fails over, each
+// byte-exact and in order per port, nothing lost that a queue accepted.
+
+#include <unity.h>
+#include <map>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+typedef std::vector<uint8_t> Message;
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 8) % range;
+}
+
+// A DIN receiver: splits a byte stream into whole messages, running status
+// expanded. Real-time bytes are messages of their own wherever they fall.
+class Receiver {
+public:
+  std::vector<Message> messages;
+
+  void feed(const std::vector<uint8_t> &bytes) {
+    for (uint8_t b : bytes)
+      feed(b);
+  }
+
+  void feed(uint8_t b) {
+    if (b >= 0xF8) {
+      messages.push_back({ b });
+      return;
+    }
+    if (b == 0xF7 && inSysEx) {
+      current.push_back(b);
+      messages.push_back(current);
+      current.clear();
+      inSysEx = false;
+      return;
+    }
+    if (b & 0x80) {
+      TEST_ASSERT_TRUE_MESSAGE(current.empty() || inSysEx == false, "status inside a SysEx");
+      TEST_ASSERT_TRUE_MESSAGE(current.size() <= 1, "message cut short");
+      current = { b };
+      inSysEx = b == 0xF0;
+      running = b < 0xF0 ? b : 0;   // system common cancels running status
+      if (dataBytes(b) == 0 && !inSysEx) {
+        messages.push_back(current);
+        current.clear();
+      }
+      return;
+    }
+    if (inSysEx) {
+      current.push_back(b);
+      return;
+    }
+    if (current.empty()) {
+      TEST_ASSERT_TRUE_MESSAGE(running != 0, "data byte without a status");
+      current = { running };
+    }
+    current.push_back(b);
+    if ((int)current.size() == 1 + dataBytes(current[0])) {
+      messages.push_back(current);
+      current.clear();
+    }
+  }
+
+  // Nothing half received.
+  bool idle() const { return current.empty() && !inSysEx; }
+
+private:
+  Message current;
+  uint8_t running = 0;
+  bool inSysEx = false;
+
+  static int dataBytes(uint8_t status) {
+    if (status < 0xF0)
+      return (status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0 ? 1 : 2;
+    return status == 0xF2 ? 2 : status == 0xF1 || status == 0xF3 ? 1 : 0;
+  }
+};
+
+static Message randomChannelMessage(uint8_t channel) {
+  uint8_t kind = 0x80 + 0x10 * nextRandom(7);
+  Message m = { (uint8_t)(kind | channel), (uint8_t)nextRandom(128) };
+  if (kind != 0xC0 && kind != 0xD0)
+    m.push_back(nextRandom(128));
+  return m;
+}
+
+static Message randomSysEx(int maxData) {
+  Message m = { 0xF0 };
+  int n = nextRandom(maxData + 1);
+  for (int i = 0; i < n; i++)
+    m.push_back(nextRandom(128));
+  m.push_back(0xF7);
+  return m;
+}
+
+// Channel messages on few channels so running status has work, with
+// system messages mixed in.
+static Message randomMessage() {
+  switch (nextRandom(10)) {
+    case 0: return { (uint8_t)(0xF8 + nextRandom(8) % 5) };   // F8, FA-FC, FE, none undefined
+    case 1: return { 0xF2, (uint8_t)nextRandom(128), (uint8_t)nextRandom(128) };
+    case 2: return randomSysEx(40);
+    default: return randomChannelMessage(nextRandom(2));
+  }
+}
+
+// Hands msg to the encoder until it has taken all of it, letting the line
+// drain between passes. Returns the passes it took.
+static int sendAll(UartMidi &uart, const Message &msg) {
+  uint16_t done = 0;
+  int passes = 0;
+  while (done < msg.size()) {
+    uint16_t took = uart.send(MidiPort::PERFORMANCE, msg.data(), msg.size(), done);
+    done += took;
+    passes++;
+    if (done < msg.size())
+      hostAdvanceUs(MIDI_UART_AHEAD_US);
+    TEST_ASSERT_LESS_THAN(1000, passes);
+  }
+  return passes;
+}
+
+static void resetUart() {
+  Serial1.sent.clear();
+  Serial1.room = 128;
+  hostAdvanceUs(MIDI_UART_STATUS_REFRESH_MS * 1000UL);   // line idle, nothing in force
+}
+
+void setUp() {
+  resetUart();
+  hostUsb.toDevice.clear();
+  hostUsb.fromDevice.clear();
+  hostUsb.inRoom = SIZE_MAX;
+  hostUsb.mounted = true;
+}
+
+void tearDown() {}
+
+// ---- Running-status encoder ----
+
+void test_running_status_drops_repeated_status() {
+  UartMidi uart;
+  sendAll(uart, { 0x90, 0x3C, 0x7F });
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  sendAll(uart, { 0x90, 0x40, 0x7F });
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  sendAll(uart, { 0xF8 });                       // real-time leaves it in force
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  sendAll(uart, { 0x90, 0x3C, 0x00 });
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  sendAll(uart, { 0x91, 0x3C, 0x00 });           // another channel is another status
+  TEST_ASSERT_TRUE(Serial1.sent == std::vector<uint8_t>({ 0x90, 0x3C, 0x7F, 0x40, 0x7F, 0xF8, 0x3C, 0x00,
+                                                          0x91, 0x3C, 0x00 }));
+  TEST_ASSERT_EQUAL(2, uart.stats().statusSaved);
+  TEST_ASSERT_EQUAL(Serial1.sent.size(), uart.stats().bytes);
+}
+
+void test_system_messages_cancel_running_status() {
+  UartMidi uart;
+  for (const Message &cancel : { Message{ 0xF0, 0x01, 0xF7 }, Message{ 0xF2, 0x00, 0x01 }, Message{ 0xF6 } }) {
+    resetUart();
+    sendAll(uart, { 0xB0, 0x07, 0x64 });
+    hostAdvanceUs(MIDI_UART_AHEAD_US);
+    sendAll(uart, cancel);
+    hostAdvanceUs(MIDI_UART_AHEAD_US);
+    sendAll(uart, { 0xB0, 0x07, 0x65 });
+    TEST_ASSERT_EQUAL_HEX8(0xB0, Serial1.sent[3 + cancel.size()]);
+  }
+}
+
+void test_status_is_refreshed_and_sent_after_abandon() {
+  UartMidi uart;
+  sendAll(uart, { 0xE0, 0x00, 0x40 });
+  hostAdvanceUs(MIDI_UART_STATUS_REFRESH_MS * 1000UL - 1);
+  sendAll(uart, { 0xE0, 0x01, 0x40 });
+  TEST_ASSERT_EQUAL(5, Serial1.sent.size());     // within the refresh period
+
+  hostAdvanceUs(1);
+  sendAll(uart, { 0xE0, 0x02, 0x40 });
+  TEST_ASSERT_EQUAL_HEX8(0xE0, Serial1.sent[5]); // a full second since it was sent
+
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  uart.abandon(MidiPort::PERFORMANCE);
+  sendAll(uart, { 0xE0, 0x03, 0x40 });
+  TEST_ASSERT_EQUAL_HEX8(0xE0, Serial1.sent[8]);
+}
+
+// Never more than MIDI_UART_AHEAD_US of line time, nor more than the UART
+// has room for, in one pass.
+void test_output_is_paced() {
+  UartMidi uart;
+  Message sysex = randomSysEx(200);
+  const int perPass = MIDI_UART_AHEAD_US / MIDI_UART_BYTE_US;
+  TEST_ASSERT_EQUAL(perPass, uart.send(MidiPort::CONTROL, sysex.data(), sysex.size(), 0));
+  TEST_ASSERT_EQUAL(0, uart.send(MidiPort::CONTROL, sysex.data(), sysex.size(), perPass));
+  hostAdvanceUs(MIDI_UART_BYTE_US);
+  TEST_ASSERT_EQUAL(1, uart.send(MidiPort::CONTROL, sysex.data(), sysex.size(), perPass));
+
+  hostAdvanceUs(MIDI_UART_AHEAD_US);
+  Serial1.room = 2;
+  TEST_ASSERT_EQUAL(2, uart.send(MidiPort::CONTROL, sysex.data(), sysex.size(), perPass + 1));
+  TEST_ASSERT_EQUAL(0, uart.send(MidiPort::CONTROL, sysex.data(), sysex.size(), perPass + 3));
+}
+
+// Random traffic, chunked by the pacing: the receiver gets exactly the
+// messages sent, and repeated channel statuses are left out.
+void test_encoded_stream_decodes_to_the_messages() {
+  seed = 5;
+  UartMidi uart;
+  std::vector<Message> sent;
+  for (int i = 0; i < 5000; i++) {
+    Message m = randomMessage();
+    sendAll(uart, m);
+    sent.push_back(m);
+    Serial1.room = 128;
+    hostAdvanceUs(nextRandom(4) ? 0 : 50000);   // mostly back to back
+  }
+  Receiver din;
+  din.feed(Serial1.sent);
+  TEST_ASSERT_TRUE(din.idle());
+  TEST_ASSERT_EQUAL(sent.size(), din.messages.size());
+  for (size_t i = 0; i < sent.size(); i++)
+    TEST_ASSERT_TRUE(sent[i] == din.messages[i]);
+  TEST_ASSERT_GREATER_THAN(100, uart.stats().statusSaved);
+  TEST_ASSERT_EQUAL(Serial1.sent.size(), uart.stats().bytes);
+}
+
+// ---- USB and UART loopback through MidiPorts ----
+
+// What each port sends, distinct so the DIN stream can be split back.
+static Message portMessage(MidiPort port) {
+  switch (port) {
+    case MidiPort::CONTROL: return randomSysEx(30);
+    case MidiPort::PERFORMANCE: return randomChannelMessage(nextRandom(16));
+    default: return nextRandom(4) ? Message{ 0xF8 } : Message{ 0xF2, (uint8_t)nextRandom(128), 0x00 };
+  }
+}
+
+static MidiPort portOf(const Message &m) {
+  if (m[0] == 0xF0)
+    return MidiPort::CONTROL;
+  return m[0] < 0xF0 ? MidiPort::PERFORMANCE : MidiPort::SYNC;
+}
+
+// Sends m on port; false if the port's queue was full and dropped it.
+static bool sendOnPort(MidiPort port, const Message &m) {
+  static MidiPortStream streams[] = { MidiPortStream(MidiPort::CONTROL), MidiPortStream(MidiPort::PERFORMANCE),
+                                      MidiPortStream(MidiPort::SYNC) };
+  uint32_t dropped = MidiPorts::stats(port).dropped;
+  MidiPorts::acquire(port);
+  for (uint8_t b : m)
+    streams[(int)port].write(b);
+  MidiPorts::release(port);
+  return MidiPorts::stats(port).dropped == dropped;
+}
+
+// Whole messages per port from the USB packets, in the order they arrived.
+static std::map<int, std::vector<Message>> usbMessages() {
+  std::map<int, Receiver> cables;
+  for (const HostUsbPacket &p : hostUsb.fromDevice) {
+    static const int bytes[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+    for (int i = 0; i < bytes[p[0] & 0x0F]; i++)
+      cables[p[0] >> 4].feed(p[1 + i]);
+  }
+  std::map<int, std::vector<Message>> out;
+  for (auto &c : cables) {
+    for (const Message &m : c.second.messages)
+      out[(int)portOf(m)].push_back(m);
+  }
+  return out;
+}
+
+static std::map<int, std::vector<Message>> dinMessages() {
+  Receiver din;
+  din.feed(Serial1.sent);
+  TEST_ASSERT_TRUE(din.idle());
+  std::map<int, std::vector<Message>> out;
+  for (const Message &m : din.messages)
+    out[(int)portOf(m)].push_back(m);
+  return out;
+}
+
+// Runs the MIDI task until every queue is empty.
+static void drainPorts() {
+  for (int pass = 0; pass < 100000; pass++) {
+    bool empty = true;
+    for (int p = 0; p < (int)MidiPort::COUNT; p++)
+      empty &= MidiPorts::stats((MidiPort)p).queued == 0;
+    if (empty)
+      return;
+    MidiPorts::flush();
+    Serial1.room = 128;
+    hostAdvanceUs(MIDI_POLL_MS * 1000);
+  }
+  TEST_FAIL_MESSAGE("queues never drained");
+}
+
+static void settleLink(UsbLink link) {
+  for (int i = 0; i < 10000 && MidiPorts::usbLink() != link; i++) {
+    MidiPorts::flush();
+    hostAdvanceUs(MIDI_POLL_MS * 1000);
+  }
+  TEST_ASSERT_EQUAL(link, MidiPorts::usbLink());
+  hostUsb.fromDevice.clear();
+  Serial1.sent.clear();
+}
+
+// Sends bursts on every port, faster than DIN can carry them, and returns
+// what was queued per port; the rest was dropped whole by the queues.
+static std::map<int, std::vector<Message>> sendBursts(int bursts) {
+  std::map<int, std::vector<Message>> sent;
+  for (int i = 0; i < bursts; i++) {
+    for (int n = nextRandom(6); n > 0; n--) {
+      MidiPort port = (MidiPort)nextRandom((int)MidiPort::COUNT);
+      Message m = portMessage(port);
+      if (sendOnPort(port, m))
+        sent[(int)port].push_back(m);
+    }
+    MidiPorts::flush();
+    Serial1.room = 128;
+    hostAdvanceUs(MIDI_POLL_MS * 1000);
+  }
+  drainPorts();
+  return sent;
+}
+
+static void assertSameMessages(const std::vector<Message> &expected, const std::vector<Message> &actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++)
+    TEST_ASSERT_TRUE(expected[i] == actual[i]);
+}
+
+void test_loopback_over_usb() {
+  seed = 21;
+  settleLink(UsbLink::UP);
+  std::map<int, std::vector<Message>> sent = sendBursts(2000);
+  std::map<int, std::vector<Message>> usb = usbMessages();
+  for (int p = 0; p < (int)MidiPort::COUNT; p++)
+    assertSameMessages(sent[p], usb[p]);
+  TEST_ASSERT_TRUE(Serial1.sent.empty());       // DIN idles while USB is up
+}
+
+void test_loopback_over_din_while_usb_is_down() {
+  seed = 22;
+  hostUsb.mounted = false;
+  settleLink(UsbLink::DOWN);
+  TEST_ASSERT_TRUE(MidiPorts::active(MidiTransport::UART));
+  std::map<int, std::vector<Message>> sent = sendBursts(2000);
+  std::map<int, std::vector<Message>> din = dinMessages();
+  for (int p = 0; p < (int)MidiPort::COUNT; p++)
+    assertSameMessages(sent[p], din[p]);
+  TEST_ASSERT_TRUE(hostUsb.fromDevice.empty());
+}
+
+// USB stalls part way through the traffic: DIN takes over from the first
+// message USB didn't finish. Per port, what USB delivered followed by what
+// DIN delivered is exactly what was sent.
+void test_failover_mid_stream() {
+  seed = 23;
+  settleLink(UsbLink::UP);
+  std::map<int, std::vector<Message>> sent;
+  for (int i = 0; i < 400; i++) {
+    if (i == 150)
+      hostUsb.inRoom = 7;                        // the host stops reading
+    for (int n = nextRandom(4); n > 0; n--) {
+      MidiPort port = (MidiPort)nextRandom((int)MidiPort::COUNT);
+      Message m = portMessage(port);
+      if (sendOnPort(port, m))
+        sent[(int)port].push_back(m);
+    }
+    MidiPorts::flush();
+    Serial1.room = 128;
+    hostAdvanceUs(MIDI_POLL_MS * 1000);
+  }
+  drainPorts();
+  TEST_ASSERT_EQUAL(UsbLink::DOWN, MidiPorts::usbLink());
+
+  std::map<int, std::vector<Message>> usb = usbMessages(), din = dinMessages();
+  for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+    std::vector<Message> both = usb[p];
+    both.insert(both.end(), din[p].begin(), din[p].end());
+    assertSameMessages(sent[p], both);
+  }
+  TEST_ASSERT_GREATER_THAN(0, din[(int)MidiPort::PERFORMANCE].size());
+  hostUsb.inRoom = SIZE_MAX;
+}
+
+int main() {
+  hostAdvanceUs(1000000);
+  MidiPorts::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_running_status_drops_repeated_status);
+  RUN_TEST(test_system_messages_cancel_running_status);
+  RUN_TEST(test_status_is_refreshed_and_sent_after_abandon);
+  RUN_TEST(test_output_is_paced);
+  RUN_TEST(test_encoded_stream_decodes_to_the_messages);
+  RUN_TEST(test_loopback_over_usb);
+  RUN_TEST(test_loopback_over_din_while_usb_is_down);
+  RUN_TEST(test_failover_mid_stream);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// PaletteCanvas on the host: colour-to-index mapping and the index-to-RGB565
+// expansion kernel, checked against a plain per-pixel loop and timed
+// against it on a full frame.
+
+#include <unity.h>
+#include <chrono>
+#include "host_log.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../src/_band.cpp"
+
+// What expand() must produce: each index looked up and byte-swapped.
+static void expandReference(const std::vector<uint16_t> &colors, const uint8_t *src, uint16_t *dst,
+                            uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        dst[i] = __builtin_bswap16(colors[src[i]]);
+}
+
+// n distinct colours, black first, so entry i of the result is index i.
+static std::vector<uint16_t> fillPalette(PaletteCanvas &canvas, int n) {
+    std::vector<uint16_t> colors;
+    for (int i = 0; i < n; i++) {
+        uint16_t color = (uint16_t)(i * 0x0101);
+        canvas.drawPixel(i % DISPLAY_WIDTH, i / DISPLAY_WIDTH, color);
+        colors.push_back(color);
+    }
+    return colors;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_colors_get_stable_indices() {
+    PaletteCanvas canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    TEST_ASSERT_TRUE(canvas.begin());
+    TEST_ASSERT_EQUAL(1, canvas.colorCount());   // black
+    canvas.fillRect(0, 0, 10, 10, 0xF800);
+    canvas.drawFastHLine(0, 20, 30, 0x001F);
+    canvas.drawFastVLine(5, 0, 40, 0xF800);
+    TEST_ASSERT_EQUAL(3, canvas.colorCount());
+    TEST_ASSERT_EQUAL(canvas.getPixel(0, 0), canvas.getPixel(5, 30));
+    TEST_ASSERT_NOT_EQUAL(canvas.getPixel(0, 0), canvas.getPixel(1, 20));
+    TEST_ASSERT_EQUAL(0, canvas.getPixel(100, 100));
+}
+
+void test_expand_matches_reference() {
+    PaletteCanvas canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    TEST_ASSERT_TRUE(canvas.begin());
+    std::vector<uint16_t> colors = fillPalette(canvas, 256);
+    TEST_ASSERT_EQUAL(0, canvas.takeMisses());
+
+    // Every index, in 32-bit aligned and unaligned positions and with tails
+    // of every length.
+    std::vector<uint8_t> src(4 + 1024);
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = (uint8_t)(i * 7 + (i >> 8));
+    std::vector<uint16_t> expected(1024), got(2 + 1024);
+    for (int srcOff = 0; srcOff < 4; srcOff++) {
+        for (int dstOff = 0; dstOff < 2; dstOff++) {
+            for (uint32_t count : { 0u, 1u, 7u, 8u, 9u, 15u, 16u, 320u, 640u, 1021u }) {
+                std::fill(got.begin(), got.end(), 0xDEAD);
+                canvas.expand(&src[srcOff], &got[dstOff], count);
+                expandReference(colors, &src[srcOff], expected.data(), count);
+                TEST_ASSERT_TRUE(std::equal(expected.begin(), expected.begin() + count, got.begin() + dstOff));
+                TEST_ASSERT_EQUAL_HEX32(0xDEAD, got[dstOff + count]);   // nothing past the end
+            }
+        }
+    }
+}
+
+void test_full_palette_counts_misses() {
+    PaletteCanvas canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    TEST_ASSERT_TRUE(canvas.begin());
+    fillPalette(canvas, 256);
+    canvas.drawPixel(0, 0, 0x1234);
+    canvas.drawPixel(1, 0, 0x1234);   // same colour: the cached lookup counts it once
+    canvas.drawPixel(2, 0, 0x1235);
+    TEST_ASSERT_EQUAL(2, canvas.takeMisses());
+    TEST_ASSERT_EQUAL(0, canvas.getPixel(0, 0));
+    TEST_ASSERT_EQUAL(0, canvas.takeMisses());
+}
+
+static volatile uint16_t sink;   // keeps the benchmark loops from being optimized out
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Not a pass/fail timing check: prints the cost per pixel of the kernel and
+// of the per-pixel loop it replaced, for a frame sent PALETTE_EXPAND_PIXELS
+// at a time as pushPalette() does. Host numbers only show the ratio.
+void test_benchmark_expand_frame() {
+    PaletteCanvas canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    TEST_ASSERT_TRUE(canvas.begin());
+    std::vector<uint16_t> colors = fillPalette(canvas, 12);
+    const uint8_t *frame = canvas.getBuffer();
+    const uint32_t pixels = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+    std::vector<uint16_t> buf(PALETTE_EXPAND_PIXELS);
+    const int rounds = 50;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t at = 0; at < pixels; at += PALETTE_EXPAND_PIXELS) {
+            canvas.expand(frame + at, buf.data(), PALETTE_EXPAND_PIXELS);
+            sink = buf[r % PALETTE_EXPAND_PIXELS];
+        }
+    }
+    double kernelNs = elapsedNs(start) / rounds / pixels;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t at = 0; at < pixels; at += PALETTE_EXPAND_PIXELS) {
+            expandReference(colors, frame + at, buf.data(), PALETTE_EXPAND_PIXELS);
+            sink = buf[r % PALETTE_EXPAND_PIXELS];
+        }
+    }
+    double loopNs = elapsedNs(start) / rounds / pixels;
+
+    char line[120];
+    snprintf(line, sizeof(line), "expand %ux%u: kernel %.2f ns/px, per-pixel loop %.2f ns/px",
+             DISPLAY_WIDTH, DISPLAY_HEIGHT, kernelNs, loopNs);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_colors_get_stable_indices);
+    RUN_TEST(test_expand_matches_reference);
+    RUN_TEST(test_full_palette_counts_misses);
+    RUN_TEST(test_benchmark_expand_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+// Setlist presets on the host: saved to LittleFS and loaded back, and a
+// damaged setlist file loading nothing rather than placeholder songs.
+// Presets saved with one NVS key per song still load.
+
+#include <unity.h>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_preset.cpp"
+
+static const char *P1 = "/setlists/p1.bin";
+
+static void savePreset(int slot, int count) {
+  Preset preset;
+  strcpy(preset.name, "Friday");
+  strcpy(preset.data.projectName, "Live Set");
+  TEST_ASSERT_TRUE(preset.data.songs.reserve(count));
+  for (int i = 0; i < count; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "Song %d", i);
+    SongInfo &song = preset.data.songs[i];
+    song.setName(name);
+    song.songIndex = 10 + i;
+    song.changedIndex = i;
+    song.locatorMs = 60000 * (i + 1);
+    preset.data.songCount++;
+  }
+  ps::savePresetToDevice(slot, preset);
+}
+
+static void assertNothingLoaded(const Preset &preset) {
+  TEST_ASSERT_EQUAL_STRING("No Preset", preset.name);
+  TEST_ASSERT_EQUAL_STRING("", preset.data.projectName);
+  TEST_ASSERT_EQUAL(0, preset.data.songCount);
+}
+
+void setUp() {
+  LittleFS.files.clear();
+  Preferences::store().clear();
+  memset(hostLogCount, 0, sizeof(hostLogCount));
+}
+
+void tearDown() {}
+
+void test_saved_preset_loads_back() {
+  savePreset(1, 3);
+  Preset preset = ps::loadPresetFromDevice(1);
+  TEST_ASSERT_EQUAL_STRING("Friday", preset.name);
+  TEST_ASSERT_EQUAL_STRING("Live Set", preset.data.projectName);
+  TEST_ASSERT_EQUAL(3, preset.data.songCount);
+  for (int i = 0; i < 3; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "Song %d", i);
+    TEST_ASSERT_EQUAL_STRING(name, preset.data.songs[i].name());
+    TEST_ASSERT_EQUAL(10 + i, preset.data.songs[i].songIndex);
+    TEST_ASSERT_EQUAL(60000 * (i + 1), preset.data.songs[i].locatorMs);
+  }
+  TEST_ASSERT_EQUAL(0, hostLogCount[LOG_LEVEL_ERROR]);
+}
+
+// Every cut of the file, down to empty, loads nothing and logs why.
+void test_truncated_setlist_loads_nothing() {
+  savePreset(1, 3);
+  std::vector<uint8_t> whole = *LittleFS.files[P1];
+  for (size_t len = whole.size() - 1; len != (size_t)-1; len--) {
+    LittleFS.files[P1]->assign(whole.begin(), whole.begin() + len);
+    int errors = hostLogCount[LOG_LEVEL_ERROR];
+    assertNothingLoaded(ps::loadPresetFromDevice(1));
+    TEST_ASSERT_EQUAL(errors + 1, hostLogCount[LOG_LEVEL_ERROR]);
+  }
+}
+
+void test_corrupt_setlist_loads_nothing() {
+  savePreset(1, 3);
+  std::vector<uint8_t> &file = *LittleFS.files[P1];
+  file[0] = 'X';                                      // magic
+  assertNothingLoaded(ps::loadPresetFromDevice(1));
+
+  savePreset(1, 3);
+  std::vector<uint8_t> &again = *LittleFS.files[P1];
+  again[again.size() - 7] = MAX_SONG_NAME_LEN + 1;     // last song's name length
+  assertNothingLoaded(ps::loadPresetFromDevice(1));
+}
+
+// The boot path: the remembered slot's file is gone, but the slot's NVS
+// keys (name, project, _count) are still there.
+void test_missing_setlist_loads_nothing() {
+  savePreset(2, 3);
+  ps::rememberLastPreset(2);
+  LittleFS.remove("/setlists/p2.bin");
+  assertNothingLoaded(ps::loadPresetFromDevice(ps::getLastPresetSlot()));
+  assertNothingLoaded(ps::loadPresetFromDevice(4));   // never saved
+}
+
+void test_legacy_nvs_preset_loads() {
+  preferences.begin("Setlists", false);
+  preferences.putString("p3_name", "Old");
+  preferences.putString("p3_proj", "Old Project");
+  preferences.putInt("p3_count", 2);
+  for (int i = 0; i < 2; i++) {
+    preferences.putString(("p3_song" + String(i)).c_str(), ("Legacy " + String(i)).c_str());
+    preferences.putInt(("p3_index" + String(i)).c_str(), 7 + i);
+    preferences.putInt(("p3_cindex" + String(i)).c_str(), i);
+    preferences.putFloat(("p3_time" + String(i)).c_str(), 1.5f * (i + 1));
+  }
+  preferences.end();
+
+  Preset preset = ps::loadPresetFromDevice(3);
+  TEST_ASSERT_EQUAL_STRING("Old", preset.name);
+  TEST_ASSERT_EQUAL_STRING("Old Project", preset.data.projectName);
+  TEST_ASSERT_EQUAL(2, preset.data.songCount);
+  TEST_ASSERT_EQUAL_STRING("Legacy 1", preset.data.songs[1].name());
+  TEST_ASSERT_EQUAL(8, preset.data.songs[1].songIndex);
+  TEST_ASSERT_EQUAL(3000, preset.data.songs[1].locatorMs);
+
+  // Saving it again moves it to LittleFS and drops the per-song keys.
+  ps::savePresetToDevice(3, preset);
+  preferences.begin("Setlists", true);
+  TEST_ASSERT_FALSE(preferences.isKey("p3_song0"));
+  preferences.end();
+  TEST_ASSERT_EQUAL(2, ps::loadPresetFromDevice(3).data.songCount);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_saved_preset_loads_back);
+  RUN_TEST(test_truncated_setlist_loads_nothing);
+  RUN_TEST(test_corrupt_setlist_loads_nothing);
+  RUN_TEST(test_missing_setlist_loads_nothing);
+  RUN_TEST(test_legacy_nvs_preset_loads);
+  return UNITY_END();
+}
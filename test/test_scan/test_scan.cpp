@@ -0,0 +1,277 @@
+// Sequenced scan over a USB loopback: a fake remote answers the device's
+// Scan and NAK SysEx, and the link between them drops, duplicates and
+// reorders the 0x03 header and 0x04 song messages.
+
+#include <unity.h>
+#include <set>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+// Modules _midi.cpp reports to that the scan doesn't involve.
+void Transport::clock(uint32_t) {}
+void Transport::start() {}
+void Transport::resume() {}
+void Transport::stop() {}
+void Transport::songPosition(uint16_t) {}
+void LinkMonitor::onReply(const uint8_t *, unsigned) {}
+
+typedef std::vector<uint8_t> Message;
+
+// Event packets for one SysEx on cable 0, as the host driver sends them.
+static void sendToDevice(const Message &msg) {
+  for (size_t i = 0; i < msg.size(); i += 3) {
+    size_t n = std::min<size_t>(3, msg.size() - i);
+    uint8_t cin = n == 3 && msg[i + 2] != 0xF7 ? 0x4 : (uint8_t)(0x4 + n);
+    HostUsbPacket p = { cin, 0, 0, 0 };
+    for (size_t j = 0; j < n; j++)
+      p[1 + j] = msg[i + j];
+    hostUsb.toDevice.push_back(p);
+  }
+}
+
+// SysEx messages the device wrote on cable 0 since the last call.
+static std::vector<Message> readFromDevice() {
+  Midi::flush();
+  std::vector<Message> out;
+  Message cur;
+  for (const HostUsbPacket &p : hostUsb.fromDevice) {
+    uint8_t cin = p[0] & 0x0F;
+    if ((p[0] >> 4) != 0 || cin < 0x4 || cin > 0x7)
+      continue;
+    uint8_t n = cin == 0x4 ? 3 : cin - 0x4;
+    cur.insert(cur.end(), p.begin() + 1, p.begin() + 1 + n);
+    if (cin != 0x4) {
+      out.push_back(cur);
+      cur.clear();
+    }
+  }
+  hostUsb.fromDevice.clear();
+  return out;
+}
+
+static void pumpDevice() {
+  for (int i = 0; i < 10000 && (!hostUsb.toDevice.empty() || usbmidi.available(0)); i++)
+    Midi::read();
+}
+
+struct FakeRemote {
+  int songCount = 0;
+  std::set<int> lost;          // never arrive, whatever is asked
+  std::set<int> dropOnce;      // lost on the first pass only
+  bool dropHeader = false;
+  bool duplicate = false;
+  bool reverse = false;
+  int passes = 0;
+
+  static Message song(int seq) {
+    Message m = { 0xF0, 0x00, 0x01, 0x61, 0x04, (uint8_t)(seq & 0x7F), (uint8_t)(seq >> 7),
+                  (uint8_t)(seq & 0x7F) };
+    char text[40];
+    int n = snprintf(text, sizeof(text), "Song %d", seq);
+    m.insert(m.end(), text, text + n);
+    m.push_back(0x00);
+    n = snprintf(text, sizeof(text), "%d.5", seq * 10);
+    m.insert(m.end(), text, text + n);
+    m.push_back(0xF7);
+    return m;
+  }
+
+  void sendPass(int from, int to, bool withHeader) {
+    std::vector<Message> pass;
+    if (withHeader && !dropHeader)
+      pass.push_back({ 0xF0, 0x00, 0x01, 0x61, 0x03, (uint8_t)(songCount & 0x7F),
+                       (uint8_t)(songCount >> 7), 0xF7 });
+    for (int seq = from; seq <= to; seq++) {
+      if (lost.count(seq) || (passes == 0 && dropOnce.count(seq)))
+        continue;
+      pass.push_back(song(seq));
+      if (duplicate)
+        pass.push_back(song(seq));
+    }
+    if (reverse)
+      std::reverse(pass.begin(), pass.end());
+    pass.push_back({ 0xF0, 0x00, 0x01, 0x61, 0x00, 0x7F, 0xF7 });
+    passes++;
+    for (const Message &m : pass) {
+      sendToDevice(m);
+      pumpDevice();
+    }
+  }
+
+  // Answers whatever the device sent.
+  void serve() {
+    for (const Message &m : readFromDevice()) {
+      if (m.size() >= 7 && m[4] == 0x10)
+        sendPass(0, songCount - 1, true);
+      else if (m.size() >= 10 && m[4] == 0x12)
+        sendPass(m[5] | (m[6] << 7), m[7] | (m[8] << 7), false);
+    }
+  }
+};
+
+// The UI's scan loop without the screen: NAK the gaps after each pass, give
+// up after SCAN_MAX_RETRIES.
+static bool runScan(FakeRemote &remote) {
+  ScanSession::begin();
+  Midi::Scan();
+  remote.serve();
+  int retries = 0;
+  while (!ScanSession::complete() && ScanSession::missing() > 0 && retries < SCAN_MAX_RETRIES) {
+    retries++;
+    ScanSession::requestMissing();
+    remote.serve();
+  }
+  if (ScanSession::complete())
+    return true;
+  ScanSession::abandon();
+  return false;
+}
+
+static void assertSong(int slot, int seq) {
+  char name[40];
+  snprintf(name, sizeof(name), "Song %d", seq);
+  TEST_ASSERT_EQUAL_STRING(name, currentProject.songs[slot].name());
+  TEST_ASSERT_EQUAL(seq, currentProject.songs[slot].songIndex);
+  TEST_ASSERT_EQUAL_UINT32(seq * 10000 + 500, currentProject.songs[slot].locatorMs);
+}
+
+static void assertAllSongs(int count) {
+  TEST_ASSERT_EQUAL(count, currentProject.songCount);
+  for (int i = 0; i < count; i++)
+    assertSong(i, i);
+}
+
+void setUp() {
+  static bool started = false;
+  if (!started) {
+    Midi::begin();
+    started = true;
+  }
+  hostUsb.toDevice.clear();
+  hostUsb.fromDevice.clear();
+}
+
+void tearDown() {}
+
+void test_clean_scan() {
+  FakeRemote remote;
+  remote.songCount = 20;
+  TEST_ASSERT_TRUE(runScan(remote));
+  TEST_ASSERT_EQUAL(1, remote.passes);
+  assertAllSongs(20);
+}
+
+void test_dropped_songs_are_requested_again() {
+  FakeRemote remote;
+  remote.songCount = 200;
+  remote.dropOnce = { 0, 3, 7, 8, 150, 199 };
+  TEST_ASSERT_TRUE(runScan(remote));
+  TEST_ASSERT_EQUAL(1 + 5, remote.passes);   // one NAK per gap: 0, 3, 7-8, 150, 199
+  assertAllSongs(200);
+}
+
+void test_duplicates_count_once() {
+  FakeRemote remote;
+  remote.songCount = 30;
+  remote.duplicate = true;
+  TEST_ASSERT_TRUE(runScan(remote));
+  TEST_ASSERT_EQUAL(30, ScanSession::received());
+  assertAllSongs(30);
+}
+
+void test_reordered_pass_with_late_header() {
+  FakeRemote remote;
+  remote.songCount = 40;
+  remote.reverse = true;    // songs from the last, then the header
+  remote.dropOnce = { 20 };
+  TEST_ASSERT_TRUE(runScan(remote));
+  assertAllSongs(40);
+}
+
+void test_gap_counts_without_a_header() {
+  FakeRemote remote;
+  remote.songCount = 10;
+  remote.dropHeader = true;
+  remote.dropOnce = { 4 };
+  TEST_ASSERT_TRUE(runScan(remote));
+  TEST_ASSERT_EQUAL(0, ScanSession::total());
+  assertAllSongs(10);
+}
+
+void test_previous_project_never_shows_through() {
+  FakeRemote first;
+  first.songCount = 50;
+  TEST_ASSERT_TRUE(runScan(first));
+
+  FakeRemote second;
+  second.songCount = 30;
+  second.lost = { 10, 11, 25 };
+  ScanSession::begin();
+  Midi::Scan();
+  second.serve();
+  TEST_ASSERT_FALSE(ScanSession::complete());
+  TEST_ASSERT_EQUAL(3, ScanSession::missing());
+  TEST_ASSERT_EQUAL_UINT32(0, currentProject.songs[10].nameId);   // empty, not "Song 10" of the first
+  TEST_ASSERT_EQUAL_UINT32(0, currentProject.songs[40].nameId);
+}
+
+void test_abandoned_scan_keeps_received_songs_in_order() {
+  FakeRemote remote;
+  remote.songCount = 30;
+  remote.lost = { 10, 11, 25 };
+  TEST_ASSERT_FALSE(runScan(remote));
+  TEST_ASSERT_EQUAL(1 + 2 * SCAN_MAX_RETRIES, remote.passes);   // 10-11 and 25 each retry
+
+  TEST_ASSERT_EQUAL(27, currentProject.songCount);
+  int slot = 0;
+  for (int seq = 0; seq < 30; seq++) {
+    if (!remote.lost.count(seq))
+      assertSong(slot++, seq);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, currentProject.songs[27].nameId);
+
+  // A retransmit that turns up after giving up changes nothing.
+  sendToDevice(FakeRemote::song(10));
+  pumpDevice();
+  TEST_ASSERT_EQUAL(27, currentProject.songCount);
+  assertSong(10, 12);
+}
+
+void test_short_header_is_ignored() {
+  FakeRemote remote;
+  remote.songCount = 5;
+  TEST_ASSERT_TRUE(runScan(remote));
+  ScanSession::begin();
+
+  // Exactly sized, so reading past the end shows up under a sanitizer.
+  static const uint8_t shortHeader[] = { 0xF0, 0x00, 0x01, 0x61, 0x03, 0xF7 };
+  uint8_t *data = (uint8_t *)malloc(sizeof(shortHeader));
+  memcpy(data, shortHeader, sizeof(shortHeader));
+  Midi::handleSysEx(data, sizeof(shortHeader));
+  free(data);
+  TEST_ASSERT_EQUAL(0, ScanSession::total());
+
+  sendToDevice({ 0xF0, 0x00, 0x01, 0x61, 0x03, 0x05, 0x00, 0xF7 });
+  pumpDevice();
+  TEST_ASSERT_EQUAL(5, ScanSession::total());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_scan);
+  RUN_TEST(test_dropped_songs_are_requested_again);
+  RUN_TEST(test_duplicates_count_once);
+  RUN_TEST(test_reordered_pass_with_late_header);
+  RUN_TEST(test_gap_counts_without_a_header);
+  RUN_TEST(test_previous_project_never_shows_through);
+  RUN_TEST(test_abandoned_scan_keeps_received_songs_in_order);
+  RUN_TEST(test_short_header_is_ignored);
+  return UNITY_END();
+}
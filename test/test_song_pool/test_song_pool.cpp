@@ -0,0 +1,234 @@
+// SongNamePool and SongList on the host, plus the scan-sized benchmark:
+// fill, copy, compact, select, reorder and save projects of 50, 500 and
+// 5,000 songs.
+
+#include <unity.h>
+#include <chrono>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_preset.cpp"
+
+static void fillProject(ProjectInfo &project, int count, const char *prefix) {
+  project.clear();
+  TEST_ASSERT_TRUE(project.songs.reserve(count));
+  for (int i = 0; i < count; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "%s %d", prefix, i);
+    SongInfo &song = project.songs[i];
+    TEST_ASSERT_TRUE(song.setName(name));
+    song.songIndex = i;
+    song.changedIndex = i;
+    song.locatorMs = i * 1000;
+    project.songCount++;
+  }
+}
+
+void setUp() {
+  currentProject.clear();
+  selectedProject.clear();
+  loadedPreset.data.clear();
+  songNames.compact();
+}
+
+void tearDown() {}
+
+void test_intern_shares_names() {
+  uint32_t a = songNames.intern("Intro");
+  uint32_t b = songNames.intern("Outro");
+  TEST_ASSERT_NOT_EQUAL(0, a);
+  TEST_ASSERT_NOT_EQUAL(a, b);
+  TEST_ASSERT_EQUAL_UINT32(a, songNames.intern("Intro"));
+  TEST_ASSERT_EQUAL_STRING("Intro", songNames.get(a));
+  TEST_ASSERT_EQUAL_STRING("Outro", songNames.get(b));
+  TEST_ASSERT_EQUAL_UINT32(0, songNames.intern(""));
+  TEST_ASSERT_EQUAL_UINT32(0, songNames.intern(nullptr));
+  TEST_ASSERT_EQUAL_STRING("", songNames.get(0));
+}
+
+void test_long_names_are_cut() {
+  char longName[MAX_SONG_NAME_LEN + 10];
+  memset(longName, 'x', sizeof(longName) - 1);
+  longName[sizeof(longName) - 1] = '\0';
+  const char *stored = songNames.get(songNames.intern(longName));
+  TEST_ASSERT_EQUAL(MAX_SONG_NAME_LEN, strlen(stored));
+}
+
+void test_names_survive_block_and_index_growth() {
+  fillProject(currentProject, 5000, "Song with a longer name");
+  TEST_ASSERT_GREATER_THAN(SONG_NAME_BLOCK_SIZE, songNames.capacity());
+  for (int i = 0; i < 5000; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "Song with a longer name %d", i);
+    TEST_ASSERT_EQUAL_STRING(name, currentProject.songs[i].name());
+    TEST_ASSERT_EQUAL_UINT32(currentProject.songs[i].nameId, songNames.intern(name));
+  }
+}
+
+void test_compact_keeps_referenced_names_only() {
+  fillProject(currentProject, 200, "Current");
+  fillProject(selectedProject, 100, "Selected");
+  selectedProject.songCount = 10;          // the rest is garbage now
+  loadedPreset.data = currentProject;
+  loadedPreset.data.songCount = 3;
+  size_t before = songNames.used();
+
+  songNames.compact();
+  TEST_ASSERT_LESS_THAN(before, songNames.used());
+  for (int i = 0; i < 200; i++) {
+    char name[MAX_SONG_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "Current %d", i);
+    TEST_ASSERT_EQUAL_STRING(name, currentProject.songs[i].name());
+  }
+  TEST_ASSERT_EQUAL_STRING("Selected 9", selectedProject.songs[9].name());
+  TEST_ASSERT_EQUAL_STRING("Current 2", loadedPreset.data.songs[2].name());
+  TEST_ASSERT_EQUAL_UINT32(currentProject.songs[2].nameId, loadedPreset.data.songs[2].nameId);
+}
+
+void test_full_pool_fails_loudly() {
+  int errors = hostLogCount[LOG_LEVEL_ERROR];
+  char name[MAX_SONG_NAME_LEN + 1];
+  int added = 0;
+  bool ok = true;
+  while (ok) {
+    snprintf(name, sizeof(name), "%040d", added);
+    SongInfo song = {};
+    ok = song.setName(name);
+    if (ok)
+      added++;
+    else
+      TEST_ASSERT_EQUAL_UINT32(0, song.nameId);
+  }
+  // Two full projects of distinct names fit.
+  TEST_ASSERT_GREATER_OR_EQUAL(2 * MAX_SONGS, added);
+  TEST_ASSERT_EQUAL(errors + 1, hostLogCount[LOG_LEVEL_ERROR]);
+}
+
+void test_song_list_grows_in_chunks() {
+  SongList list;
+  TEST_ASSERT_EQUAL(0, list.capacity());
+  TEST_ASSERT_TRUE(list.reserve(SONG_CHUNK_SIZE + 1));
+  TEST_ASSERT_EQUAL(2 * SONG_CHUNK_SIZE, list.capacity());
+  SongInfo *first = &list[0];
+  list[SONG_CHUNK_SIZE].songIndex = 7;
+  TEST_ASSERT_TRUE(list.reserve(10 * SONG_CHUNK_SIZE));
+  TEST_ASSERT_EQUAL_PTR(first, &list[0]);    // chunks never move
+  TEST_ASSERT_EQUAL(7, list[SONG_CHUNK_SIZE].songIndex);
+  TEST_ASSERT_FALSE(list.reserve(MAX_SONGS + 1));
+
+  int errors = hostLogCount[LOG_LEVEL_ERROR];
+  list[-1].songIndex = 5;                    // scratch, not a crash
+  TEST_ASSERT_EQUAL(0, list[list.capacity()].songIndex);
+  TEST_ASSERT_EQUAL(errors + 2, hostLogCount[LOG_LEVEL_ERROR]);
+}
+
+void test_select_and_reorder() {
+  fillProject(currentProject, 10, "Song");
+  strcpy(currentProject.projectName, "Live Set");
+  SongSelection picked;
+  picked.toggle(2);
+  picked.toggle(5);
+  picked.toggle(9);
+  TEST_ASSERT_TRUE(selectedProject.select(currentProject, picked, 3));
+  TEST_ASSERT_EQUAL_STRING("Live Set", selectedProject.projectName);
+  TEST_ASSERT_EQUAL(3, selectedProject.songCount);
+  TEST_ASSERT_EQUAL_STRING("Song 5", selectedProject.songs[1].name());
+  TEST_ASSERT_EQUAL(9, selectedProject.songs[2].songIndex);
+  TEST_ASSERT_EQUAL(2, selectedProject.songs[2].changedIndex);
+
+  TEST_ASSERT_TRUE(selectedProject.swapSongs(2, 0));
+  TEST_ASSERT_EQUAL_STRING("Song 9", selectedProject.songs[0].name());
+  TEST_ASSERT_EQUAL_STRING("Song 2", selectedProject.songs[2].name());
+  int errors = hostLogCount[LOG_LEVEL_ERROR];
+  TEST_ASSERT_FALSE(selectedProject.swapSongs(2, 3));     // past songCount
+  TEST_ASSERT_FALSE(selectedProject.swapSongs(-1, 0));
+  TEST_ASSERT_EQUAL(errors, hostLogCount[LOG_LEVEL_ERROR]);
+
+  // Fewer picks than asked for stop at the last pick.
+  TEST_ASSERT_TRUE(selectedProject.select(currentProject, picked, 10));
+  TEST_ASSERT_EQUAL(3, selectedProject.songCount);
+  TEST_ASSERT_FALSE(selectedProject.select(currentProject, picked, MAX_SONGS + 1));
+  TEST_ASSERT_EQUAL(0, selectedProject.songCount);
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Not a pass/fail timing check: prints the cost per song so a change in
+// complexity shows up next to the previous run. Select picks every other
+// song, as New Setlist does; reorder walks the last song to the top one
+// encoder step at a time; save writes the setlist to the LittleFS stand-in.
+void test_benchmark_scan_sizes() {
+  for (int count : { 50, 500, 5000 }) {
+    setUp();
+    LittleFS.files.clear();
+    int errors = hostLogCount[LOG_LEVEL_ERROR];
+    auto start = std::chrono::steady_clock::now();
+    fillProject(currentProject, count, "Benchmark song");
+    double fillUs = elapsedUs(start);
+
+    start = std::chrono::steady_clock::now();
+    loadedPreset.data = currentProject;
+    double copyUs = elapsedUs(start);
+    TEST_ASSERT_EQUAL_STRING(currentProject.songs[count - 1].name(),
+                             loadedPreset.data.songs[count - 1].name());
+
+    start = std::chrono::steady_clock::now();
+    songNames.compact();
+    double compactUs = elapsedUs(start);
+
+    SongSelection picked;
+    for (int i = 0; i < count; i += 2)
+      picked.toggle(i);
+    int half = (count + 1) / 2;
+    start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(selectedProject.select(currentProject, picked, half));
+    double selectUs = elapsedUs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = half - 1; i > 0; i--)
+      TEST_ASSERT_TRUE(selectedProject.swapSongs(i, i - 1));
+    double reorderUs = elapsedUs(start);
+
+    strcpy(loadedPreset.name, "Benchmark");
+    loadedPreset.data = selectedProject;
+    loadedPreset.data.songCount = selectedProject.songCount;
+    start = std::chrono::steady_clock::now();
+    ps::savePresetToDevice(1, loadedPreset);
+    double saveUs = elapsedUs(start);
+    size_t fileBytes = LittleFS.files["/setlists/p1.bin"]->size();
+
+    char line[240];
+    snprintf(line, sizeof(line),
+             "%5d songs: fill %.2f us/song, copy %.0f us, compact %.0f us, %u song bytes, pool %u bytes",
+             count, fillUs / count, copyUs, compactUs, (unsigned)(count * sizeof(SongInfo)),
+             (unsigned)songNames.used());
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line),
+             "%5d songs: select %d %.0f us, reorder %.3f us/step, save %.0f us (%u bytes)",
+             count, half, selectUs, reorderUs / (half - 1), saveUs, (unsigned)fileBytes);
+    TEST_MESSAGE(line);
+
+    // Names are stored once however many projects refer to them.
+    TEST_ASSERT_LESS_THAN((size_t)count * 21 + 1, songNames.used());
+    // The last pick is on top, and the setlist reads back as saved.
+    TEST_ASSERT_EQUAL(2 * (half - 1), selectedProject.songs[0].songIndex);
+    Preset saved = ps::loadPresetFromDevice(1);
+    TEST_ASSERT_EQUAL(half, saved.data.songCount);
+    TEST_ASSERT_EQUAL_STRING(selectedProject.songs[0].name(), saved.data.songs[0].name());
+    TEST_ASSERT_EQUAL(errors, hostLogCount[LOG_LEVEL_ERROR]);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_intern_shares_names);
+  RUN_TEST(test_long_names_are_cut);
+  RUN_TEST(test_names_survive_block_and_index_growth);
+  RUN_TEST(test_compact_keeps_referenced_names_only);
+  RUN_TEST(test_full_pool_fails_loudly);
+  RUN_TEST(test_song_list_grows_in_chunks);
+  RUN_TEST(test_select_and_reorder);
+  RUN_TEST(test_benchmark_scan_sizes);
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+// The ESP32 DMA path of Adafruit_SPITFT against a mock of the IDF SPI
+// master driver: pixels must reach the wire byte for byte and in order,
+// with no working buffer rewritten, DC or CS moved, or CPU write issued
+// while a transaction that reads it is still queued.
+
+#define ESP32 1
+#define USE_SPI_DMA
+#include <unity.h>
+#include "config.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_ILI9341/Adafruit_ILI9341.cpp"
+
+static const uint8_t RAMWR = ILI9341_RAMWR;
+
+// Exposes the DMA state for the checks.
+class TestTFT : public Adafruit_ILI9341 {
+public:
+    TestTFT() : Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_RST) {}
+    bool dmaAttached() const { return dmaDevice != NULL; }
+    uint16_t bufferPixels() const { return maxFillLen; }
+};
+
+static std::vector<uint16_t> pattern(uint32_t len, uint32_t seed) {
+    std::vector<uint16_t> px(len);
+    for (uint32_t i = 0; i < len; i++)
+        px[i] = (uint16_t)((i + seed) * 2654435761u >> 7);
+    return px;
+}
+
+static std::vector<uint8_t> bigEndianBytes(const std::vector<uint16_t> &px) {
+    std::vector<uint8_t> out;
+    for (uint16_t c : px) {
+        out.push_back(c >> 8);
+        out.push_back(c & 0xFF);
+    }
+    return out;
+}
+
+static void assertWire(const std::vector<uint8_t> &expected) {
+    std::vector<uint8_t> sent = hostSpi.dataAfter(RAMWR);
+    TEST_ASSERT_EQUAL(expected.size(), sent.size());
+    TEST_ASSERT_TRUE(expected == sent);
+}
+
+static void assertClean() {
+    TEST_ASSERT_EQUAL(0, hostSpi.cpuDuringDma);
+    TEST_ASSERT_EQUAL(0, hostSpi.pinDuringDma);
+    TEST_ASSERT_EQUAL(0, hostSpi.overQueued);
+    TEST_ASSERT_EQUAL(0, hostSpi.overwritten);
+    TEST_ASSERT_EQUAL(0, hostSpi.reapedNothing);
+    TEST_ASSERT_EQUAL(0, hostSpi.deselected);
+    TEST_ASSERT_TRUE(hostSpi.pending.empty());
+}
+
+void setUp() {
+    hostSpi.reset();
+    hostSpi.dcPin = TFT_DC;
+    hostSpi.csPin = TFT_CS;
+    hostPinHook = hostSpiPinHook;
+    hostSpiBusResult = ESP_OK;
+}
+
+void tearDown() {}
+
+void test_begin_attaches_dma() {
+    TestTFT tft;
+    tft.begin();
+    TEST_ASSERT_TRUE(tft.dmaAttached());
+    TEST_ASSERT_EQUAL(SPITFT_DMA_QUEUE, hostSpi.queueSize);
+    TEST_ASSERT_EQUAL(SPITFT_DMA_BUF_PIXELS, tft.bufferPixels());
+    TEST_ASSERT_EQUAL(0, hostSpi.dmaTransactions);   // the init commands go by CPU
+    assertClean();
+}
+
+void test_pixels_are_swapped_and_sent_in_order() {
+    TestTFT tft;
+    tft.begin();
+    // Several working buffers' worth, so both buffers are reused.
+    std::vector<uint16_t> px = pattern(5 * SPITFT_DMA_BUF_PIXELS + 123, 1);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, px.size() / 320 + 1);
+    tft.writePixels(px.data(), px.size());
+    tft.endWrite();
+    assertWire(bigEndianBytes(px));
+    TEST_ASSERT_EQUAL(6, hostSpi.dmaTransactions);
+    TEST_ASSERT_LESS_THAN(SPITFT_DMA_QUEUE + 1, hostSpi.maxPending);
+    assertClean();
+}
+
+void test_non_blocking_write_copies_the_callers_pixels() {
+    TestTFT tft;
+    tft.begin();
+    std::vector<uint16_t> px = pattern(3 * SPITFT_DMA_BUF_PIXELS, 2);
+    std::vector<uint8_t> expected = bigEndianBytes(px);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(px.data(), px.size(), false);
+    TEST_ASSERT_TRUE(tft.dmaBusy() || !hostSpi.pending.empty());
+    std::fill(px.begin(), px.end(), 0xFFFF);   // the caller reuses its buffer
+    tft.endWrite();
+    assertWire(expected);
+    assertClean();
+}
+
+void test_big_endian_dma_buffer_is_sent_in_place() {
+    TestTFT tft;
+    tft.begin();
+    uint32_t len = SPITFT_DMA_MAX_PIXELS + 500;
+    uint16_t *px = (uint16_t *)heap_caps_malloc(len * 2, MALLOC_CAP_DMA);
+    std::vector<uint16_t> colors = pattern(len, 3);
+    for (uint32_t i = 0; i < len; i++)
+        px[i] = __builtin_bswap16(colors[i]);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(px, len, true, true);
+    tft.endWrite();
+    assertWire(bigEndianBytes(colors));
+    TEST_ASSERT_EQUAL(2, hostSpi.dmaTransactions);   // no copies, largest transactions
+    assertClean();
+    heap_caps_free(px);
+}
+
+void test_fill_reuses_the_color_buffer() {
+    TestTFT tft;
+    tft.begin();
+    tft.fillScreen(ILI9341_RED);
+    uint32_t fills = hostSpi.dmaTransactions;
+    TEST_ASSERT_EQUAL((320 * 240 + SPITFT_DMA_BUF_PIXELS - 1) / SPITFT_DMA_BUF_PIXELS, fills);
+    tft.fillScreen(ILI9341_BLUE);    // refills the buffer only once the red is out
+    std::vector<uint16_t> blue(320 * 240, ILI9341_BLUE);
+    assertWire(bigEndianBytes(blue));
+    assertClean();
+}
+
+void test_mixed_runs_keep_their_order() {
+    TestTFT tft;
+    tft.begin();
+    std::vector<uint16_t> expected;
+    std::vector<uint16_t> run = pattern(SPITFT_DMA_BUF_PIXELS + 7, 4);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writeColor(ILI9341_GREEN, 5000);                  // DMA fill
+    expected.insert(expected.end(), 5000, ILI9341_GREEN);
+    tft.writePixels(run.data(), run.size(), false);       // DMA, past the fill buffer
+    expected.insert(expected.end(), run.begin(), run.end());
+    tft.writePixels(run.data(), 10);                      // short: CPU after the queue drains
+    expected.insert(expected.end(), run.begin(), run.begin() + 10);
+    tft.writeColor(ILI9341_WHITE, 3);                     // short fill: CPU
+    expected.insert(expected.end(), 3, ILI9341_WHITE);
+    tft.writeColor(ILI9341_GREEN, 100);                   // DMA again
+    expected.insert(expected.end(), 100, ILI9341_GREEN);
+    tft.endWrite();
+    assertWire(bigEndianBytes(expected));
+    assertClean();
+}
+
+void test_commands_wait_for_queued_pixels() {
+    TestTFT tft;
+    tft.begin();
+    std::vector<uint16_t> px = pattern(4 * SPITFT_DMA_BUF_PIXELS, 5);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(px.data(), px.size(), false);
+    tft.setAddrWindow(0, 0, 10, 10);   // DC goes low for the command
+    tft.writeColor(ILI9341_BLACK, 100);
+    tft.endWrite();
+    assertClean();
+    assertWire(bigEndianBytes(std::vector<uint16_t>(100, ILI9341_BLACK)));
+}
+
+void test_falls_back_to_cpu_without_the_driver() {
+    hostSpiBusResult = ESP_ERR_NO_MEM;
+    TestTFT tft;
+    tft.begin();
+    TEST_ASSERT_FALSE(tft.dmaAttached());
+    std::vector<uint16_t> px = pattern(3000, 6);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(px.data(), px.size());
+    tft.endWrite();
+    tft.fillRect(0, 0, 40, 40, ILI9341_RED);
+    TEST_ASSERT_EQUAL(0, hostSpi.dmaTransactions);
+    assertWire(bigEndianBytes(std::vector<uint16_t>(1600, ILI9341_RED)));
+    assertClean();
+}
+
+void test_stats_count_bytes_and_bus_time() {
+    TestTFT tft;
+    tft.begin();
+    tft.resetDMAStats();
+    std::vector<uint16_t> px = pattern(10000, 7);
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(px.data(), px.size());
+    tft.endWrite();
+    const SPITFT_DMAStats &s = tft.getDMAStats();
+    TEST_ASSERT_EQUAL_UINT32(hostSpi.dmaTransactions, s.transactions);
+    TEST_ASSERT_EQUAL_UINT32(20000, s.bytes);
+    TEST_ASSERT_GREATER_THAN(0, s.busyUs);
+    TEST_ASSERT_FALSE(tft.dmaBusy());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_attaches_dma);
+    RUN_TEST(test_pixels_are_swapped_and_sent_in_order);
+    RUN_TEST(test_non_blocking_write_copies_the_callers_pixels);
+    RUN_TEST(test_big_endian_dma_buffer_is_sent_in_place);
+    RUN_TEST(test_fill_reuses_the_color_buffer);
+    RUN_TEST(test_mixed_runs_keep_their_order);
+    RUN_TEST(test_commands_wait_for_queued_pixels);
+    RUN_TEST(test_falls_back_to_cpu_without_the_driver);
+    RUN_TEST(test_stats_count_bytes_and_bus_time);
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+// Incremental sync against a full rescan: add, remove and rename ops sent as
+// the remote would send them must leave currentProject exactly as scanning
+// the new list from scratch does, songIndex and hash included.
+
+#include <unity.h>
+#include <string>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+// Modules _midi.cpp reports to that sync doesn't involve.
+void Transport::clock(uint32_t) {}
+void Transport::start() {}
+void Transport::resume() {}
+void Transport::stop() {}
+void Transport::songPosition(uint16_t) {}
+void LinkMonitor::onReply(const uint8_t *, unsigned) {}
+
+struct ModelSong {
+  std::string name;
+  int seconds;
+};
+typedef std::vector<ModelSong> Model;
+typedef std::vector<uint8_t> Message;
+
+static void deliver(Message m) {
+  Midi::handleSysEx(m.data(), m.size());
+}
+
+static Message header(uint8_t type) {
+  return { 0xF0, 0x00, 0x01, 0x61, type };
+}
+
+static void appendSong(Message &m, int seq, const ModelSong &song) {
+  m.push_back((uint8_t)(seq & 0x7F));   // index byte, superseded by seq
+  m.insert(m.end(), song.name.begin(), song.name.end());
+  m.push_back(0x00);
+  std::string time = std::to_string(song.seconds);
+  m.insert(m.end(), time.begin(), time.end());
+  m.push_back(0xF7);
+}
+
+// Full sequenced scan of model into currentProject.
+static void rescan(const Model &model) {
+  ScanSession::begin();
+  Message name = header(0x02);
+  const char *project = "Live Set";
+  name.insert(name.end(), project, project + strlen(project));
+  name.push_back(0xF7);
+  deliver(name);
+  int n = model.size();
+  deliver({ 0xF0, 0x00, 0x01, 0x61, 0x03, (uint8_t)(n & 0x7F), (uint8_t)(n >> 7), 0xF7 });
+  for (int seq = 0; seq < n; seq++) {
+    Message m = header(0x04);
+    m.push_back((uint8_t)(seq & 0x7F));
+    m.push_back((uint8_t)(seq >> 7));
+    appendSong(m, seq, model[seq]);
+    deliver(m);
+  }
+  deliver({ 0xF0, 0x00, 0x01, 0x61, 0x00, 0x7F, 0xF7 });
+  TEST_ASSERT_TRUE(ScanSession::complete());
+}
+
+static Message op(uint8_t code, int seq) {
+  Message m = header(0x06);
+  m.push_back(code);
+  m.push_back((uint8_t)(seq & 0x7F));
+  m.push_back((uint8_t)(seq >> 7));
+  return m;
+}
+
+// Applies one op to the model and returns the message that carries it.
+static Message addOp(Model &model, int seq, const ModelSong &song) {
+  model.insert(model.begin() + seq, song);
+  Message m = op(0x01, seq);
+  appendSong(m, seq, song);
+  return m;
+}
+
+static Message removeOp(Model &model, int seq) {
+  model.erase(model.begin() + seq);
+  Message m = op(0x02, seq);
+  m.push_back(0xF7);
+  return m;
+}
+
+static Message renameOp(Model &model, int seq, const std::string &name) {
+  model[seq].name = name;
+  Message m = op(0x03, seq);
+  m.insert(m.end(), name.begin(), name.end());
+  m.push_back(0xF7);
+  return m;
+}
+
+static Model numbered(int count) {
+  Model model;
+  for (int i = 0; i < count; i++)
+    model.push_back({ "Song " + std::to_string(i), 60 * i });
+  return model;
+}
+
+// Sends the device's hash; what it sends is dropped, the test plays the remote.
+static void beginSync() {
+  ProjectSync::begin();
+  Midi::flush();
+  hostUsb.fromDevice.clear();
+}
+
+static void endDiff(uint32_t remoteHash) {
+  Message end = header(0x07);
+  end.resize(10);
+  ProjectSync::encodeHash(remoteHash, &end[5]);
+  end.push_back(0xF7);
+  deliver(end);
+}
+
+static void assertSameProject(const ProjectInfo &expected, const ProjectInfo &actual) {
+  TEST_ASSERT_EQUAL(expected.songCount, actual.songCount);
+  for (int i = 0; i < expected.songCount; i++) {
+    TEST_ASSERT_EQUAL_STRING(expected.songs[i].name(), actual.songs[i].name());
+    TEST_ASSERT_EQUAL(expected.songs[i].songIndex, actual.songs[i].songIndex);
+    TEST_ASSERT_EQUAL_UINT32(expected.songs[i].locatorMs, actual.songs[i].locatorMs);
+  }
+  TEST_ASSERT_EQUAL_HEX32(ProjectSync::hash(expected), ProjectSync::hash(actual));
+}
+
+// Scans before, syncs to after with ops, and checks the result against a
+// scan of after.
+static void syncAndCompare(const Model &before, const Model &after, const std::vector<Message> &ops) {
+  rescan(after);
+  ProjectInfo expected = currentProject;
+  rescan(before);
+
+  beginSync();
+  for (const Message &m : ops)
+    deliver(m);
+  endDiff(ProjectSync::hash(expected));
+
+  TEST_ASSERT_EQUAL(SyncResult::UPDATED, ProjectSync::result());
+  assertSameProject(expected, currentProject);
+}
+
+void setUp() {
+  static bool started = false;
+  if (!started) {
+    Midi::begin();
+    started = true;
+  }
+}
+
+void tearDown() {}
+
+void test_remove_renumbers_later_songs() {
+  Model before = numbered(6), after = before;
+  std::vector<Message> ops = { removeOp(after, 0), removeOp(after, 2) };
+  syncAndCompare(before, after, ops);
+  TEST_ASSERT_EQUAL_STRING("Song 1", currentProject.songs[0].name());
+  TEST_ASSERT_EQUAL(0, currentProject.songs[0].songIndex);
+  TEST_ASSERT_EQUAL_STRING("Song 5", currentProject.songs[3].name());
+  TEST_ASSERT_EQUAL(3, currentProject.songs[3].songIndex);
+  TEST_ASSERT_EQUAL_UINT32(0, currentProject.songs[4].nameId);   // vacated slot
+}
+
+void test_add_renumbers_later_songs() {
+  Model before = numbered(5), after = before;
+  std::vector<Message> ops = { addOp(after, 0, { "Opener", 5 }), addOp(after, 3, { "Middle", 7 }),
+                               addOp(after, 7, { "Encore", 9 }) };
+  syncAndCompare(before, after, ops);
+  TEST_ASSERT_EQUAL_STRING("Song 4", currentProject.songs[6].name());
+  TEST_ASSERT_EQUAL(6, currentProject.songs[6].songIndex);
+  TEST_ASSERT_EQUAL(7, currentProject.songs[7].songIndex);
+}
+
+void test_rename_keeps_index() {
+  Model before = numbered(4), after = before;
+  std::vector<Message> ops = { renameOp(after, 2, "Two, renamed") };
+  syncAndCompare(before, after, ops);
+  TEST_ASSERT_EQUAL(2, currentProject.songs[2].songIndex);
+}
+
+void test_random_edits_match_a_rescan() {
+  uint32_t seed = 12345;
+  auto next = [&seed](int range) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int)((seed >> 8) % range);
+  };
+  for (int round = 0; round < 100; round++) {
+    Model before = numbered(1 + next(300)), after = before;
+    std::vector<Message> ops;
+    int count = 1 + next(20);
+    for (int i = 0; i < count; i++) {
+      int kind = next(3);
+      if (kind == 0 || after.empty()) {
+        ModelSong song = { "Added " + std::to_string(round) + "." + std::to_string(i), next(5000) };
+        ops.push_back(addOp(after, next(after.size() + 1), song));
+      } else if (kind == 1) {
+        ops.push_back(removeOp(after, next(after.size())));
+      } else {
+        ops.push_back(renameOp(after, next(after.size()), "Renamed " + std::to_string(next(1000))));
+      }
+    }
+    syncAndCompare(before, after, ops);
+  }
+}
+
+void test_hash_covers_song_index() {
+  rescan(numbered(3));
+  ProjectInfo project = currentProject;
+  uint32_t h = ProjectSync::hash(project);
+  project.songs[1].songIndex = 2;
+  TEST_ASSERT_NOT_EQUAL(h, ProjectSync::hash(project));
+}
+
+void test_stale_index_forces_a_rescan() {
+  Model before = numbered(5), after = before;
+  std::vector<Message> ops = { removeOp(after, 1) };
+  rescan(after);
+  uint32_t remoteHash = ProjectSync::hash(currentProject);
+  rescan(before);
+
+  beginSync();
+  for (const Message &m : ops)
+    deliver(m);
+  currentProject.songs[2].songIndex = 7;   // as if the remove hadn't renumbered it
+  endDiff(remoteHash);
+  TEST_ASSERT_EQUAL(SyncResult::MISMATCH, ProjectSync::result());
+}
+
+void test_out_of_range_op_fails() {
+  rescan(numbered(3));
+  uint32_t h = ProjectSync::hash(currentProject);
+  beginSync();
+  Message remove = op(0x02, 3);
+  remove.push_back(0xF7);
+  deliver(remove);
+  endDiff(h);
+  TEST_ASSERT_EQUAL(SyncResult::MISMATCH, ProjectSync::result());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_remove_renumbers_later_songs);
+  RUN_TEST(test_add_renumbers_later_songs);
+  RUN_TEST(test_rename_keeps_index);
+  RUN_TEST(test_random_edits_match_a_rescan);
+  RUN_TEST(test_hash_covers_song_index);
+  RUN_TEST(test_stale_index_forces_a_rescan);
+  RUN_TEST(test_out_of_range_op_fails);
+  return UNITY_END();
+}
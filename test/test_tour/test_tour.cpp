@@ -0,0 +1,237 @@
+// The screen tour on the host: every ScreenState is drawn with the tour's
+// fixtures into the capture canvas and to a model ILI9341 over the SPI DMA
+// mock. What reaches the panel must be exactly what was captured, and each
+// screen's hash and SPI cost is printed. Set SCREEN_TOUR_LOG to a path to
+// also write the tour's TOUR/SHOT log there for tools/screen_tour.py. The
+// home screen's progress bar is also run for ten seconds of a playing song
+// to put a number on its cost per frame.
+
+#define ESP32 1
+#define USE_SPI_DMA
+#include <unity.h>
+#include <chrono>
+#include "host_log.h"
+#include "host_ili9341.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_ILI9341/Adafruit_ILI9341.cpp"
+#include "../../lib/XPT2046_Touchscreen/XPT2046_Touchscreen.cpp"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_render.cpp"
+#include "../../src/_spibus.cpp"
+#include "../../src/_band.cpp"
+#include "../../src/_ui.cpp"
+#include "../../src/_tour.cpp"
+#include "../../src/_preset.cpp"
+#include "../../src/_progress.cpp"
+#include "../../src/_transport.cpp"
+#include "../../src/_link.cpp"
+#include "../../src/_cue.cpp"
+#include "../../src/_tasks.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+static const int SCREEN_COUNT = (int)ScreenState::WIFI_PROPERTIES + 1;
+
+// Collects what the tour prints.
+class LogPrint : public Print {
+public:
+    size_t write(uint8_t b) override {
+        text += (char)b;
+        return 1;
+    }
+
+    std::string text;
+};
+
+// One UI and panel for the run, as on the device (Adafruit_ILI9341 keeps
+// the last address window in statics).
+static UI ui;
+static HostPanel panel(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+static void assertPanelShows(const GFXcanvas16 &frame, const char *screen) {
+    panel.update();
+    TEST_ASSERT_EQUAL_MESSAGE(0, hostSpi.errors(), screen);
+    TEST_ASSERT_EQUAL_MESSAGE(0, panel.outside, screen);
+    const uint16_t *expected = frame.getBuffer();
+    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+        for (int x = 0; x < DISPLAY_WIDTH; x++) {
+            if (panel.at(x, y) != expected[y * DISPLAY_WIDTH + x]) {
+                char msg[96];
+                snprintf(msg, sizeof(msg), "%s pixel %d,%d: panel 0x%04X, captured 0x%04X", screen, x, y,
+                         panel.at(x, y), expected[y * DISPLAY_WIDTH + x]);
+                TEST_FAIL_MESSAGE(msg);
+            }
+        }
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_panel_matches_capture_on_every_screen() {
+    GFXcanvas16 frame(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    memcpy(frame.getBuffer(), panel.fb.data(), panel.fb.size() * sizeof(uint16_t));
+    ScreenTour::loadFixtures();
+    for (int i = 0; i < SCREEN_COUNT; i++) {
+        const char *name = UI::screenName((ScreenState)i);
+        TourResult r = ScreenTour::shoot(ui, (ScreenState)i, frame);
+        assertPanelShows(frame, name);
+        TEST_ASSERT_GREATER_THAN_MESSAGE(0, r.spiBytes, name);
+
+        char line[128];
+        snprintf(line, sizeof(line), "%-20s hash=%08lx ops=%4u bytes=%6lu dma=%3lu bus=%3lu", name,
+                 (unsigned long)r.hash, r.ops, (unsigned long)r.spiBytes, (unsigned long)r.spiTxns,
+                 (unsigned long)r.busHolds);
+        TEST_MESSAGE(line);
+    }
+}
+
+static std::vector<std::string> tourLines(const std::string &log) {
+    std::vector<std::string> lines;
+    size_t at = 0, end;
+    while ((end = log.find('\n', at)) != std::string::npos) {
+        if (log.compare(at, 5, "TOUR ") == 0)
+            lines.push_back(log.substr(at, end - at));
+        at = end + 1;
+    }
+    return lines;
+}
+
+// The same fixtures give the same frames and the same bus traffic: a
+// baseline taken from one run is valid for the next.
+void test_tour_is_repeatable() {
+    LogPrint first, second;
+    ScreenTour::run(ui, first, false);
+    ScreenTour::run(ui, second, false);
+    std::vector<std::string> a = tourLines(first.text), b = tourLines(second.text);
+    TEST_ASSERT_EQUAL(SCREEN_COUNT + 2, a.size());   // begin, screens, end
+    TEST_ASSERT_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        // Everything but the timings, which follow the host clock.
+        TEST_ASSERT_EQUAL_STRING(a[i].substr(0, a[i].find(" push=")).c_str(),
+                                 b[i].substr(0, b[i].find(" push=")).c_str());
+    }
+    panel.update();
+    TEST_ASSERT_EQUAL(0, hostSpi.errors());
+}
+
+// Frame dumps decode back to the captured pixels, and the log can be handed
+// to tools/screen_tour.py.
+void test_dump_matches_frame() {
+    LogPrint log;
+    ScreenTour::run(ui, log, true);
+    panel.update();
+    const char *path = getenv("SCREEN_TOUR_LOG");
+    if (path) {
+        FILE *f = fopen(path, "w");
+        TEST_ASSERT_NOT_NULL(f);
+        fwrite(log.text.data(), 1, log.text.size(), f);
+        fclose(f);
+    }
+
+    // The last SHOT is WIFI_PROPERTIES, which the panel still shows.
+    size_t shot = log.text.rfind("SHOT WIFI_PROPERTIES 320 240\n");
+    TEST_ASSERT_TRUE(shot != std::string::npos);
+    const char *p = log.text.c_str() + log.text.find('\n', shot) + 1;
+    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+        TEST_ASSERT_EQUAL_CHAR('|', *p++);
+        int x = 0;
+        unsigned run, color;
+        int used;
+        while (*p == ' ' && sscanf(p, " %x:%x%n", &run, &color, &used) == 2) {
+            for (unsigned i = 0; i < run; i++, x++)
+                TEST_ASSERT_EQUAL_HEX16(panel.at(x, y), color);
+            p += used;
+        }
+        TEST_ASSERT_EQUAL(DISPLAY_WIDTH, x);
+        TEST_ASSERT_EQUAL_CHAR('\n', *p++);
+    }
+    TEST_ASSERT_EQUAL(0, strncmp(p, "SHOT end\n", 9));
+}
+
+// The progress bar every PROGRESS_FRAME_MS for ten seconds into the first
+// song of the fixture setlist at 120 bpm, as the render task draws it: the pixels and SPI bytes each frame puts
+// on the wire, and the wire time at DISPLAY_SPI_FREQ as a share of the frame
+// period. The budget is 1% of the display's time, on average.
+void test_progress_frame_cost() {
+    const uint32_t CLOCK_US = 60000000UL / (24 * 120);
+    ScreenTour::loadFixtures();
+    StateStore::setTrack(0);
+    for (int i = 0; i < 48; i++) {        // tempo known before Start
+        Transport::clock(micros());
+        hostAdvanceUs(CLOCK_US);
+    }
+    Transport::songPosition(240 * 2 * 4);  // the song's locator at 240 s
+    Transport::resume();
+    uint64_t clockDueUs = hostNowUs;
+    ui.setScreenState(ScreenState::HOME);
+    panel.update();
+
+    const int FRAMES = 10000 / PROGRESS_FRAME_MS;
+    uint32_t pixels = 0, bytes = 0, maxBytes = 0, drawn = 0;
+    double cpuUs = 0;
+    for (int f = 0; f < FRAMES; f++) {
+        uint64_t end = hostNowUs + PROGRESS_FRAME_MS * 1000ULL;
+        while (clockDueUs < end) {
+            hostNowUs = clockDueUs;
+            Transport::clock(micros());
+            clockDueUs += CLOCK_US;
+        }
+        hostNowUs = end;
+        uint32_t before = panel.pixelsWritten;
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            Render::Lock lock;
+            ui.drawRegions(REGION_PROGRESS);
+        }
+        cpuUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        uint32_t frameBytes = hostSpi.wire.size();
+        panel.update();
+        pixels += panel.pixelsWritten - before;
+        bytes += frameBytes;
+        maxBytes = frameBytes > maxBytes ? frameBytes : maxBytes;
+        drawn += frameBytes > 0;
+    }
+    Transport::stop();
+    TEST_ASSERT_EQUAL(0, hostSpi.errors());
+    TEST_ASSERT_GREATER_THAN(0, drawn);    // the bar moved and the times ticked
+
+    double wireUs = 8.0e6 / DISPLAY_SPI_FREQ;
+    double avgPct = bytes * wireUs / FRAMES / (PROGRESS_FRAME_MS * 10.0);
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%d frames, %lu drew: %.0f px and %.0f bytes per frame (max %lu bytes, %.0f us on the wire)",
+             FRAMES, (unsigned long)drawn, (double)pixels / FRAMES, (double)bytes / FRAMES,
+             (unsigned long)maxBytes, maxBytes * wireUs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "wire time %.3f%% of the display on average, host CPU %.1f us per frame",
+             avgPct, cpuUs / FRAMES);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(avgPct < 1.0);
+}
+
+int main() {
+    hostSpi.dcPin = TFT_DC;
+    hostSpi.csPin = TFT_CS;
+    hostPinHook = hostSpiPinHook;
+    Render::begin(ui);   // the lock; no task is started on the host
+    ui.init();
+    panel.update();
+    // Two stored presets for SELECT_SETLIST, which reads names from NVS.
+    ScreenTour::loadFixtures();
+    ps::savePresetToDevice(1, loadedPreset);
+    ps::savePresetToDevice(3, loadedPreset);
+    UNITY_BEGIN();
+    RUN_TEST(test_panel_matches_capture_on_every_screen);
+    RUN_TEST(test_tour_is_repeatable);
+    RUN_TEST(test_dump_matches_frame);
+    RUN_TEST(test_progress_frame_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// The Transport PLL against a jittered MIDI clock. Clocks are generated at
+// exact tempos and timestamped the way the MIDI task sees them: up to a poll
+// period late, now and then held up for several milliseconds, never out of
+// order. The estimate must settle on the true tempo without relocking, keep
+// the playhead on the true song time, and follow real tempo changes.
+
+#include <unity.h>
+#include <cmath>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_transport.cpp"
+
+// A clock source at a true tempo, read by a polling task.
+struct JitteredClock {
+  double bpm;
+  double trueUs;            // when the current clock was sent
+  uint32_t lastReadUs;
+  uint32_t seed = 1;
+  int stallPercent = 2;     // clocks held up by a busy MIDI task
+  uint32_t stallUs = 8000;
+
+  JitteredClock(double bpm, uint32_t startUs) : bpm(bpm), trueUs(startUs), lastReadUs(startUs) {}
+
+  double periodUs() const { return 60e6 / (24 * bpm); }
+
+  uint32_t random(uint32_t range) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (seed >> 8) % range;
+  }
+
+  // Sends the next clock and returns when it was read.
+  uint32_t next() {
+    trueUs += periodUs();
+    uint32_t late = random(MIDI_POLL_MS * 1000);
+    if ((int)random(100) < stallPercent)
+      late += random(stallUs);
+    uint32_t read = (uint32_t)(uint64_t)(trueUs + late);
+    if ((int32_t)(read - lastReadUs) < 0)
+      read = lastReadUs;     // one task reads them in order
+    lastReadUs = read;
+    Transport::clock(read);
+    return read;
+  }
+
+  void run(int clocks) {
+    for (int i = 0; i < clocks; i++)
+      next();
+  }
+};
+
+static void assertTempo(double bpm, double tolerance) {
+  double measured = Transport::tempoCentiBpm() / 100.0;
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%.2f bpm measured for %.2f", measured, bpm);
+  TEST_ASSERT_TRUE_MESSAGE(fabs(measured - bpm) <= bpm * tolerance, msg);
+}
+
+void setUp() {
+  Transport::reset();
+  StateStore::setTransport(false);
+}
+
+void tearDown() {}
+
+void test_settles_on_the_true_tempo() {
+  for (double bpm : { 60.0, 98.7, 120.0, 128.5, 174.0, 240.0 }) {
+    setUp();
+    JitteredClock clock(bpm, 1000000);
+    clock.run(24 * 16);
+    TEST_ASSERT_TRUE(Transport::locked());
+    assertTempo(bpm, 0.002);
+
+    TransportStats s = Transport::stats();
+    TEST_ASSERT_EQUAL(0, s.relocks);
+    TEST_ASSERT_LESS_THAN((int32_t)(MIDI_POLL_MS * 1000 + clock.stallUs), s.maxErrorUs);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%6.1f bpm: measured %6.2f, worst arrival error %5ld us", bpm,
+             Transport::tempoCentiBpm() / 100.0, (long)s.maxErrorUs);
+    TEST_MESSAGE(line);
+  }
+}
+
+// The played position tracks the true song time, between clocks as well,
+// and never runs backwards.
+void test_playhead_follows_song_time() {
+  JitteredClock clock(126.0, 5000000);
+  clock.run(48);                 // tempo known before Start
+  Transport::start();
+  uint32_t nowUs = clock.next(); // the Start position itself
+  double songStartUs = clock.trueUs;
+  uint32_t last = 0;
+  for (int i = 0; i < 24 * 64; i++) {
+    uint32_t readUs = clock.next();
+    for (; (int32_t)(nowUs - readUs) < 0; nowUs += 997) {
+      uint32_t ms = Transport::playheadMs(nowUs);
+      TEST_ASSERT_TRUE(ms >= last);
+      last = ms;
+    }
+    if (i > 48) {
+      double trueMs = ((double)(readUs - (uint32_t)songStartUs)) / 1000.0;
+      TEST_ASSERT_INT_WITHIN(MIDI_POLL_MS + 2, (uint32_t)trueMs, Transport::playheadMs(readUs));
+    }
+  }
+  TEST_ASSERT_EQUAL(24 * 64, Transport::ticks());
+}
+
+// The next beat is predicted within the arrival jitter.
+void test_next_beat_is_predicted() {
+  JitteredClock clock(140.0, 0);
+  clock.stallPercent = 0;
+  clock.run(24 * 4);
+  Transport::start();
+  clock.next();
+  clock.run(24 * 8 - 1);
+  uint32_t nowUs = clock.lastReadUs;
+  uint32_t predicted = nowUs + Transport::usUntilTick(Transport::ticks() + 24, nowUs);
+  for (int i = 0; i < 24; i++)
+    clock.next();
+  TEST_ASSERT_INT_WITHIN(MIDI_POLL_MS * 1000 * 2, clock.lastReadUs, predicted);
+}
+
+// A real tempo change relocks once and settles on the new tempo.
+void test_follows_a_tempo_jump() {
+  JitteredClock clock(120.0, 0);
+  clock.run(24 * 8);
+  assertTempo(120.0, 0.002);
+  clock.bpm = 90.0;
+  clock.run(TRANSPORT_RELOCK_CLOCKS + TRANSPORT_LOCK_CLOCKS + 24 * 8);
+  TEST_ASSERT_EQUAL(1, Transport::stats().relocks);
+  TEST_ASSERT_TRUE(Transport::locked());
+  assertTempo(90.0, 0.002);
+}
+
+// A slow ramp, as from automation, is tracked without relocks.
+void test_follows_a_tempo_ramp() {
+  JitteredClock clock(100.0, 0);
+  clock.run(24 * 8);
+  for (int beat = 0; beat < 64; beat++) {
+    clock.bpm += 0.25;
+    clock.run(24);
+  }
+  TEST_ASSERT_EQUAL(0, Transport::stats().relocks);
+  assertTempo(clock.bpm, 0.005);
+}
+
+// The clock counter wraps about every 71 minutes.
+void test_micros_wrap() {
+  JitteredClock clock(120.0, UINT32_MAX - 24 * 20833);
+  clock.run(24 * 16);
+  TEST_ASSERT_EQUAL(0, Transport::stats().relocks);
+  assertTempo(120.0, 0.002);
+}
+
+// Clocks stopping for a while isn't a tempo change: the estimate is kept.
+void test_pause_keeps_the_tempo() {
+  JitteredClock clock(110.0, 0);
+  clock.run(24 * 8);
+  clock.trueUs += 2e6;
+  clock.run(2);
+  assertTempo(110.0, 0.002);
+  clock.run(24 * 4);
+  TEST_ASSERT_EQUAL(0, Transport::stats().relocks);
+  assertTempo(110.0, 0.002);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_settles_on_the_true_tempo);
+  RUN_TEST(test_playhead_follows_song_time);
+  RUN_TEST(test_next_beat_is_predicted);
+  RUN_TEST(test_follows_a_tempo_jump);
+  RUN_TEST(test_follows_a_tempo_ramp);
+  RUN_TEST(test_micros_wrap);
+  RUN_TEST(test_pause_keeps_the_tempo);
+  return UNITY_END();
+}
@@ -0,0 +1,487 @@
+// The USB MIDI interface on the host: the interface descriptor for 1, 3 and
+// 4 cables walked as a USB host reads it, the per-cable event packet packer
+// against the USB MIDI 1.0 code index table, and the MidiPortStream paths:
+// the per-cable receive ring and the per-port send queue.
+
+#include <unity.h>
+#include <map>
+#include <set>
+#include "host_log.h"
+#include "../../src/config.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+typedef std::vector<uint8_t> Bytes;
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 8) % range;
+}
+
+// Bytes a packet carries, by Code Index Number (USB MIDI 1.0, table 4-1).
+static int cinBytes(uint8_t cin) {
+  static const int bytes[16] = { -1, -1, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+  return bytes[cin & 0x0F];
+}
+
+// Byte stream per cable out of what the device wrote.
+static std::map<int, Bytes> unpack(const std::vector<HostUsbPacket> &packets) {
+  std::map<int, Bytes> streams;
+  for (const HostUsbPacket &p : packets) {
+    int n = cinBytes(p[0]);
+    TEST_ASSERT_GREATER_THAN(0, n);
+    for (int i = 0; i < 3; i++) {
+      if (i >= n)
+        TEST_ASSERT_EQUAL_HEX8(0, p[1 + i]);   // unused bytes are zero
+      else
+        streams[p[0] >> 4].push_back(p[1 + i]);
+    }
+  }
+  return streams;
+}
+
+// ---- Interface descriptor ----
+
+struct Descriptor {
+  const uint8_t *d;
+};
+
+// Splits buf into descriptors by bLength; every byte must belong to one.
+static std::vector<Descriptor> walk(const uint8_t *buf, uint16_t len) {
+  std::vector<Descriptor> out;
+  uint16_t at = 0;
+  while (at < len) {
+    TEST_ASSERT_GREATER_OR_EQUAL(2, buf[at]);
+    TEST_ASSERT_LESS_OR_EQUAL(len - at, buf[at]);
+    out.push_back({ buf + at });
+    at += buf[at];
+  }
+  TEST_ASSERT_EQUAL(len, at);
+  return out;
+}
+
+// Checks a descriptor the way a host parses it: an Audio Control interface
+// pointing at a MIDI Streaming interface, a pair of embedded and external
+// jacks each way per cable, and bulk endpoints whose jack lists name the
+// embedded jacks.
+static void checkDescriptor(const uint8_t *buf, uint16_t len, uint8_t cables, uint8_t itf, uint8_t epIn,
+                            uint8_t epOut, const uint8_t *names) {
+  std::vector<Descriptor> ds = walk(buf, len);
+  TEST_ASSERT_EQUAL(4 + 4 * cables + 4, ds.size());
+
+  // Audio Control interface, no endpoints, and its header.
+  const uint8_t *ac = ds[0].d;
+  TEST_ASSERT_EQUAL(9, ac[0]);
+  TEST_ASSERT_EQUAL(0x04, ac[1]);
+  TEST_ASSERT_EQUAL(itf, ac[2]);
+  TEST_ASSERT_EQUAL(0, ac[4]);
+  TEST_ASSERT_EQUAL(1, ac[5]);
+  TEST_ASSERT_EQUAL(1, ac[6]);
+  const uint8_t *acHeader = ds[1].d;
+  TEST_ASSERT_EQUAL(0x24, acHeader[1]);
+  TEST_ASSERT_EQUAL(1, acHeader[7]);            // one streaming interface
+  TEST_ASSERT_EQUAL(itf + 1, acHeader[8]);
+  TEST_ASSERT_EQUAL(acHeader[0], acHeader[5] | acHeader[6] << 8);
+
+  // MIDI Streaming interface with two endpoints, and its header, whose
+  // total covers everything after it.
+  const uint8_t *ms = ds[2].d;
+  TEST_ASSERT_EQUAL(0x04, ms[1]);
+  TEST_ASSERT_EQUAL(itf + 1, ms[2]);
+  TEST_ASSERT_EQUAL(2, ms[4]);
+  TEST_ASSERT_EQUAL(1, ms[5]);
+  TEST_ASSERT_EQUAL(3, ms[6]);
+  const uint8_t *msHeader = ds[3].d;
+  TEST_ASSERT_EQUAL(0x24, msHeader[1]);
+  TEST_ASSERT_EQUAL(0x01, msHeader[2]);
+  TEST_ASSERT_EQUAL(buf + len - msHeader, msHeader[5] | msHeader[6] << 8);
+
+  // Jacks: IDs unique, every OUT jack fed by an IN jack of the other kind.
+  std::map<uint8_t, uint8_t> inJacks;            // id -> embedded/external
+  std::set<uint8_t> embeddedIn, embeddedOut, ids;
+  size_t d = 4;
+  for (uint8_t c = 0; c < cables; c++) {
+    for (int j = 0; j < 4; j++, d++) {
+      const uint8_t *jack = ds[d].d;
+      TEST_ASSERT_EQUAL(0x24, jack[1]);
+      uint8_t kind = jack[3], id = jack[4];
+      TEST_ASSERT_TRUE(ids.insert(id).second);
+      if (jack[2] == 0x02) {
+        TEST_ASSERT_EQUAL(6, jack[0]);
+        TEST_ASSERT_EQUAL(names[c], jack[5]);
+        inJacks[id] = kind;
+        if (kind == 0x01)
+          embeddedIn.insert(id);
+      } else {
+        TEST_ASSERT_EQUAL(0x03, jack[2]);
+        TEST_ASSERT_EQUAL(9, jack[0]);
+        TEST_ASSERT_EQUAL(1, jack[5]);           // one source
+        TEST_ASSERT_TRUE(inJacks.count(jack[6]));
+        TEST_ASSERT_NOT_EQUAL(kind, inJacks[jack[6]]);
+        TEST_ASSERT_EQUAL(names[c], jack[8]);
+        if (kind == 0x01)
+          embeddedOut.insert(id);
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL(cables, embeddedIn.size());
+  TEST_ASSERT_EQUAL(cables, embeddedOut.size());
+
+  // OUT endpoint feeds the embedded IN jacks, IN endpoint drains the
+  // embedded OUT jacks.
+  for (int e = 0; e < 2; e++) {
+    const uint8_t *ep = ds[d++].d;
+    TEST_ASSERT_EQUAL(9, ep[0]);
+    TEST_ASSERT_EQUAL(0x05, ep[1]);
+    TEST_ASSERT_EQUAL_HEX8(e == 0 ? epOut : epIn, ep[2]);
+    TEST_ASSERT_EQUAL(0x02, ep[3]);              // bulk
+    TEST_ASSERT_EQUAL(64, ep[4] | ep[5] << 8);
+    const uint8_t *cs = ds[d++].d;
+    TEST_ASSERT_EQUAL(4 + cables, cs[0]);
+    TEST_ASSERT_EQUAL(0x25, cs[1]);
+    TEST_ASSERT_EQUAL(cables, cs[3]);
+    const std::set<uint8_t> &expected = e == 0 ? embeddedIn : embeddedOut;
+    std::set<uint8_t> listed(cs + 4, cs + 4 + cables);
+    TEST_ASSERT_TRUE(listed == expected);
+  }
+}
+
+static void checkCables(uint8_t requested, uint8_t expected) {
+  ESPNATIVEUSBMIDI midi(requested);
+  TEST_ASSERT_EQUAL(expected, midi.cables());
+  uint8_t names[ESPNATIVEUSBMIDI_MAX_CABLES] = {};
+  for (uint8_t c = 0; c < expected; c++) {
+    std::string name = "Port " + std::to_string(c + 1);
+    midi.setCableName(c, name.c_str());
+    names[c] = (uint8_t)(hostUsb.strings.size() - 1);
+  }
+  midi.setCableName(expected, "no such cable");   // ignored
+
+  uint16_t len = midi.getInterfaceDescriptor(0, nullptr, 0);
+  TEST_ASSERT_EQUAL(34 + 30 * expected + 2 * (13 + expected), len);
+  // Exactly sized, so a write past the end shows up under ASan.
+  uint8_t *buf = (uint8_t *)malloc(len);
+  TEST_ASSERT_EQUAL(len, midi.makeItfDesc(5, buf, len, 0x83, 0x03));
+  checkDescriptor(buf, len, expected, 5, 0x83, 0x03, names);
+  free(buf);
+
+  buf = (uint8_t *)malloc(len - 1);
+  TEST_ASSERT_EQUAL(0, midi.makeItfDesc(5, buf, len - 1, 0x83, 0x03));
+  free(buf);
+}
+
+void test_descriptor_one_cable() {
+  checkCables(1, 1);
+  checkCables(0, 1);
+}
+
+void test_descriptor_three_cables() {
+  checkCables(3, 3);
+}
+
+void test_descriptor_four_cables() {
+  checkCables(4, 4);
+  checkCables(9, ESPNATIVEUSBMIDI_MAX_CABLES);
+}
+
+// What the Arduino core gets for the firmware's interface: usbmidi, named
+// by MidiPorts::begin(), on the endpoints the core hands out.
+void test_registered_descriptor() {
+  TEST_ASSERT_NOT_NULL(hostUsb.loadDescriptor);
+  TEST_ASSERT_EQUAL(usbmidi.getInterfaceDescriptor(0, nullptr, 0), hostUsb.descriptorLen);
+  std::vector<uint8_t> buf(hostUsb.descriptorLen);
+  uint8_t itf = 2;
+  hostUsb.nextEndpoint = 3;
+  TEST_ASSERT_EQUAL(hostUsb.descriptorLen, hostUsb.loadDescriptor(buf.data(), &itf));
+  TEST_ASSERT_EQUAL(4, itf);
+  // Each cable is named after the port that reads it.
+  uint8_t names[MIDI_USB_CABLES] = {};
+  for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+    if (!MidiPorts::reader((MidiPort)p))
+      continue;
+    for (size_t i = 0; i < hostUsb.strings.size(); i++) {
+      if (hostUsb.strings[i] == MidiPorts::name((MidiPort)p))
+        names[MidiPorts::cable((MidiPort)p)] = (uint8_t)i;
+    }
+  }
+  checkDescriptor(buf.data(), buf.size(), MIDI_USB_CABLES, 2, 0x83, 0x03, names);
+  for (uint8_t c = 0; c < MIDI_USB_CABLES; c++)
+    TEST_ASSERT_NOT_EQUAL(0, names[c]);
+  // Registered once: a second call loads nothing.
+  TEST_ASSERT_EQUAL(0, hostUsb.loadDescriptor(buf.data(), &itf));
+}
+
+// ---- Event packet packer ----
+
+static std::vector<HostUsbPacket> pack(ESPNATIVEUSBMIDI &midi, uint8_t cable, const Bytes &bytes) {
+  hostUsb.fromDevice.clear();
+  for (uint8_t b : bytes)
+    TEST_ASSERT_EQUAL(1, midi.write(cable, b));
+  return hostUsb.fromDevice;
+}
+
+static void assertPackets(const std::vector<HostUsbPacket> &expected, const std::vector<HostUsbPacket> &actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    for (int j = 0; j < 4; j++)
+      TEST_ASSERT_EQUAL_HEX8(expected[i][j], actual[i][j]);
+  }
+}
+
+void test_packer_code_index_numbers() {
+  ESPNATIVEUSBMIDI midi(4);
+  assertPackets({ { 0x09, 0x90, 0x3C, 0x7F } }, pack(midi, 0, { 0x90, 0x3C, 0x7F }));
+  assertPackets({ { 0x38, 0x83, 0x3C, 0x00 } }, pack(midi, 3, { 0x83, 0x3C, 0x00 }));
+  assertPackets({ { 0x1A, 0xA0, 0x01, 0x02 } }, pack(midi, 1, { 0xA0, 0x01, 0x02 }));
+  assertPackets({ { 0x2B, 0xB5, 0x07, 0x64 } }, pack(midi, 2, { 0xB5, 0x07, 0x64 }));
+  assertPackets({ { 0x0C, 0xC0, 0x05, 0x00 } }, pack(midi, 0, { 0xC0, 0x05 }));
+  assertPackets({ { 0x0D, 0xD0, 0x40, 0x00 } }, pack(midi, 0, { 0xD0, 0x40 }));
+  assertPackets({ { 0x0E, 0xE0, 0x00, 0x40 } }, pack(midi, 0, { 0xE0, 0x00, 0x40 }));
+  assertPackets({ { 0x02, 0xF1, 0x23, 0x00 } }, pack(midi, 0, { 0xF1, 0x23 }));
+  assertPackets({ { 0x03, 0xF2, 0x10, 0x02 } }, pack(midi, 0, { 0xF2, 0x10, 0x02 }));
+  assertPackets({ { 0x02, 0xF3, 0x04, 0x00 } }, pack(midi, 0, { 0xF3, 0x04 }));
+  // Single bytes go as CIN 5, as TinyUSB's stream writer sends them.
+  assertPackets({ { 0x05, 0xF6, 0, 0 } }, pack(midi, 0, { 0xF6 }));
+  assertPackets({ { 0x15, 0xF8, 0, 0 } }, pack(midi, 1, { 0xF8 }));
+  assertPackets({ { 0x25, 0xFA, 0, 0 } }, pack(midi, 2, { 0xFA }));
+}
+
+void test_packer_sysex_endings() {
+  ESPNATIVEUSBMIDI midi(4);
+  assertPackets({ { 0x06, 0xF0, 0xF7, 0 } }, pack(midi, 0, { 0xF0, 0xF7 }));
+  assertPackets({ { 0x07, 0xF0, 0x01, 0xF7 } }, pack(midi, 0, { 0xF0, 0x01, 0xF7 }));
+  assertPackets({ { 0x04, 0xF0, 0x01, 0x02 }, { 0x05, 0xF7, 0, 0 } }, pack(midi, 0, { 0xF0, 0x01, 0x02, 0xF7 }));
+  assertPackets({ { 0x14, 0xF0, 0x01, 0x02 }, { 0x16, 0x03, 0xF7, 0 } },
+                pack(midi, 1, { 0xF0, 0x01, 0x02, 0x03, 0xF7 }));
+  assertPackets({ { 0x24, 0xF0, 0x01, 0x02 }, { 0x27, 0x03, 0x04, 0xF7 } },
+                pack(midi, 2, { 0xF0, 0x01, 0x02, 0x03, 0x04, 0xF7 }));
+  // A stray data byte outside any message goes on its own.
+  assertPackets({ { 0x0F, 0x42, 0, 0 } }, pack(midi, 0, { 0x42 }));
+}
+
+// Messages on different cables, written byte by byte in turn, each come out
+// whole on their own cable.
+void test_packer_interleaves_cables() {
+  ESPNATIVEUSBMIDI midi(3);
+  Bytes a = { 0xF0, 0x7E, 0x01, 0x02, 0x03, 0x04, 0x05, 0xF7 };
+  Bytes b = { 0x91, 0x40, 0x50, 0xB1, 0x0A, 0x40 };
+  Bytes c = { 0xF8, 0xF8, 0xFA, 0xF8 };
+  hostUsb.fromDevice.clear();
+  for (size_t i = 0; i < 8; i++) {
+    if (i < a.size()) midi.write(0, a[i]);
+    if (i < b.size()) midi.write(1, b[i]);
+    if (i < c.size()) midi.write(2, c[i]);
+  }
+  std::map<int, Bytes> streams = unpack(hostUsb.fromDevice);
+  TEST_ASSERT_TRUE(streams[0] == a);
+  TEST_ASSERT_TRUE(streams[1] == b);
+  TEST_ASSERT_TRUE(streams[2] == c);
+}
+
+// A full IN FIFO holds the finished packet back; nothing is lost, doubled
+// or reordered, and reset() drops only the packet in progress.
+void test_packer_backpressure_and_reset() {
+  ESPNATIVEUSBMIDI midi(2);
+  hostUsb.fromDevice.clear();
+  hostUsb.inRoom = 0;
+  for (uint8_t b : { 0x90, 0x3C, 0x7F })
+    TEST_ASSERT_EQUAL(1, midi.write(0, b));
+  TEST_ASSERT_EQUAL(0, midi.write(0, 0x80));     // held: takes nothing
+  TEST_ASSERT_FALSE(midi.flush(0));
+  TEST_ASSERT_EQUAL(1, midi.write(1, 0xC0));     // the other cable packs on
+  TEST_ASSERT_TRUE(hostUsb.fromDevice.empty());
+
+  hostUsb.inRoom = 1;
+  TEST_ASSERT_TRUE(midi.flush(0));
+  TEST_ASSERT_TRUE(midi.flush(0));
+  hostUsb.inRoom = SIZE_MAX;
+  for (uint8_t b : { 0x80, 0x3C, 0x00 })
+    midi.write(0, b);
+  assertPackets({ { 0x09, 0x90, 0x3C, 0x7F }, { 0x08, 0x80, 0x3C, 0x00 } }, hostUsb.fromDevice);
+
+  hostUsb.fromDevice.clear();
+  midi.reset(1);                                  // drops the half program change
+  for (uint8_t b : { 0xC1, 0x07 })
+    midi.write(1, b);
+  assertPackets({ { 0x1C, 0xC1, 0x07, 0x00 } }, hostUsb.fromDevice);
+  TEST_ASSERT_EQUAL(0, midi.write(2, 0x90));     // no such cable
+  TEST_ASSERT_TRUE(midi.flush(7));
+}
+
+// A random well-formed message of every kind the firmware sends.
+static Bytes randomMessage() {
+  uint8_t channel = nextRandom(16);
+  switch (nextRandom(6)) {
+    case 0: return { (uint8_t)(0x80 + 0x10 * nextRandom(4) + channel), (uint8_t)nextRandom(128), (uint8_t)nextRandom(128) };
+    case 1: return { (uint8_t)(0xE0 + channel), (uint8_t)nextRandom(128), (uint8_t)nextRandom(128) };
+    case 2: return { (uint8_t)(0xC0 + 0x10 * nextRandom(2) + channel), (uint8_t)nextRandom(128) };
+    case 3: return { (uint8_t)(0xF8 + nextRandom(5)) };
+    case 4: return { 0xF2, (uint8_t)nextRandom(128), (uint8_t)nextRandom(128) };
+    default: {
+      Bytes m = { 0xF0 };
+      int n = nextRandom(MIDI_PORT_MESSAGE_MAX - 1);
+      for (int i = 0; i < n; i++)
+        m.push_back(nextRandom(128));
+      m.push_back(0xF7);
+      return m;
+    }
+  }
+}
+
+void test_packer_round_trips_random_streams() {
+  seed = 99;
+  ESPNATIVEUSBMIDI midi(4);
+  std::map<int, Bytes> sent;
+  hostUsb.fromDevice.clear();
+  std::vector<Bytes> pending(4);
+  for (int i = 0; i < 20000; i++) {
+    uint8_t cable = nextRandom(4);
+    if (pending[cable].empty())
+      pending[cable] = randomMessage();
+    uint8_t b = pending[cable].front();
+    pending[cable].erase(pending[cable].begin());
+    TEST_ASSERT_EQUAL(1, midi.write(cable, b));
+    sent[cable].push_back(b);
+  }
+  // Finish what is in flight.
+  for (uint8_t cable = 0; cable < 4; cable++) {
+    for (uint8_t b : pending[cable]) {
+      midi.write(cable, b);
+      sent[cable].push_back(b);
+    }
+  }
+  std::map<int, Bytes> received = unpack(hostUsb.fromDevice);
+  for (int cable = 0; cable < 4; cable++)
+    TEST_ASSERT_TRUE(received[cable] == sent[cable]);
+}
+
+// ---- MidiPortStream ----
+
+static void toDevice(uint8_t cable, const Bytes &m) {
+  // Packed as a host driver would.
+  ESPNATIVEUSBMIDI packer(4);
+  std::vector<HostUsbPacket> saved = hostUsb.fromDevice;
+  hostUsb.fromDevice.clear();
+  for (uint8_t b : m)
+    packer.write(cable, b);
+  for (const HostUsbPacket &p : hostUsb.fromDevice)
+    hostUsb.toDevice.push_back(p);
+  hostUsb.fromDevice = saved;
+}
+
+// Each port's stream reads its own cable, in order, across many wraps of
+// the receive ring. A cable whose ring is full holds the next packet until
+// it is read; nothing is dropped.
+void test_port_streams_read_their_cable() {
+  seed = 7;
+  MidiPortStream streams[] = { MidiPortStream(MidiPort::CONTROL), MidiPortStream(MidiPort::PERFORMANCE),
+                               MidiPortStream(MidiPort::SYNC) };
+  std::map<int, Bytes> sent, received;
+  for (int round = 0; round < 300; round++) {
+    for (int i = 0; i < 8; i++) {
+      uint8_t cable = nextRandom(MIDI_USB_CABLES);
+      Bytes m = randomMessage();
+      toDevice(cable, m);
+      sent[cable].insert(sent[cable].end(), m.begin(), m.end());
+    }
+    // Read unevenly so the rings fill, wrap and block one another.
+    for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+      int budget = nextRandom(ESPNATIVEUSBMIDI_RX_SIZE);
+      while (budget-- > 0 && streams[p].available() > 0)
+        received[MidiPorts::cable((MidiPort)p)].push_back(streams[p].read());
+    }
+  }
+  for (int guard = 0; guard < 100000 && (!hostUsb.toDevice.empty() || usbmidi.available(0) ||
+                                           usbmidi.available(1) || usbmidi.available(2)); guard++) {
+    for (int p = 0; p < (int)MidiPort::COUNT; p++) {
+      int b = streams[p].read();
+      if (b >= 0)
+        received[MidiPorts::cable((MidiPort)p)].push_back(b);
+    }
+  }
+  TEST_ASSERT_TRUE(hostUsb.toDevice.empty());
+  for (int cable = 0; cable < MIDI_USB_CABLES; cable++) {
+    TEST_ASSERT_EQUAL(sent[cable].size(), received[cable].size());
+    TEST_ASSERT_TRUE(sent[cable] == received[cable]);
+  }
+  TEST_ASSERT_EQUAL(-1, streams[0].read());
+}
+
+void test_foreign_packets_are_skipped() {
+  hostUsb.toDevice.push_back({ 0x79, 0x90, 0x01, 0x02 });   // cable 7
+  hostUsb.toDevice.push_back({ 0x00, 0x90, 0x01, 0x02 });   // reserved CIN
+  hostUsb.toDevice.push_back({ 0x01, 0x90, 0x01, 0x02 });
+  toDevice(0, { 0xFA });
+  MidiPortStream control(MidiPort::CONTROL);
+  TEST_ASSERT_EQUAL(1, control.available());
+  TEST_ASSERT_EQUAL_HEX8(0xFA, control.read());
+}
+
+// Messages written through a port's stream reach its cable whole and in
+// order across many wraps of the send queue. One that doesn't fit the
+// queue, or outgrows a message, is dropped whole.
+void test_port_queue_wraps_and_drops_whole_messages() {
+  seed = 11;
+  MidiPortStream perf(MidiPort::PERFORMANCE);
+  uint8_t cable = MidiPorts::cable(MidiPort::PERFORMANCE);
+  hostUsb.fromDevice.clear();
+  Bytes expected;
+  uint32_t dropped = MidiPorts::stats(MidiPort::PERFORMANCE).dropped;
+  uint32_t expectDropped = dropped;
+  for (int round = 0; round < 200; round++) {
+    int burst = 1 + nextRandom(40);
+    uint16_t queued = MidiPorts::stats(MidiPort::PERFORMANCE).queued;
+    for (int i = 0; i < burst; i++) {
+      Bytes m = randomMessage();
+      bool tooLong = nextRandom(50) == 0;
+      if (tooLong)
+        m.insert(m.begin() + 1, MIDI_PORT_MESSAGE_MAX, 0x00);
+      MidiPorts::acquire(MidiPort::PERFORMANCE);
+      for (uint8_t b : m)
+        perf.write(b);
+      MidiPorts::release(MidiPort::PERFORMANCE);
+      if (tooLong || queued + 1 + m.size() > MIDI_PORT_QUEUE_BYTES) {
+        expectDropped++;
+      } else {
+        queued += 1 + m.size();
+        expected.insert(expected.end(), m.begin(), m.end());
+      }
+    }
+    MidiPorts::flush();
+  }
+  TEST_ASSERT_EQUAL(expectDropped, MidiPorts::stats(MidiPort::PERFORMANCE).dropped);
+  TEST_ASSERT_GREATER_THAN(dropped, expectDropped);
+  TEST_ASSERT_EQUAL(0, MidiPorts::stats(MidiPort::PERFORMANCE).queued);
+  std::map<int, Bytes> streams = unpack(hostUsb.fromDevice);
+  TEST_ASSERT_EQUAL(expected.size(), streams[cable].size());
+  TEST_ASSERT_TRUE(expected == streams[cable]);
+}
+
+void setUp() {
+  hostUsb.toDevice.clear();
+  hostUsb.fromDevice.clear();
+  hostUsb.inRoom = SIZE_MAX;
+}
+
+void tearDown() {}
+
+int main() {
+  MidiPorts::begin();
+  UNITY_BEGIN();
+  RUN_TEST(test_registered_descriptor);
+  RUN_TEST(test_descriptor_one_cable);
+  RUN_TEST(test_descriptor_three_cables);
+  RUN_TEST(test_descriptor_four_cables);
+  RUN_TEST(test_packer_code_index_numbers);
+  RUN_TEST(test_packer_sysex_endings);
+  RUN_TEST(test_packer_interleaves_cables);
+  RUN_TEST(test_packer_backpressure_and_reset);
+  RUN_TEST(test_packer_round_trips_random_streams);
+  RUN_TEST(test_port_streams_read_their_cable);
+  RUN_TEST(test_foreign_packets_are_skipped);
+  RUN_TEST(test_port_queue_wraps_and_drops_whole_messages);
+  return UNITY_END();
+}
@@ -0,0 +1,442 @@
+// The WebSocket command parser on the host: binary control ops and their
+// ACKs, the older text commands, GET_FILE paths up to the LittleFS limit,
+// frames that are short, split, oversized or random, and state broadcasts
+// to a full table of phones with some of them stalled. The HTTP side serves
+// the asset manifest's routes; set WEB_IMAGE to the output directory of
+// tools/build_web.py to serve a real image and print what the page costs on
+// first and repeat loads, otherwise a small fixture image is used.
+
+#define ESP32 1
+#define USE_SPI_DMA
+#include <unity.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "host_log.h"
+#include "host_ili9341.h"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_SPITFT.cpp"
+#include "../../lib/Adafruit_GFX_Library/Adafruit_GFX.cpp"
+#include "../../lib/Adafruit_ILI9341/Adafruit_ILI9341.cpp"
+#include "../../lib/XPT2046_Touchscreen/XPT2046_Touchscreen.cpp"
+#include "../../src/config.cpp"
+#include "../../src/_state.cpp"
+#include "../../src/_render.cpp"
+#include "../../src/_spibus.cpp"
+#include "../../src/_band.cpp"
+#include "../../src/_ui.cpp"
+#include "../../src/_tour.cpp"
+#include "../../src/_json.cpp"
+#include "../../src/_preset.cpp"
+#include "../../src/_progress.cpp"
+#include "../../src/_transport.cpp"
+#include "../../src/_link.cpp"
+#include "../../src/_cue.cpp"
+#include "../../src/_tasks.cpp"
+#include "../../src/_scan.cpp"
+#include "../../src/_sync.cpp"
+#include "../../src/_midi.cpp"
+#include "../../src/_midiport.cpp"
+#include "../../src/_midiuart.cpp"
+#include "../../lib/ESPNATIVEUSBMIDI-master/src/ESPNATIVEUSBMIDI.cpp"
+
+typedef std::vector<uint8_t> Frame;
+
+static UI ui;
+static AsyncWebSocket *ws;
+static AsyncWebSocketClient *phone;
+
+static void sendBinary(const Frame &f) {
+    ws->receive(phone, WS_BINARY, f.data(), f.size());
+}
+
+static void sendText(const std::string &s) {
+    ws->receive(phone, WS_TEXT, s.data(), s.size());
+}
+
+// WS_OP_ACK frames the phone got since the last call.
+static std::vector<Frame> takeAcks() {
+    std::vector<Frame> acks;
+    for (const AsyncWebSocketClient::Message &m : phone->sent) {
+        if (m.binary && !m.data.empty() && m.data[0] == WS_OP_ACK)
+            acks.push_back(m.data);
+    }
+    phone->sent.clear();
+    return acks;
+}
+
+static std::vector<std::string> takeTexts() {
+    std::vector<std::string> texts;
+    for (const AsyncWebSocketClient::Message &m : phone->sent) {
+        if (!m.binary)
+            texts.push_back(m.str());
+    }
+    phone->sent.clear();
+    return texts;
+}
+
+// Preset state broadcasts a client got since the last call.
+static std::vector<std::string> takeStates(AsyncWebSocketClient *c) {
+    std::vector<std::string> states;
+    for (const AsyncWebSocketClient::Message &m : c->sent) {
+        if (!m.binary && !m.data.empty() && m.data[0] == '{')
+            states.push_back(m.str());
+    }
+    c->sent.clear();
+    return states;
+}
+
+static void assertAck(uint16_t id, WsStatus status, const Frame &command) {
+    Frame f = command;
+    f.insert(f.begin() + 1, { (uint8_t)id, (uint8_t)(id >> 8) });
+    sendBinary(f);
+    std::vector<Frame> acks = takeAcks();
+    TEST_ASSERT_EQUAL(1, acks.size());
+    TEST_ASSERT_EQUAL(4, acks[0].size());
+    TEST_ASSERT_EQUAL_HEX8(WS_OP_ACK, acks[0][0]);
+    TEST_ASSERT_EQUAL(id, acks[0][1] | (acks[0][2] << 8));
+    TEST_ASSERT_EQUAL(status, acks[0][3]);
+}
+
+struct Asset {
+    std::string path, mime, etag;
+    bool immutable;
+};
+
+static std::vector<Asset> assets;
+
+static void addFile(const std::string &path, const std::string &data) {
+    File f = LittleFS.open(path.c_str(), "w");
+    f.write((const uint8_t *)data.data(), data.size());
+    f.close();
+}
+
+// The image from WEB_IMAGE, or a fixture in the same layout: a page and a
+// script stored gzipped, a stylesheet that didn't shrink stored as it is.
+static void loadWebImage() {
+    const char *dir = getenv("WEB_IMAGE");
+    if (dir) {
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+            if (!entry.is_regular_file())
+                continue;
+            std::ifstream in(entry.path(), std::ios::binary);
+            std::stringstream data;
+            data << in.rdbuf();
+            addFile("/" + std::filesystem::relative(entry.path(), dir).generic_string(), data.str());
+        }
+    } else {
+        addFile("/index.html.gz", std::string("\x1f\x8b\x08page", 7));
+        addFile("/app.1a2b3c4d.js.gz", std::string("\x1f\x8b\x08script", 9));
+        addFile("/style.5e6f7a8b.css", "body{}");
+        addFile(WEB_ASSET_MANIFEST, "/app.1a2b3c4d.js application/javascript 00112233aabbccdd 1\n"
+                                    "/style.5e6f7a8b.css text/css 44556677eeff0011 1\n"
+                                    "/index.html text/html 8899aabbccddeeff 0\n");
+    }
+    File manifest = LittleFS.open(WEB_ASSET_MANIFEST, "r");
+    while (manifest && manifest.available()) {
+        String line = manifest.readStringUntil('\n');
+        char path[128], mime[64], etag[32];
+        int immutable;
+        if (sscanf(line.c_str(), "%127s %63s %31s %d", path, mime, etag, &immutable) == 4)
+            assets.push_back({ path, mime, std::string("\"") + etag + "\"", immutable != 0 });
+    }
+    if (manifest)
+        manifest.close();
+}
+
+void setUp() {
+    StateStore::stop();
+    StateStore::setTrack(0);
+    phone->sent.clear();
+}
+
+void tearDown() {}
+
+void test_binary_ops_are_acked_with_their_id() {
+    assertAck(0x1234, WS_STATUS_OK, { WS_OP_NEXT });       // stopped: step the track
+    TEST_ASSERT_EQUAL(1, StateStore::get().track);
+    assertAck(0x0001, WS_STATUS_OK, { WS_OP_PREV });
+    assertAck(0x0002, WS_STATUS_OK, { WS_OP_PREV });       // wraps to the last
+    TEST_ASSERT_EQUAL(loadedPreset.data.songCount - 1, StateStore::get().track);
+    assertAck(0x0003, WS_STATUS_OK, { WS_OP_NEXT });
+    TEST_ASSERT_EQUAL(0, StateStore::get().track);
+    assertAck(0xFFFF, WS_STATUS_OK, { WS_OP_PLAY });
+    TEST_ASSERT_TRUE(StateStore::get().playing);
+    assertAck(0x0100, WS_STATUS_OK, { WS_OP_NEXT });       // playing: cue
+    TEST_ASSERT_EQUAL(1, StateStore::get().cueDepth);
+    assertAck(0x0101, WS_STATUS_OK, { WS_OP_PREV });       // playing: uncue
+    assertAck(0x0102, WS_STATUS_REJECTED, { WS_OP_PREV });
+    TEST_ASSERT_EQUAL(0, StateStore::get().cueDepth);
+    assertAck(0x0103, WS_STATUS_OK, { WS_OP_STOP, 0xAA }); // trailing bytes are ignored
+    TEST_ASSERT_FALSE(StateStore::get().playing);
+    assertAck(7, WS_STATUS_UNKNOWN, { 0x00 });
+    assertAck(8, WS_STATUS_UNKNOWN, { WS_OP_ACK });         // a server op
+}
+
+void test_short_and_split_binary_frames_do_nothing() {
+    for (Frame f : { Frame{}, Frame{ WS_OP_NEXT }, Frame{ WS_OP_NEXT, 0x01 } })
+        sendBinary(f);
+    Frame play = { WS_OP_PLAY, 0x05, 0x00 };
+    ws->receivePart(phone, WS_BINARY, play.data(), 2, 0, 3);
+    ws->receivePart(phone, WS_BINARY, play.data() + 2, 1, 2, 3);
+    TEST_ASSERT_EQUAL(0, takeAcks().size());
+    AppState state = StateStore::get();
+    TEST_ASSERT_FALSE(state.playing);
+    TEST_ASSERT_EQUAL(0, state.track);
+}
+
+void test_text_commands_run_without_an_ack() {
+    sendText("next");
+    sendText("next");
+    TEST_ASSERT_EQUAL(2, StateStore::get().track);
+    sendText("prev");
+    sendText("play");
+    TEST_ASSERT_TRUE(StateStore::get().playing);
+    sendText("stop");
+    sendText("bogus");
+    sendText("");
+    TEST_ASSERT_FALSE(StateStore::get().playing);
+    TEST_ASSERT_EQUAL(1, StateStore::get().track);
+    TEST_ASSERT_EQUAL(0, takeAcks().size());
+}
+
+// The longest path LittleFS takes, with an offset and a length, is still a
+// command.
+void test_get_file_takes_the_longest_path() {
+    std::string path = "/" + std::string(WEB_MAX_PATH_LEN - 1, 'p');
+    File f = LittleFS.open(path.c_str(), "w");
+    f.write((const uint8_t *)"0123456789", 10);
+    f.close();
+
+    std::string command = "GET_FILE:" + path + ",4294967295,4294967295";
+    TEST_ASSERT_EQUAL(WEB_MAX_TEXT_COMMAND, command.size());
+    sendText(command);
+    std::vector<std::string> texts = takeTexts();
+    TEST_ASSERT_EQUAL(1, texts.size());
+    TEST_ASSERT_EQUAL_STRING("Error: Offset past end of file", texts[0].c_str());
+
+    sendText("GET_FILE:" + path + ",3,4");
+    texts = takeTexts();
+    TEST_ASSERT_EQUAL(1, texts.size());
+    TEST_ASSERT_EQUAL_STRING(("FILE " + path + " 3 4 10").c_str(), texts[0].c_str());
+    webServerManager.update();
+    std::string data;
+    for (const AsyncWebSocketClient::Message &m : phone->sent) {
+        if (m.binary && m.data[0] == WS_OP_FILE_DATA)
+            data += m.str().substr(1);
+    }
+    TEST_ASSERT_EQUAL_STRING("3456", data.c_str());
+}
+
+// Longer text gets an error instead of being dropped, whole or split.
+void test_oversized_text_is_answered() {
+    std::string command = "GET_FILE:/" + std::string(WEB_MAX_TEXT_COMMAND, 'x');
+    sendText(command);
+    std::vector<std::string> texts = takeTexts();
+    TEST_ASSERT_EQUAL(1, texts.size());
+    TEST_ASSERT_EQUAL_STRING("Error: Command too long", texts[0].c_str());
+
+    ws->receivePart(phone, WS_TEXT, command.data(), 100, 0, command.size());
+    ws->receivePart(phone, WS_TEXT, command.data() + 100, command.size() - 100, 100, command.size());
+    texts = takeTexts();
+    TEST_ASSERT_EQUAL(1, texts.size());
+    TEST_ASSERT_EQUAL_STRING("Error: Command too long", texts[0].c_str());
+}
+
+// WEB_MAX_CLIENTS phones, a quarter of them stalled: the ones that keep up
+// get every broadcast, a stalled one is skipped while it is behind and then
+// gets the latest state once.
+void test_phones_fan_out_and_slow_ones_coalesce() {
+    std::vector<AsyncWebSocketClient *> phones = { phone };
+    while (phones.size() < WEB_MAX_CLIENTS)
+        phones.push_back(ws->connect());
+    AsyncWebSocketClient *extra = ws->connect();
+    TEST_ASSERT_TRUE(extra->closed);               // the table is full
+    ws->disconnect(extra);
+
+    webServerManager.update();                     // new phones get the snapshot
+    std::string joined;
+    for (AsyncWebSocketClient *p : phones) {
+        std::vector<std::string> states = takeStates(p);
+        if (p != phone) {
+            TEST_ASSERT_EQUAL(1, states.size());
+            joined = states[0];
+        }
+    }
+
+    std::vector<AsyncWebSocketClient *> slow;
+    for (size_t i = 3; i < phones.size(); i += 4) {
+        phones[i]->queued = WEB_SLOW_CLIENT_QUEUE;
+        slow.push_back(phones[i]);
+    }
+    const int updates = 10;
+    std::vector<std::string> expected;
+    for (int i = 0; i < updates; i++) {
+        TEST_ASSERT_TRUE(StateStore::stepTrack(1));
+        webServerManager.update();
+        std::vector<std::string> states = takeStates(phone);
+        TEST_ASSERT_EQUAL(1, states.size());
+        expected.push_back(states[0]);
+        TEST_ASSERT_TRUE(states[0].find("\"currentTrack\":" + std::to_string((i + 1) % 6)) != std::string::npos);
+    }
+    for (AsyncWebSocketClient *p : phones) {
+        if (p == phone)
+            continue;
+        std::vector<std::string> states = takeStates(p);
+        bool stalled = p->queued > 0;
+        TEST_ASSERT_EQUAL(stalled ? 0 : updates, states.size());
+        if (!stalled)
+            TEST_ASSERT_TRUE(states == expected);
+    }
+
+    // Drained: one message with the latest state, not the ten missed.
+    for (AsyncWebSocketClient *p : slow)
+        p->queued = 0;
+    webServerManager.update();
+    webServerManager.update();
+    for (AsyncWebSocketClient *p : phones) {
+        std::vector<std::string> states = takeStates(p);
+        bool wasSlow = std::find(slow.begin(), slow.end(), p) != slow.end();
+        TEST_ASSERT_EQUAL(wasSlow ? 1 : 0, states.size());
+        if (wasSlow)
+            TEST_ASSERT_EQUAL_STRING(expected.back().c_str(), states[0].c_str());
+    }
+    TEST_ASSERT_TRUE(joined != expected.back());
+
+    for (AsyncWebSocketClient *p : phones) {
+        if (p != phone)
+            ws->disconnect(p);
+    }
+}
+
+// Each asset: 200 with its ETag, MIME type and cache policy, gzipped when
+// it is stored gzipped, and the page at / as well.
+void test_assets_are_served_with_an_etag() {
+    AsyncWebServer &http = *AsyncWebServer::host;
+    TEST_ASSERT_GREATER_THAN(0, assets.size());
+    for (const Asset &a : assets) {
+        bool gzipped = LittleFS.exists((a.path + ".gz").c_str());
+        std::vector<const char *> urls = { a.path.c_str() };
+        if (a.path == "/index.html")
+            urls.push_back("/");
+        for (const char *url : urls) {
+            AsyncWebServerResponse r = http.get(url);
+            TEST_ASSERT_EQUAL(200, r.code);
+            TEST_ASSERT_EQUAL_STRING(a.etag.c_str(), r.header("ETag").c_str());
+            TEST_ASSERT_EQUAL_STRING(a.mime.c_str(), r.header("Content-Type").c_str());
+            TEST_ASSERT_EQUAL_STRING(gzipped ? "gzip" : "", r.header("Content-Encoding").c_str());
+            TEST_ASSERT_EQUAL_STRING(a.immutable ? WEB_CACHE_IMMUTABLE : WEB_CACHE_REVALIDATE,
+                                     r.header("Cache-Control").c_str());
+            File stored = LittleFS.open((a.path + (gzipped ? ".gz" : "")).c_str(), "r");
+            TEST_ASSERT_EQUAL(stored.size(), r.body.size());
+        }
+    }
+    TEST_ASSERT_TRUE(std::any_of(assets.begin(), assets.end(), [](const Asset &a) {
+        return LittleFS.exists((a.path + ".gz").c_str());
+    }));
+}
+
+// A matching If-None-Match, alone or in a list, gets 304 with no body;
+// a stale one gets the asset.
+void test_matching_etag_gets_304() {
+    AsyncWebServer &http = *AsyncWebServer::host;
+    for (const Asset &a : assets) {
+        for (const std::string &tags : { a.etag, "\"0000000000000000\", " + a.etag }) {
+            AsyncWebServerResponse r = http.get(a.path.c_str(), { { "If-None-Match", tags } });
+            TEST_ASSERT_EQUAL(304, r.code);
+            TEST_ASSERT_EQUAL(0, r.body.size());
+            TEST_ASSERT_EQUAL_STRING(a.etag.c_str(), r.header("ETag").c_str());
+        }
+        AsyncWebServerResponse r = http.get(a.path.c_str(), { { "If-None-Match", "\"0000000000000000\"" } });
+        TEST_ASSERT_EQUAL(200, r.code);
+        TEST_ASSERT_GREATER_THAN(0, r.body.size());
+    }
+    TEST_ASSERT_EQUAL(404, http.get("/missing.js").code);
+}
+
+// The page and what it loads, as a browser would with an empty cache and
+// then with that cache: immutable assets aren't requested again and the
+// page is revalidated.
+void test_first_and_repeat_load_cost() {
+    AsyncWebServer &http = *AsyncWebServer::host;
+    std::map<std::string, std::string> cache;   // URL -> ETag
+    int requests[2] = {}, bytes[2] = {};
+    for (int load = 0; load < 2; load++) {
+        for (const Asset &a : assets) {
+            std::string url = a.path == "/index.html" ? "/" : a.path;
+            std::map<std::string, std::string> headers;
+            if (cache.count(url)) {
+                if (a.immutable)
+                    continue;
+                headers["If-None-Match"] = cache[url];
+            }
+            AsyncWebServerResponse r = http.get(url.c_str(), headers);
+            TEST_ASSERT_EQUAL(load ? 304 : 200, r.code);
+            requests[load]++;
+            bytes[load] += r.body.size();
+            cache[url] = r.header("ETag");
+        }
+    }
+    int revalidated = std::count_if(assets.begin(), assets.end(), [](const Asset &a) { return !a.immutable; });
+    TEST_ASSERT_EQUAL(assets.size(), requests[0]);
+    TEST_ASSERT_EQUAL(revalidated, requests[1]);
+    TEST_ASSERT_EQUAL(0, bytes[1]);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%s: first load %d bytes in %d requests, repeat %d bytes in %d",
+             getenv("WEB_IMAGE") ? "image" : "fixture", bytes[0], requests[0], bytes[1], requests[1]);
+    TEST_MESSAGE(line);
+}
+
+// Random frames: each one of three bytes or more gets exactly one ACK with
+// its ID, UNKNOWN for anything that isn't a control op, and nothing reads
+// past the frame (ASan).
+void test_random_binary_frames() {
+    uint32_t seed = 2024;
+    auto next = [&seed](int range) {
+        seed = seed * 1103515245UL + 12345UL;
+        return (int)((seed >> 8) % range);
+    };
+    for (int i = 0; i < 5000; i++) {
+        Frame f(next(8));
+        for (uint8_t &b : f)
+            b = next(4) ? next(256) : 1 + next(4);   // control ops are common
+        sendBinary(f);
+        std::vector<Frame> acks = takeAcks();
+        if (f.size() < 3) {
+            TEST_ASSERT_EQUAL(0, acks.size());
+            continue;
+        }
+        TEST_ASSERT_EQUAL(1, acks.size());
+        TEST_ASSERT_EQUAL_HEX8(f[1], acks[0][1]);
+        TEST_ASSERT_EQUAL_HEX8(f[2], acks[0][2]);
+        bool control = f[0] >= WS_OP_PREV && f[0] <= WS_OP_STOP;
+        TEST_ASSERT_EQUAL(control, acks[0][3] != WS_STATUS_UNKNOWN);
+    }
+}
+
+int main() {
+    hostSpi.dcPin = TFT_DC;
+    hostSpi.csPin = TFT_CS;
+    hostPinHook = hostSpiPinHook;
+    loadWebImage();
+    Render::begin(ui);
+    ui.init();
+    ScreenTour::loadFixtures();   // a six-song setlist to step through and cue
+    webServerManager.setup();
+    ws = AsyncWebSocket::host;
+    phone = ws->connect();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_ops_are_acked_with_their_id);
+    RUN_TEST(test_short_and_split_binary_frames_do_nothing);
+    RUN_TEST(test_text_commands_run_without_an_ack);
+    RUN_TEST(test_get_file_takes_the_longest_path);
+    RUN_TEST(test_oversized_text_is_answered);
+    RUN_TEST(test_phones_fan_out_and_slow_ones_coalesce);
+    RUN_TEST(test_random_binary_frames);
+    RUN_TEST(test_assets_are_served_with_an_etag);
+    RUN_TEST(test_matching_etag_gets_304);
+    RUN_TEST(test_first_and_repeat_load_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,98 @@
+"""PlatformIO pre-script: builds the LittleFS web assets.
+
+data/ holds the editable sources. Before buildfs/uploadfs this script writes
+the image contents to $BUILD_DIR/data and points PROJECT_DATA_DIR there:
+
+  * every asset except the HTML pages gets its content hash in the file name
+    (app.js -> app.3f2a9c1d.js) and references to it in the HTML and CSS are
+    rewritten, so the server can mark it immutable;
+  * text assets are stored as name.gz when that is smaller, which the web
+    server sends with Content-Encoding: gzip;
+  * /assets.txt lists "path mime etag immutable" per asset for the server.
+
+Run it by hand with `python tools/build_web.py [data_dir] [out_dir]`.
+"""
+import gzip
+import hashlib
+import mimetypes
+import os
+import re
+import shutil
+import sys
+
+MANIFEST = "assets.txt"
+COMPRESSIBLE = {".html", ".htm", ".css", ".js", ".json", ".svg", ".txt"}
+REWRITTEN = {".html", ".htm", ".css"}
+# Entry points keep their names; everything they load is hashed.
+ENTRY = {".html", ".htm"}
+MIME = {".js": "application/javascript", ".css": "text/css", ".html": "text/html",
+        ".htm": "text/html", ".json": "application/json", ".svg": "image/svg+xml"}
+
+
+def build(src, out):
+    files = []
+    for root, _, names in os.walk(src):
+        for name in sorted(names):
+            path = os.path.relpath(os.path.join(root, name), src).replace(os.sep, "/")
+            if not name.startswith("."):
+                files.append(path)
+    # Hash leaves first so the files that reference them see the final names.
+    order = {".html": 2, ".htm": 2, ".css": 1}
+    files.sort(key=lambda p: (order.get(os.path.splitext(p)[1], 0), p))
+
+    if os.path.isdir(out):
+        shutil.rmtree(out)
+    os.makedirs(out)
+
+    renamed = {}
+    manifest = []
+    first_load = 0
+    for path in files:
+        ext = os.path.splitext(path)[1].lower()
+        data = open(os.path.join(src, path), "rb").read()
+        if ext in REWRITTEN and renamed:
+            text = data.decode("utf-8")
+            for old, new in renamed.items():
+                text = re.sub(r"(?<=[\"'(/])" + re.escape(old) + r"(?=[\"')?#])", new, text)
+            data = text.encode("utf-8")
+
+        name = path
+        immutable = ext not in ENTRY
+        if immutable:
+            digest = hashlib.sha256(data).hexdigest()[:8]
+            stem, _ = os.path.splitext(path)
+            name = "%s.%s%s" % (stem, digest, ext)
+            renamed[path] = name
+
+        stored, target = data, name
+        if ext in COMPRESSIBLE:
+            packed = gzip.compress(data, 9, mtime=0)
+            if len(packed) < len(data):
+                stored, target = packed, name + ".gz"
+
+        dest = os.path.join(out, target)
+        os.makedirs(os.path.dirname(dest), exist_ok=True)
+        with open(dest, "wb") as f:
+            f.write(stored)
+
+        mime = MIME.get(ext) or mimetypes.guess_type(path)[0] or "application/octet-stream"
+        etag = hashlib.sha256(stored).hexdigest()[:16]
+        manifest.append("/%s %s %s %d" % (name, mime, etag, immutable))
+        first_load += len(stored)
+        print("web: %-28s %6d -> %6d bytes" % (name, len(data), len(stored)))
+
+    with open(os.path.join(out, MANIFEST), "w") as f:
+        f.write("\n".join(manifest) + "\n")
+    print("web: %d assets, %d bytes on first load" % (len(manifest), first_load))
+
+
+if __name__ == "__main__" and "Import" not in globals():
+    src = sys.argv[1] if len(sys.argv) > 1 else "data"
+    build(src, sys.argv[2] if len(sys.argv) > 2 else os.path.join("build", "data"))
+else:
+    Import("env")  # noqa: F821  (provided by SCons)
+    src_dir = env.subst("$PROJECT_DATA_DIR")  # noqa: F821
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "data")  # noqa: F821
+    if any(t in ("buildfs", "uploadfs", "uploadfsota") for t in COMMAND_LINE_TARGETS):  # noqa: F821
+        build(src_dir, out_dir)
+        env.Replace(PROJECT_DATA_DIR=out_dir)  # noqa: F821
@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""Print an input log recorded with INPUT_LOG_MODE 1 (copied off LittleFS).
+
+    python tools/input_log.py input.log [--summary]
+"""
+import argparse
+import struct
+import sys
+
+EVENT = struct.Struct("<IBBhhH")
+KINDS = ("pin", "analog", "touch", "release")
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("log")
+    ap.add_argument("--summary", action="store_true", help="only print event counts per channel")
+    args = ap.parse_args()
+
+    data = open(args.log, "rb").read()
+    if data[:4] != b"INP1":
+        sys.exit("not an input log")
+    counts = {}
+    last = 0
+    for offset in range(4, len(data) - EVENT.size + 1, EVENT.size):
+        t, kind, pin, a, b, _ = EVENT.unpack_from(data, offset)
+        name = KINDS[kind] if kind < len(KINDS) else f"kind{kind}"
+        key = f"{name} {pin}" if name in ("pin", "analog") else name
+        counts[key] = counts.get(key, 0) + 1
+        last = t
+        if args.summary:
+            continue
+        if name == "touch":
+            print(f"{t:9} ms  touch   {a:4},{b:4}")
+        elif name == "release":
+            print(f"{t:9} ms  release")
+        else:
+            print(f"{t:9} ms  {name:7} gpio{pin:<3} {a}")
+    print(f"{sum(counts.values())} events over {last / 1000:.1f} s", file=sys.stderr)
+    for key, n in sorted(counts.items()):
+        print(f"  {key:12} {n}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Decode a serial capture from a LOG_BINARY build.
+
+Binary log records start with the bytes 1B 4C ("\\x1bL"). Their format
+strings are looked up in the firmware ELF, so pass the ELF that matches the
+flashed build. Any bytes outside records are printed unchanged.
+
+    python tools/log_decode.py .pio/build/esp32-s3-devkitc-1/firmware.elf capture.bin
+    pio device monitor --raw | python tools/log_decode.py firmware.elf -
+"""
+import argparse
+import re
+import struct
+import sys
+
+SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])")
+LEVELS = "-EWID"
+HEADER = struct.Struct("<BBII")   # size, level, timeUs, fmt address
+
+
+class Elf:
+    """Loadable sections of a 32-bit little-endian ELF, addressed by VMA."""
+
+    def __init__(self, path):
+        data = open(path, "rb").read()
+        if data[:4] != b"\x7fELF" or data[4] != 1:
+            sys.exit(f"{path}: not a 32-bit ELF")
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+            if sh_type == 1 and flags & 0x2 and addr:   # PROGBITS, ALLOC
+                self.sections.append((addr, data[offset:offset + size]))
+        self.cache = {}
+
+    def string(self, addr):
+        if addr not in self.cache:
+            text = None
+            for base, blob in self.sections:
+                if base <= addr < base + len(blob):
+                    end = blob.find(b"\0", addr - base)
+                    text = blob[addr - base:end].decode("utf-8", "replace")
+                    break
+            self.cache[addr] = text
+        return self.cache[addr]
+
+
+def format_record(fmt, args):
+    out, pos = [], 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        py = "%" + flags + width + (("." + prec) if prec else "")
+        if conv == "s":
+            if not args:
+                out.append(m.group(0))
+                continue
+            n = args[0]
+            out.append((py + "s") % args[1:1 + n].decode("utf-8", "replace"))
+            args = args[1 + n:]
+            continue
+        size = 8 if conv in "eEfFgGaA" or length in ("ll", "j") else 4
+        if len(args) < size:
+            out.append(m.group(0))
+            continue
+        raw, args = args[:size], args[size:]
+        if conv in "eEfFgGaA":
+            out.append((py + conv.replace("a", "e").replace("A", "E")) % struct.unpack("<d", raw)[0])
+        elif conv == "p":
+            out.append("0x%08x" % struct.unpack("<I", raw)[0])
+        elif conv == "c":
+            out.append(chr(raw[0]))
+        else:
+            signed = conv in "di"
+            value = struct.unpack("<q" if size == 8 and signed else "<Q" if size == 8 else
+                                  "<i" if signed else "<I", raw)[0]
+            out.append((py + ("d" if conv in "diu" else conv)) % value)
+    out.append(fmt[pos:])
+    return "".join(out).rstrip("\n")
+
+
+def decode(elf, data, write):
+    i = 0
+    while i < len(data):
+        j = data.find(b"\x1bL", i)
+        if j < 0 or j + 2 + HEADER.size > len(data):
+            write(data[i:].decode("utf-8", "replace"))
+            return
+        write(data[i:j].decode("utf-8", "replace"))
+        size, level, time_us, addr = HEADER.unpack_from(data, j + 2)
+        end = j + 2 + size
+        fmt = elf.string(addr) if size >= HEADER.size and end <= len(data) else None
+        if fmt is None:
+            write("\x1bL")
+            i = j + 2
+            continue
+        args = data[j + 2 + HEADER.size:end]
+        lvl = LEVELS[level] if level < len(LEVELS) else "?"
+        write("%5d.%03d %s %s\n" % (time_us // 1000000, time_us // 1000 % 1000, lvl, format_record(fmt, args)))
+        i = end
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf", help="firmware.elf of the running build")
+    ap.add_argument("capture", help="raw serial capture ('-' for stdin)")
+    args = ap.parse_args()
+    elf = Elf(args.elf)
+    stream = sys.stdin.buffer if args.capture == "-" else open(args.capture, "rb")
+    decode(elf, stream.read(), sys.stdout.write)
+
+
+if __name__ == "__main__":
+    main()
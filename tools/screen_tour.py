@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decode the serial log of a screen-tour build.
+
+Writes one PNG per SHOT block and compares the TOUR lines against a saved
+baseline: a changed hash means a screen looks different, more SPI bytes means
+it got more expensive to draw.
+
+    python tools/screen_tour.py tour.log --png shots/ --baseline tour.json
+    python tools/screen_tour.py tour.log --save tour.json
+
+The host suite writes the same log without a board (timings follow the host
+clock there, so only hashes and bytes compare between the two):
+
+    SCREEN_TOUR_LOG=tour.log pio test -e native -f test_tour
+"""
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+TOUR_LINE = re.compile(r"^TOUR (\S+)\s+hash=([0-9a-f]+) ops=(\d+) bytes=(\d+) dma=(\d+) "
+                       r"bus=(\d+) push=(\d+) total=(\d+)")
+
+
+def parse(lines):
+    screens, shots = {}, {}
+    shot = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        if shot is not None:
+            if line == "SHOT end":
+                shots[shot[0]] = shot
+                shot = None
+            elif line.startswith("|"):
+                row = []
+                for token in line[1:].split():
+                    run, color = token.split(":")
+                    row.extend([int(color, 16)] * int(run, 16))
+                shot[3].append(row)
+            continue
+        if line.startswith("SHOT "):
+            _, name, w, h = line.split()
+            shot = (name, int(w), int(h), [])
+            continue
+        m = TOUR_LINE.match(line)
+        if m:
+            keys = ("ops", "bytes", "dma", "bus", "push", "total")
+            entry = {"hash": m.group(2)}
+            entry.update(zip(keys, (int(v) for v in m.groups()[2:])))
+            screens[m.group(1)] = entry
+    return screens, shots
+
+
+def write_png(path, width, height, rows):
+    raw = bytearray()
+    for row in rows:
+        raw.append(0)  # no filter
+        for c in row[:width]:
+            r, g, b = (c >> 11) & 0x1F, (c >> 5) & 0x3F, c & 0x1F
+            raw += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+    def chunk(kind, data):
+        body = kind + data
+        return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xFFFFFFFF)
+
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def compare(screens, baseline, tolerance):
+    failures = 0
+    for name, old in baseline.items():
+        new = screens.get(name)
+        if new is None:
+            print(f"{name:22} missing from this run")
+            failures += 1
+            continue
+        notes = []
+        if new["hash"] != old["hash"]:
+            notes.append(f"pixels changed ({old['hash']} -> {new['hash']})")
+        if new["bytes"] > old["bytes"] * (1 + tolerance):
+            notes.append(f"SPI bytes {old['bytes']} -> {new['bytes']}")
+        if new["dma"] > old["dma"] * (1 + tolerance):
+            notes.append(f"DMA transactions {old['dma']} -> {new['dma']}")
+        print(f"{name:22} {'; '.join(notes) if notes else 'ok'}")
+        failures += bool(notes)
+    return failures
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", help="serial log of a screen-tour build ('-' for stdin)")
+    ap.add_argument("--png", metavar="DIR", help="write each dumped frame as DIR/<screen>.png")
+    ap.add_argument("--baseline", metavar="JSON", help="compare against a saved run")
+    ap.add_argument("--save", metavar="JSON", help="save this run as a baseline")
+    ap.add_argument("--tolerance", type=float, default=0.05,
+                    help="allowed SPI cost growth before a screen is flagged (default 0.05)")
+    args = ap.parse_args()
+
+    with (sys.stdin if args.log == "-" else open(args.log, errors="replace")) as f:
+        screens, shots = parse(f)
+    if not screens:
+        sys.exit("no TOUR lines found; was the log captured from a screen-tour build?")
+
+    for name, s in screens.items():
+        print(f"{name:22} {s['hash']}  {s['bytes']:7} B  {s['dma']:4} dma  {s['push']:6} us")
+
+    if args.png:
+        os.makedirs(args.png, exist_ok=True)
+        for name, width, height, rows in shots.values():
+            write_png(os.path.join(args.png, name + ".png"), width, height, rows)
+        print(f"wrote {len(shots)} frames to {args.png}")
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(screens, f, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if compare(screens, baseline, args.tolerance):
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
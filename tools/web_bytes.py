@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Measure what the web UI costs a phone on first and repeat loads.
+
+Loads the page and everything it references like a browser with an empty
+cache, then loads it again with that cache: assets marked immutable are not
+requested at all, the rest are revalidated with If-None-Match.
+
+    python tools/web_bytes.py http://192.168.4.1/
+"""
+import argparse
+import gzip
+import re
+import sys
+import urllib.error
+import urllib.parse
+import urllib.request
+
+REFS = re.compile(r"""(?:src|href)\s*=\s*["']([^"'#?]+)""")
+
+
+def fetch(url, etag=None):
+    req = urllib.request.Request(url, headers={"Accept-Encoding": "gzip"})
+    if etag:
+        req.add_header("If-None-Match", etag)
+    try:
+        with urllib.request.urlopen(req, timeout=10) as resp:
+            return resp.status, resp.headers, resp.read()
+    except urllib.error.HTTPError as e:
+        if e.code == 304:
+            return 304, e.headers, b""
+        raise
+
+
+def body_text(headers, body):
+    if headers.get("Content-Encoding") == "gzip":
+        body = gzip.decompress(body)
+    return body.decode("utf-8", "replace")
+
+
+def load(base, cache):
+    """One page load. Returns (requests, bytes) and fills cache."""
+    requests = total = 0
+    queue, seen = [base], set()
+    while queue:
+        url = queue.pop(0)
+        if url in seen:
+            continue
+        seen.add(url)
+        entry = cache.get(url)
+        if entry and "immutable" in entry["cache"]:
+            print("  %-40s cached" % urllib.parse.urlparse(url).path)
+            continue
+        status, headers, body = fetch(url, entry and entry["etag"])
+        requests += 1
+        total += len(body)
+        print("  %-40s %d %6d bytes %s" % (urllib.parse.urlparse(url).path, status, len(body),
+                                           headers.get("Content-Encoding") or ""))
+        if status == 200:
+            entry = cache[url] = {"etag": headers.get("ETag"), "cache": headers.get("Cache-Control") or "",
+                                  "headers": headers, "body": body}
+        if entry and (entry["headers"].get("Content-Type") or "").startswith(("text/html", "text/css")):
+            for ref in REFS.findall(body_text(entry["headers"], entry["body"])):
+                queue.append(urllib.parse.urljoin(url, ref))
+    return requests, total
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("url", help="page URL, e.g. http://192.168.4.1/")
+    args = ap.parse_args()
+    cache = {}
+    print("first load:")
+    first = load(args.url, cache)
+    print("repeat load:")
+    repeat = load(args.url, cache)
+    print("first:  %d requests, %d bytes" % first)
+    print("repeat: %d requests, %d bytes" % repeat)
+    sys.exit(0 if repeat[1] < first[1] else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Load the device's WebSocket like a band's worth of phones.
+
+Opens N connections to /ws. The fast phones send binary control commands
+(next/prev while stopped) and time the ACKs; the slow phones stop reading
+their socket for a while, so their queue on the device backs up, then read
+everything and report how many snapshots reached them. With coalescing, a
+slow phone gets a handful of snapshots rather than one per broadcast.
+
+    python tools/ws_phones.py 192.168.4.1 --phones 20 --slow 4 --commands 50
+"""
+import argparse
+import base64
+import os
+import socket
+import statistics
+import struct
+import threading
+import time
+
+OP_PREV, OP_NEXT, OP_ACK = 0x01, 0x02, 0x80
+
+
+class WebSocket:
+    """Just enough of RFC 6455 for this test."""
+
+    def __init__(self, host, port, path="/ws"):
+        self.sock = socket.create_connection((host, port), timeout=10)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (path, host, key)).encode())
+        response = b""
+        while b"\r\n\r\n" not in response:
+            chunk = self.sock.recv(1024)
+            if not chunk:
+                raise ConnectionError("handshake closed")
+            response += chunk
+        if b" 101 " not in response.split(b"\r\n")[0]:
+            raise ConnectionError(response.split(b"\r\n")[0].decode())
+        self.buffer = response.split(b"\r\n\r\n", 1)[1]
+
+    def send(self, payload, opcode=0x2):
+        mask = os.urandom(4)
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        else:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.sock.sendall(header + mask + masked)
+
+    def _read(self, n):
+        while len(self.buffer) < n:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("closed")
+            self.buffer += chunk
+        data, self.buffer = self.buffer[:n], self.buffer[n:]
+        return data
+
+    def recv(self):
+        """Returns (opcode, payload) of the next message."""
+        b0, b1 = self._read(2)
+        length = b1 & 0x7F
+        if length == 126:
+            length, = struct.unpack(">H", self._read(2))
+        elif length == 127:
+            length, = struct.unpack(">Q", self._read(8))
+        return b0 & 0x0F, self._read(length)
+
+    def close(self):
+        self.sock.close()
+
+
+class Phone(threading.Thread):
+    def __init__(self, args, index, slow):
+        super().__init__(daemon=True)
+        self.args, self.index, self.slow = args, index, slow
+        self.ack_ms, self.statuses, self.snapshots, self.error = [], {}, 0, None
+
+    def run(self):
+        try:
+            ws = WebSocket(self.args.host, self.args.port)
+            if self.slow:
+                # Stop reading; the kernel buffers fill and the device queue grows.
+                time.sleep(self.args.stall)
+                ws.sock.settimeout(2)
+                try:
+                    while True:
+                        opcode, payload = ws.recv()
+                        if opcode == 0x1 and payload.startswith(b"{"):
+                            self.snapshots += 1
+                except (socket.timeout, ConnectionError):
+                    pass
+            else:
+                ws.sock.settimeout(5)
+                for n in range(self.args.commands):
+                    request_id = (self.index << 8 | n) & 0xFFFF or 1
+                    sent = time.monotonic()
+                    ws.send(bytes([OP_NEXT if n % 2 == 0 else OP_PREV, request_id & 0xFF, request_id >> 8]))
+                    while True:
+                        opcode, payload = ws.recv()
+                        if opcode == 0x1 and payload.startswith(b"{"):
+                            self.snapshots += 1
+                        elif opcode == 0x2 and payload[:1] == bytes([OP_ACK]) and \
+                                payload[1] | payload[2] << 8 == request_id:
+                            self.ack_ms.append((time.monotonic() - sent) * 1000)
+                            self.statuses[payload[3]] = self.statuses.get(payload[3], 0) + 1
+                            break
+                    time.sleep(self.args.interval)
+            ws.close()
+        except Exception as e:  # report per phone, keep the others running
+            self.error = e
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("host")
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("--phones", type=int, default=20)
+    ap.add_argument("--slow", type=int, default=4, help="phones that stop reading")
+    ap.add_argument("--commands", type=int, default=50, help="commands per fast phone")
+    ap.add_argument("--interval", type=float, default=0.05, help="seconds between commands")
+    ap.add_argument("--stall", type=float, default=10, help="seconds a slow phone stops reading")
+    args = ap.parse_args()
+
+    phones = [Phone(args, i + 1, i < args.slow) for i in range(args.phones)]
+    for p in phones:
+        p.start()
+        time.sleep(0.05)
+    for p in phones:
+        p.join()
+
+    acks = [ms for p in phones for ms in p.ack_ms]
+    broadcasts = max((p.snapshots for p in phones if not p.slow), default=0)
+    for p in phones:
+        kind = "slow" if p.slow else "fast"
+        detail = "error: %s" % p.error if p.error else "%d acks, %d snapshots" % (len(p.ack_ms), p.snapshots)
+        print("phone %2d %s  %s" % (p.index, kind, detail))
+    if acks:
+        acks.sort()
+        print("ack latency: median %.1f ms, p95 %.1f ms, max %.1f ms over %d commands" % (
+            statistics.median(acks), acks[int(len(acks) * 0.95)], acks[-1], len(acks)))
+    slow = [p.snapshots for p in phones if p.slow and not p.error]
+    if slow:
+        print("slow phones got %d-%d snapshots; fast phones saw up to %d" % (min(slow), max(slow), broadcasts))
+    print("%d of %d phones failed" % (sum(1 for p in phones if p.error), len(phones)))
+
+
+if __name__ == "__main__":
+    main()